@@ -19,6 +19,7 @@
 #include <stdexcept>
 #include <algorithm>
 #include <functional>
+#include <ctime>
 #if defined __GNUC__
 #include <cxxabi.h>
 #endif
@@ -28,6 +29,8 @@
 #include <QtDebug>
 #include <QMessageBox>
 #include <QMainWindow>
+#include <QElapsedTimer>
+#include <QDateTime>
 #include <util/util.h>
 #include <util/exceptions.h>
 #include <interfaces/iinfo.h>
@@ -47,6 +50,42 @@
 
 namespace LeechCraft
 {
+	namespace
+	{
+		/** Stores the wall and CPU time taken by an initialization stage
+		 * of a plugin in the given dynamic property of the plugin
+		 * instance object, as a QVariantList of the stage start time
+		 * (msecs since epoch), wall time and CPU time (both in usecs).
+		 *
+		 * Plugins may use these values to build their own startup
+		 * profiles.
+		 */
+		class InitStageTimer
+		{
+			QObject * const Plugin_;
+			const char * const Property_;
+			const qint64 StartMSecs_;
+			const std::clock_t StartCpu_;
+			QElapsedTimer Timer_;
+		public:
+			InitStageTimer (QObject *plugin, const char *property)
+			: Plugin_ (plugin)
+			, Property_ (property)
+			, StartMSecs_ (QDateTime::currentMSecsSinceEpoch ())
+			, StartCpu_ (std::clock ())
+			{
+				Timer_.start ();
+			}
+
+			~InitStageTimer ()
+			{
+				const qint64 cpu = static_cast<qint64> (std::clock () - StartCpu_) * 1000000 / CLOCKS_PER_SEC;
+				Plugin_->setProperty (Property_,
+						QVariantList () << StartMSecs_ << Timer_.nsecsElapsed () / 1000 << cpu);
+			}
+		};
+	}
+
 	PluginManager::PluginManager (const QStringList& pluginPaths, QObject *parent)
 	: QAbstractItemModel (parent)
 	, DefaultPluginIcon_ (QIcon (":/resources/images/defaultpluginicon.svg"))
@@ -323,7 +362,10 @@ namespace LeechCraft
 			{
 				qDebug () << "Initializing" << ii->GetName ();
 				emit loadProgress (tr ("Initializing %1: stage one...").arg (ii->GetName ()));
-				ii->Init (ICoreProxy_ptr (new CoreProxy ()));
+				{
+					InitStageTimer timer (obj, "LeechCraft/InitTimes/Init");
+					ii->Init (ICoreProxy_ptr (new CoreProxy ()));
+				}
 
 				const QString& path = GetPluginLibraryPath (obj);
 				if (path.isEmpty ())
@@ -416,6 +458,7 @@ namespace LeechCraft
 			try
 			{
 				emit loadProgress (tr ("Initializing %1: stage two...").arg (ii->GetName ()));
+				InitStageTimer timer (obj, "LeechCraft/InitTimes/SecondInit");
 				ii->SecondInit ();
 			}
 			catch (const std::exception& e)
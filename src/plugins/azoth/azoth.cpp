@@ -23,6 +23,9 @@
 #include <QVBoxLayout>
 #include <QMenu>
 #include <QStringListModel>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QDir>
 
 #ifdef ENABLE_MEDIACALLS
 #include <QAudioDeviceInfo>
@@ -51,6 +54,7 @@
 #include "chatstyleoptionmanager.h"
 #include "colorlisteditorwidget.h"
 #include "customstatusesmanager.h"
+#include "startupprofiler.h"
 
 namespace LeechCraft
 {
@@ -76,6 +80,8 @@ namespace Azoth
 
 	void Plugin::SecondInit ()
 	{
+		Core::Instance ().GetStartupProfiler ()->RegisterPlugin (this);
+
 		InitMW ();
 
 		XmlSettingsDialog_->SetDataSource ("SmileIcons",
@@ -334,6 +340,10 @@ namespace Azoth
 				SIGNAL (moreThisStuffRequested (const QString&)),
 				this,
 				SLOT (handleMoreThisStuff (const QString&)));
+		connect (XmlSettingsDialog_.get (),
+				SIGNAL (pushButtonClicked (QString)),
+				this,
+				SLOT (handlePushButton (QString)));
 
 		XmlSettingsDialog_->SetDataSource ("StatusIcons",
 				Core::Instance ().GetResourceLoader (Core::RLTStatusIconLoader)->
@@ -583,6 +593,25 @@ namespace Azoth
 		XmlSettingsManager::Instance ().setProperty ("MWFloating", floating);
 	}
 
+	void Plugin::handlePushButton (const QString& name)
+	{
+		if (name != "ExportStartupProfile")
+			return;
+
+		const auto& path = QFileDialog::getSaveFileName (0,
+				tr ("Export startup profile"),
+				QDir::homePath () + "/azoth_startup_trace.json",
+				tr ("Chrome trace files (*.json)"));
+		if (path.isEmpty ())
+			return;
+
+		if (!Core::Instance ().GetStartupProfiler ()->ExportChromeTrace (path))
+			QMessageBox::critical (0,
+					"LeechCraft",
+					tr ("Unable to export startup profile to %1.")
+						.arg (path));
+	}
+
 	void Plugin::handleMoreThisStuff (const QString& id)
 	{
 		QMap<QString, QStringList> id2tags;
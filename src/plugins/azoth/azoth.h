@@ -115,6 +115,7 @@ namespace Azoth
 		void handleMWLocation (Qt::DockWidgetArea);
 		void handleMWFloating (bool);
 		void handleMoreThisStuff (const QString&);
+		void handlePushButton (const QString&);
 		void handleConsoleWidget (ConsoleWidget*);
 	signals:
 		void gotEntity (const LeechCraft::Entity&);
@@ -29,6 +29,7 @@
 #include "interfaces/azoth/iaccount.h"
 #include "interfaces/azoth/iextselfinfoaccount.h"
 #include "core.h"
+#include "startupprofiler.h"
 #include "xmlsettingsmanager.h"
 #include "util.h"
 
@@ -74,6 +75,8 @@ namespace Azoth
 	void ContactListDelegate::paint (QPainter *painter,
 			const QStyleOptionViewItem& sopt, const QModelIndex& index) const
 	{
+		Core::Instance ().GetStartupProfiler ()->HandleCLRendered ();
+
 		QStyleOptionViewItemV4 o = sopt;
 		Core::CLEntryType type = index.data (Core::CLREntryType).value<Core::CLEntryType> ();
 
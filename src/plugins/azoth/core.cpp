@@ -78,6 +78,7 @@
 #include "chatstyleoptionmanager.h"
 #include "riexhandler.h"
 #include "customstatusesmanager.h"
+#include "startupprofiler.h"
 
 Q_DECLARE_METATYPE (QList<QColor>);
 Q_DECLARE_METATYPE (QPointer<QObject>);
@@ -205,6 +206,7 @@ namespace Azoth
 	, EventsNotifier_ (new EventsNotifier)
 	, ImportManager_ (new ImportManager)
 	, UnreadQueueManager_ (new UnreadQueueManager)
+	, StartupProfiler_ (new StartupProfiler)
 	{
 		FillANFields ();
 
@@ -361,6 +363,11 @@ namespace Azoth
 		return CustomStatusesManager_.get ();
 	}
 
+	StartupProfiler* Core::GetStartupProfiler () const
+	{
+		return StartupProfiler_.get ();
+	}
+
 	QSet<QByteArray> Core::GetExpectedPluginClasses () const
 	{
 		QSet<QByteArray> classes;
@@ -381,6 +388,13 @@ namespace Azoth
 			return;
 		}
 
+		StartupProfiler_->RegisterPlugin (plugin);
+
+		auto ii = qobject_cast<IInfo*> (plugin);
+		StartupProfiler::ScopedEvent profileEvent (StartupProfiler_.get (),
+				"register " + (ii ? ii->GetName () : plugin->metaObject ()->className ()),
+				"plugin");
+
 		QByteArray sig = QMetaObject::normalizedSignature ("initPlugin (QObject*)");
 		if (plugin->metaObject ()->indexOfMethod (sig) != -1)
 			QMetaObject::invokeMethod (plugin,
@@ -1865,6 +1879,9 @@ namespace Azoth
 		if (!pgp)
 			return;
 
+		StartupProfiler::ScopedEvent profileEvent (StartupProfiler_.get (),
+				"restore key for " + acc->GetAccountName (), "account");
+
 		QSettings settings (QCoreApplication::organizationName (),
 			QCoreApplication::applicationName () + "_Azoth");
 		settings.beginGroup ("PrivateKeys");
@@ -1974,6 +1991,9 @@ namespace Azoth
 			return;
 		}
 
+		StartupProfiler::ScopedEvent profileEvent (StartupProfiler_.get (),
+				"restore " + account->GetAccountName (), "account");
+
 		const auto& showKey = QString::fromUtf8 ("ShowAccount_" + account->GetAccountID ());
 		const bool show = XmlSettingsManager::Instance ().Property (showKey, true).toBool ();
 		account->SetShownInRoster (show);
@@ -2080,6 +2100,8 @@ namespace Azoth
 				EntryStatus s;
 				QDataStream stream (var.toByteArray ());
 				stream >> s;
+				if (s.State_ != SOffline)
+					StartupProfiler_->HandleAccountState (account, SConnecting);
 				account->ChangeState (s);
 			}
 			else
@@ -2265,6 +2287,7 @@ namespace Azoth
 		}
 
 		UpdateInitState (status.State_);
+		StartupProfiler_->HandleAccountState (acc, status.State_);
 
 		if (status.State_ == SOffline)
 			LastAccountStatusChange_.remove (acc);
@@ -73,6 +73,7 @@ namespace Azoth
 	class UnreadQueueManager;
 	class ChatStyleOptionManager;
 	class CustomStatusesManager;
+	class StartupProfiler;
 
 	class Core : public QObject
 	{
@@ -147,6 +148,7 @@ namespace Azoth
 		QMap<QByteArray, std::shared_ptr<ChatStyleOptionManager>> StyleOptionManagers_;
 		std::shared_ptr<Util::ShortcutManager> ShortcutManager_;
 		std::shared_ptr<CustomStatusesManager> CustomStatusesManager_;
+		std::shared_ptr<StartupProfiler> StartupProfiler_;
 
 		Core ();
 	public:
@@ -190,6 +192,7 @@ namespace Azoth
 		ChatStyleOptionManager* GetChatStylesOptionsManager (const QByteArray&) const;
 		Util::ShortcutManager* GetShortcutManager () const;
 		CustomStatusesManager* GetCustomStatusesManager () const;
+		StartupProfiler* GetStartupProfiler () const;
 
 		QSet<QByteArray> GetExpectedPluginClasses () const;
 		void AddPlugin (QObject*);
@@ -17,8 +17,12 @@
  **********************************************************************/
 
 #include "avatarsstorage.h"
-#include <util/util.h>
 #include <QTimer>
+#include <QBuffer>
+#include <QFile>
+#include <QtDebug>
+#include <util/util.h>
+#include "keyedstore.h"
 
 namespace LeechCraft
 {
@@ -26,48 +30,97 @@ namespace Azoth
 {
 namespace Xoox
 {
+	namespace
+	{
+		const int MaxStoredAvatars = 4000;
+	}
+
 	AvatarsStorage::AvatarsStorage (QObject *parent)
 	: QObject (parent)
+	, Decoded_ (16 * 1024 * 1024)
 	{
 		AvatarsDir_ = Util::CreateIfNotExists ("azoth/xoox/hashed_avatars");
+		Store_.reset (new KeyedStore (Util::CreateIfNotExists ("azoth/xoox").filePath ("avatars.lcks")));
 
 		QTimer::singleShot (30000, this, SLOT (collectOldAvatars ()));
 	}
 
+	AvatarsStorage::~AvatarsStorage ()
+	{
+	}
+
 	/** The clients are free to not call this function if they know the avatar is
-	 * already stored. That means that we should be beware of this when implementing
-	 * caching, if we'd ever do.
+	 * already stored, so the decoded cache is populated from GetAvatar() as
+	 * well.
 	 *
 	 * See EntryBase::SetVCard() for example.
 	 */
 	void AvatarsStorage::StoreAvatar (const QImage& image, const QByteArray& hash)
 	{
-		QFile file (AvatarsDir_.absoluteFilePath (hash));
-		if (file.exists () && file.size ())
+		if (Store_->Contains (hash))
 			return;
 
-		if (!file.open (QIODevice::WriteOnly | QIODevice::Truncate))
+		QByteArray data;
+		QBuffer buffer (&data);
+		buffer.open (QIODevice::WriteOnly);
+		if (!image.save (&buffer, "PNG", 100))
 		{
 			qWarning () << Q_FUNC_INFO
-					<< "unable to open file"
-					<< file.fileName ()
-					<< "for writing";
+					<< "unable to serialize avatar"
+					<< hash;
 			return;
 		}
 
-		image.save (&file, "PNG", 100);
+		Store_->Put (hash, data);
+		Decoded_.insert (hash, new QImage (image), image.byteCount ());
 	}
 
+	/** Decoded images are kept in an LRU cache bounded by their size in
+	 * bytes, so repeated lookups of the same avatar don't touch the
+	 * disk at all. Avatars stored in the legacy one-file-per-hash
+	 * directory are moved to the store on first access.
+	 */
 	QImage AvatarsStorage::GetAvatar (const QByteArray& hash) const
 	{
-		return QImage (AvatarsDir_.absoluteFilePath (hash));
+		if (const auto cached = Decoded_.object (hash))
+			return *cached;
+
+		QImage image;
+		if (Store_->Contains (hash))
+			image = QImage::fromData (Store_->Get (hash), "PNG");
+		else if (AvatarsDir_.exists (hash))
+		{
+			QFile file (AvatarsDir_.absoluteFilePath (hash));
+			if (file.open (QIODevice::ReadOnly))
+			{
+				const auto& data = file.readAll ();
+				image = QImage::fromData (data);
+				if (!image.isNull ())
+					Store_->Put (hash, data);
+				file.close ();
+				file.remove ();
+			}
+		}
+
+		if (!image.isNull ())
+			Decoded_.insert (hash, new QImage (image), image.byteCount ());
+
+		return image;
 	}
 
 	void AvatarsStorage::collectOldAvatars ()
 	{
 		auto list = AvatarsDir_.entryList (QDir::Files, QDir::Time | QDir::Reversed);
-		while (list.size () > 4000)
+		while (list.size () > MaxStoredAvatars)
 			AvatarsDir_.remove (list.takeLast ());
+
+		auto keys = Store_->GetKeys ();
+		if (keys.size () <= MaxStoredAvatars &&
+				Store_->GetGarbageSize () < Store_->GetFileSize () / 2)
+			return;
+
+		keys = keys.mid (qMax (0, keys.size () - MaxStoredAvatars));
+		Store_->Compact (keys);
 	}
 }
 }
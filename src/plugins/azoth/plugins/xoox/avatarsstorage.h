@@ -18,10 +18,11 @@
 
 #pragma once
 
+#include <memory>
 #include <QObject>
 #include <QDir>
-
-class QImage;
+#include <QCache>
+#include <QImage>
 
 namespace LeechCraft
 {
@@ -29,13 +30,18 @@ namespace Azoth
 {
 namespace Xoox
 {
+	class KeyedStore;
+
 	class AvatarsStorage : public QObject
 	{
 		Q_OBJECT
 
 		QDir AvatarsDir_;
+		std::unique_ptr<KeyedStore> Store_;
+		mutable QCache<QByteArray, QImage> Decoded_;
 	public:
 		AvatarsStorage (QObject* = 0);
+		~AvatarsStorage ();
 
 		void StoreAvatar (const QImage&, const QByteArray&);
 		QImage GetAvatar (const QByteArray&) const;
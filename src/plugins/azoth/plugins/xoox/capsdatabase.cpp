@@ -17,9 +17,12 @@
  **********************************************************************/
 
 #include "capsdatabase.h"
+#include <QDataStream>
+#include <QDir>
 #include <QFile>
 #include <QTimer>
 #include <util/util.h>
+#include "keyedstore.h"
 
 Q_DECLARE_METATYPE (QXmppDiscoveryIq::Identity);
 
@@ -64,64 +67,97 @@ namespace Azoth
 {
 namespace Xoox
 {
+	CapsDatabase::CapsEntry::CapsEntry ()
+	: HasFeatures_ (false)
+	, HasIdentities_ (false)
+	{
+	}
+
 	CapsDatabase::CapsDatabase (QObject *parent)
 	: QObject (parent)
 	, SaveScheduled_ (false)
 	{
 		qRegisterMetaType<QXmppDiscoveryIq::Identity> ("QXmppDiscoveryIq::Identity");
 		qRegisterMetaTypeStreamOperators<QXmppDiscoveryIq::Identity> ("QXmppDiscoveryIq::Identity");
-		Load ();
+
+		const QDir dir = Util::CreateIfNotExists ("azoth/xoox");
+		const bool existed = dir.exists ("caps.lcks");
+		Store_.reset (new KeyedStore (dir.filePath ("caps.lcks")));
+		if (!existed)
+			MigrateLegacy ();
+	}
+
+	CapsDatabase::~CapsDatabase ()
+	{
+		if (SaveScheduled_)
+			save ();
 	}
 
 	bool CapsDatabase::Contains (const QByteArray& hash) const
 	{
-		return Ver2Features_.contains (hash) &&
-				Ver2Identities_.contains (hash);
+		if (!Entries_.contains (hash) && !Store_->Contains (hash))
+			return false;
+
+		const auto& entry = GetEntry (hash);
+		return entry.HasFeatures_ && entry.HasIdentities_;
 	}
 
 	QStringList CapsDatabase::Get (const QByteArray& hash) const
 	{
-		return Ver2Features_ [hash];
+		return GetEntry (hash).Features_;
 	}
 
 	void CapsDatabase::Set (const QByteArray& hash, const QStringList& features)
 	{
-		Ver2Features_ [hash] = features;
+		GetEntry (hash);
+
+		auto& entry = Entries_ [hash];
+		entry.Features_ = features;
+		entry.HasFeatures_ = true;
+
+		Dirty_ << hash;
 		ScheduleSave ();
 	}
 
 	QList<QXmppDiscoveryIq::Identity> CapsDatabase::GetIdentities (const QByteArray& hash) const
 	{
-		return Ver2Identities_ [hash];
+		return GetEntry (hash).Identities_;
 	}
 
 	void CapsDatabase::SetIdentities (const QByteArray& hash,
 			const QList<QXmppDiscoveryIq::Identity>& ids)
 	{
-		Ver2Identities_ [hash] = ids;
+		GetEntry (hash);
+
+		auto& entry = Entries_ [hash];
+		entry.Identities_ = ids;
+		entry.HasIdentities_ = true;
+
+		Dirty_ << hash;
 		ScheduleSave ();
 	}
 
-	void CapsDatabase::save () const
+	void CapsDatabase::save ()
 	{
-		QDir dir = Util::CreateIfNotExists ("azoth/xoox");
-		QFile file (dir.filePath ("caps_s.db"));
-		if (!file.open (QIODevice::WriteOnly | QIODevice::Truncate))
+		SaveScheduled_ = false;
+
+		for (const auto& hash : Dirty_)
 		{
-			qWarning () << Q_FUNC_INFO
-					<< "unable to open file"
-					<< file.fileName ()
-					<< "for writing:"
-					<< file.errorString ();
-			return;
-		}
+			const auto& entry = Entries_ [hash];
 
-		QDataStream stream (&file);
-		stream << static_cast<quint8> (2)
-				<< Ver2Features_
-				<< Ver2Identities_;
+			QByteArray data;
+			QDataStream stream (&data, QIODevice::WriteOnly);
+			stream << static_cast<quint8> (1)
+					<< entry.HasFeatures_
+					<< entry.Features_
+					<< entry.HasIdentities_
+					<< entry.Identities_;
+			Store_->Put (hash, data);
+		}
+		Dirty_.clear ();
 
-		SaveScheduled_ = false;
+		if (Store_->GetGarbageSize () > Store_->GetFileSize () / 2)
+			Store_->Compact (Store_->GetKeys ());
 	}
 
 	void CapsDatabase::ScheduleSave ()
@@ -135,10 +171,44 @@ namespace Xoox
 				SLOT (save ()));
 	}
 
-	void CapsDatabase::Load ()
+	const CapsDatabase::CapsEntry& CapsDatabase::GetEntry (const QByteArray& hash) const
+	{
+		if (Entries_.contains (hash))
+			return Entries_ [hash];
+
+		auto& entry = Entries_ [hash];
+
+		const auto& data = Store_->Get (hash);
+		if (data.isEmpty ())
+			return entry;
+
+		QDataStream stream (data);
+		quint8 ver = 0;
+		stream >> ver;
+		if (ver != 1)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unknown entry version"
+					<< ver
+					<< "for"
+					<< hash;
+			return entry;
+		}
+
+		stream >> entry.HasFeatures_
+				>> entry.Features_
+				>> entry.HasIdentities_
+				>> entry.Identities_;
+		return entry;
+	}
+
+	void CapsDatabase::MigrateLegacy ()
 	{
 		QDir dir = Util::CreateIfNotExists ("azoth/xoox");
 		QFile file (dir.filePath ("caps_s.db"));
+		if (!file.exists ())
+			return;
+
 		if (!file.open (QIODevice::ReadOnly))
 		{
 			qWarning () << Q_FUNC_INFO
@@ -149,6 +219,9 @@ namespace Xoox
 			return;
 		}
 
+		QHash<QByteArray, QStringList> ver2features;
+		QHash<QByteArray, QList<QXmppDiscoveryIq::Identity>> ver2identities;
+
 		QDataStream stream (&file);
 		quint8 ver = 0;
 		stream >> ver;
@@ -157,9 +230,31 @@ namespace Xoox
 					<< "unknown storage version"
 					<< ver;
 		if (ver >= 1)
-			stream >> Ver2Features_;
+			stream >> ver2features;
 		if (ver >= 2)
-			stream >> Ver2Identities_;
+			stream >> ver2identities;
+
+		for (auto i = ver2features.begin (), end = ver2features.end (); i != end; ++i)
+		{
+			auto& entry = Entries_ [i.key ()];
+			entry.Features_ = i.value ();
+			entry.HasFeatures_ = true;
+			Dirty_ << i.key ();
+		}
+
+		for (auto i = ver2identities.begin (), end = ver2identities.end (); i != end; ++i)
+		{
+			auto& entry = Entries_ [i.key ()];
+			entry.Identities_ = i.value ();
+			entry.HasIdentities_ = true;
+			Dirty_ << i.key ();
+		}
+
+		save ();
+		Entries_.clear ();
+
+		file.close ();
+		file.remove ();
 	}
 }
 }
@@ -18,8 +18,10 @@
 
 #pragma once
 
+#include <memory>
 #include <QObject>
 #include <QHash>
+#include <QSet>
 #include <QStringList>
 #include <QXmppDiscoveryIq.h>
 
@@ -29,15 +31,34 @@ namespace Azoth
 {
 namespace Xoox
 {
+	class KeyedStore;
+
+	/** Caps are kept in a KeyedStore, and only the entries that are
+	 * actually requested are decoded and kept in memory. Changed
+	 * entries are appended to the store on save instead of rewriting
+	 * the whole database.
+	 */
 	class CapsDatabase : public QObject
 	{
 		Q_OBJECT
 
-		QHash<QByteArray, QStringList> Ver2Features_;
-		QHash<QByteArray, QList<QXmppDiscoveryIq::Identity>> Ver2Identities_;
+		struct CapsEntry
+		{
+			bool HasFeatures_;
+			bool HasIdentities_;
+			QStringList Features_;
+			QList<QXmppDiscoveryIq::Identity> Identities_;
+
+			CapsEntry ();
+		};
+
+		std::unique_ptr<KeyedStore> Store_;
+		mutable QHash<QByteArray, CapsEntry> Entries_;
+		QSet<QByteArray> Dirty_;
 		mutable bool SaveScheduled_;
 	public:
 		CapsDatabase (QObject* = 0);
+		~CapsDatabase ();
 
 		bool Contains (const QByteArray&) const;
 		QStringList Get (const QByteArray&) const;
@@ -45,10 +66,11 @@ namespace Xoox
 		QList<QXmppDiscoveryIq::Identity> GetIdentities (const QByteArray&) const;
 		void SetIdentities (const QByteArray&, const QList<QXmppDiscoveryIq::Identity>&);
 	private slots:
-		void save () const;
+		void save ();
 	private:
 		void ScheduleSave ();
-		void Load ();
+		const CapsEntry& GetEntry (const QByteArray&) const;
+		void MigrateLegacy ();
 	};
 }
 }
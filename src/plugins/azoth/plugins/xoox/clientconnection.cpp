@@ -76,6 +76,7 @@
 #include "serverinfostorage.h"
 #include "xmlsettingsmanager.h"
 #include "inforequestpolicymanager.h"
+#include "connectbatcher.h"
 
 namespace LeechCraft
 {
@@ -117,6 +118,19 @@ namespace Xoox
 	, ProxyObject_ (0)
 	, CapsManager_ (new CapsManager (this))
 	, ServerInfoStorage_ (new ServerInfoStorage (this, Settings_))
+	, ConnectBatcher_ (new ConnectBatcher ([this] (const QStringList& jids)
+				{ HandleRosterChanges (jids); },
+				[this] (const QList<QXmppPresence>& presences)
+				{
+					for (const auto& pres : presences)
+					{
+						QString jid;
+						QString resource;
+						Split (pres.from (), &jid, &resource);
+						HandleContactPresence (pres, jid, resource);
+					}
+				},
+				this))
 	, IsConnected_ (false)
 	, FirstTimeConnect_ (true)
 	, VCardQueue_ (new FetchQueue ([this] (QString str, bool report)
@@ -556,6 +570,11 @@ namespace Xoox
 		return ServerInfoStorage_;
 	}
 
+	ConnectBatcher* ClientConnection::GetConnectBatcher () const
+	{
+		return ConnectBatcher_;
+	}
+
 	void ClientConnection::SetSignaledLog (bool signaled)
 	{
 		if (signaled)
@@ -893,6 +912,9 @@ namespace Xoox
 	void ClientConnection::handleConnected ()
 	{
 		IsConnected_ = true;
+		if (XmlSettingsManager::Instance ().property ("BatchConnectPhase").toBool ())
+			ConnectBatcher_->Start ();
+
 		emit statusChanged (EntryStatus (LastState_.State_, LastState_.Status_));
 
 		Client_->vCardManager ().requestVCard (OurBareJID_);
@@ -913,6 +935,7 @@ namespace Xoox
 
 	void ClientConnection::handleDisconnected ()
 	{
+		ConnectBatcher_->Abort ();
 		emit statusChanged (EntryStatus (SOffline, LastState_.Status_));
 	}
 
@@ -938,6 +961,8 @@ namespace Xoox
 		}
 		emit gotRosterItems (items);
 
+		ConnectBatcher_->HandleRosterReceived (items.size ());
+
 		Q_FOREACH (const QXmppMessage& msg, OfflineMsgQueue_)
 			handleMessageReceived (msg);
 		OfflineMsgQueue_.clear ();
@@ -953,25 +978,17 @@ namespace Xoox
 
 	void ClientConnection::handleRosterChanged (const QString& bareJid)
 	{
-		QXmppRosterManager& rm = Client_->rosterManager ();
-		QMap<QString, QXmppPresence> presences = rm.getAllPresencesForBareJid (bareJid);
-
-		if (!JID2CLEntry_.contains (bareJid))
-			emit gotRosterItems (QObjectList () << CreateCLEntry (bareJid));
-
-		GlooxCLEntry *entry = JID2CLEntry_ [bareJid];
-		Q_FOREACH (const QString& resource, presences.keys ())
-		{
-			const QXmppPresence& pres = presences [resource];
-			entry->SetClientInfo (resource, pres);
-			entry->SetStatus (XooxUtil::PresenceToStatus (pres), resource, pres);
-		}
-		entry->UpdateRI (rm.getRosterEntry (bareJid));
+		if (ConnectBatcher_->IsActive ())
+			ConnectBatcher_->AddRosterChange (bareJid);
+		else
+			HandleRosterChanges (QStringList (bareJid));
 	}
 
 	void ClientConnection::handleRosterItemRemoved (const QString& bareJid)
 	{
 		qDebug () << "RosterItemRemoved" << bareJid;
+		ConnectBatcher_->RemoveRosterChange (bareJid);
+
 		if (!JID2CLEntry_.contains (bareJid))
 			return;
 
@@ -1046,17 +1063,11 @@ namespace Xoox
 
 			return;
 		}
-		else if (!JID2CLEntry_.contains (jid))
-		{
-			if (ODSEntries_.contains (jid))
-				ConvertFromODS (jid, Client_->rosterManager ().getRosterEntry (jid));
-			else
-				return;
-		}
-
-		JID2CLEntry_ [jid]->HandlePresence (pres, resource);
 
-		CryptHandler_->HandlePresence (pres, jid, resource);
+		if (ConnectBatcher_->IsActive ())
+			ConnectBatcher_->AddPresence (pres);
+		else
+			HandleContactPresence (pres, jid, resource);
 	}
 
 	namespace
@@ -1312,6 +1323,48 @@ namespace Xoox
 		}
 	}
 
+	void ClientConnection::HandleContactPresence (const QXmppPresence& pres,
+			const QString& jid, const QString& resource)
+	{
+		if (!JID2CLEntry_.contains (jid))
+		{
+			if (ODSEntries_.contains (jid))
+				ConvertFromODS (jid, Client_->rosterManager ().getRosterEntry (jid));
+			else
+				return;
+		}
+
+		JID2CLEntry_ [jid]->HandlePresence (pres, resource);
+
+		CryptHandler_->HandlePresence (pres, jid, resource);
+	}
+
+	void ClientConnection::HandleRosterChanges (const QStringList& bareJids)
+	{
+		QXmppRosterManager& rm = Client_->rosterManager ();
+
+		QObjectList newItems;
+		Q_FOREACH (const QString& bareJid, bareJids)
+		{
+			if (!JID2CLEntry_.contains (bareJid))
+				newItems << CreateCLEntry (bareJid);
+
+			GlooxCLEntry *entry = JID2CLEntry_ [bareJid];
+
+			const QMap<QString, QXmppPresence>& presences = rm.getAllPresencesForBareJid (bareJid);
+			Q_FOREACH (const QString& resource, presences.keys ())
+			{
+				const QXmppPresence& pres = presences [resource];
+				entry->SetClientInfo (resource, pres);
+				entry->SetStatus (XooxUtil::PresenceToStatus (pres), resource, pres);
+			}
+			entry->UpdateRI (rm.getRosterEntry (bareJid));
+		}
+
+		if (!newItems.isEmpty ())
+			emit gotRosterItems (newItems);
+	}
+
 	/** @todo Handle action reasons in QXmppPresence::Subscribe and
 	 * QXmppPresence::Unsubscribe cases.
 	 */
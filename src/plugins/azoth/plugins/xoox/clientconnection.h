@@ -79,6 +79,7 @@ namespace Xoox
 	class ClientConnectionErrorMgr;
 	class CryptHandler;
 	class ServerInfoStorage;
+	class ConnectBatcher;
 
 	class ClientConnection : public QObject
 	{
@@ -127,6 +128,8 @@ namespace Xoox
 
 		ServerInfoStorage *ServerInfoStorage_;
 
+		ConnectBatcher *ConnectBatcher_;
+
 		QHash<QString, GlooxCLEntry*> JID2CLEntry_;
 		QHash<QString, GlooxCLEntry*> ODSEntries_;
 
@@ -208,6 +211,7 @@ namespace Xoox
 
 		CryptHandler* GetCryptHandler () const;
 		ServerInfoStorage* GetServerInfoStorage () const;
+		ConnectBatcher* GetConnectBatcher () const;
 
 		void SetSignaledLog (bool);
 
@@ -254,6 +258,8 @@ namespace Xoox
 	private:
 		void SetupLogger ();
 		void HandleOtherPresence (const QXmppPresence&);
+		void HandleContactPresence (const QXmppPresence&, const QString&, const QString&);
+		void HandleRosterChanges (const QStringList&);
 		void HandleRIEX (QString, QList<RIEXManager::Item>, QString = QString ());
 		void InvokeCallbacks (const QXmppIq&);
 	public slots:
@@ -0,0 +1,231 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "connectbatcher.h"
+#include <QTimer>
+#include <QtDebug>
+
+namespace LeechCraft
+{
+namespace Azoth
+{
+namespace Xoox
+{
+	namespace
+	{
+		const int FlushInterval = 20;
+		const int SettleInterval = 1500;
+		const int MaxPhaseDuration = 30000;
+	}
+
+	ConnectBatcher::Stats::Stats ()
+	: RosterReceivedMs_ (-1)
+	, FinishedMs_ (-1)
+	, FlushTimeMs_ (0)
+	, RosterItems_ (0)
+	, PresencesReceived_ (0)
+	, PresencesApplied_ (0)
+	, RosterChanges_ (0)
+	, Flushes_ (0)
+	{
+	}
+
+	ConnectBatcher::ConnectBatcher (RosterHandler_f rosterHandler,
+			PresencesHandler_f presencesHandler, QObject *parent)
+	: QObject (parent)
+	, RosterHandler_ (rosterHandler)
+	, PresencesHandler_ (presencesHandler)
+	, FlushTimer_ (new QTimer (this))
+	, SettleTimer_ (new QTimer (this))
+	, DeadlineTimer_ (new QTimer (this))
+	, IsActive_ (false)
+	, RosterReceived_ (false)
+	{
+		FlushTimer_->setSingleShot (true);
+		FlushTimer_->setInterval (FlushInterval);
+		connect (FlushTimer_,
+				SIGNAL (timeout ()),
+				this,
+				SLOT (flush ()));
+
+		SettleTimer_->setSingleShot (true);
+		SettleTimer_->setInterval (SettleInterval);
+		connect (SettleTimer_,
+				SIGNAL (timeout ()),
+				this,
+				SLOT (finish ()));
+
+		DeadlineTimer_->setSingleShot (true);
+		DeadlineTimer_->setInterval (MaxPhaseDuration);
+		connect (DeadlineTimer_,
+				SIGNAL (timeout ()),
+				this,
+				SLOT (finish ()));
+	}
+
+	bool ConnectBatcher::IsActive () const
+	{
+		return IsActive_;
+	}
+
+	void ConnectBatcher::Start ()
+	{
+		Abort ();
+
+		IsActive_ = true;
+		Stats_ = Stats ();
+		Elapsed_.start ();
+		DeadlineTimer_->start ();
+	}
+
+	void ConnectBatcher::Abort ()
+	{
+		IsActive_ = false;
+		RosterReceived_ = false;
+
+		FlushTimer_->stop ();
+		SettleTimer_->stop ();
+		DeadlineTimer_->stop ();
+
+		PendingPresences_.clear ();
+		PendingRosterChanges_.clear ();
+		PendingRosterChangesSet_.clear ();
+	}
+
+	void ConnectBatcher::HandleRosterReceived (int items)
+	{
+		if (!IsActive_)
+			return;
+
+		RosterReceived_ = true;
+		Stats_.RosterItems_ = items;
+		Stats_.RosterReceivedMs_ = Elapsed_.elapsed ();
+
+		flush ();
+		SettleTimer_->start ();
+	}
+
+	void ConnectBatcher::AddPresence (const QXmppPresence& pres)
+	{
+		PendingPresences_ [pres.from ()] = pres;
+		++Stats_.PresencesReceived_;
+
+		ScheduleFlush ();
+	}
+
+	void ConnectBatcher::AddRosterChange (const QString& bareJid)
+	{
+		++Stats_.RosterChanges_;
+		if (!PendingRosterChangesSet_.contains (bareJid))
+		{
+			PendingRosterChangesSet_ << bareJid;
+			PendingRosterChanges_ << bareJid;
+		}
+
+		ScheduleFlush ();
+	}
+
+	void ConnectBatcher::RemoveRosterChange (const QString& bareJid)
+	{
+		if (PendingRosterChangesSet_.remove (bareJid))
+			PendingRosterChanges_.removeOne (bareJid);
+	}
+
+	ConnectBatcher::Stats ConnectBatcher::GetStats () const
+	{
+		return Stats_;
+	}
+
+	void ConnectBatcher::ScheduleFlush ()
+	{
+		if (!RosterReceived_)
+			return;
+
+		SettleTimer_->start ();
+		if (!FlushTimer_->isActive ())
+			FlushTimer_->start ();
+	}
+
+	void ConnectBatcher::flush ()
+	{
+		if (!RosterReceived_ ||
+				(PendingRosterChanges_.isEmpty () && PendingPresences_.isEmpty ()))
+			return;
+
+		QElapsedTimer flushTimer;
+		flushTimer.start ();
+
+		const auto rosterChanges = PendingRosterChanges_;
+		PendingRosterChanges_.clear ();
+		PendingRosterChangesSet_.clear ();
+
+		const auto presences = PendingPresences_.values ();
+		PendingPresences_.clear ();
+
+		if (!rosterChanges.isEmpty ())
+			RosterHandler_ (rosterChanges);
+		if (!presences.isEmpty ())
+			PresencesHandler_ (presences);
+
+		++Stats_.Flushes_;
+		Stats_.PresencesApplied_ += presences.size ();
+		Stats_.FlushTimeMs_ += flushTimer.elapsed ();
+	}
+
+	void ConnectBatcher::finish ()
+	{
+		if (!IsActive_)
+			return;
+
+		// Past the deadline the queue is applied even if the roster
+		// hasn't been received.
+		RosterReceived_ = true;
+		flush ();
+
+		Stats_.FinishedMs_ = Elapsed_.elapsed ();
+
+		qDebug () << Q_FUNC_INFO
+				<< "connect phase finished in"
+				<< Stats_.FinishedMs_
+				<< "ms; roster of"
+				<< Stats_.RosterItems_
+				<< "items received at"
+				<< Stats_.RosterReceivedMs_
+				<< "ms;"
+				<< Stats_.PresencesReceived_
+				<< "presences and"
+				<< Stats_.RosterChanges_
+				<< "roster pushes handled in"
+				<< Stats_.Flushes_
+				<< "batches taking"
+				<< Stats_.FlushTimeMs_
+				<< "ms total,"
+				<< Stats_.PresencesApplied_
+				<< "presences applied after coalescing";
+
+		IsActive_ = false;
+		RosterReceived_ = false;
+		SettleTimer_->stop ();
+		FlushTimer_->stop ();
+		DeadlineTimer_->stop ();
+
+		emit finished ();
+	}
+}
+}
+}
@@ -0,0 +1,117 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#pragma once
+
+#include <functional>
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QElapsedTimer>
+#include <QXmppPresence.h>
+
+class QTimer;
+
+namespace LeechCraft
+{
+namespace Azoth
+{
+namespace Xoox
+{
+	/** @brief Accumulates roster pushes and presences right after login.
+	 *
+	 * While active, roster changes and contact presences are queued
+	 * instead of being handled one by one. The queue is flushed at most
+	 * once per FlushInterval, applying only the latest presence for each
+	 * full JID. Nothing is flushed before the roster itself is received.
+	 *
+	 * The batcher finishes once no presences arrive for SettleInterval
+	 * after the roster has been received, or after MaxPhaseDuration
+	 * since Start() in any case, so a roster that never arrives doesn't
+	 * hold the queued items back forever.
+	 */
+	class ConnectBatcher : public QObject
+	{
+		Q_OBJECT
+	public:
+		typedef std::function<void (const QStringList&)> RosterHandler_f;
+		typedef std::function<void (const QList<QXmppPresence>&)> PresencesHandler_f;
+
+		struct Stats
+		{
+			qint64 RosterReceivedMs_;
+			qint64 FinishedMs_;
+			qint64 FlushTimeMs_;
+
+			int RosterItems_;
+			int PresencesReceived_;
+			int PresencesApplied_;
+			int RosterChanges_;
+			int Flushes_;
+
+			Stats ();
+		};
+	private:
+		const RosterHandler_f RosterHandler_;
+		const PresencesHandler_f PresencesHandler_;
+
+		QTimer *FlushTimer_;
+		QTimer *SettleTimer_;
+		QTimer *DeadlineTimer_;
+
+		bool IsActive_;
+		bool RosterReceived_;
+
+		QElapsedTimer Elapsed_;
+		Stats Stats_;
+
+		QHash<QString, QXmppPresence> PendingPresences_;
+		QStringList PendingRosterChanges_;
+		QSet<QString> PendingRosterChangesSet_;
+	public:
+		ConnectBatcher (RosterHandler_f, PresencesHandler_f, QObject* = 0);
+
+		bool IsActive () const;
+
+		void Start ();
+		void Abort ();
+
+		void HandleRosterReceived (int);
+
+		void AddPresence (const QXmppPresence&);
+		void AddRosterChange (const QString&);
+
+		/** Drops the queued roster change for the given bare JID, if
+		 * any, so that a contact removed in the meantime doesn't get
+		 * recreated by the next flush.
+		 */
+		void RemoveRosterChange (const QString&);
+
+		Stats GetStats () const;
+	private:
+		void ScheduleFlush ();
+	private slots:
+		void flush ();
+		void finish ();
+	signals:
+		void finished ();
+	};
+}
+}
+}
@@ -0,0 +1,340 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "keyedstore.h"
+#include <algorithm>
+#include <QtEndian>
+#include <QtDebug>
+
+namespace LeechCraft
+{
+namespace Azoth
+{
+namespace Xoox
+{
+	namespace
+	{
+		const QByteArray Magic = "LCKS";
+		const quint32 StoreVersion = 1;
+
+		const qint64 FileHeaderSize = 8;
+		const qint64 RecordHeaderSize = 8;
+
+		QByteArray MakeFileHeader ()
+		{
+			QByteArray result = Magic;
+			result.resize (FileHeaderSize);
+			qToBigEndian (StoreVersion, reinterpret_cast<uchar*> (result.data () + Magic.size ()));
+			return result;
+		}
+
+		QByteArray MakeRecordHeader (quint32 keySize, quint32 valueSize)
+		{
+			QByteArray result (RecordHeaderSize, 0);
+			auto data = reinterpret_cast<uchar*> (result.data ());
+			qToBigEndian (keySize, data);
+			qToBigEndian (valueSize, data + 4);
+			return result;
+		}
+	}
+
+	KeyedStore::KeyedStore (const QString& path)
+	: File_ (path)
+	, Map_ (0)
+	, MapSize_ (0)
+	, Garbage_ (0)
+	{
+		Open ();
+	}
+
+	KeyedStore::~KeyedStore ()
+	{
+		Unmap ();
+	}
+
+	bool KeyedStore::IsValid () const
+	{
+		return File_.isOpen ();
+	}
+
+	bool KeyedStore::Contains (const QByteArray& key) const
+	{
+		return Index_.contains (key);
+	}
+
+	QByteArray KeyedStore::Get (const QByteArray& key)
+	{
+		if (!Index_.contains (key))
+			return QByteArray ();
+
+		const auto& rec = Index_ [key];
+		if (rec.Offset_ + rec.Size_ > MapSize_)
+			Remap ();
+
+		if (Map_ && rec.Offset_ + rec.Size_ <= MapSize_)
+			return QByteArray (reinterpret_cast<const char*> (Map_ + rec.Offset_), rec.Size_);
+
+		if (!File_.seek (rec.Offset_))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to seek to"
+					<< rec.Offset_
+					<< "in"
+					<< File_.fileName ();
+			return QByteArray ();
+		}
+		return File_.read (rec.Size_);
+	}
+
+	void KeyedStore::Put (const QByteArray& key, const QByteArray& value)
+	{
+		if (!IsValid ())
+			return;
+
+		const qint64 pos = File_.size ();
+		if (!File_.seek (pos))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to seek to the end of"
+					<< File_.fileName ();
+			return;
+		}
+
+		if (File_.write (MakeRecordHeader (key.size (), value.size ())) != RecordHeaderSize ||
+				File_.write (key) != key.size () ||
+				File_.write (value) != value.size ())
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to write record to"
+					<< File_.fileName ()
+					<< File_.errorString ();
+			File_.resize (pos);
+			return;
+		}
+		File_.flush ();
+
+		if (Index_.contains (key))
+			Garbage_ += RecordHeaderSize + key.size () + Index_ [key].Size_;
+
+		Index_ [key] = { pos + RecordHeaderSize + key.size (), static_cast<quint32> (value.size ()) };
+	}
+
+	int KeyedStore::GetCount () const
+	{
+		return Index_.size ();
+	}
+
+	QList<QByteArray> KeyedStore::GetKeys () const
+	{
+		auto keys = Index_.keys ();
+		std::sort (keys.begin (), keys.end (),
+				[this] (const QByteArray& left, const QByteArray& right)
+					{ return Index_ [left].Offset_ < Index_ [right].Offset_; });
+		return keys;
+	}
+
+	qint64 KeyedStore::GetGarbageSize () const
+	{
+		return Garbage_;
+	}
+
+	qint64 KeyedStore::GetFileSize () const
+	{
+		return File_.size ();
+	}
+
+	void KeyedStore::Compact (const QList<QByteArray>& keep)
+	{
+		if (!IsValid ())
+			return;
+
+		QFile newFile (File_.fileName () + ".new");
+		if (!newFile.open (QIODevice::WriteOnly | QIODevice::Truncate))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to open"
+					<< newFile.fileName ()
+					<< "for writing:"
+					<< newFile.errorString ();
+			return;
+		}
+
+		bool ok = newFile.write (MakeFileHeader ()) == FileHeaderSize;
+		for (auto i = keep.begin (), end = keep.end (); ok && i != end; ++i)
+		{
+			const auto& key = *i;
+			if (!Index_.contains (key))
+				continue;
+
+			const auto& value = Get (key);
+			ok = newFile.write (MakeRecordHeader (key.size (), value.size ())) == RecordHeaderSize &&
+					newFile.write (key) == key.size () &&
+					newFile.write (value) == value.size ();
+		}
+		ok = newFile.flush () && ok;
+		newFile.close ();
+		if (!ok || newFile.error () != QFile::NoError)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to write the compacted copy to"
+					<< newFile.fileName ()
+					<< newFile.errorString ();
+			newFile.remove ();
+			return;
+		}
+
+		const auto& path = File_.fileName ();
+		const auto& backupPath = path + ".old";
+		QFile::remove (backupPath);
+
+		Unmap ();
+		File_.close ();
+
+		// The old file is kept as a backup until the compacted copy is
+		// in place, so a failed rename doesn't lose the whole store.
+		if (!File_.rename (backupPath))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to back up"
+					<< path
+					<< File_.errorString ();
+			newFile.remove ();
+		}
+		else if (!newFile.rename (path))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to replace"
+					<< path
+					<< "with the compacted copy:"
+					<< newFile.errorString ();
+			newFile.remove ();
+			File_.rename (path);
+		}
+		else
+		{
+			QFile::remove (backupPath);
+			File_.setFileName (path);
+		}
+
+		Open ();
+	}
+
+	void KeyedStore::Open ()
+	{
+		Index_.clear ();
+		Garbage_ = 0;
+
+		if (!File_.open (QIODevice::ReadWrite))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to open file"
+					<< File_.fileName ()
+					<< File_.errorString ();
+			return;
+		}
+
+		if (File_.size () < FileHeaderSize)
+		{
+			File_.resize (0);
+			File_.write (MakeFileHeader ());
+			File_.flush ();
+			return;
+		}
+
+		const auto& header = File_.read (FileHeaderSize);
+		if (!header.startsWith (Magic) ||
+				qFromBigEndian<quint32> (reinterpret_cast<const uchar*> (header.constData () + 4)) != StoreVersion)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unknown storage format in"
+					<< File_.fileName ()
+					<< "; starting from scratch";
+			File_.resize (0);
+			File_.close ();
+			Open ();
+			return;
+		}
+
+		BuildIndex ();
+	}
+
+	void KeyedStore::BuildIndex ()
+	{
+		if (!Remap ())
+			return;
+
+		qint64 pos = FileHeaderSize;
+		while (pos + RecordHeaderSize <= MapSize_)
+		{
+			const auto keySize = qFromBigEndian<quint32> (Map_ + pos);
+			const auto valueSize = qFromBigEndian<quint32> (Map_ + pos + 4);
+			const qint64 end = pos + RecordHeaderSize + keySize + valueSize;
+			if (end > MapSize_)
+				break;
+
+			const QByteArray key (reinterpret_cast<const char*> (Map_ + pos + RecordHeaderSize), keySize);
+			if (Index_.contains (key))
+				Garbage_ += RecordHeaderSize + keySize + Index_ [key].Size_;
+			Index_ [key] = { pos + RecordHeaderSize + keySize, valueSize };
+
+			pos = end;
+		}
+
+		if (pos != MapSize_)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< File_.fileName ()
+					<< "has a truncated record at"
+					<< pos
+					<< "; dropping it";
+			Unmap ();
+			File_.resize (pos);
+			Remap ();
+		}
+	}
+
+	bool KeyedStore::Remap ()
+	{
+		Unmap ();
+
+		MapSize_ = File_.size ();
+		Map_ = File_.map (0, MapSize_);
+		if (!Map_)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to map"
+					<< File_.fileName ()
+					<< File_.errorString ();
+			MapSize_ = 0;
+			return false;
+		}
+
+		return true;
+	}
+
+	void KeyedStore::Unmap ()
+	{
+		if (Map_)
+			File_.unmap (Map_);
+
+		Map_ = 0;
+		MapSize_ = 0;
+	}
+}
+}
+}
@@ -0,0 +1,86 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#pragma once
+
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QByteArray>
+
+namespace LeechCraft
+{
+namespace Azoth
+{
+namespace Xoox
+{
+	/** @brief Append-only keyed blob storage backed by a single file.
+	 *
+	 * Records are never rewritten in place: storing a value for an
+	 * already known key just appends a new record, and the index is
+	 * updated to point to it. Only record headers are walked on open,
+	 * values are read from the memory-mapped file on demand.
+	 *
+	 * The file is compacted via Compact() once the amount of stale
+	 * records gets too large.
+	 */
+	class KeyedStore
+	{
+		struct Record
+		{
+			qint64 Offset_;
+			quint32 Size_;
+		};
+
+		QFile File_;
+		uchar *Map_;
+		qint64 MapSize_;
+
+		QHash<QByteArray, Record> Index_;
+		qint64 Garbage_;
+	public:
+		KeyedStore (const QString& path);
+		~KeyedStore ();
+
+		bool IsValid () const;
+
+		bool Contains (const QByteArray&) const;
+		QByteArray Get (const QByteArray&);
+		void Put (const QByteArray&, const QByteArray&);
+
+		int GetCount () const;
+		QList<QByteArray> GetKeys () const;
+
+		qint64 GetGarbageSize () const;
+		qint64 GetFileSize () const;
+
+		/** @brief Rewrites the storage keeping only the given keys.
+		 *
+		 * The keys are written in the given order, which is then used as
+		 * the storage order as returned by GetKeys().
+		 */
+		void Compact (const QList<QByteArray>& keep);
+	private:
+		void Open ();
+		void BuildIndex ();
+		bool Remap ();
+		void Unmap ();
+	};
+}
+}
+}
@@ -0,0 +1,243 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "startupprofiler.h"
+#include <QDateTime>
+#include <QFile>
+#include <QStringList>
+#include <QtDebug>
+#include <interfaces/iinfo.h>
+#include "interfaces/azoth/iaccount.h"
+
+namespace LeechCraft
+{
+namespace Azoth
+{
+	namespace
+	{
+		qint64 GetNowUs ()
+		{
+			return QDateTime::currentMSecsSinceEpoch () * 1000;
+		}
+
+		qint64 GetCpuUs (std::clock_t start)
+		{
+			return static_cast<qint64> (std::clock () - start) * 1000000 / CLOCKS_PER_SEC;
+		}
+
+		QString Escape (QString str)
+		{
+			str.replace ('\\', "\\\\");
+			str.replace ('"', "\\\"");
+			str.replace ('\n', "\\n");
+			str.replace ('\t', "\\t");
+			return '"' + str + '"';
+		}
+
+		QString Serialize (const QVariant& var)
+		{
+			switch (var.type ())
+			{
+			case QVariant::Int:
+			case QVariant::UInt:
+			case QVariant::LongLong:
+			case QVariant::ULongLong:
+			case QVariant::Double:
+				return var.toString ();
+			case QVariant::Bool:
+				return var.toBool () ? "true" : "false";
+			default:
+				return Escape (var.toString ());
+			}
+		}
+	}
+
+	StartupProfiler::ScopedEvent::ScopedEvent (StartupProfiler *profiler,
+			const QString& name, const QString& category)
+	: Profiler_ (profiler)
+	, StartCpu_ (std::clock ())
+	{
+		Event_.Name_ = name;
+		Event_.Category_ = category;
+		Event_.Lane_ = LMain;
+		Event_.StartUs_ = GetNowUs ();
+		Event_.IsInstant_ = false;
+
+		Timer_.start ();
+	}
+
+	StartupProfiler::ScopedEvent::~ScopedEvent ()
+	{
+		Event_.WallUs_ = Timer_.nsecsElapsed () / 1000;
+		Event_.CpuUs_ = GetCpuUs (StartCpu_);
+		Profiler_->AddEvent (Event_);
+	}
+
+	StartupProfiler::StartupProfiler (QObject *parent)
+	: QObject (parent)
+	, CLRendered_ (false)
+	{
+	}
+
+	void StartupProfiler::AddEvent (const Event& event)
+	{
+		Events_ << event;
+	}
+
+	void StartupProfiler::RegisterPlugin (QObject *plugin)
+	{
+		if (!Plugins_.contains (plugin))
+			Plugins_ << plugin;
+	}
+
+	void StartupProfiler::HandleAccountState (IAccount *acc, State state)
+	{
+		auto accObj = acc->GetQObject ();
+		if (ConnectedAccounts_.contains (accObj))
+			return;
+
+		switch (state)
+		{
+		case SOffline:
+		case SError:
+			ConnectStarts_.remove (accObj);
+			return;
+		case SConnecting:
+			if (!ConnectStarts_.contains (accObj))
+				ConnectStarts_ [accObj] = GetNowUs ();
+			return;
+		default:
+			break;
+		}
+
+		if (!ConnectStarts_.contains (accObj))
+			return;
+
+		ConnectedAccounts_ << accObj;
+
+		const qint64 start = ConnectStarts_.take (accObj);
+
+		Event e;
+		e.Name_ = "connect " + acc->GetAccountName ();
+		e.Category_ = "account";
+		e.Lane_ = LConnect;
+		e.StartUs_ = start;
+		e.WallUs_ = GetNowUs () - start;
+		e.CpuUs_ = -1;
+		e.IsInstant_ = false;
+		AddEvent (e);
+	}
+
+	void StartupProfiler::HandleCLRendered ()
+	{
+		if (CLRendered_)
+			return;
+
+		CLRendered_ = true;
+
+		Event e;
+		e.Name_ = "first contact list render";
+		e.Category_ = "render";
+		e.Lane_ = LMain;
+		e.StartUs_ = GetNowUs ();
+		e.WallUs_ = 0;
+		e.CpuUs_ = -1;
+		e.IsInstant_ = true;
+		AddEvent (e);
+	}
+
+	QList<StartupProfiler::Event> StartupProfiler::GetEvents () const
+	{
+		auto result = Events_;
+
+		auto addStage = [&result] (QObject *plugin, const char *prop, const QString& stage)
+		{
+			const auto& list = plugin->property (prop).toList ();
+			if (list.size () != 3)
+				return;
+
+			auto ii = qobject_cast<IInfo*> (plugin);
+
+			Event e;
+			e.Name_ = (ii ? ii->GetName () : plugin->metaObject ()->className ()) + ' ' + stage;
+			e.Category_ = "plugin";
+			e.Lane_ = LMain;
+			e.StartUs_ = list.at (0).toLongLong () * 1000;
+			e.WallUs_ = list.at (1).toLongLong ();
+			e.CpuUs_ = list.at (2).toLongLong ();
+			e.IsInstant_ = false;
+			result << e;
+		};
+
+		for (auto plugin : Plugins_)
+		{
+			addStage (plugin, "LeechCraft/InitTimes/Init", "Init");
+			addStage (plugin, "LeechCraft/InitTimes/SecondInit", "SecondInit");
+		}
+
+		return result;
+	}
+
+	QByteArray StartupProfiler::ExportChromeTrace () const
+	{
+		QStringList events;
+		for (const auto& e : GetEvents ())
+		{
+			auto args = e.Args_;
+			if (e.CpuUs_ >= 0)
+				args ["cpu_us"] = e.CpuUs_;
+
+			QStringList argsStrs;
+			for (auto i = args.begin (), end = args.end (); i != end; ++i)
+				argsStrs << Escape (i.key ()) + ":" + Serialize (i.value ());
+
+			QString str = QString ("{\"name\":%1,\"cat\":%2,\"pid\":1,\"tid\":%3,\"ts\":%4,")
+					.arg (Escape (e.Name_))
+					.arg (Escape (e.Category_))
+					.arg (static_cast<int> (e.Lane_))
+					.arg (e.StartUs_);
+			if (e.IsInstant_)
+				str += "\"ph\":\"i\",\"s\":\"p\",";
+			else
+				str += QString ("\"ph\":\"X\",\"dur\":%1,").arg (e.WallUs_);
+			str += "\"args\":{" + argsStrs.join (",") + "}}";
+
+			events << str;
+		}
+
+		return "{\"traceEvents\":[\n" + events.join (",\n").toUtf8 () + "\n],\"displayTimeUnit\":\"ms\"}\n";
+	}
+
+	bool StartupProfiler::ExportChromeTrace (const QString& path) const
+	{
+		QFile file (path);
+		if (!file.open (QIODevice::WriteOnly | QIODevice::Truncate))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to open"
+					<< path
+					<< "for writing:"
+					<< file.errorString ();
+			return false;
+		}
+
+		file.write (ExportChromeTrace ());
+		return true;
+	}
+}
+}
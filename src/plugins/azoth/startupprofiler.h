@@ -0,0 +1,109 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#pragma once
+
+#include <ctime>
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QVariantMap>
+#include <QElapsedTimer>
+#include "interfaces/azoth/azothcommon.h"
+
+namespace LeechCraft
+{
+namespace Azoth
+{
+	class IAccount;
+
+	/** @brief Collects timings of Azoth startup stages.
+	 *
+	 * Recorded stages include the Init()/SecondInit() of Azoth and its
+	 * subplugins (as measured by the LeechCraft core), subplugin
+	 * registration, account restore and connection, and the first
+	 * contact list render.
+	 *
+	 * The collected data can be exported in the Chrome trace event
+	 * format, viewable in chrome://tracing.
+	 */
+	class StartupProfiler : public QObject
+	{
+		Q_OBJECT
+	public:
+		enum Lane
+		{
+			LMain = 1,
+			LConnect
+		};
+
+		struct Event
+		{
+			QString Name_;
+			QString Category_;
+			Lane Lane_;
+
+			qint64 StartUs_;
+			qint64 WallUs_;
+			qint64 CpuUs_;
+
+			bool IsInstant_;
+
+			QVariantMap Args_;
+		};
+
+		/** @brief Records the lifetime of the object as a single event.
+		 */
+		class ScopedEvent
+		{
+			StartupProfiler * const Profiler_;
+			Event Event_;
+			const std::clock_t StartCpu_;
+			QElapsedTimer Timer_;
+
+			ScopedEvent (const ScopedEvent&) = delete;
+			ScopedEvent& operator= (const ScopedEvent&) = delete;
+		public:
+			ScopedEvent (StartupProfiler*, const QString& name, const QString& category);
+			~ScopedEvent ();
+		};
+	private:
+		QList<Event> Events_;
+		QObjectList Plugins_;
+
+		QHash<QObject*, qint64> ConnectStarts_;
+		QSet<QObject*> ConnectedAccounts_;
+
+		bool CLRendered_;
+	public:
+		StartupProfiler (QObject* = 0);
+
+		void AddEvent (const Event&);
+
+		void RegisterPlugin (QObject*);
+
+		void HandleAccountState (IAccount*, State);
+		void HandleCLRendered ();
+
+		QList<Event> GetEvents () const;
+
+		QByteArray ExportChromeTrace () const;
+		bool ExportChromeTrace (const QString&) const;
+	};
+}
+}
@@ -0,0 +1,212 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "albumthumbnailcache.h"
+#include <functional>
+#include <QFileInfo>
+#include <QImage>
+#include <QImageReader>
+#include <QCryptographicHash>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
+#include <QtDebug>
+#include <util/util.h>
+
+namespace LeechCraft
+{
+namespace LMP
+{
+	namespace
+	{
+		struct LoadResult
+		{
+			QImage Image_;
+			bool FromDisk_;
+		};
+
+		LoadResult LoadThumbnail (const QString& path, int size, const QString& thumbPath)
+		{
+			const QFileInfo srcInfo (path);
+			if (!srcInfo.exists ())
+				return { QImage (), false };
+
+			const QFileInfo thumbInfo (thumbPath);
+			if (thumbInfo.exists () &&
+					thumbInfo.lastModified () >= srcInfo.lastModified ())
+			{
+				const QImage image (thumbPath);
+				if (!image.isNull ())
+					return { image, true };
+			}
+
+			/* Let the reader downscale the image while decoding if it
+			 * can (JPEG decoders can do that quite cheaply), leaving
+			 * some headroom for the smooth scaling pass.
+			 */
+			QImageReader reader (path);
+			const auto& origSize = reader.size ();
+			if (origSize.isValid () &&
+					(origSize.width () > size * 2 || origSize.height () > size * 2))
+				reader.setScaledSize (origSize.scaled (size * 2, size * 2, Qt::KeepAspectRatio));
+
+			auto image = reader.read ();
+			if (image.isNull ())
+				return { QImage (), false };
+
+			image = image.scaled (size, size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+			if (!image.save (thumbPath, "PNG"))
+				qWarning () << Q_FUNC_INFO
+						<< "unable to save thumbnail"
+						<< thumbPath;
+
+			return { image, false };
+		}
+
+		QString MakeKey (const QString& path, int size)
+		{
+			return QString::number (size) + ':' + path;
+		}
+
+		QString KeyToPath (const QString& key)
+		{
+			return key.mid (key.indexOf (':') + 1);
+		}
+
+		QString HashPath (const QString& path)
+		{
+			return QCryptographicHash::hash (path.toUtf8 (), QCryptographicHash::Sha1).toHex ();
+		}
+	}
+
+	AlbumThumbnailCache::AlbumThumbnailCache (QObject *parent)
+	: QObject (parent)
+	, ThumbsDir_ (Util::CreateIfNotExists ("lmp/thumbnails"))
+	, MemCache_ (16 * 1024 * 1024)
+	, Stats_ ()
+	{
+	}
+
+	QPixmap AlbumThumbnailCache::GetThumbnail (const QString& path, int size)
+	{
+		if (path.isEmpty () || size <= 0 || Failed_.contains (path))
+			return QPixmap ();
+
+		const auto& key = MakeKey (path, size);
+		if (auto px = MemCache_.object (key))
+		{
+			++Stats_.MemHits_;
+			return *px;
+		}
+
+		++Stats_.MemMisses_;
+
+		if (Pending_.contains (key))
+			return QPixmap ();
+
+		Pending_ << key;
+
+		const auto& thumbPath = GetThumbPath (path, size);
+		auto watcher = new QFutureWatcher<LoadResult> ();
+		watcher->setProperty ("Key", key);
+		watcher->setProperty ("Size", size);
+		connect (watcher,
+				SIGNAL (finished ()),
+				this,
+				SLOT (handleThumbnailLoaded ()));
+		auto worker = [path, size, thumbPath] () { return LoadThumbnail (path, size, thumbPath); };
+		watcher->setFuture (QtConcurrent::run (std::function<LoadResult ()> (worker)));
+
+		return QPixmap ();
+	}
+
+	void AlbumThumbnailCache::Invalidate (const QString& path)
+	{
+		Failed_.remove (path);
+
+		for (auto i = Pending_.begin (); i != Pending_.end (); )
+			if (KeyToPath (*i) == path)
+				i = Pending_.erase (i);
+			else
+				++i;
+
+		for (const auto& key : MemCache_.keys ())
+			if (KeyToPath (key) == path)
+				MemCache_.remove (key);
+
+		const auto& mask = HashPath (path) + "_*.png";
+		for (const auto& name : ThumbsDir_.entryList (QStringList (mask), QDir::Files))
+			ThumbsDir_.remove (name);
+	}
+
+	void AlbumThumbnailCache::SetMemoryBudget (int bytes)
+	{
+		MemCache_.setMaxCost (bytes);
+	}
+
+	AlbumThumbnailCache::Stats AlbumThumbnailCache::GetStats () const
+	{
+		auto stats = Stats_;
+		stats.MemUsed_ = MemCache_.totalCost ();
+		stats.MemBudget_ = MemCache_.maxCost ();
+		return stats;
+	}
+
+	QString AlbumThumbnailCache::GetThumbPath (const QString& path, int size) const
+	{
+		return ThumbsDir_.absoluteFilePath (QString ("%1_%2.png")
+					.arg (HashPath (path))
+					.arg (size));
+	}
+
+	void AlbumThumbnailCache::handleThumbnailLoaded ()
+	{
+		auto watcher = dynamic_cast<QFutureWatcher<LoadResult>*> (sender ());
+		if (!watcher)
+			return;
+
+		watcher->deleteLater ();
+
+		const auto& key = watcher->property ("Key").toString ();
+		const int size = watcher->property ("Size").toInt ();
+		const auto& path = KeyToPath (key);
+
+		// The thumbnail has been invalidated while it was being loaded.
+		if (!Pending_.remove (key))
+			return;
+
+		const auto& result = watcher->result ();
+		if (result.Image_.isNull ())
+		{
+			++Stats_.Failures_;
+			Failed_ << path;
+			return;
+		}
+
+		if (result.FromDisk_)
+			++Stats_.DiskHits_;
+		else
+			++Stats_.Decodes_;
+
+		const auto& image = result.Image_;
+		const int cost = image.width () * image.height () * image.depth () / 8;
+		MemCache_.insert (key, new QPixmap (QPixmap::fromImage (image)), cost);
+
+		emit thumbnailReady (path, size);
+	}
+}
+}
@@ -0,0 +1,78 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#pragma once
+
+#include <QObject>
+#include <QDir>
+#include <QCache>
+#include <QSet>
+#include <QPixmap>
+
+namespace LeechCraft
+{
+namespace LMP
+{
+	/** Cache of scaled album art thumbnails.
+	 *
+	 * Thumbnails are decoded and scaled in the thread pool and are
+	 * kept both on disk and in a memory cache limited by the given
+	 * number of bytes. GetThumbnail() never blocks: it returns a null
+	 * pixmap if the thumbnail isn't ready yet, and thumbnailReady() is
+	 * emitted once it is.
+	 */
+	class AlbumThumbnailCache : public QObject
+	{
+		Q_OBJECT
+
+		const QDir ThumbsDir_;
+
+		QCache<QString, QPixmap> MemCache_;
+		QSet<QString> Pending_;
+		QSet<QString> Failed_;
+	public:
+		struct Stats
+		{
+			quint64 MemHits_;
+			quint64 MemMisses_;
+			quint64 DiskHits_;
+			quint64 Decodes_;
+			quint64 Failures_;
+
+			int MemUsed_;
+			int MemBudget_;
+		};
+	private:
+		Stats Stats_;
+	public:
+		AlbumThumbnailCache (QObject* = 0);
+
+		QPixmap GetThumbnail (const QString& path, int size);
+		void Invalidate (const QString& path);
+
+		void SetMemoryBudget (int bytes);
+		Stats GetStats () const;
+	private:
+		QString GetThumbPath (const QString& path, int size) const;
+	private slots:
+		void handleThumbnailLoaded ();
+	signals:
+		void thumbnailReady (const QString& path, int size);
+	};
+}
+}
@@ -310,7 +310,7 @@ namespace LMP
 		if (info.LocalPath_.isEmpty ())
 			return;
 
-		QMutexLocker tlLocker (&Core::Instance ().GetLocalFileResolver ()->GetMutex ());
+		QMutexLocker tlLocker (&Core::Instance ().GetLocalFileResolver ()->GetMutex (info.LocalPath_));
 
 		auto r = Core::Instance ().GetLocalFileResolver ()->GetFileRef (info.LocalPath_);
 		auto tag = r.tag ();
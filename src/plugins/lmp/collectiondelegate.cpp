@@ -19,7 +19,10 @@
 #include "collectiondelegate.h"
 #include <QPainter>
 #include <QApplication>
+#include <QAbstractItemView>
 #include "localcollection.h"
+#include "albumthumbnailcache.h"
+#include "core.h"
 
 namespace LeechCraft
 {
@@ -31,8 +34,12 @@ namespace LMP
 	CollectionDelegate::CollectionDelegate (QObject *parent)
 	: QStyledItemDelegate (parent)
 	, DefaultAlbum_ (QIcon::fromTheme ("media-optical").pixmap (64, 64))
-	, PXCache_ (100000)
+	, Thumbnails_ (Core::Instance ().GetLocalCollection ()->GetAlbumThumbnailCache ())
 	{
+		connect (Thumbnails_,
+				SIGNAL (thumbnailReady (QString, int)),
+				this,
+				SLOT (handleThumbnailReady ()));
 	}
 
 	void CollectionDelegate::paint (QPainter *painter,
@@ -67,14 +74,9 @@ namespace LMP
 		const int maxIconHeight = option.rect.height () - Padding * 2;
 
 		const QString& path = index.data (LocalCollection::Role::AlbumArt).value<QString> ();
-		QPixmap *cached = PXCache_ [path];
-		QPixmap px = cached ? *cached : QPixmap (path);
-		const bool special = !px.isNull ();
-		if (!special)
-			px = DefaultAlbum_;
-		px = px.scaled (maxIconHeight, maxIconHeight, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-		if (!cached && special)
-			PXCache_.insert (path, new QPixmap (px), px.size ().width () * px.size ().height ());
+		auto px = Thumbnails_->GetThumbnail (path, maxIconHeight);
+		if (px.isNull ())
+			px = GetDefaultAlbum (maxIconHeight);
 
 		painter->drawPixmap (option.rect.left () + Padding, option.rect.top () + Padding, px);
 
@@ -85,5 +87,19 @@ namespace LMP
 
 		painter->restore ();
 	}
+
+	QPixmap CollectionDelegate::GetDefaultAlbum (int size) const
+	{
+		if (!ScaledDefaultAlbums_.contains (size))
+			ScaledDefaultAlbums_ [size] = DefaultAlbum_.scaled (size, size,
+					Qt::KeepAspectRatio, Qt::SmoothTransformation);
+		return ScaledDefaultAlbums_ [size];
+	}
+
+	void CollectionDelegate::handleThumbnailReady ()
+	{
+		if (auto view = qobject_cast<QAbstractItemView*> (parent ()))
+			view->viewport ()->update ();
+	}
 }
 }
@@ -19,17 +19,22 @@
 #pragma once
 
 #include <QStyledItemDelegate>
-#include <QPixmapCache>
-#include <QCache>
+#include <QHash>
 
 namespace LeechCraft
 {
 namespace LMP
 {
+	class AlbumThumbnailCache;
+
 	class CollectionDelegate : public QStyledItemDelegate
 	{
+		Q_OBJECT
+
 		const QPixmap DefaultAlbum_;
-		mutable QCache<QString, QPixmap> PXCache_;
+		mutable QHash<int, QPixmap> ScaledDefaultAlbums_;
+
+		AlbumThumbnailCache * const Thumbnails_;
 	public:
 		CollectionDelegate (QObject* = 0);
 
@@ -37,6 +42,9 @@ namespace LMP
 		QSize sizeHint (const QStyleOptionViewItem&, const QModelIndex&) const;
 	private:
 		void PaintAlbum (QPainter*, const QStyleOptionViewItem&, const QModelIndex&) const;
+		QPixmap GetDefaultAlbum (int size) const;
+	private slots:
+		void handleThumbnailReady ();
 	};
 }
 }
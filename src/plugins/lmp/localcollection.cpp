@@ -20,12 +20,16 @@
 #include <functional>
 #include <algorithm>
 #include <numeric>
+#include <memory>
 #include <QStandardItemModel>
 #include <QSortFilterProxyModel>
 #include <QMimeData>
 #include <QtConcurrentMap>
 #include <QtConcurrentRun>
 #include <QTimer>
+#include <QThread>
+#include <QAtomicInt>
+#include <QFileInfo>
 #include <QtDebug>
 #include <util/util.h>
 #include "localcollectionstorage.h"
@@ -34,6 +38,7 @@
 #include "localfileresolver.h"
 #include "player.h"
 #include "albumartmanager.h"
+#include "albumthumbnailcache.h"
 #include "xmlsettingsmanager.h"
 #include "localcollectionwatcher.h"
 #include "collectionsortermodel.h"
@@ -50,12 +55,48 @@ namespace LMP
 			if (type == LocalCollection::NodeType::Track)
 				return QStringList (index.data (LocalCollection::Role::TrackPath).toString ());
 
+			if (model->canFetchMore (index))
+				const_cast<QAbstractItemModel*> (model)->fetchMore (index);
+
 			QStringList paths;
 			for (int i = 0; i < model->rowCount (index); ++i)
 				paths += CollectPaths (model->index (i, 0, index), model);
 			return paths;
 		}
 
+		/** Artist items that haven't had their albums loaded yet carry
+		 * the artist ID in this role.
+		 */
+		const int UnloadedArtistRole = Qt::UserRole + 100;
+
+		class LazyCollectionModel : public QStandardItemModel
+		{
+			const std::function<void (int)> Loader_;
+		public:
+			LazyCollectionModel (const std::function<void (int)>& loader, QObject *parent)
+			: QStandardItemModel (parent)
+			, Loader_ (loader)
+			{
+			}
+
+			bool hasChildren (const QModelIndex& parent) const
+			{
+				return canFetchMore (parent) || QStandardItemModel::hasChildren (parent);
+			}
+
+			bool canFetchMore (const QModelIndex& parent) const
+			{
+				return parent.data (UnloadedArtistRole).isValid ();
+			}
+
+			void fetchMore (const QModelIndex& parent)
+			{
+				const auto& id = parent.data (UnloadedArtistRole);
+				if (id.isValid ())
+					Loader_ (id.toInt ());
+			}
+		};
+
 		class CollectionDraggableModel : public CollectionSorterModel
 		{
 		public:
@@ -93,10 +134,11 @@ namespace LMP
 	: QObject (parent)
 	, IsReady_ (false)
 	, Storage_ (new LocalCollectionStorage (this))
-	, CollectionModel_ (new QStandardItemModel (this))
+	, CollectionModel_ (new LazyCollectionModel ([this] (int id) { LoadArtist (id); }, this))
 	, Sorter_ (new CollectionDraggableModel (this))
 	, FilesWatcher_ (new LocalCollectionWatcher (this))
 	, AlbumArtMgr_ (new AlbumArtManager (this))
+	, ThumbnailCache_ (new AlbumThumbnailCache (this))
 	, Watcher_ (new QFutureWatcher<MediaInfo> (this))
 	, UpdateNewArtists_ (0)
 	, UpdateNewAlbums_ (0)
@@ -111,12 +153,19 @@ namespace LMP
 				this,
 				SIGNAL (scanProgressChanged (int)));
 
+		const bool lazy = XmlSettingsManager::Instance ()
+				.property ("LazyCollectionLoading").toBool ();
 		auto loadWatcher = new QFutureWatcher<LocalCollectionStorage::LoadResult> ();
+		loadWatcher->setProperty ("Lazy", lazy);
 		connect (loadWatcher,
 				SIGNAL (finished ()),
 				this,
 				SLOT (handleLoadFinished ()));
-		auto worker = [] () { return LocalCollectionStorage ().Load (); };
+		auto worker = [lazy] ()
+		{
+			LocalCollectionStorage storage;
+			return lazy ? storage.LoadArtists () : storage.Load ();
+		};
 		auto future = QtConcurrent::run (std::function<LocalCollectionStorage::LoadResult ()> (worker));
 		loadWatcher->setFuture (future);
 
@@ -149,6 +198,11 @@ namespace LMP
 		return AlbumArtMgr_;
 	}
 
+	AlbumThumbnailCache* LocalCollection::GetAlbumThumbnailCache () const
+	{
+		return ThumbnailCache_;
+	}
+
 	QAbstractItemModel* LocalCollection::GetCollectionModel () const
 	{
 		return Sorter_;
@@ -172,6 +226,7 @@ namespace LMP
 		Storage_->Clear ();
 		CollectionModel_->clear ();
 		Artists_.clear ();
+		UnloadedArtists_.clear ();
 		PresentPaths_.clear ();
 
 		Path2Track_.clear ();
@@ -186,6 +241,8 @@ namespace LMP
 		Track2Item_.clear ();
 
 		RemoveRootPaths (RootPaths_);
+
+		InvalidateSmartPlaylists ();
 	}
 
 	namespace
@@ -194,70 +251,165 @@ namespace LMP
 		{
 			QSet<QString> UnchangedFiles_;
 			QSet<QString> ChangedFiles_;
+			QSet<QString> RemovedFiles_;
 		};
+
+		QHash<QString, QDateTime> LoadMTimes (LocalCollectionStorage& storage, const QString& prefix)
+		{
+			try
+			{
+				return storage.GetMTimes (prefix);
+			}
+			catch (const std::exception& e)
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "error getting mtimes for"
+						<< prefix
+						<< e.what ();
+				return QHash<QString, QDateTime> ();
+			}
+		}
+
+		/** Moves the entries for the given infos from stored to either
+		 * result.UnchangedFiles_ or result.ChangedFiles_, recording the
+		 * new mtimes of the latter in changed.
+		 */
+		void DiffMTimes (const QList<QFileInfo>& infos, QHash<QString, QDateTime>& stored,
+				QHash<QString, QDateTime>& changed, IterateResult& result)
+		{
+			for (const auto& info : infos)
+			{
+				const auto& trackPath = info.absoluteFilePath ();
+				const auto& mtime = info.lastModified ();
+
+				const auto& storedDt = stored.take (trackPath);
+				if (storedDt.isValid () &&
+						std::abs (storedDt.msecsTo (mtime)) < 1500)
+				{
+					result.UnchangedFiles_ << trackPath;
+					continue;
+				}
+
+				changed [trackPath] = mtime;
+				result.ChangedFiles_ << trackPath;
+			}
+		}
+
+		void StoreMTimes (LocalCollectionStorage& storage, const QHash<QString, QDateTime>& changed)
+		{
+			try
+			{
+				storage.SetMTimes (changed);
+			}
+			catch (const std::exception& e)
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "error setting mtimes"
+						<< e.what ();
+			}
+		}
+
+		QString DirPrefix (const QString& path)
+		{
+			if (path.endsWith ('/') || !QFileInfo (path).isDir ())
+				return path;
+
+			return path + '/';
+		}
+
+		void RunIterate (QObject *collection, const std::function<IterateResult ()>& worker)
+		{
+			auto watcher = new QFutureWatcher<IterateResult> ();
+			QObject::connect (watcher,
+					SIGNAL (finished ()),
+					collection,
+					SLOT (handleIterateFinished ()));
+			watcher->setFuture (QtConcurrent::run (worker));
+		}
 	}
 
 	void LocalCollection::Scan (const QString& path, bool root)
 	{
-		auto watcher = new QFutureWatcher<IterateResult> ();
-		connect (watcher,
-				SIGNAL (finished ()),
-				this,
-				SLOT (handleIterateFinished ()));
-		watcher->setProperty ("Path", path);
-		watcher->setProperty ("IsRoot", root);
-
 		if (root)
 			AddRootPaths (QStringList (path));
 
 		const bool symLinks = XmlSettingsManager::Instance ()
 				.property ("FollowSymLinks").toBool ();
-		auto worker = [path, symLinks] () -> IterateResult
-		{
-			IterateResult result;
+		RunIterate (this, [path, symLinks] () -> IterateResult
+			{
+				IterateResult result;
 
-			LocalCollectionStorage storage;
+				LocalCollectionStorage storage;
+				auto stored = LoadMTimes (storage, DirPrefix (path));
+
+				QHash<QString, QDateTime> changed;
+				DiffMTimes (RecIterateInfo (path, symLinks), stored, changed, result);
+				StoreMTimes (storage, changed);
+
+				result.RemovedFiles_ = QSet<QString>::fromList (stored.keys ());
+
+				return result;
+			});
+	}
 
-			const auto& allInfos = RecIterateInfo (path, symLinks);
-			for (const auto& info : allInfos)
+	void LocalCollection::UpdateFiles (const QStringList& paths)
+	{
+		const bool symLinks = XmlSettingsManager::Instance ()
+				.property ("FollowSymLinks").toBool ();
+		RunIterate (this, [paths, symLinks] () -> IterateResult
 			{
-				const auto& trackPath = info.absoluteFilePath ();
-				const auto& mtime = info.lastModified ();
-				try
-				{
-					const auto& storedDt = storage.GetMTime (trackPath);
-					if (storedDt.isValid () &&
-							std::abs (storedDt.msecsTo (mtime)) < 1500)
-					{
-						result.UnchangedFiles_ << trackPath;
-						continue;
-					}
-				}
-				catch (const std::exception& e)
-				{
-					qWarning () << Q_FUNC_INFO
-							<< "error getting mtime"
-							<< trackPath
-							<< e.what ();
-				}
+				IterateResult result;
+
+				LocalCollectionStorage storage;
 
-				try
+				QHash<QString, QDateTime> changed;
+				for (const auto& path : paths)
 				{
-					storage.SetMTime (trackPath, mtime);
+					auto stored = LoadMTimes (storage, DirPrefix (path));
+					DiffMTimes (RecIterateInfo (path, symLinks), stored, changed, result);
 				}
-				catch (const std::exception& e)
+				StoreMTimes (storage, changed);
+
+				return result;
+			});
+	}
+
+	void LocalCollection::RescanDirs (const QStringList& dirs)
+	{
+		const bool symLinks = XmlSettingsManager::Instance ()
+				.property ("FollowSymLinks").toBool ();
+		RunIterate (this, [dirs, symLinks] () -> IterateResult
+			{
+				IterateResult result;
+
+				LocalCollectionStorage storage;
+
+				QHash<QString, QDateTime> changed;
+				for (const auto& dir : dirs)
 				{
-					qWarning () << Q_FUNC_INFO
-							<< "error setting mtime"
-							<< trackPath
-							<< e.what ();
+					const auto& prefix = dir + '/';
+					auto stored = LoadMTimes (storage, prefix);
+					DiffMTimes (DirIterateInfo (dir, symLinks), stored, changed, result);
+
+					for (const auto& path : stored.keys ())
+						if (path.indexOf ('/', prefix.size ()) == -1)
+							result.RemovedFiles_ << path;
 				}
-				result.ChangedFiles_ << trackPath;
-			}
+				StoreMTimes (storage, changed);
 
-			return result;
-		};
-		watcher->setFuture (QtConcurrent::run (worker));
+				return result;
+			});
+	}
+
+	void LocalCollection::RemoveFiles (const QStringList& paths)
+	{
+		for (const auto& path : paths)
+		{
+			RemoveTrack (path);
+
+			for (const auto& subPath : LoadMTimes (*Storage_, path + '/').keys ())
+				RemoveTrack (subPath);
+		}
 	}
 
 	void LocalCollection::Unscan (const QString& path)
@@ -265,10 +417,7 @@ namespace LMP
 		if (!RootPaths_.contains (path))
 			return;
 
-		QStringList toRemove;
-		auto pred = [&path] (const QString& subPath) { return subPath.startsWith (path); };
-		std::copy_if (PresentPaths_.begin (), PresentPaths_.end (),
-				std::back_inserter (toRemove), pred);
+		const auto& toRemove = LoadMTimes (*Storage_, path).keys ();
 		PresentPaths_.subtract (QSet<QString>::fromList (toRemove));
 
 		try
@@ -325,6 +474,8 @@ namespace LMP
 
 	int LocalCollection::FindAlbum (const QString& artist, const QString& album) const
 	{
+		EnsureArtistLoaded (FindArtist (artist));
+
 		auto artistPos = std::find_if (Artists_.begin (), Artists_.end (),
 				[&artist] (decltype (Artists_.front ()) item) { return item.Name_ == artist; });
 		if (artistPos == Artists_.end ())
@@ -340,6 +491,9 @@ namespace LMP
 
 	void LocalCollection::SetAlbumArt (int id, const QString& path)
 	{
+		// The new cover may have been saved over the old one.
+		ThumbnailCache_->Invalidate (path);
+
 		if (Album2Item_.contains (id))
 			Album2Item_ [id]->setData (path, Role::AlbumArt);
 
@@ -351,11 +505,36 @@ namespace LMP
 
 	Collection::Album_ptr LocalCollection::GetAlbum (int albumId) const
 	{
+		EnsureAlbumLoaded (albumId);
 		return AlbumID2Album_ [albumId];
 	}
 
 	int LocalCollection::FindTrack (const QString& path) const
 	{
+		const auto pos = Path2Track_.find (path);
+		if (pos != Path2Track_.end ())
+			return *pos;
+
+		if (UnloadedArtists_.isEmpty ())
+			return -1;
+
+		try
+		{
+			const auto& ids = Storage_->FindTrack (path);
+			if (ids.first == -1)
+				return -1;
+
+			EnsureArtistLoaded (ids.second);
+		}
+		catch (const std::exception& e)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "error looking up"
+					<< path
+					<< e.what ();
+			return -1;
+		}
+
 		return Path2Track_.value (path, -1);
 	}
 
@@ -373,12 +552,10 @@ namespace LMP
 	QList<int> LocalCollection::GetDynamicPlaylist (DynamicPlaylist type) const
 	{
 		QList<int> result;
-		const auto& keys = Track2Path_.keys ();
 		switch (type)
 		{
 		case DynamicPlaylist::Random50:
-			for (int i = 0; i < 50; ++i)
-				result << keys [qrand () % keys.size ()];
+			result = Storage_->GetRandomTracks (50);
 			break;
 		case DynamicPlaylist::LovedTracks:
 			result = Storage_->GetLovedTracks ();
@@ -390,11 +567,76 @@ namespace LMP
 		return result;
 	}
 
+	QList<int> LocalCollection::GetSmartPlaylist (const SmartPlaylist& rules) const
+	{
+		const auto& key = rules.GetKey ();
+		const auto& now = QDateTime::currentDateTime ();
+
+		// Time-based rules have day granularity, an hour is fine.
+		const auto pos = SmartPlaylists_.find (key);
+		if (pos != SmartPlaylists_.end () &&
+				(!rules.DependsOnTime () || pos->Evaluated_.secsTo (now) < 60 * 60))
+			return pos->Tracks_;
+
+		QList<int> result;
+		try
+		{
+			result = Storage_->GetSmartPlaylist (rules);
+		}
+		catch (const std::runtime_error& e)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "error evaluating smart playlist"
+					<< key
+					<< e.what ();
+			return QList<int> ();
+		}
+
+		if (rules.Order_ != SmartPlaylist::Order::Random)
+			SmartPlaylists_ [key] = { rules, result, now };
+
+		return result;
+	}
+
+	QStringList LocalCollection::GetGenres () const
+	{
+		try
+		{
+			return Storage_->GetGenres ();
+		}
+		catch (const std::runtime_error& e)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< e.what ();
+			return QStringList ();
+		}
+	}
+
+	QList<int> LocalCollection::GetYears () const
+	{
+		try
+		{
+			return Storage_->GetYears ();
+		}
+		catch (const std::runtime_error& e)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< e.what ();
+			return QList<int> ();
+		}
+	}
+
 	QStringList LocalCollection::TrackList2PathList (const QList<int>& tracks) const
 	{
 		QStringList result;
 		std::transform (tracks.begin (), tracks.end (), std::back_inserter (result),
-				[this] (int id) { return Track2Path_ [id]; });
+				[this] (int id) -> QString
+				{
+					const auto& path = Track2Path_.value (id);
+					return path.isEmpty () && !UnloadedArtists_.isEmpty () ?
+							Storage_->GetTrackPath (id) :
+							path;
+				});
 		result.removeAll (QString ());
 		return result;
 	}
@@ -414,19 +656,20 @@ namespace LMP
 
 	Collection::TrackStats LocalCollection::GetTrackStats (const QString& path) const
 	{
-		if (!Path2Track_.contains (path))
+		const int trackId = FindTrack (path);
+		if (trackId == -1)
 			return Collection::TrackStats ();
 
 		try
 		{
-			return Storage_->GetTrackStats (Path2Track_ [path]);
+			return Storage_->GetTrackStats (trackId);
 		}
 		catch (const std::runtime_error& e)
 		{
 			qWarning () << Q_FUNC_INFO
 					<< "error fetching stats for track"
 					<< path
-					<< Path2Track_ [path]
+					<< trackId
 					<< e.what ();
 			return Collection::TrackStats ();
 		}
@@ -434,6 +677,8 @@ namespace LMP
 
 	QList<int> LocalCollection::GetAlbumArtists (int albumId) const
 	{
+		EnsureAlbumLoaded (albumId);
+
 		QList<int> result;
 		for (const auto& artist : Artists_)
 		{
@@ -447,6 +692,8 @@ namespace LMP
 
 	Collection::Artist LocalCollection::GetArtist (int id) const
 	{
+		EnsureArtistLoaded (id);
+
 		auto pos = std::find_if (Artists_.begin (), Artists_.end (),
 				[id] (decltype (Artists_.front ()) artist) { return artist.ID_ == id; });
 		return pos != Artists_.end () ?
@@ -456,7 +703,28 @@ namespace LMP
 
 	Collection::Artists_t LocalCollection::GetAllArtists () const
 	{
-		return Artists_;
+		if (UnloadedArtists_.isEmpty ())
+			return Artists_;
+
+		auto result = Artists_;
+		for (auto& artist : result)
+		{
+			if (!UnloadedArtists_.contains (artist.ID_))
+				continue;
+
+			try
+			{
+				artist.Albums_ = Storage_->GetArtistAlbums (artist.ID_);
+			}
+			catch (const std::exception& e)
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "error fetching albums for"
+						<< artist.ID_
+						<< e.what ();
+			}
+		}
+		return result;
 	}
 
 	void LocalCollection::HandleExistingInfos (const QList<MediaInfo>& infos)
@@ -495,6 +763,10 @@ namespace LMP
 			const auto& newArts = Storage_->AddToCollection (QList<MediaInfo> () << info);
 			HandleNewArtists (newArts);
 
+			// Keep the added date recorded for the new track if the old one had no stats.
+			if (!stats.Added_.isValid ())
+				continue;
+
 			const auto newTrackIdx = FindTrack (path);
 			stats.TrackID_ = newTrackIdx;
 			Storage_->SetTrackStats (stats);
@@ -519,6 +791,76 @@ namespace LMP
 		}
 	}
 
+	QStandardItem* LocalCollection::GetArtistItem (const Collection::Artist& artist)
+	{
+		return GetItem (Artist2Item_,
+				artist.ID_,
+				[this, &artist] (QStandardItem *item)
+				{
+					item->setIcon (ArtistIcon_);
+					item->setText (artist.Name_);
+					item->setData (artist.Name_, Role::ArtistName);
+					item->setData (NodeType::Artist, Role::Node);
+				},
+				CollectionModel_);
+	}
+
+	void LocalCollection::AddArtistItems (const Collection::Artist& artist)
+	{
+		auto artistItem = GetArtistItem (artist);
+		for (auto album : artist.Albums_)
+		{
+			AlbumArtMgr_->CheckAlbumArt (artist, album);
+
+			auto albumItem = GetItem (Album2Item_,
+					album->ID_,
+					[album, artist] (QStandardItem *item)
+					{
+						item->setText (QString::fromUtf8 ("%1 — %2")
+								.arg (album->Year_)
+								.arg (album->Name_));
+						item->setData (album->Year_, Role::AlbumYear);
+						item->setData (album->Name_, Role::AlbumName);
+						item->setData (artist.Name_, Role::ArtistName);
+						item->setData (NodeType::Album, Role::Node);
+						if (!album->CoverPath_.isEmpty ())
+							item->setData (album->CoverPath_, Role::AlbumArt);
+					},
+					artistItem);
+
+			if (AlbumID2Album_.contains (album->ID_))
+				AlbumID2Album_ [album->ID_]->Tracks_ << album->Tracks_;
+			else
+			{
+				AlbumID2Album_ [album->ID_] = album;
+				AlbumID2ArtistID_ [album->ID_] = artist.ID_;
+			}
+
+			for (const auto& track : album->Tracks_)
+			{
+				const QString& name = QString::fromUtf8 ("%1 — %2")
+						.arg (track.Number_)
+						.arg (track.Name_);
+				auto item = new QStandardItem (name);
+				item->setEditable (false);
+				item->setData (track.Number_, Role::TrackNumber);
+				item->setData (track.Name_, Role::TrackTitle);
+				item->setData (track.FilePath_, Role::TrackPath);
+				item->setData (track.Genres_, Role::TrackGenres);
+				item->setData (NodeType::Track, Role::Node);
+				albumItem->appendRow (item);
+
+				PresentPaths_ << track.FilePath_;
+				Path2Track_ [track.FilePath_] = track.ID_;
+				Track2Path_ [track.ID_] = track.FilePath_;
+
+				Track2Album_ [track.ID_] = album->ID_;
+
+				Track2Item_ [track.ID_] = item;
+			}
+		}
+	}
+
 	void LocalCollection::HandleNewArtists (const Collection::Artists_t& artists)
 	{
 		int albumCount = 0;
@@ -526,81 +868,20 @@ namespace LMP
 		const bool shouldEmit = !Artists_.isEmpty ();
 
 		Q_FOREACH (const auto& artist, artists)
-		{
 			if (std::find_if (Artists_.begin (), Artists_.end (),
 						[&artist] (decltype (artist) present) { return present.ID_ == artist.ID_; }) == Artists_.end ())
 				Artists_ += artist;
-			Q_FOREACH (auto album, artist.Albums_)
-				Q_FOREACH (const auto& track, album->Tracks_)
-					PresentPaths_ << track.FilePath_;
-		}
 
 		for (const auto& artist : artists)
 		{
 			albumCount += artist.Albums_.size ();
-
-			auto artistItem = GetItem (Artist2Item_,
-					artist.ID_,
-					[this, &artist] (QStandardItem *item)
-					{
-						item->setIcon (ArtistIcon_);
-						item->setText (artist.Name_);
-						item->setData (artist.Name_, Role::ArtistName);
-						item->setData (NodeType::Artist, Role::Node);
-					},
-					CollectionModel_);
 			for (auto album : artist.Albums_)
-			{
 				trackCount += album->Tracks_.size ();
 
-				AlbumArtMgr_->CheckAlbumArt (artist, album);
-
-				auto albumItem = GetItem (Album2Item_,
-						album->ID_,
-						[album, artist] (QStandardItem *item)
-						{
-							item->setText (QString::fromUtf8 ("%1 — %2")
-									.arg (album->Year_)
-									.arg (album->Name_));
-							item->setData (album->Year_, Role::AlbumYear);
-							item->setData (album->Name_, Role::AlbumName);
-							item->setData (artist.Name_, Role::ArtistName);
-							item->setData (NodeType::Album, Role::Node);
-							if (!album->CoverPath_.isEmpty ())
-								item->setData (album->CoverPath_, Role::AlbumArt);
-						},
-						artistItem);
-
-				if (AlbumID2Album_.contains (album->ID_))
-					AlbumID2Album_ [album->ID_]->Tracks_ << album->Tracks_;
-				else
-				{
-					AlbumID2Album_ [album->ID_] = album;
-					AlbumID2ArtistID_ [album->ID_] = artist.ID_;
-				}
-
-				for (const auto& track : album->Tracks_)
-				{
-					const QString& name = QString::fromUtf8 ("%1 — %2")
-							.arg (track.Number_)
-							.arg (track.Name_);
-					auto item = new QStandardItem (name);
-					item->setEditable (false);
-					item->setData (track.Number_, Role::TrackNumber);
-					item->setData (track.Name_, Role::TrackTitle);
-					item->setData (track.FilePath_, Role::TrackPath);
-					item->setData (track.Genres_, Role::TrackGenres);
-					item->setData (NodeType::Track, Role::Node);
-					albumItem->appendRow (item);
-
-					Path2Track_ [track.FilePath_] = track.ID_;
-					Track2Path_ [track.ID_] = track.FilePath_;
-
-					Track2Album_ [track.ID_] = album->ID_;
-
-					Track2Item_ [track.ID_] = item;
-				}
-			}
+			// The new tracks will be fetched along with the rest of the
+			// artist when (and if) it is loaded.
+			if (!UnloadedArtists_.contains (artist.ID_))
+				AddArtistItems (artist);
 		}
 
 		if (shouldEmit &&
@@ -612,6 +893,95 @@ namespace LMP
 		}
 	}
 
+	void LocalCollection::HandleLazyArtists (const Collection::Artists_t& artists)
+	{
+		Artists_ += artists;
+
+		for (const auto& artist : artists)
+		{
+			UnloadedArtists_ << artist.ID_;
+			GetArtistItem (artist)->setData (artist.ID_, UnloadedArtistRole);
+		}
+	}
+
+	void LocalCollection::LoadArtist (int id)
+	{
+		if (!UnloadedArtists_.remove (id))
+			return;
+
+		Artist2Item_ [id]->setData (QVariant (), UnloadedArtistRole);
+
+		QList<Collection::Album_ptr> albums;
+		try
+		{
+			albums = Storage_->GetArtistAlbums (id);
+		}
+		catch (const std::exception& e)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "error loading artist"
+					<< id
+					<< e.what ();
+			return;
+		}
+
+		const auto pos = std::find_if (Artists_.begin (), Artists_.end (),
+				[id] (decltype (Artists_.front ()) artist) { return artist.ID_ == id; });
+		if (pos == Artists_.end ())
+			return;
+
+		pos->Albums_ = albums;
+		AddArtistItems (*pos);
+	}
+
+	void LocalCollection::EnsureArtistLoaded (int id) const
+	{
+		// Loading an artist only materializes what's already in the
+		// storage, so it's fine to do it from the const lookup methods.
+		if (UnloadedArtists_.contains (id))
+			const_cast<LocalCollection*> (this)->LoadArtist (id);
+	}
+
+	void LocalCollection::EnsureAlbumLoaded (int albumId) const
+	{
+		if (UnloadedArtists_.isEmpty () || AlbumID2Album_.contains (albumId))
+			return;
+
+		try
+		{
+			EnsureArtistLoaded (Storage_->GetAlbumArtist (albumId));
+		}
+		catch (const std::exception& e)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "error looking up album"
+					<< albumId
+					<< e.what ();
+		}
+	}
+
+	bool LocalCollection::IsPresentPath (const QString& path) const
+	{
+		if (PresentPaths_.contains (path))
+			return true;
+
+		if (UnloadedArtists_.isEmpty ())
+			return false;
+
+		try
+		{
+			return Storage_->FindTrack (path).first != -1;
+		}
+		catch (const std::exception& e)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "error looking up"
+					<< path
+					<< e.what ();
+			return false;
+		}
+	}
+
 	void LocalCollection::RemoveTrack (const QString& path)
 	{
 		const int id = FindTrack (path);
@@ -631,6 +1001,8 @@ namespace LMP
 			throw;
 		}
 
+		RemoveFromSmartPlaylists (id);
+
 		auto item = Track2Item_.take (id);
 		item->parent ()->removeRow (item->row ());
 
@@ -650,6 +1022,62 @@ namespace LMP
 			RemoveAlbum (album->ID_);
 	}
 
+	void LocalCollection::UpdateSmartPlaylists (int trackId)
+	{
+		for (auto i = SmartPlaylists_.begin (); i != SmartPlaylists_.end (); )
+		{
+			const auto& rules = i->Rules_;
+			if (!rules.DependsOnStats ())
+			{
+				++i;
+				continue;
+			}
+
+			if (!rules.IsIncremental ())
+			{
+				i = SmartPlaylists_.erase (i);
+				continue;
+			}
+
+			try
+			{
+				const bool matches = Storage_->MatchesSmartPlaylist (rules, trackId);
+				const bool contains = i->Tracks_.contains (trackId);
+				if (matches && !contains)
+					i->Tracks_ << trackId;
+				else if (!matches && contains)
+					i->Tracks_.removeAll (trackId);
+				++i;
+			}
+			catch (const std::runtime_error& e)
+			{
+				qWarning () << Q_FUNC_INFO
+						<< e.what ();
+				i = SmartPlaylists_.erase (i);
+			}
+		}
+	}
+
+	void LocalCollection::RemoveFromSmartPlaylists (int trackId)
+	{
+		for (auto i = SmartPlaylists_.begin (); i != SmartPlaylists_.end (); )
+			if (i->Rules_.IsIncremental ())
+			{
+				i->Tracks_.removeAll (trackId);
+				++i;
+			}
+			else if (i->Tracks_.contains (trackId))
+				i = SmartPlaylists_.erase (i);
+			else
+				++i;
+	}
+
+	void LocalCollection::InvalidateSmartPlaylists ()
+	{
+		SmartPlaylists_.clear ();
+		emit smartPlaylistsChanged ();
+	}
+
 	void LocalCollection::RemoveAlbum (int id)
 	{
 		try
@@ -736,30 +1164,25 @@ namespace LMP
 			emit rootPathsChanged (RootPaths_);
 	}
 
-	void LocalCollection::CheckRemovedFiles (const QSet<QString>& scanned, const QString& rootPath)
-	{
-		auto toRemove = PresentPaths_;
-		toRemove.subtract (scanned);
-
-		for (auto pos = toRemove.begin (); pos != toRemove.end (); )
-		{
-			if (pos->startsWith (rootPath) && !scanned.contains (*pos))
-				++pos;
-			else
-				pos = toRemove.erase (pos);
-		}
-
-		Q_FOREACH (const auto& path, toRemove)
-			RemoveTrack (path);
-	}
-
 	void LocalCollection::InitiateScan (const QSet<QString>& newPaths)
 	{
 		auto resolver = Core::Instance ().GetLocalFileResolver ();
+		resolver->ResetFormatStats ();
+		ScanTimer_.start ();
 
 		emit scanStarted (newPaths.size ());
-		auto worker = [resolver] (const QString& path) -> MediaInfo
+
+		const int lookahead = 2 * QThread::idealThreadCount ();
+		const auto paths = newPaths.toList ();
+		resolver->Prefetch (paths.mid (0, lookahead));
+
+		auto counter = std::make_shared<QAtomicInt> (0);
+		auto worker = [resolver, paths, counter, lookahead] (const QString& path) -> MediaInfo
 		{
+			const int prefetchPos = counter->fetchAndAddRelaxed (1) + lookahead;
+			if (prefetchPos < paths.size ())
+				resolver->Prefetch (QStringList (paths.at (prefetchPos)));
+
 			try
 			{
 				return resolver->ResolveInfo (path);
@@ -773,19 +1196,21 @@ namespace LMP
 				return MediaInfo ();
 			}
 		};
-		QFuture<MediaInfo> future = QtConcurrent::mapped (newPaths,
+		QFuture<MediaInfo> future = QtConcurrent::mapped (paths,
 				std::function<MediaInfo (const QString&)> (worker));
 		Watcher_->setFuture (future);
 	}
 
 	void LocalCollection::recordPlayedTrack (const QString& path)
 	{
-		if (!Path2Track_.contains (path))
+		const int trackId = FindTrack (path);
+		if (trackId == -1)
 			return;
 
 		try
 		{
-			Storage_->RecordTrackPlayed (Path2Track_ [path]);
+			Storage_->RecordTrackPlayed (trackId);
+			UpdateSmartPlaylists (trackId);
 		}
 		catch (const std::runtime_error& e)
 		{
@@ -797,8 +1222,11 @@ namespace LMP
 
 	void LocalCollection::rescanOnLoad ()
 	{
+		const bool cheap = XmlSettingsManager::Instance ()
+				.property ("CheapRescanOnLoad").toBool ();
 		Q_FOREACH (const auto& rootPath, RootPaths_)
-			Scan (rootPath, true);
+			if (!cheap || !FilesWatcher_->CatchUp (rootPath))
+				Scan (rootPath, true);
 	}
 
 	void LocalCollection::handleLoadFinished ()
@@ -808,7 +1236,10 @@ namespace LMP
 		const auto& result = watcher->result ();
 		Storage_->Load (result);
 
-		HandleNewArtists (result.Artists_);
+		if (watcher->property ("Lazy").toBool ())
+			HandleLazyArtists (result.Artists_);
+		else
+			HandleNewArtists (result.Artists_);
 
 		IsReady_ = true;
 
@@ -823,12 +1254,11 @@ namespace LMP
 	{
 		sender ()->deleteLater ();
 
-		const auto& path = sender ()->property ("Path").toString ();
-
 		auto watcher = dynamic_cast<QFutureWatcher<IterateResult>*> (sender ());
 		const auto& result = watcher->result ();
 
-		CheckRemovedFiles (result.ChangedFiles_ + result.UnchangedFiles_, path);
+		Q_FOREACH (const auto& removed, result.RemovedFiles_)
+			RemoveTrack (removed);
 
 		if (Watcher_->isRunning ())
 			NewPathsQueue_ << result.ChangedFiles_;
@@ -838,6 +1268,29 @@ namespace LMP
 
 	void LocalCollection::handleScanFinished ()
 	{
+		const auto& stats = Core::Instance ().GetLocalFileResolver ()->GetFormatStats ();
+		for (auto i = stats.begin (), end = stats.end (); i != end; ++i)
+		{
+			const auto& st = i.value ();
+			const double secs = st.ParseNSecs_ / 1e9;
+			qDebug () << Q_FUNC_INFO
+					<< "format"
+					<< i.key ()
+					<< ":"
+					<< st.Files_
+					<< "files,"
+					<< st.Bytes_ / (1024 * 1024)
+					<< "MiB,"
+					<< secs
+					<< "s of parsing,"
+					<< (secs > 0 ? st.Files_ / secs : 0)
+					<< "files/s per thread";
+		}
+		qDebug () << Q_FUNC_INFO
+				<< "scan took"
+				<< ScanTimer_.elapsed ()
+				<< "ms";
+
 		auto future = Watcher_->future ();
 		QList<MediaInfo> newInfos, existingInfos;
 		Q_FOREACH (const auto& info, future)
@@ -846,7 +1299,7 @@ namespace LMP
 			if (path.isEmpty ())
 				continue;
 
-			if (PresentPaths_.contains (path))
+			if (IsPresentPath (path))
 				existingInfos << info;
 			else
 			{
@@ -877,6 +1330,8 @@ namespace LMP
 		}
 
 		HandleExistingInfos (existingInfos);
+
+		InvalidateSmartPlaylists ();
 	}
 
 	void LocalCollection::saveRootPaths ()
@@ -22,10 +22,12 @@
 #include <QHash>
 #include <QSet>
 #include <QFutureWatcher>
+#include <QElapsedTimer>
 #include <QIcon>
 #include "interfaces/lmp/collectiontypes.h"
 #include "interfaces/lmp/ilocalcollection.h"
 #include "mediainfo.h"
+#include "smartplaylist.h"
 
 class QStandardItemModel;
 class QStandardItem;
@@ -38,6 +40,7 @@ namespace LeechCraft
 namespace LMP
 {
 	class AlbumArtManager;
+	class AlbumThumbnailCache;
 	class LocalCollectionStorage;
 	class Player;
 	class LocalCollectionWatcher;
@@ -59,9 +62,16 @@ namespace LMP
 		LocalCollectionWatcher *FilesWatcher_;
 
 		AlbumArtManager *AlbumArtMgr_;
+		AlbumThumbnailCache *ThumbnailCache_;
 
 		Collection::Artists_t Artists_;
 
+		/** Artists whose albums and tracks haven't been loaded from
+		 * the storage yet. Only non-empty if the collection is loaded
+		 * lazily.
+		 */
+		QSet<int> UnloadedArtists_;
+
 		QSet<QString> PresentPaths_;
 		QHash<QString, int> Path2Track_;
 		QHash<int, QString> Track2Path_;
@@ -74,7 +84,19 @@ namespace LMP
 		QHash<int, QStandardItem*> Album2Item_;
 		QHash<int, QStandardItem*> Track2Item_;
 
+		struct SmartPlaylistResult
+		{
+			SmartPlaylist Rules_;
+			QList<int> Tracks_;
+			QDateTime Evaluated_;
+		};
+		/** Cached results of smart playlists, keyed by
+		 * SmartPlaylist::GetKey().
+		 */
+		mutable QHash<QString, SmartPlaylistResult> SmartPlaylists_;
+
 		QFutureWatcher<MediaInfo> *Watcher_;
+		QElapsedTimer ScanTimer_;
 		QList<QSet<QString>> NewPathsQueue_;
 
 		int UpdateNewArtists_;
@@ -127,6 +149,7 @@ namespace LMP
 		bool IsReady () const;
 
 		AlbumArtManager* GetAlbumArtManager () const;
+		AlbumThumbnailCache* GetAlbumThumbnailCache () const;
 
 		QAbstractItemModel* GetCollectionModel () const;
 		void Enqueue (const QModelIndex&, Player*);
@@ -134,6 +157,22 @@ namespace LMP
 		void Clear ();
 
 		void Scan (const QString&, bool root = true);
+
+		/** Rescans the given files or directories (recursively) for new
+		 * or changed tracks without looking for removed ones.
+		 */
+		void UpdateFiles (const QStringList&);
+
+		/** Rescans only the direct children of the given directories,
+		 * including the removed ones.
+		 */
+		void RescanDirs (const QStringList&);
+
+		/** Removes the given tracks or all the tracks under the given
+		 * directories.
+		 */
+		void RemoveFiles (const QStringList&);
+
 		void Unscan (const QString&);
 		void Rescan ();
 
@@ -151,6 +190,9 @@ namespace LMP
 		QVariant GetTrackData (int trackId, Role) const;
 
 		QList<int> GetDynamicPlaylist (DynamicPlaylist) const;
+		QList<int> GetSmartPlaylist (const SmartPlaylist&) const;
+		QStringList GetGenres () const;
+		QList<int> GetYears () const;
 		QStringList TrackList2PathList (const QList<int>&) const;
 
 		void AddTrackTo (int, StaticRating);
@@ -164,15 +206,27 @@ namespace LMP
 		void RemoveTrack (const QString&);
 	private:
 		void HandleExistingInfos (const QList<MediaInfo>&);
+
+		QStandardItem* GetArtistItem (const Collection::Artist&);
+		void AddArtistItems (const Collection::Artist&);
 		void HandleNewArtists (const Collection::Artists_t&);
+		void HandleLazyArtists (const Collection::Artists_t&);
+
+		void LoadArtist (int);
+		void EnsureArtistLoaded (int) const;
+		void EnsureAlbumLoaded (int) const;
+		bool IsPresentPath (const QString&) const;
+
+		void UpdateSmartPlaylists (int trackId);
+		void RemoveFromSmartPlaylists (int trackId);
+		void InvalidateSmartPlaylists ();
+
 		void RemoveAlbum (int);
 		Collection::Artists_t::iterator RemoveArtist (Collection::Artists_t::iterator);
 
 		void AddRootPaths (QStringList);
 		void RemoveRootPaths (const QStringList&);
 
-		void CheckRemovedFiles (const QSet<QString>& scanned, const QString& root);
-
 		void InitiateScan (const QSet<QString>&);
 	public slots:
 		void recordPlayedTrack (const QString&);
@@ -189,6 +243,12 @@ namespace LMP
 
 		void collectionReady ();
 
+		/** Emitted when the contents of the collection have changed so
+		 * that smart playlists and the lists of genres and years are
+		 * to be reevaluated.
+		 */
+		void smartPlaylistsChanged ();
+
 		void rootPathsChanged (const QStringList&);
 	};
 }
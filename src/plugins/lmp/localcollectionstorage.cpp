@@ -25,6 +25,7 @@
 #include <util/util.h>
 #include <util/dblock.h>
 #include "util.h"
+#include "smartplaylist.h"
 
 namespace LeechCraft
 {
@@ -214,6 +215,189 @@ namespace LMP
 		PresentArtists_ = result.PresentArtists_;
 	}
 
+	LocalCollectionStorage::LoadResult LocalCollectionStorage::LoadArtists ()
+	{
+		const auto& artists = GetAllArtists ();
+
+		QHash<int, Collection::Artist> id2artist;
+		for (const auto& artist : artists)
+		{
+			AddToPresent (artist);
+			id2artist [artist.ID_] = artist;
+		}
+
+		QSqlQuery albums (DB_);
+		albums.setForwardOnly (true);
+		if (!albums.exec ("SELECT artists2albums.ArtistID, albums.Id, albums.Name, albums.Year "
+				"FROM albums INNER JOIN artists2albums ON albums.Id = artists2albums.AlbumID;"))
+		{
+			Util::DBLock::DumpError (albums);
+			throw std::runtime_error ("cannot fetch albums");
+		}
+
+		while (albums.next ())
+		{
+			const Collection::Album album =
+			{
+				albums.value (1).toInt (),
+				albums.value (2).toString (),
+				albums.value (3).toInt (),
+				QString (),
+				QList<Collection::Track> ()
+			};
+			AddToPresent (id2artist [albums.value (0).toInt ()], album);
+		}
+
+		LoadResult result =
+		{
+			artists,
+			PresentArtists_,
+			PresentAlbums_
+		};
+		return result;
+	}
+
+	QList<Collection::Album_ptr> LocalCollectionStorage::GetArtistAlbums (int artistId)
+	{
+		QList<Collection::Album_ptr> albums;
+
+		GetArtistAlbums_.bindValue (":artist_id", artistId);
+		if (!GetArtistAlbums_.exec ())
+		{
+			Util::DBLock::DumpError (GetArtistAlbums_);
+			throw std::runtime_error ("cannot fetch artist albums");
+		}
+
+		while (GetArtistAlbums_.next ())
+		{
+			const Collection::Album album =
+			{
+				GetArtistAlbums_.value (0).toInt (),
+				GetArtistAlbums_.value (1).toString (),
+				GetArtistAlbums_.value (2).toInt (),
+				GetArtistAlbums_.value (3).toString (),
+				QList<Collection::Track> ()
+			};
+			albums << Collection::Album_ptr (new Collection::Album (album));
+		}
+		GetArtistAlbums_.finish ();
+
+		for (auto album : albums)
+			album->Tracks_ = GetAlbumTracks (album->ID_);
+
+		return albums;
+	}
+
+	QPair<int, int> LocalCollectionStorage::FindTrack (const QString& path)
+	{
+		FindTrack_.bindValue (":path", path);
+		if (!FindTrack_.exec ())
+		{
+			Util::DBLock::DumpError (FindTrack_);
+			throw std::runtime_error ("cannot find track");
+		}
+
+		const auto& result = FindTrack_.next () ?
+				qMakePair (FindTrack_.value (0).toInt (), FindTrack_.value (1).toInt ()) :
+				qMakePair (-1, -1);
+		FindTrack_.finish ();
+		return result;
+	}
+
+	QString LocalCollectionStorage::GetTrackPath (int trackId)
+	{
+		GetTrackPath_.bindValue (":track_id", trackId);
+		if (!GetTrackPath_.exec ())
+		{
+			Util::DBLock::DumpError (GetTrackPath_);
+			throw std::runtime_error ("cannot get track path");
+		}
+
+		const auto& result = GetTrackPath_.next () ?
+				GetTrackPath_.value (0).toString () :
+				QString ();
+		GetTrackPath_.finish ();
+		return result;
+	}
+
+	int LocalCollectionStorage::GetAlbumArtist (int albumId)
+	{
+		GetAlbumArtist_.bindValue (":album_id", albumId);
+		if (!GetAlbumArtist_.exec ())
+		{
+			Util::DBLock::DumpError (GetAlbumArtist_);
+			throw std::runtime_error ("cannot get album artist");
+		}
+
+		const int result = GetAlbumArtist_.next () ?
+				GetAlbumArtist_.value (0).toInt () :
+				-1;
+		GetAlbumArtist_.finish ();
+		return result;
+	}
+
+	QList<int> LocalCollectionStorage::GetRandomTracks (int count)
+	{
+		QSqlQuery query (DB_);
+		query.prepare ("SELECT Id FROM tracks ORDER BY RANDOM () LIMIT :count;");
+		query.bindValue (":count", count);
+		if (!query.exec ())
+		{
+			Util::DBLock::DumpError (query);
+			throw std::runtime_error ("cannot get random tracks");
+		}
+
+		QList<int> result;
+		while (query.next ())
+			result << query.value (0).toInt ();
+		return result;
+	}
+
+	QList<int> LocalCollectionStorage::GetSmartPlaylist (const SmartPlaylist& rules)
+	{
+		auto query = ExecSmartQuery (rules, -1);
+
+		QList<int> result;
+		while (query.next ())
+			result << query.value (0).toInt ();
+		return result;
+	}
+
+	bool LocalCollectionStorage::MatchesSmartPlaylist (const SmartPlaylist& rules, int trackId)
+	{
+		return ExecSmartQuery (rules, trackId).next ();
+	}
+
+	QStringList LocalCollectionStorage::GetGenres ()
+	{
+		QSqlQuery query (DB_);
+		if (!query.exec ("SELECT DISTINCT Name FROM genres ORDER BY Name COLLATE NOCASE;"))
+		{
+			Util::DBLock::DumpError (query);
+			throw std::runtime_error ("cannot get genres");
+		}
+
+		QStringList result;
+		while (query.next ())
+			result << query.value (0).toString ();
+		return result;
+	}
+
+	QList<int> LocalCollectionStorage::GetYears ()
+	{
+		QSqlQuery query (DB_);
+		if (!query.exec ("SELECT DISTINCT Year FROM albums WHERE Year > 0 ORDER BY Year;"))
+		{
+			Util::DBLock::DumpError (query);
+			throw std::runtime_error ("cannot get years");
+		}
+
+		QList<int> result;
+		while (query.next ())
+			result << query.value (0).toInt ();
+		return result;
+	}
+
 	void LocalCollectionStorage::RemoveTrack (int id)
 	{
 		RemoveTrack_.bindValue (":track_id", id);
@@ -342,6 +526,51 @@ namespace LMP
 		}
 	}
 
+	QHash<QString, QDateTime> LocalCollectionStorage::GetMTimes (const QString& prefix)
+	{
+		auto& query = prefix.isEmpty () ? GetAllFilesMTimes_ : GetPrefixFilesMTimes_;
+		if (!prefix.isEmpty ())
+		{
+			auto upper = prefix;
+			upper [upper.size () - 1] = QChar (upper.at (upper.size () - 1).unicode () + 1);
+
+			query.bindValue (":prefix", prefix);
+			query.bindValue (":upper", upper);
+		}
+
+		if (!query.exec ())
+		{
+			Util::DBLock::DumpError (query);
+			throw std::runtime_error ("cannot get files mtimes");
+		}
+
+		QHash<QString, QDateTime> result;
+		while (query.next ())
+			result [query.value (0).toString ()] = query.value (1).toDateTime ();
+		query.finish ();
+
+		return result;
+	}
+
+	void LocalCollectionStorage::SetMTimes (const QHash<QString, QDateTime>& mtimes)
+	{
+		if (mtimes.isEmpty ())
+			return;
+
+		Util::DBLock lock (DB_);
+		lock.Init ();
+
+		for (auto i = mtimes.begin (), end = mtimes.end (); i != end; ++i)
+		{
+			SetFileMTime_.bindValue (":filepath", i.key ());
+			SetFileMTime_.bindValue (":mtime", i.value ());
+			if (!SetFileMTime_.exec ())
+				Util::DBLock::DumpError (SetFileMTime_);
+		}
+
+		lock.Good ();
+	}
+
 	const int LovedStateID = 1;
 	const int BannedStateID = 2;
 
@@ -402,6 +631,126 @@ namespace LMP
 		return result;
 	}
 
+	QSqlQuery LocalCollectionStorage::ExecSmartQuery (const SmartPlaylist& rules, int trackId)
+	{
+		QString queryStr = "SELECT tracks.Id FROM tracks";
+		QStringList conds;
+		QList<QPair<QString, QVariant>> binds;
+
+		if (rules.MinYear_ > 0 || rules.MaxYear_ > 0)
+			queryStr += " INNER JOIN albums ON albums.Id = tracks.AlbumId";
+		if (rules.DependsOnStats ())
+			queryStr += " LEFT OUTER JOIN statistics ON statistics.TrackId = tracks.Id";
+
+		if (trackId >= 0)
+		{
+			conds << "tracks.Id = :track_id";
+			binds.append ({ ":track_id", trackId });
+		}
+
+		if (!rules.Genres_.isEmpty ())
+		{
+			QStringList placeholders;
+			for (int i = 0; i < rules.Genres_.size (); ++i)
+			{
+				const auto& placeholder = ":genre" + QString::number (i);
+				placeholders << placeholder;
+				binds.append ({ placeholder, rules.Genres_.at (i) });
+			}
+			conds << "tracks.Id IN (SELECT TrackId FROM genres WHERE Name COLLATE NOCASE IN (" +
+					placeholders.join (", ") + "))";
+		}
+
+		if (rules.MinYear_ > 0)
+		{
+			conds << "albums.Year >= :min_year";
+			binds.append ({ ":min_year", rules.MinYear_ });
+		}
+		if (rules.MaxYear_ > 0)
+		{
+			conds << "albums.Year <= :max_year";
+			binds.append ({ ":max_year", rules.MaxYear_ });
+		}
+
+		if (rules.MinRating_ > 0)
+		{
+			conds << "statistics.Rating >= :min_rating";
+			binds.append ({ ":min_rating", rules.MinRating_ });
+		}
+
+		if (rules.MinPlaycount_ > 0)
+		{
+			conds << "statistics.Playcount >= :min_playcount";
+			binds.append ({ ":min_playcount", rules.MinPlaycount_ });
+		}
+		if (rules.MaxPlaycount_ >= 0)
+		{
+			conds << "coalesce (statistics.Playcount, 0) <= :max_playcount";
+			binds.append ({ ":max_playcount", rules.MaxPlaycount_ });
+		}
+
+		const auto& now = QDateTime::currentDateTime ();
+		if (rules.PlayedWithinDays_ > 0)
+		{
+			conds << "statistics.LastPlay >= :played_after";
+			binds.append ({ ":played_after", now.addDays (-rules.PlayedWithinDays_) });
+		}
+		if (rules.NotPlayedForDays_ > 0)
+		{
+			conds << "(statistics.LastPlay IS NULL OR statistics.LastPlay < :played_before)";
+			binds.append ({ ":played_before", now.addDays (-rules.NotPlayedForDays_) });
+		}
+		if (rules.AddedWithinDays_ > 0)
+		{
+			conds << "statistics.Added >= :added_after";
+			binds.append ({ ":added_after", now.addDays (-rules.AddedWithinDays_) });
+		}
+
+		if (!conds.isEmpty ())
+			queryStr += " WHERE " + conds.join (" AND ");
+
+		if (trackId < 0)
+		{
+			switch (rules.Order_)
+			{
+			case SmartPlaylist::Order::None:
+				break;
+			case SmartPlaylist::Order::Random:
+				queryStr += " ORDER BY RANDOM ()";
+				break;
+			case SmartPlaylist::Order::MostPlayed:
+				queryStr += " ORDER BY statistics.Playcount DESC";
+				break;
+			case SmartPlaylist::Order::RecentlyPlayed:
+				queryStr += " ORDER BY statistics.LastPlay DESC";
+				break;
+			case SmartPlaylist::Order::RecentlyAdded:
+				queryStr += " ORDER BY statistics.Added DESC";
+				break;
+			}
+
+			if (rules.Limit_ > 0)
+			{
+				queryStr += " LIMIT :limit";
+				binds.append ({ ":limit", rules.Limit_ });
+			}
+		}
+
+		QSqlQuery query (DB_);
+		query.setForwardOnly (true);
+		query.prepare (queryStr + ";");
+		for (const auto& bind : binds)
+			query.bindValue (bind.first, bind.second);
+
+		if (!query.exec ())
+		{
+			Util::DBLock::DumpError (query);
+			throw std::runtime_error ("cannot evaluate smart playlist");
+		}
+
+		return query;
+	}
+
 	Collection::Artists_t LocalCollectionStorage::GetAllArtists ()
 	{
 		Collection::Artists_t artists;
@@ -486,6 +835,48 @@ namespace LMP
 		return newAlbums;
 	}
 
+	QList<Collection::Track> LocalCollectionStorage::GetAlbumTracks (int albumId)
+	{
+		GetAlbumTracks_.bindValue (":album_id", albumId);
+		if (!GetAlbumTracks_.exec ())
+		{
+			Util::DBLock::DumpError (GetAlbumTracks_);
+			throw std::runtime_error ("cannot fetch album tracks");
+		}
+
+		QList<Collection::Track> tracks;
+		while (GetAlbumTracks_.next ())
+		{
+			const Collection::Track track =
+			{
+				GetAlbumTracks_.value (0).toInt (),
+				GetAlbumTracks_.value (1).toInt (),
+				GetAlbumTracks_.value (2).toString (),
+				GetAlbumTracks_.value (3).toInt (),
+				QStringList (),
+				GetAlbumTracks_.value (4).toString ()
+			};
+			tracks << track;
+		}
+		GetAlbumTracks_.finish ();
+
+		for (auto& track : tracks)
+		{
+			GetTrackGenres_.bindValue (":track_id", track.ID_);
+			if (!GetTrackGenres_.exec ())
+			{
+				Util::DBLock::DumpError (GetTrackGenres_);
+				throw std::runtime_error ("cannot fetch track genres");
+			}
+
+			while (GetTrackGenres_.next ())
+				track.Genres_ << GetTrackGenres_.value (0).toString ();
+			GetTrackGenres_.finish ();
+		}
+
+		return tracks;
+	}
+
 	void LocalCollectionStorage::AddArtist (Collection::Artist& artist)
 	{
 		AddArtist_.bindValue (":name", artist.Name_);
@@ -539,6 +930,14 @@ namespace LMP
 		const int id = AddTrack_.lastInsertId ().toInt ();
 		track.ID_ = id;
 
+		AddTrackStats_.bindValue (":track_id", id);
+		AddTrackStats_.bindValue (":added", QDateTime::currentDateTime ());
+		if (!AddTrackStats_.exec ())
+		{
+			Util::DBLock::DumpError (AddTrackStats_);
+			throw std::runtime_error ("unable to add track statistics");
+		}
+
 		Q_FOREACH (const QString& genre, track.Genres_)
 		{
 			AddGenre_.bindValue (":track_id", id);
@@ -592,6 +991,26 @@ namespace LMP
 		GetAlbums_ = QSqlQuery (DB_);
 		GetAlbums_.prepare ("SELECT Id, Name, Year, CoverPath FROM albums;");
 
+		GetArtistAlbums_ = QSqlQuery (DB_);
+		GetArtistAlbums_.prepare ("SELECT albums.Id, albums.Name, albums.Year, albums.CoverPath "
+				"FROM albums INNER JOIN artists2albums ON albums.Id = artists2albums.AlbumID "
+				"WHERE artists2albums.ArtistID = :artist_id;");
+
+		GetAlbumTracks_ = QSqlQuery (DB_);
+		GetAlbumTracks_.prepare ("SELECT Id, TrackNumber, Name, Length, Path FROM tracks WHERE AlbumID = :album_id;");
+
+		GetTrackGenres_ = QSqlQuery (DB_);
+		GetTrackGenres_.prepare ("SELECT Name FROM genres WHERE TrackId = :track_id;");
+
+		FindTrack_ = QSqlQuery (DB_);
+		FindTrack_.prepare ("SELECT Id, ArtistID FROM tracks WHERE Path = :path;");
+
+		GetTrackPath_ = QSqlQuery (DB_);
+		GetTrackPath_.prepare ("SELECT Path FROM tracks WHERE Id = :track_id;");
+
+		GetAlbumArtist_ = QSqlQuery (DB_);
+		GetAlbumArtist_.prepare ("SELECT ArtistID FROM artists2albums WHERE AlbumID = :album_id;");
+
 		AddArtist_ = QSqlQuery (DB_);
 		AddArtist_.prepare ("INSERT INTO artists (Name) VALUES (:name);");
 
@@ -605,6 +1024,10 @@ namespace LMP
 		AddTrack_.prepare ("INSERT INTO tracks (ArtistID, AlbumID, Path, Name, TrackNumber, Length) "
 				"VALUES (:artist_id, :album_id, :path, :name, :track_number, :length);");
 
+		AddTrackStats_ = QSqlQuery (DB_);
+		AddTrackStats_.prepare ("INSERT OR IGNORE INTO statistics (TrackId, Playcount, Added) "
+				"VALUES (:track_id, 0, :added);");
+
 		AddGenre_ = QSqlQuery (DB_);
 		AddGenre_.prepare ("INSERT INTO genres (TrackId, Name) VALUES (:track_id, :name);");
 
@@ -639,6 +1062,15 @@ namespace LMP
 		GetFileMTime_ = QSqlQuery (DB_);
 		GetFileMTime_.prepare ("SELECT MTime FROM fileTimes, tracks WHERE tracks.Path = :filepath AND tracks.Id = fileTimes.TrackID;");
 
+		GetAllFilesMTimes_ = QSqlQuery (DB_);
+		GetAllFilesMTimes_.setForwardOnly (true);
+		GetAllFilesMTimes_.prepare ("SELECT tracks.Path, fileTimes.MTime FROM tracks LEFT OUTER JOIN fileTimes ON tracks.Id = fileTimes.TrackID;");
+
+		GetPrefixFilesMTimes_ = QSqlQuery (DB_);
+		GetPrefixFilesMTimes_.setForwardOnly (true);
+		GetPrefixFilesMTimes_.prepare ("SELECT tracks.Path, fileTimes.MTime FROM tracks LEFT OUTER JOIN fileTimes ON tracks.Id = fileTimes.TrackID "
+				"WHERE tracks.Path >= :prefix AND tracks.Path < :upper;");
+
 		SetFileMTime_ = QSqlQuery (DB_);
 		SetFileMTime_.prepare ("INSERT OR REPLACE INTO fileTimes (TrackID, MTime) VALUES ((SELECT Id FROM tracks WHERE Path = :filepath), :mtime);");
 
@@ -731,6 +1163,16 @@ namespace LMP
 			}
 
 		QSqlQuery (DB_).exec ("CREATE UNIQUE INDEX IF NOT EXISTS index_tracksPaths ON tracks (Path);");
+		QSqlQuery (DB_).exec ("CREATE INDEX IF NOT EXISTS index_tracksAlbums ON tracks (AlbumID);");
+		QSqlQuery (DB_).exec ("CREATE INDEX IF NOT EXISTS index_genresTracks ON genres (TrackId);");
+		QSqlQuery (DB_).exec ("CREATE INDEX IF NOT EXISTS index_artists2albumsArtists ON artists2albums (ArtistID);");
+		QSqlQuery (DB_).exec ("CREATE INDEX IF NOT EXISTS index_artists2albumsAlbums ON artists2albums (AlbumID);");
+		QSqlQuery (DB_).exec ("CREATE INDEX IF NOT EXISTS index_genresNames ON genres (Name COLLATE NOCASE);");
+		QSqlQuery (DB_).exec ("CREATE INDEX IF NOT EXISTS index_albumsYears ON albums (Year);");
+		QSqlQuery (DB_).exec ("CREATE INDEX IF NOT EXISTS index_statisticsPlaycount ON statistics (Playcount);");
+		QSqlQuery (DB_).exec ("CREATE INDEX IF NOT EXISTS index_statisticsLastPlay ON statistics (LastPlay);");
+		QSqlQuery (DB_).exec ("CREATE INDEX IF NOT EXISTS index_statisticsAdded ON statistics (Added);");
+		QSqlQuery (DB_).exec ("CREATE INDEX IF NOT EXISTS index_statisticsRating ON statistics (Rating);");
 
 		lock.Good ();
 	}
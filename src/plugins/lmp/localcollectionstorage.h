@@ -20,6 +20,7 @@
 
 #include <QObject>
 #include <QHash>
+#include <QPair>
 #include <QSqlDatabase>
 #include <QSqlQuery>
 #include "mediainfo.h"
@@ -29,6 +30,8 @@ namespace LeechCraft
 {
 namespace LMP
 {
+	struct SmartPlaylist;
+
 	class LocalCollectionStorage : public QObject
 	{
 		Q_OBJECT
@@ -41,10 +44,18 @@ namespace LMP
 		QSqlQuery GetArtists_;
 		QSqlQuery GetAlbums_;
 
+		QSqlQuery GetArtistAlbums_;
+		QSqlQuery GetAlbumTracks_;
+		QSqlQuery GetTrackGenres_;
+		QSqlQuery FindTrack_;
+		QSqlQuery GetTrackPath_;
+		QSqlQuery GetAlbumArtist_;
+
 		QSqlQuery AddArtist_;
 		QSqlQuery AddAlbum_;
 		QSqlQuery LinkArtistAlbum_;
 		QSqlQuery AddTrack_;
+		QSqlQuery AddTrackStats_;
 		QSqlQuery AddGenre_;
 
 		QSqlQuery RemoveTrack_;
@@ -59,6 +70,8 @@ namespace LMP
 
 		QSqlQuery GetFileMTime_;
 		QSqlQuery SetFileMTime_;
+		QSqlQuery GetAllFilesMTimes_;
+		QSqlQuery GetPrefixFilesMTimes_;
 
 		// 1 is loved, 2 is banned
 		QSqlQuery GetLovedBanned_;
@@ -80,6 +93,36 @@ namespace LMP
 		LoadResult Load ();
 		void Load (const LoadResult&);
 
+		/** @brief Loads only the artists, without their albums.
+		 *
+		 * The albums and tracks of an artist are loaded on demand
+		 * via GetArtistAlbums().
+		 */
+		LoadResult LoadArtists ();
+		QList<Collection::Album_ptr> GetArtistAlbums (int artistId);
+
+		/** @brief Returns the track ID and the artist ID for the path.
+		 *
+		 * Both are -1 if there is no such track in the collection.
+		 */
+		QPair<int, int> FindTrack (const QString& path);
+		QString GetTrackPath (int trackId);
+		int GetAlbumArtist (int albumId);
+		QList<int> GetRandomTracks (int count);
+
+		/** @brief Returns the IDs of the tracks matching the rules.
+		 */
+		QList<int> GetSmartPlaylist (const SmartPlaylist&);
+
+		/** @brief Checks whether the given track matches the rules.
+		 *
+		 * The order and limit of the rules are ignored.
+		 */
+		bool MatchesSmartPlaylist (const SmartPlaylist&, int trackId);
+
+		QStringList GetGenres ();
+		QList<int> GetYears ();
+
 		void RemoveTrack (int);
 		void RemoveAlbum (int);
 		void RemoveArtist (int);
@@ -93,6 +136,14 @@ namespace LMP
 		QDateTime GetMTime (const QString&);
 		void SetMTime (const QString&, const QDateTime&);
 
+		/** @brief Returns the mtimes of all known tracks under the given path.
+		 *
+		 * Tracks without a recorded mtime are present in the result
+		 * with a null QDateTime. An empty prefix returns all the tracks.
+		 */
+		QHash<QString, QDateTime> GetMTimes (const QString& prefix);
+		void SetMTimes (const QHash<QString, QDateTime>&);
+
 		void SetTrackLoved (int);
 		void SetTrackBanned (int);
 		void ClearTrackLovedBanned (int);
@@ -102,6 +153,8 @@ namespace LMP
 		void MarkLovedBanned (int, int);
 		QList<int> GetLovedBanned (int);
 
+		QSqlQuery ExecSmartQuery (const SmartPlaylist&, int trackId);
+
 		Collection::Artists_t GetAllArtists ();
 		QHash<int, Collection::Album_ptr> GetAllAlbums ();
 		QList<Collection::Track> GetAlbumTracks (int);
@@ -18,104 +18,534 @@
 
 #include "localcollectionwatcher.h"
 #include <algorithm>
+#include <vector>
 #include <QtConcurrentRun>
+#include <QFutureWatcher>
 #include <QFileSystemWatcher>
+#include <QSocketNotifier>
 #include <QtDebug>
 #include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDataStream>
 #include <QTimer>
+#include <util/util.h>
 #include "core.h"
 #include "localcollection.h"
-#include "util.h"
+#include "xmlsettingsmanager.h"
+
+#ifdef Q_OS_LINUX
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#endif
 
 namespace LeechCraft
 {
 namespace LMP
 {
+	namespace
+	{
+#ifdef Q_OS_LINUX
+		const quint32 WatchMask = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE |
+				IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+#endif
+
+		const int FlushDelay = 2000;
+	}
+
 	LocalCollectionWatcher::LocalCollectionWatcher (QObject *parent)
 	: QObject (parent)
+#ifdef Q_OS_LINUX
+	, INotifyFd_ (inotify_init1 (IN_NONBLOCK | IN_CLOEXEC))
+	, Notifier_ (0)
+	, WatchLimitReached_ (false)
+	, Overflowed_ (false)
+#else
 	, Watcher_ (new QFileSystemWatcher (this))
+#endif
 	, ScanTimer_ (new QTimer (this))
 	{
+#ifdef Q_OS_LINUX
+		if (INotifyFd_ >= 0)
+		{
+			Notifier_ = new QSocketNotifier (INotifyFd_, QSocketNotifier::Read, this);
+			connect (Notifier_,
+					SIGNAL (activated (int)),
+					this,
+					SLOT (handleINotifyActivated ()));
+		}
+		else
+			qWarning () << Q_FUNC_INFO
+					<< "unable to initialize inotify, collection won't be watched:"
+					<< strerror (errno);
+#else
 		connect (Watcher_,
 				SIGNAL (directoryChanged (QString)),
 				this,
 				SLOT (handleDirectoryChanged (QString)));
+#endif
 
 		ScanTimer_->setSingleShot (true);
 		connect (ScanTimer_,
 				SIGNAL (timeout ()),
 				this,
 				SLOT (rescanQueue ()));
+
+		LoadTrees ();
+	}
+
+	LocalCollectionWatcher::~LocalCollectionWatcher ()
+	{
+#ifdef Q_OS_LINUX
+		delete Notifier_;
+		if (INotifyFd_ >= 0)
+			close (INotifyFd_);
+#endif
 	}
 
 	namespace
 	{
-		QStringList CollectSubdirs (const QString& path)
+		void CollectDirTree (const QString& path, bool followSymlinks,
+				LocalCollectionWatcher::DirTree_t& result)
 		{
-			QDir dir (path);
-			const auto& list = dir.entryList (QDir::Dirs | QDir::NoDotAndDotDot);
+			result [path] = QFileInfo (path).lastModified ();
+
+			QDir::Filters filters = QDir::Dirs | QDir::NoDotAndDotDot;
+			if (!followSymlinks)
+				filters |= QDir::NoSymLinks;
+
+			Q_FOREACH (const auto& info, QDir (path).entryInfoList (filters))
+			{
+				const auto& subdir = info.absoluteFilePath ();
+				if (!result.contains (subdir))
+					CollectDirTree (subdir, followSymlinks, result);
+			}
+		}
 
-			QStringList result (path);
-			std::for_each (list.begin (), list.end (),
-					[&dir, &result] (decltype (list.front ()) item)
-						{ result += CollectSubdirs (dir.filePath (item)); });
+		LocalCollectionWatcher::DirTree_t CollectDirTree (const QString& path)
+		{
+			const bool symLinks = XmlSettingsManager::Instance ()
+					.property ("FollowSymLinks").toBool ();
+
+			LocalCollectionWatcher::DirTree_t result;
+			CollectDirTree (path, symLinks, result);
 			return result;
 		}
+
+		typedef LocalCollectionWatcher::DirTree_t (*Collector_f) (const QString&);
+
+		void RunCollector (QObject *watcher, const QString& path, const char *slot)
+		{
+			auto futureWatcher = new QFutureWatcher<LocalCollectionWatcher::DirTree_t> ();
+			futureWatcher->setProperty ("Path", path);
+			QObject::connect (futureWatcher,
+					SIGNAL (finished ()),
+					watcher,
+					slot);
+
+			futureWatcher->setFuture (QtConcurrent::run (static_cast<Collector_f> (CollectDirTree), path));
+		}
+
+		void RemoveSubtree (LocalCollectionWatcher::DirTree_t& tree, const QString& dir)
+		{
+			const auto& prefix = dir + '/';
+			for (auto i = tree.begin (); i != tree.end (); )
+				if (i.key () == dir || i.key ().startsWith (prefix))
+					i = tree.erase (i);
+				else
+					++i;
+		}
+
+		QString GetTreesPath ()
+		{
+			return Util::CreateIfNotExists ("lmp").filePath ("dirtree.dat");
+		}
 	}
 
 	void LocalCollectionWatcher::AddPath (const QString& path)
 	{
 		qDebug () << Q_FUNC_INFO << "scanning" << path;
-		auto watcher = new QFutureWatcher<QStringList> ();
-		watcher->setProperty ("Path", path);
-		connect (watcher,
-				SIGNAL (finished ()),
-				this,
-				SLOT (handleSubdirsCollected ()));
-
-		watcher->setFuture (QtConcurrent::run (CollectSubdirs, path));
+		RunCollector (this, path, SLOT (handleSubdirsCollected ()));
 	}
 
 	void LocalCollectionWatcher::RemovePath (const QString& path)
 	{
-		Watcher_->removePaths (Dir2Subdirs_ [path]);
+#ifdef Q_OS_LINUX
+		RemoveWatches (path);
+#else
+		Watcher_->removePaths (Trees_ [path].keys ());
+#endif
+
+		Trees_.remove (path);
+		SavedTrees_.remove (path);
+		SaveTrees ();
 	}
 
-	void LocalCollectionWatcher::ScheduleDir (const QString& dir)
+	bool LocalCollectionWatcher::CatchUp (const QString& path)
+	{
+		if (!SavedTrees_.contains (path))
+			return false;
+
+		qDebug () << Q_FUNC_INFO << "catching up with" << path;
+		RunCollector (this, path, SLOT (handleCatchUpCollected ()));
+		return true;
+	}
+
+#ifdef Q_OS_LINUX
+	void LocalCollectionWatcher::AddWatches (const QStringList& dirs)
+	{
+		if (INotifyFd_ < 0)
+			return;
+
+		for (const auto& dir : dirs)
+		{
+			if (Dir2WD_.contains (dir))
+				continue;
+
+			const int wd = inotify_add_watch (INotifyFd_,
+					QFile::encodeName (dir).constData (), WatchMask);
+			if (wd < 0)
+			{
+				if (errno == ENOSPC)
+				{
+					if (!WatchLimitReached_)
+						qWarning () << Q_FUNC_INFO
+								<< "inotify watches limit reached, consider raising"
+								<< "fs.inotify.max_user_watches; changes in some directories"
+								<< "will only be noticed on next startup";
+					WatchLimitReached_ = true;
+					return;
+				}
+
+				qWarning () << Q_FUNC_INFO
+						<< "unable to watch"
+						<< dir
+						<< strerror (errno);
+				continue;
+			}
+
+			WD2Dir_ [wd] = dir;
+			Dir2WD_ [dir] = wd;
+		}
+	}
+
+	void LocalCollectionWatcher::RemoveWatches (const QString& dir)
+	{
+		const auto& prefix = dir + '/';
+		for (auto i = Dir2WD_.begin (); i != Dir2WD_.end (); )
+			if (i.key () == dir || i.key ().startsWith (prefix))
+			{
+				inotify_rm_watch (INotifyFd_, *i);
+				WD2Dir_.remove (*i);
+				i = Dir2WD_.erase (i);
+			}
+			else
+				++i;
+	}
+
+	void LocalCollectionWatcher::HandleEvent (int wd, quint32 mask, const QString& name)
+	{
+		if (mask & IN_Q_OVERFLOW)
+		{
+			Overflowed_ = true;
+			return;
+		}
+
+		if (mask & IN_IGNORED)
+		{
+			const auto& dir = WD2Dir_.take (wd);
+			if (Dir2WD_.value (dir, -1) == wd)
+				Dir2WD_.remove (dir);
+			return;
+		}
+
+		const auto& dir = WD2Dir_.value (wd);
+		if (dir.isEmpty () || name.isEmpty ())
+			return;
+
+		const auto& path = dir + '/' + name;
+		TouchedDirs_ << dir;
+
+		if (mask & (IN_CREATE | IN_MOVED_TO | IN_CLOSE_WRITE))
+		{
+			if (mask & IN_ISDIR)
+				NewDirs_ << path;
+			else if (mask & IN_CREATE)
+				return;
+
+			ChangedPaths_ << path;
+			RemovedPaths_.remove (path);
+		}
+		else if (mask & (IN_DELETE | IN_MOVED_FROM))
+		{
+			if (mask & IN_ISDIR)
+			{
+				RemoveWatches (path);
+				NewDirs_.remove (path);
+			}
+
+			RemovedPaths_ << path;
+			ChangedPaths_.remove (path);
+		}
+	}
+#endif
+
+	void LocalCollectionWatcher::ScheduleFlush ()
 	{
 		if (ScanTimer_->isActive ())
 			ScanTimer_->stop ();
-		ScanTimer_->start (2000);
+		ScanTimer_->start (FlushDelay);
+	}
+
+	QString LocalCollectionWatcher::FindRoot (const QString& path) const
+	{
+		for (auto i = Trees_.begin (), end = Trees_.end (); i != end; ++i)
+			if (path == i.key () || path.startsWith (i.key () + '/'))
+				return i.key ();
+
+		return QString ();
+	}
 
-		if (!ScheduledDirs_.contains (dir))
-			ScheduledDirs_ << dir;
+	void LocalCollectionWatcher::LoadTrees ()
+	{
+		QFile file (GetTreesPath ());
+		if (!file.exists ())
+			return;
+
+		if (!file.open (QIODevice::ReadOnly))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to open"
+					<< file.fileName ()
+					<< file.errorString ();
+			return;
+		}
+
+		QDataStream in (&file);
+		quint8 version = 0;
+		in >> version;
+		if (version != 1)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unknown version"
+					<< version;
+			return;
+		}
+
+		in >> SavedTrees_;
+	}
+
+	void LocalCollectionWatcher::SaveTrees () const
+	{
+		auto trees = Trees_;
+		for (auto i = SavedTrees_.begin (), end = SavedTrees_.end (); i != end; ++i)
+			trees [i.key ()] = *i;
+
+		QFile file (GetTreesPath ());
+		if (!file.open (QIODevice::WriteOnly))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to open"
+					<< file.fileName ()
+					<< file.errorString ();
+			return;
+		}
+
+		QDataStream out (&file);
+		out << static_cast<quint8> (1)
+				<< trees;
 	}
 
 	void LocalCollectionWatcher::handleSubdirsCollected ()
 	{
-		auto watcher = dynamic_cast<QFutureWatcher<QStringList>*> (sender ());
+		auto watcher = dynamic_cast<QFutureWatcher<DirTree_t>*> (sender ());
 		if (!watcher)
 			return;
 
 		watcher->deleteLater ();
 
-		const auto& paths = watcher->result ();
+		const auto& tree = watcher->result ();
 		const auto& path = watcher->property ("Path").toString ();
-		Dir2Subdirs_ [path] = paths;
-		Watcher_->addPaths (paths);
+		Trees_ [path] = tree;
+
+#ifdef Q_OS_LINUX
+		AddWatches (tree.keys ());
+#else
+		Watcher_->addPaths (tree.keys ());
+#endif
+
+		SaveTrees ();
+	}
+
+	void LocalCollectionWatcher::handleCatchUpCollected ()
+	{
+		auto watcher = dynamic_cast<QFutureWatcher<DirTree_t>*> (sender ());
+		if (!watcher)
+			return;
+
+		watcher->deleteLater ();
+
+		const auto& tree = watcher->result ();
+		const auto& path = watcher->property ("Path").toString ();
+		const auto& saved = SavedTrees_.take (path);
+
+		QStringList changed;
+		for (auto i = tree.begin (), end = tree.end (); i != end; ++i)
+			if (saved.value (i.key ()) != *i)
+				changed << i.key ();
+
+		QStringList removed;
+		for (auto i = saved.begin (), end = saved.end (); i != end; ++i)
+			if (!tree.contains (i.key ()))
+				removed << i.key ();
+
+		qDebug () << Q_FUNC_INFO
+				<< path
+				<< ":"
+				<< changed.size ()
+				<< "changed and"
+				<< removed.size ()
+				<< "removed directories out of"
+				<< tree.size ();
+
+		auto collection = Core::Instance ().GetLocalCollection ();
+		if (!removed.isEmpty ())
+			collection->RemoveFiles (removed);
+		if (!changed.isEmpty ())
+			collection->RescanDirs (changed);
+
+		if (Trees_.contains (path))
+			Trees_ [path] = tree;
+		SaveTrees ();
+	}
+
+	void LocalCollectionWatcher::handleNewDirCollected ()
+	{
+		auto watcher = dynamic_cast<QFutureWatcher<DirTree_t>*> (sender ());
+		if (!watcher)
+			return;
+
+		watcher->deleteLater ();
+
+		// The directory or its root may have been removed meanwhile.
+		const auto& path = watcher->property ("Path").toString ();
+		const auto& root = FindRoot (path);
+		if (root.isEmpty () || !QFileInfo (path).isDir ())
+			return;
+
+		const auto& subtree = watcher->result ();
+#ifdef Q_OS_LINUX
+		AddWatches (subtree.keys ());
+#endif
+
+		auto& tree = Trees_ [root];
+		for (auto i = subtree.begin (), end = subtree.end (); i != end; ++i)
+			tree [i.key ()] = *i;
+
+		SaveTrees ();
+	}
+
+	void LocalCollectionWatcher::handleINotifyActivated ()
+	{
+#ifdef Q_OS_LINUX
+		std::vector<char> buf (64 * 1024);
+		while (true)
+		{
+			const auto len = read (INotifyFd_, buf.data (), buf.size ());
+			if (len <= 0)
+				break;
+
+			for (auto ptr = buf.data (); ptr < buf.data () + len; )
+			{
+				const auto event = reinterpret_cast<const inotify_event*> (ptr);
+				ptr += sizeof (inotify_event) + event->len;
+
+				const auto& name = event->len ?
+						QFile::decodeName (event->name) :
+						QString ();
+				HandleEvent (event->wd, event->mask, name);
+			}
+		}
+
+		ScheduleFlush ();
+#endif
 	}
 
 	void LocalCollectionWatcher::handleDirectoryChanged (const QString& path)
 	{
-		ScheduleDir (path);
+#ifndef Q_OS_LINUX
+		if (!ScheduledDirs_.contains (path))
+			ScheduledDirs_ << path;
+
+		ScheduleFlush ();
+#else
+		Q_UNUSED (path);
+#endif
 	}
 
 	void LocalCollectionWatcher::rescanQueue ()
 	{
+		auto collection = Core::Instance ().GetLocalCollection ();
+
+#ifdef Q_OS_LINUX
+		if (Overflowed_)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "inotify queue overflowed, rescanning everything";
+
+			Overflowed_ = false;
+			ChangedPaths_.clear ();
+			RemovedPaths_.clear ();
+			NewDirs_.clear ();
+			TouchedDirs_.clear ();
+
+			Q_FOREACH (const auto& root, Trees_.keys ())
+			{
+				AddPath (root);
+				collection->Scan (root, false);
+			}
+			return;
+		}
+
+		// The new directories may be whole trees moved into the
+		// collection, so they are walked in background.
+		for (const auto& dir : NewDirs_)
+			if (!FindRoot (dir).isEmpty ())
+				RunCollector (this, dir, SLOT (handleNewDirCollected ()));
+
+		for (const auto& path : RemovedPaths_)
+		{
+			const auto& root = FindRoot (path);
+			if (!root.isEmpty () && Trees_ [root].contains (path))
+				RemoveSubtree (Trees_ [root], path);
+		}
+
+		for (const auto& dir : TouchedDirs_)
+		{
+			const auto& root = FindRoot (dir);
+			if (!root.isEmpty () && Trees_ [root].contains (dir))
+				Trees_ [root] [dir] = QFileInfo (dir).lastModified ();
+		}
+
+		if (!RemovedPaths_.isEmpty ())
+			collection->RemoveFiles (RemovedPaths_.toList ());
+		if (!ChangedPaths_.isEmpty ())
+			collection->UpdateFiles (ChangedPaths_.toList ());
+
+		ChangedPaths_.clear ();
+		RemovedPaths_.clear ();
+		NewDirs_.clear ();
+		TouchedDirs_.clear ();
+
+		SaveTrees ();
+#else
 		Q_FOREACH (const auto& path, ScheduledDirs_)
-			Core::Instance ().GetLocalCollection ()->Scan (path, false);
+			collection->Scan (path, false);
 
 		ScheduledDirs_.clear ();
+#endif
 	}
 }
 }
@@ -22,32 +22,84 @@
 #include <QHash>
 #include <QSet>
 #include <QStringList>
+#include <QDateTime>
 
 class QFileSystemWatcher;
+class QSocketNotifier;
 class QTimer;
 
 namespace LeechCraft
 {
 namespace LMP
 {
+	/** Watches the collection root paths for changes.
+	 *
+	 * On Linux inotify is used directly, so the exact files that were
+	 * written, moved or deleted are known and only they are passed to
+	 * the collection. Elsewhere QFileSystemWatcher is used, and the whole
+	 * changed directory is rescanned.
+	 *
+	 * The watcher also keeps a persistent snapshot of the directories
+	 * under each root path along with their modification times, so that
+	 * the changes made while LMP wasn't running can be picked up by
+	 * rescanning only the directories whose contents have changed.
+	 */
 	class LocalCollectionWatcher : public QObject
 	{
 		Q_OBJECT
+	public:
+		typedef QHash<QString, QDateTime> DirTree_t;
+	private:
+		QHash<QString, DirTree_t> Trees_;
+		QHash<QString, DirTree_t> SavedTrees_;
 
-		QFileSystemWatcher *Watcher_;
-		QHash<QString, QStringList> Dir2Subdirs_;
+#ifdef Q_OS_LINUX
+		int INotifyFd_;
+		QSocketNotifier *Notifier_;
+		QHash<int, QString> WD2Dir_;
+		QHash<QString, int> Dir2WD_;
+		bool WatchLimitReached_;
 
+		QSet<QString> ChangedPaths_;
+		QSet<QString> RemovedPaths_;
+		QSet<QString> NewDirs_;
+		QSet<QString> TouchedDirs_;
+		bool Overflowed_;
+#else
+		QFileSystemWatcher *Watcher_;
 		QList<QString> ScheduledDirs_;
+#endif
+
 		QTimer *ScanTimer_;
 	public:
 		LocalCollectionWatcher (QObject* = 0);
+		~LocalCollectionWatcher ();
 
 		void AddPath (const QString&);
 		void RemovePath (const QString&);
+
+		/** Rescans the directories under the given root path that have
+		 * changed since the last time the snapshot was saved.
+		 *
+		 * Returns false if there is no snapshot for the root path, in
+		 * which case a full scan is needed.
+		 */
+		bool CatchUp (const QString&);
 	private:
-		void ScheduleDir (const QString&);
+		void AddWatches (const QStringList&);
+		void RemoveWatches (const QString&);
+		void HandleEvent (int, quint32, const QString&);
+		void ScheduleFlush ();
+
+		QString FindRoot (const QString&) const;
+
+		void LoadTrees ();
+		void SaveTrees () const;
 	private slots:
 		void handleSubdirsCollected ();
+		void handleCatchUpCollected ();
+		void handleNewDirCollected ();
+		void handleINotifyActivated ();
 		void handleDirectoryChanged (const QString&);
 		void rescanQueue ();
 	};
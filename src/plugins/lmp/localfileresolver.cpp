@@ -18,9 +18,23 @@
 
 #include "localfileresolver.h"
 #include <QtDebug>
+#include <QFile>
 #include <QFileInfo>
+#include <QElapsedTimer>
 #include <taglib/fileref.h>
 #include <taglib/tag.h>
+#include <taglib/taglib.h>
+
+#if TAGLIB_MAJOR_VERSION > 1 || TAGLIB_MINOR_VERSION >= 8
+#define LMP_TAGLIB_HAS_PROPERTIES
+#include <taglib/tpropertymap.h>
+#endif
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
 
 namespace LeechCraft
 {
@@ -41,34 +55,45 @@ namespace LMP
 		return Path_;
 	}
 
+	LocalFileResolver::FormatStats::FormatStats ()
+	: Files_ (0)
+	, Bytes_ (0)
+	, ParseNSecs_ (0)
+	{
+	}
+
 	LocalFileResolver::LocalFileResolver (QObject *parent)
 	: QObject (parent)
+	, Cache_ (5000)
 	{
 	}
 
 	TagLib::FileRef LocalFileResolver::GetFileRef (const QString& file) const
 	{
 #ifdef Q_OS_WIN32
-		return TagLib::FileRef (reinterpret_cast<const wchar_t*> (file.utf16 ()));
+		return TagLib::FileRef (reinterpret_cast<const wchar_t*> (file.utf16 ()),
+				true, TagLib::AudioProperties::Fast);
 #else
-		return TagLib::FileRef (file.toUtf8 ().constData ());
+		return TagLib::FileRef (file.toUtf8 ().constData (),
+				true, TagLib::AudioProperties::Fast);
 #endif
 	}
 
 	MediaInfo LocalFileResolver::ResolveInfo (const QString& file)
 	{
-		const auto& modified = QFileInfo (file).lastModified ();
+		const QFileInfo fi (file);
+		const auto& modified = fi.lastModified ();
 		{
-			QReadLocker locker (&CacheLock_);
-			if (Cache_.contains (file))
-			{
-				const auto& pair = Cache_ [file];
-				if (pair.first == modified)
-					return pair.second;
-			}
+			QMutexLocker locker (&CacheLock_);
+			if (const auto pair = Cache_.object (file))
+				if (pair->first == modified)
+					return pair->second;
 		}
 
-		QMutexLocker tlLocker (&TaglibMutex_);
+		QElapsedTimer timer;
+		timer.start ();
+
+		QMutexLocker tlLocker (&GetMutex (file));
 
 		auto r = GetFileRef (file);
 		auto tag = r.tag ();
@@ -93,18 +118,122 @@ namespace LMP
 			static_cast<qint32> (tag->year ()),
 			static_cast<qint32> (tag->track ())
 		};
+
+		tlLocker.unlock ();
+
+		{
+			QMutexLocker locker (&StatsLock_);
+			auto& stats = Stats_ [fi.suffix ().toLower ()];
+			++stats.Files_;
+			stats.Bytes_ += fi.size ();
+			stats.ParseNSecs_ += timer.nsecsElapsed ();
+		}
+
+		{
+			QMutexLocker locker (&CacheLock_);
+			Cache_.insert (file, new QPair<QDateTime, MediaInfo> (modified, info));
+		}
+		return info;
+	}
+
+	QMutex& LocalFileResolver::GetMutex (const QString& file)
+	{
+		return TaglibMutexes_ [qHash (file) % LockStripes];
+	}
+
+	void LocalFileResolver::Prefetch (const QStringList& files) const
+	{
+#ifdef Q_OS_LINUX
+		const off_t headSize = 256 * 1024;
+		const off_t tailSize = 128 * 1024;
+
+		for (const auto& file : files)
+		{
+			const int fd = open (QFile::encodeName (file).constData (), O_RDONLY);
+			if (fd < 0)
+				continue;
+
+			struct stat st;
+			if (!fstat (fd, &st))
+			{
+				posix_fadvise (fd, 0, headSize, POSIX_FADV_WILLNEED);
+				if (st.st_size > headSize + tailSize)
+					posix_fadvise (fd, st.st_size - tailSize, tailSize, POSIX_FADV_WILLNEED);
+			}
+
+			close (fd);
+		}
+#else
+		Q_UNUSED (files);
+#endif
+	}
+
+	void LocalFileResolver::ReadAhead (const QString& file) const
+	{
+#ifdef Q_OS_LINUX
+		const int fd = open (QFile::encodeName (file).constData (), O_RDONLY);
+		if (fd < 0)
+			return;
+
+		posix_fadvise (fd, 0, 0, POSIX_FADV_WILLNEED);
+		close (fd);
+#else
+		Q_UNUSED (file);
+#endif
+	}
+
+#ifdef LMP_TAGLIB_HAS_PROPERTIES
+	namespace
+	{
+		bool GetRGValue (const TagLib::PropertyMap& props, const char *key, double& value)
 		{
-			QWriteLocker locker (&CacheLock_);
-			if (Cache_.size () > 200)
-				Cache_.clear ();
-			Cache_ [file] = qMakePair (modified, info);
+			const auto pos = props.find (key);
+			if (pos == props.end () || pos->second.isEmpty ())
+				return false;
+
+			// Values look like "-7.03 dB" or "0.988525".
+			const auto& str = QString::fromUtf8 (pos->second.front ().toCString (true));
+			bool ok = false;
+			value = str.section (' ', 0, 0, QString::SectionSkipEmpty).toDouble (&ok);
+			return ok;
 		}
+	}
+#endif
+
+	ReplayGainInfo LocalFileResolver::ResolveReplayGain (const QString& file)
+	{
+		ReplayGainInfo info;
+#ifdef LMP_TAGLIB_HAS_PROPERTIES
+		QMutexLocker tlLocker (&GetMutex (file));
+
+		auto r = GetFileRef (file);
+		if (r.isNull ())
+			return info;
+
+		const auto& props = r.file ()->properties ();
+		info.HasTrack_ = GetRGValue (props, "REPLAYGAIN_TRACK_GAIN", info.TrackGain_);
+		if (info.HasTrack_)
+			GetRGValue (props, "REPLAYGAIN_TRACK_PEAK", info.TrackPeak_);
+
+		info.HasAlbum_ = GetRGValue (props, "REPLAYGAIN_ALBUM_GAIN", info.AlbumGain_);
+		if (info.HasAlbum_)
+			GetRGValue (props, "REPLAYGAIN_ALBUM_PEAK", info.AlbumPeak_);
+#else
+		Q_UNUSED (file);
+#endif
 		return info;
 	}
 
-	QMutex& LocalFileResolver::GetMutex ()
+	QHash<QString, LocalFileResolver::FormatStats> LocalFileResolver::GetFormatStats () const
+	{
+		QMutexLocker locker (&StatsLock_);
+		return Stats_;
+	}
+
+	void LocalFileResolver::ResetFormatStats ()
 	{
-		return TaglibMutex_;
+		QMutexLocker locker (&StatsLock_);
+		Stats_.clear ();
 	}
 }
 }
@@ -21,12 +21,14 @@
 #include <stdexcept>
 #include <QObject>
 #include <QHash>
-#include <QReadWriteLock>
+#include <QCache>
 #include <QMutex>
 #include <QDateTime>
+#include <QStringList>
 #include <taglib/fileref.h>
 #include "interfaces/lmp/itagresolver.h"
 #include "mediainfo.h"
+#include "transitions.h"
 
 namespace LeechCraft
 {
@@ -47,16 +49,61 @@ namespace LMP
 	{
 		Q_OBJECT
 		Q_INTERFACES (LeechCraft::LMP::ITagResolver)
+	public:
+		struct FormatStats
+		{
+			int Files_;
+			qint64 Bytes_;
+			qint64 ParseNSecs_;
+
+			FormatStats ();
+		};
+	private:
+		enum { LockStripes = 64 };
+		QMutex TaglibMutexes_ [LockStripes];
 
-		QMutex TaglibMutex_;
-		QReadWriteLock CacheLock_;
-		QHash<QString, QPair<QDateTime, MediaInfo>> Cache_;
+		QMutex CacheLock_;
+		QCache<QString, QPair<QDateTime, MediaInfo>> Cache_;
+
+		mutable QMutex StatsLock_;
+		QHash<QString, FormatStats> Stats_;
 	public:
 		LocalFileResolver (QObject* = 0);
 
 		TagLib::FileRef GetFileRef (const QString&) const;
 		MediaInfo ResolveInfo (const QString&);
-		QMutex& GetMutex ();
+
+		/** @brief Returns the mutex guarding TagLib access to the given file.
+		 *
+		 * Different files may map to different mutexes, so independent
+		 * files can be parsed concurrently.
+		 */
+		QMutex& GetMutex (const QString&);
+
+		/** @brief Hints the OS to read the tag-holding parts of the files.
+		 *
+		 * Only the beginning and the end of each file are requested,
+		 * which is where the tags of all supported formats live. This
+		 * function doesn't block.
+		 */
+		void Prefetch (const QStringList&) const;
+
+		/** @brief Hints the OS to read the whole file.
+		 *
+		 * This is used to get the next track into the page cache while
+		 * the current one is playing. This function doesn't block.
+		 */
+		void ReadAhead (const QString&) const;
+
+		/** @brief Reads the ReplayGain tags of the file.
+		 *
+		 * Gains are in dB, peaks are relative to full scale. Requires
+		 * TagLib 1.8 or newer, otherwise nothing is ever found.
+		 */
+		ReplayGainInfo ResolveReplayGain (const QString&);
+
+		QHash<QString, FormatStats> GetFormatStats () const;
+		void ResetFormatStats ();
 	};
 }
 }
@@ -19,15 +19,19 @@
 #include "player.h"
 #include <algorithm>
 #include <random>
+#include <cstdlib>
 #include <QStandardItemModel>
 #include <QFileInfo>
 #include <QDir>
 #include <QMimeData>
 #include <QUrl>
 #include <QtConcurrentRun>
+#include <QFutureWatcher>
 #include <QApplication>
+#include <QTimer>
 #include <phonon/mediaobject.h>
 #include <phonon/audiooutput.h>
+#include <phonon/volumefadereffect.h>
 #include <util/util.h>
 #include "core.h"
 #include "mediainfo.h"
@@ -37,7 +41,9 @@
 #include "playlistmanager.h"
 #include "staticplaylistmanager.h"
 #include "xmlsettingsmanager.h"
+#include "transitions.h"
 #include "playlistparsers/playlistfactory.h"
+#include "playlistparsers/playliststreamer.h"
 
 #if defined(Q_OS_WIN32)
 	#ifdef GetQObject
@@ -248,14 +254,28 @@ namespace LMP
 		return left.LocalPath_ < right.LocalPath_;
 	}
 
+	Player::TransitionStats::TransitionStats ()
+	: Gapless_ (0)
+	, Restarted_ (0)
+	, LateEnqueues_ (0)
+	, TotalLatencyMs_ (0)
+	, MaxLatencyMs_ (0)
+	, Underruns_ (0)
+	, UnderrunMs_ (0)
+	{
+	}
+
 	Player::Player (QObject *parent)
 	: QObject (parent)
 	, PlaylistModel_ (new PlaylistModel (this))
 	, Source_ (new Phonon::MediaObject (this))
 	, Output_ (new Phonon::AudioOutput (Phonon::MusicCategory, this))
 	, Path_ (Phonon::createPath (Source_, Output_))
+	, HasLazyItems_ (false)
 	, RadioItem_ (0)
+	, RGFader_ (0)
 	, PlayMode_ (PlayMode::Sequential)
+	, ExpectedSwitchMs_ (0)
 	{
 		qRegisterMetaType<QList<Phonon::MediaSource>> ("QList<Phonon::MediaSource>");
 		qRegisterMetaType<StringPair_t> ("StringPair_t");
@@ -275,6 +295,10 @@ namespace LMP
 				this, "setTransitionTime");
 		setTransitionTime ();
 
+		XmlSettingsManager::Instance ().RegisterObject ({ "EnableReplayGain", "ReplayGainMode", "ReplayGainPreamp" },
+				this, "handleReplayGainChanged");
+		handleReplayGainChanged ();
+
 		XmlSettingsManager::Instance ().RegisterObject ("SingleTrackDisplayMask",
 				this, "refillPlaylist");
 
@@ -289,7 +313,7 @@ namespace LMP
 		connect (Source_,
 				SIGNAL (stateChanged (Phonon::State, Phonon::State)),
 				this,
-				SLOT (handleStateChanged (Phonon::State)));
+				SLOT (handleStateChanged (Phonon::State, Phonon::State)));
 
 		connect (Source_,
 				SIGNAL (metaDataChanged ()),
@@ -337,6 +361,8 @@ namespace LMP
 
 		PlayMode_ = playMode;
 		emit playModeChanged (PlayMode_);
+
+		PrepareNextSource ();
 	}
 
 	QList<SortingCriteria> Player::GetSortingCriteria () const
@@ -353,18 +379,6 @@ namespace LMP
 		XmlSettingsManager::Instance ().setProperty ("SortingCriteria", SaveCriteria (criteria));
 	}
 
-	namespace
-	{
-		QList<Phonon::MediaSource> FileToSource (const QString& file)
-		{
-			auto parser = MakePlaylistParser (file);
-			if (parser)
-				return parser (file);
-
-			return QList<Phonon::MediaSource> () << Phonon::MediaSource (file);
-		}
-	}
-
 	void Player::PrepareURLInfo (const QUrl& url, const MediaInfo& info)
 	{
 		Url2Info_ [url] = info;
@@ -373,10 +387,24 @@ namespace LMP
 	void Player::Enqueue (const QStringList& paths, bool sort)
 	{
 		QList<Phonon::MediaSource> sources;
-		std::for_each (paths.begin (), paths.end (),
-				[&sources] (decltype (paths.front ()) path)
-					{ sources += FileToSource (path); });
-		Enqueue (sources, sort);
+		for (const auto& path : paths)
+		{
+			if (!MakeStreamingPlaylistParser (path))
+			{
+				sources << Phonon::MediaSource (path);
+				continue;
+			}
+
+			if (!sources.isEmpty ())
+				PendingEnqueue_ << PendingEnqueueItem { QString (), sources, sort };
+			sources.clear ();
+			PendingEnqueue_ << PendingEnqueueItem { path, QList<Phonon::MediaSource> (), sort };
+		}
+
+		if (!sources.isEmpty ())
+			PendingEnqueue_ << PendingEnqueueItem { QString (), sources, sort };
+
+		ProcessPendingEnqueue ();
 	}
 
 	void Player::Enqueue (const QList<Phonon::MediaSource>& sources, bool sort)
@@ -385,12 +413,22 @@ namespace LMP
 	}
 
 	void Player::ReplaceQueue (const QList<Phonon::MediaSource>& queue, bool sort)
+	{
+		CancelStreamers ();
+		ResetQueue (queue, sort);
+	}
+
+	void Player::ResetQueue (const QList<Phonon::MediaSource>& queue, bool sort)
 	{
 		PlaylistModel_->clear ();
 		Items_.clear ();
 		AlbumRoots_.clear ();
 		CurrentQueue_.clear ();
 
+		HasLazyItems_ = false;
+		LazyResolveQueue_.clear ();
+		LazyPending_.clear ();
+
 		AddToPlaylistModel (queue, sort);
 	}
 
@@ -468,6 +506,8 @@ namespace LMP
 
 		Core::Instance ().GetPlaylistManager ()->
 				GetStaticManager ()->SetOnLoadPlaylist (CurrentQueue_);
+
+		PrepareNextSource ();
 	}
 
 	void Player::SetStopAfter (const QModelIndex& index)
@@ -491,6 +531,8 @@ namespace LMP
 			CurrentStopSource_ = stopSource;
 			Items_ [stopSource]->setData (true, Role::IsStop);
 		}
+
+		PrepareNextSource ();
 	}
 
 	void Player::SetRadioStation (Media::IRadioStation_ptr station)
@@ -535,6 +577,11 @@ namespace LMP
 		return info;
 	}
 
+	Player::TransitionStats Player::GetTransitionStats () const
+	{
+		return TransitionStats_;
+	}
+
 	QString Player::GetCurrentAAPath () const
 	{
 		const auto& info = GetCurrentMediaInfo ();
@@ -675,9 +722,17 @@ namespace LMP
 
 	void Player::AddToPlaylistModel (QList<Phonon::MediaSource> sources, bool sort)
 	{
+		if (HasLazyItems_ && !sources.isEmpty ())
+		{
+			AppendLazily (sources);
+			Core::Instance ().GetPlaylistManager ()->
+					GetStaticManager ()->SetOnLoadPlaylist (CurrentQueue_);
+			return;
+		}
+
 		if (!CurrentQueue_.isEmpty ())
 		{
-			ReplaceQueue (CurrentQueue_ + sources, sort);
+			ResetQueue (CurrentQueue_ + sources, sort);
 			return;
 		}
 
@@ -699,6 +754,103 @@ namespace LMP
 		watcher->setFuture (QtConcurrent::run (worker));
 	}
 
+	void Player::EnqueuePlaylist (const QString& path, bool sort)
+	{
+		auto streamer = new PlaylistStreamer (MakeStreamingPlaylistParser (path), path, 1000, this);
+		streamer->setProperty ("LMP/Sort", sort);
+		connect (streamer,
+				SIGNAL (gotChunk (QList<Phonon::MediaSource>, bool)),
+				this,
+				SLOT (handlePlaylistChunk (QList<Phonon::MediaSource>, bool)));
+		connect (streamer,
+				SIGNAL (finished ()),
+				this,
+				SLOT (handleStreamerFinished ()));
+		Streamers_ << streamer;
+		streamer->Start ();
+	}
+
+	void Player::AppendLazily (const QList<Phonon::MediaSource>& sources)
+	{
+		PlaylistModel_->setHorizontalHeaderLabels (QStringList (tr ("Playlist")));
+
+		QList<QStandardItem*> items;
+		for (const auto& source : sources)
+		{
+			CurrentQueue_ << source;
+
+			auto item = new QStandardItem ();
+			item->setEditable (false);
+			item->setData (QVariant::fromValue (source), Role::Source);
+			switch (source.type ())
+			{
+			case Phonon::MediaSource::LocalFile:
+				item->setText (QFileInfo (source.fileName ()).fileName ());
+				break;
+			case Phonon::MediaSource::Url:
+				item->setText (source.url ().toString ());
+				break;
+			case Phonon::MediaSource::Stream:
+				item->setText (tr ("Stream"));
+				break;
+			default:
+				item->setText ("unknown");
+				break;
+			}
+
+			Items_ [source] = item;
+			items << item;
+		}
+
+		PlaylistModel_->invisibleRootItem ()->appendRows (items);
+
+		HasLazyItems_ = true;
+	}
+
+	void Player::ProcessPendingEnqueue ()
+	{
+		// Plain files following a playlist wait for its streamer to
+		// finish so that the queue keeps the original order.
+		while (Streamers_.isEmpty () && !PendingEnqueue_.isEmpty ())
+		{
+			const auto item = PendingEnqueue_.takeFirst ();
+			if (!item.Playlist_.isEmpty ())
+				EnqueuePlaylist (item.Playlist_, item.Sort_);
+			else
+				Enqueue (item.Sources_, item.Sort_);
+		}
+	}
+
+	void Player::CancelStreamers ()
+	{
+		for (auto streamer : Streamers_)
+			streamer->Cancel ();
+		Streamers_.clear ();
+		PendingEnqueue_.clear ();
+	}
+
+	void Player::RequestLazyInfo (const QModelIndex& index)
+	{
+		if (!HasLazyItems_ || index.data (Role::IsAlbum).toBool ())
+			return;
+
+		const auto& source = index.data (Role::Source).value<Phonon::MediaSource> ();
+		if (source.type () != Phonon::MediaSource::LocalFile ||
+				LazyPending_.contains (source))
+			return;
+
+		auto item = Items_.value (source);
+		if (!item || item->data (Role::Info).isValid ())
+			return;
+
+		LazyPending_ << source;
+		LazyResolveQueue_ << source;
+		if (LazyResolveQueue_.size () == 1)
+			QTimer::singleShot (0,
+					this,
+					SLOT (resolveLazyItems ()));
+	}
+
 	bool Player::HandleCurrentStop (const Phonon::MediaSource& source)
 	{
 		if (source != CurrentStopSource_)
@@ -710,6 +862,96 @@ namespace LMP
 		return true;
 	}
 
+	void Player::PlaySource (const Phonon::MediaSource& source)
+	{
+		AboutToFinishTimer_.invalidate ();
+
+		Source_->stop ();
+		Source_->setCurrentSource (source);
+		Source_->play ();
+	}
+
+	void Player::PrepareNextSource ()
+	{
+		if (CurrentStation_ ||
+				!XmlSettingsManager::Instance ().property ("PreloadNextTrack").toBool ())
+			return;
+
+		const auto& current = Source_->currentSource ();
+		if (current.type () == Phonon::MediaSource::Empty ||
+				current.type () == Phonon::MediaSource::Invalid)
+			return;
+
+		const auto& next = current == CurrentStopSource_ ?
+				Phonon::MediaSource () :
+				GetNextSource (current);
+		switch (GetPreloadAction (next, Source_->queue ()))
+		{
+		case PreloadAction::Keep:
+			return;
+		case PreloadAction::Clear:
+			Source_->clearQueue ();
+			return;
+		case PreloadAction::Replace:
+			Source_->setQueue (QList<Phonon::MediaSource> () << next);
+			break;
+		}
+
+		const auto& path = next.fileName ();
+		if (path.isEmpty ())
+			return;
+
+		Core::Instance ().GetLocalFileResolver ()->ReadAhead (path);
+		if (RGFader_ && !RGInfos_.contains (path))
+			ResolveReplayGainAsync (path);
+	}
+
+	void Player::ApplyReplayGain (const Phonon::MediaSource& source)
+	{
+		if (!RGFader_)
+			return;
+
+		const auto& path = source.fileName ();
+		if (path.isEmpty ())
+		{
+			RGFader_->setVolume (1);
+			return;
+		}
+
+		// Tags aren't read in the GUI thread right at the transition,
+		// the gain is applied once they are resolved in background.
+		if (!RGInfos_.contains (path))
+		{
+			RGFader_->setVolume (1);
+			ResolveReplayGainAsync (path);
+			return;
+		}
+
+		auto& xsm = XmlSettingsManager::Instance ();
+		const bool preferAlbum = xsm.property ("ReplayGainMode").toString () == "Album";
+		const double preamp = xsm.property ("ReplayGainPreamp").toDouble ();
+		RGFader_->setVolume (GetGainFactor (RGInfos_ [path], preferAlbum, preamp));
+	}
+
+	void Player::ResolveReplayGainAsync (const QString& path)
+	{
+		if (RGResolving_.contains (path))
+			return;
+
+		RGResolving_ << path;
+
+		typedef QPair<QString, ReplayGainInfo> Result_t;
+
+		auto resolver = Core::Instance ().GetLocalFileResolver ();
+		auto watcher = new QFutureWatcher<Result_t> ();
+		connect (watcher,
+				SIGNAL (finished ()),
+				this,
+				SLOT (handleReplayGainResolved ()));
+		watcher->setFuture (QtConcurrent::run (std::function<Result_t ()> ([resolver, path] ()
+				{ return qMakePair (path, resolver->ResolveReplayGain (path)); })));
+	}
+
 	void Player::UnsetRadio ()
 	{
 		if (!CurrentStation_)
@@ -782,10 +1024,7 @@ namespace LMP
 		switch (PlayMode_)
 		{
 		case PlayMode::Sequential:
-			if (pos != CurrentQueue_.end () && ++pos != CurrentQueue_.end ())
-				return *pos;
-			else
-				return Phonon::MediaSource ();
+			return GetFollowingSource (CurrentQueue_, current, false);
 		case PlayMode::Shuffle:
 			return GetRandomBy<int> (pos,
 					[this] (const Phonon::MediaSource& source)
@@ -801,27 +1040,11 @@ namespace LMP
 		case PlayMode::RepeatTrack:
 			return current;
 		case PlayMode::RepeatAlbum:
-		{
-			if (pos == CurrentQueue_.end ())
-				return Phonon::MediaSource ();
-
-			const auto& curAlbum = GetMediaInfo (*pos).Album_;
-			++pos;
-			if (pos == CurrentQueue_.end () ||
-					GetMediaInfo (*pos).Album_ != curAlbum)
-			{
-				do
-					--pos;
-				while (pos >= CurrentQueue_.begin () &&
-						GetMediaInfo (*pos).Album_ == curAlbum);
-				++pos;
-			}
-			return *pos;
-		}
+			return GetFollowingInGroup (CurrentQueue_, current,
+					[this] (const Phonon::MediaSource& source)
+						{ return GetMediaInfo (source).Album_; });
 		case PlayMode::RepeatWhole:
-			if (pos == CurrentQueue_.end () || ++pos == CurrentQueue_.end ())
-				pos = CurrentQueue_.begin ();
-			return *pos;
+			return GetFollowingSource (CurrentQueue_, current, true);
 		}
 
 		return Phonon::MediaSource ();
@@ -852,10 +1075,7 @@ namespace LMP
 			return;
 		}
 
-		Source_->stop ();
-		const auto& source = index.data (Role::Source).value<Phonon::MediaSource> ();
-		Source_->setCurrentSource (source);
-		Source_->play ();
+		PlaySource (index.data (Role::Source).value<Phonon::MediaSource> ());
 	}
 
 	void Player::previousTrack ()
@@ -879,9 +1099,7 @@ namespace LMP
 			next = *(--pos);
 		}
 
-		Source_->stop ();
-		Source_->setCurrentSource (next);
-		Source_->play ();
+		PlaySource (next);
 	}
 
 	void Player::nextTrack ()
@@ -899,9 +1117,7 @@ namespace LMP
 		if (next.type () == Phonon::MediaSource::Empty)
 			return;
 
-		Source_->stop ();
-		Source_->setCurrentSource (next);
-		Source_->play ();
+		PlaySource (next);
 	}
 
 	void Player::togglePause ()
@@ -944,6 +1160,11 @@ namespace LMP
 		Url2Info_.clear ();
 		Source_->clearQueue ();
 
+		CancelStreamers ();
+		HasLazyItems_ = false;
+		LazyResolveQueue_.clear ();
+		LazyPending_.clear ();
+
 		Core::Instance ().GetPlaylistManager ()->
 				GetStaticManager ()->SetOnLoadPlaylist (CurrentQueue_);
 	}
@@ -964,6 +1185,82 @@ namespace LMP
 		emit playerAvailable (true);
 	}
 
+	void Player::handlePlaylistChunk (const QList<Phonon::MediaSource>& sources, bool last)
+	{
+		auto streamer = static_cast<PlaylistStreamer*> (sender ());
+		if (!Streamers_.contains (streamer))
+			return;
+
+		const bool isFirst = !streamer->property ("LMP/GotChunks").toBool ();
+		streamer->setProperty ("LMP/GotChunks", true);
+
+		if (last)
+			Streamers_.removeAll (streamer);
+
+		// Small playlists fit into a single chunk, so they are handled
+		// just like before: resolved, sorted and grouped by albums.
+		if (isFirst && last && !HasLazyItems_)
+		{
+			if (!sources.isEmpty ())
+				AddToPlaylistModel (sources, streamer->property ("LMP/Sort").toBool ());
+			ProcessPendingEnqueue ();
+			return;
+		}
+
+		AppendLazily (sources);
+
+		if (last)
+			Core::Instance ().GetPlaylistManager ()->
+					GetStaticManager ()->SetOnLoadPlaylist (CurrentQueue_);
+
+		if (isFirst && Source_->state () == Phonon::StoppedState)
+		{
+			const auto& song = XmlSettingsManager::Instance ().property ("LastSong").toString ();
+			if (!song.isEmpty () && Items_.contains (Phonon::MediaSource (song)))
+				Source_->setCurrentSource (Phonon::MediaSource (song));
+		}
+	}
+
+	void Player::handleStreamerFinished ()
+	{
+		Streamers_.removeAll (static_cast<PlaylistStreamer*> (sender ()));
+		ProcessPendingEnqueue ();
+	}
+
+	void Player::resolveLazyItems ()
+	{
+		if (LazyResolveQueue_.isEmpty ())
+			return;
+
+		const auto sources = LazyResolveQueue_;
+		LazyResolveQueue_.clear ();
+
+		std::function<QList<QPair<Phonon::MediaSource, MediaInfo>> ()> worker =
+				[sources] { return PairResolveAll (sources); };
+
+		auto watcher = new QFutureWatcher<QList<QPair<Phonon::MediaSource, MediaInfo>>> ();
+		connect (watcher,
+				SIGNAL (finished ()),
+				this,
+				SLOT (handleLazyResolved ()));
+		watcher->setFuture (QtConcurrent::run (worker));
+	}
+
+	void Player::handleLazyResolved ()
+	{
+		auto watcher = dynamic_cast<QFutureWatcher<QList<QPair<Phonon::MediaSource, MediaInfo>>>*> (sender ());
+		watcher->deleteLater ();
+
+		for (const auto& pair : watcher->result ())
+		{
+			if (!LazyPending_.remove (pair.first))
+				continue;
+
+			if (auto item = Items_.value (pair.first))
+				FillItem (item, pair.second);
+		}
+	}
+
 	void Player::continueAfterSorted (const QList<QPair<Phonon::MediaSource, MediaInfo>>& sources)
 	{
 		CurrentQueue_.clear ();
@@ -1075,12 +1372,14 @@ namespace LMP
 		const auto& currentSource = Source_->currentSource ();
 		if (Items_.contains (currentSource))
 			Items_ [currentSource]->setData (true, Role::IsCurrent);
+
+		PrepareNextSource ();
 	}
 
 	void Player::restorePlaylist ()
 	{
 		auto staticMgr = Core::Instance ().GetPlaylistManager ()->GetStaticManager ();
-		Enqueue (staticMgr->GetOnLoadPlaylist ());
+		Enqueue (QStringList (staticMgr->GetOnLoadPlaylistPath ()));
 	}
 
 	void Player::handleStationError (const QString& error)
@@ -1146,19 +1445,39 @@ namespace LMP
 					Q_ARG (QString, path));
 
 		if (HandleCurrentStop (current))
+		{
+			Source_->clearQueue ();
+			return;
+		}
+
+		AboutToFinishTimer_.start ();
+		ExpectedSwitchMs_ = Source_->remainingTime ();
+
+		if (!Source_->queue ().isEmpty ())
 			return;
 
 		const auto& next = GetNextSource (current);
-		if (next.type () != Phonon::MediaSource::Empty)
-			Source_->enqueue (next);
+		if (next.type () == Phonon::MediaSource::Empty)
+			return;
+
+		if (XmlSettingsManager::Instance ().property ("PreloadNextTrack").toBool ())
+			++TransitionStats_.LateEnqueues_;
+		Source_->enqueue (next);
 	}
 
 	void Player::handlePlaybackFinished ()
 	{
-		if (!Source_->queue ().isEmpty ())
+		AboutToFinishTimer_.invalidate ();
+
+		auto queue = Source_->queue ();
+		if (!queue.isEmpty ())
 		{
-			auto queue = Source_->queue ();
-			Source_->setCurrentSource (Source_->queue ().takeFirst ());
+			++TransitionStats_.Restarted_;
+			qDebug () << Q_FUNC_INFO
+					<< "the backend has stopped instead of switching to"
+					<< queue.first ().fileName ();
+
+			Source_->setCurrentSource (queue.takeFirst ());
 			Source_->play ();
 			Source_->setQueue (queue);
 		}
@@ -1166,15 +1485,55 @@ namespace LMP
 			emit songChanged (MediaInfo ());
 	}
 
-	void Player::handleStateChanged (Phonon::State state)
+	void Player::handleStateChanged (Phonon::State state, Phonon::State oldState)
 	{
 		qDebug () << Q_FUNC_INFO << state;
 		if (state == Phonon::ErrorState)
 			qDebug () << Source_->errorType () << Source_->errorString ();
+
+		if (state == Phonon::BufferingState && oldState == Phonon::PlayingState)
+		{
+			++TransitionStats_.Underruns_;
+			UnderrunTimer_.start ();
+		}
+		else if (oldState == Phonon::BufferingState && UnderrunTimer_.isValid ())
+		{
+			TransitionStats_.UnderrunMs_ += UnderrunTimer_.elapsed ();
+			UnderrunTimer_.invalidate ();
+		}
 	}
 
 	void Player::handleCurrentSourceChanged (const Phonon::MediaSource& source)
 	{
+		if (AboutToFinishTimer_.isValid ())
+		{
+			const auto latency = AboutToFinishTimer_.elapsed () - ExpectedSwitchMs_;
+			AboutToFinishTimer_.invalidate ();
+
+			auto& stats = TransitionStats_;
+			++stats.Gapless_;
+			stats.TotalLatencyMs_ += std::abs (latency);
+			stats.MaxLatencyMs_ = std::max (stats.MaxLatencyMs_, std::abs (latency));
+
+			qDebug () << Q_FUNC_INFO
+					<< "transition latency:"
+					<< latency
+					<< "ms; gapless:"
+					<< stats.Gapless_
+					<< "restarted:"
+					<< stats.Restarted_
+					<< "late enqueues:"
+					<< stats.LateEnqueues_
+					<< "underruns:"
+					<< stats.Underruns_
+					<< "("
+					<< stats.UnderrunMs_
+					<< "ms)";
+		}
+
+		ApplyReplayGain (source);
+		PrepareNextSource ();
+
 		XmlSettingsManager::Instance ().setProperty ("LastSong", source.fileName ());
 
 		QStandardItem *curItem = 0;
@@ -1184,7 +1543,17 @@ namespace LMP
 			curItem = Items_ [source];
 
 		if (curItem)
+		{
+			if (HasLazyItems_ &&
+					source.type () == Phonon::MediaSource::LocalFile &&
+					!curItem->data (Role::Info).isValid ())
+			{
+				LazyPending_.remove (source);
+				FillItem (curItem, PairResolve (source).second);
+			}
+
 			curItem->setData (true, Role::IsCurrent);
+		}
 
 		if (Url2Info_.contains (source.url ()))
 		{
@@ -1246,5 +1615,58 @@ namespace LMP
 				.property ("TransitionTime").toInt ();
 		Source_->setTransitionTime (time);
 	}
+
+	void Player::handleReplayGainChanged ()
+	{
+		const bool enable = XmlSettingsManager::Instance ()
+				.property ("EnableReplayGain").toBool ();
+		if (enable && !RGFader_)
+		{
+			RGFader_ = new Phonon::VolumeFaderEffect (this);
+			if (!Path_.insertEffect (RGFader_))
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "unable to insert volume fader effect, ReplayGain won't work";
+				delete RGFader_;
+				RGFader_ = 0;
+				return;
+			}
+		}
+		else if (!enable && RGFader_)
+		{
+			Path_.removeEffect (RGFader_);
+			delete RGFader_;
+			RGFader_ = 0;
+			RGInfos_.clear ();
+			RGResolving_.clear ();
+			return;
+		}
+
+		ApplyReplayGain (Source_->currentSource ());
+	}
+
+	void Player::handleReplayGainResolved ()
+	{
+		typedef QPair<QString, ReplayGainInfo> Result_t;
+
+		auto watcher = dynamic_cast<QFutureWatcher<Result_t>*> (sender ());
+		if (!watcher)
+			return;
+
+		watcher->deleteLater ();
+
+		const auto& result = watcher->result ();
+		if (!RGResolving_.remove (result.first) || !RGFader_)
+			return;
+
+		if (RGInfos_.size () > 256)
+			RGInfos_.clear ();
+
+		RGInfos_ [result.first] = result.second;
+
+		const auto& current = Source_->currentSource ();
+		if (current.fileName () == result.first)
+			ApplyReplayGain (current);
+	}
 }
 }
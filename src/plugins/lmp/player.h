@@ -20,6 +20,8 @@
 
 #include <functional>
 #include <QObject>
+#include <QElapsedTimer>
+#include <QSet>
 
 #ifdef ENABLE_MPRIS
 #include <qdbuscontext.h>
@@ -30,6 +32,7 @@
 #include <interfaces/media/iradiostation.h>
 #include "mediainfo.h"
 #include "sortingcriteria.h"
+#include "localfileresolver.h"
 
 class QModelIndex;
 class QStandardItem;
@@ -40,6 +43,7 @@ namespace Phonon
 {
 	class MediaObject;
 	class AudioOutput;
+	class VolumeFaderEffect;
 }
 
 typedef QPair<QString, QString> StringPair_t;
@@ -49,6 +53,7 @@ namespace LeechCraft
 namespace LMP
 {
 	struct MediaInfo;
+	class PlaylistStreamer;
 
 	class Player : public QObject
 #ifdef ENABLE_MPRIS
@@ -66,6 +71,29 @@ namespace LMP
 		QHash<Phonon::MediaSource, QStandardItem*> Items_;
 		QHash<QString, QList<QStandardItem*>> AlbumRoots_;
 
+		/** Playlist files that are being parsed and whose sources are
+		 * appended to the queue chunk by chunk.
+		 */
+		QList<PlaylistStreamer*> Streamers_;
+
+		/** Enqueued playlists and plain files waiting for the preceding
+		 * playlists to be streamed.
+		 */
+		struct PendingEnqueueItem
+		{
+			QString Playlist_;
+			QList<Phonon::MediaSource> Sources_;
+			bool Sort_;
+		};
+		QList<PendingEnqueueItem> PendingEnqueue_;
+
+		/** Whether there are items in the queue whose info is resolved
+		 * only when they are shown.
+		 */
+		bool HasLazyItems_;
+		QList<Phonon::MediaSource> LazyResolveQueue_;
+		QSet<Phonon::MediaSource> LazyPending_;
+
 		Phonon::MediaSource CurrentStopSource_;
 
 		Media::IRadioStation_ptr CurrentStation_;
@@ -73,6 +101,40 @@ namespace LMP
 		QHash<QUrl, MediaInfo> Url2Info_;
 
 		MediaInfo LastPhononMediaInfo_;
+
+		Phonon::VolumeFaderEffect *RGFader_;
+		QHash<QString, ReplayGainInfo> RGInfos_;
+		QSet<QString> RGResolving_;
+	public:
+		struct TransitionStats
+		{
+			/** Transitions done by the backend from the queue.
+			 */
+			int Gapless_;
+
+			/** Transitions where the backend stopped and the next source
+			 * had to be started manually, which means an audible gap.
+			 */
+			int Restarted_;
+
+			/** Transitions where the next source was only enqueued in
+			 * aboutToFinish() instead of being prepared beforehand.
+			 */
+			int LateEnqueues_;
+
+			qint64 TotalLatencyMs_;
+			qint64 MaxLatencyMs_;
+
+			int Underruns_;
+			qint64 UnderrunMs_;
+
+			TransitionStats ();
+		};
+	private:
+		TransitionStats TransitionStats_;
+		QElapsedTimer AboutToFinishTimer_;
+		qint64 ExpectedSwitchMs_;
+		QElapsedTimer UnderrunTimer_;
 	public:
 		enum class PlayMode
 		{
@@ -134,13 +196,34 @@ namespace LMP
 
 		MediaInfo GetCurrentMediaInfo () const;
 		QString GetCurrentAAPath () const;
+
+		TransitionStats GetTransitionStats () const;
+
+		/** Requests the info about the track at the given index to be
+		 * resolved if it has been enqueued lazily and hasn't been
+		 * resolved yet.
+		 *
+		 * This is intended to be called by the views for the rows
+		 * that are actually shown.
+		 */
+		void RequestLazyInfo (const QModelIndex&);
 	private:
 		MediaInfo GetMediaInfo (const Phonon::MediaSource&) const;
 		MediaInfo GetPhononMediaInfo () const;
 		void AddToPlaylistModel (QList<Phonon::MediaSource>, bool);
+		void EnqueuePlaylist (const QString&, bool);
+		void ResetQueue (const QList<Phonon::MediaSource>&, bool);
+		void AppendLazily (const QList<Phonon::MediaSource>&);
+		void ProcessPendingEnqueue ();
+		void CancelStreamers ();
 
 		bool HandleCurrentStop (const Phonon::MediaSource&);
 
+		void PlaySource (const Phonon::MediaSource&);
+		void PrepareNextSource ();
+		void ApplyReplayGain (const Phonon::MediaSource&);
+		void ResolveReplayGainAsync (const QString&);
+
 		void UnsetRadio ();
 
 		template<typename T>
@@ -158,6 +241,10 @@ namespace LMP
 		void shufflePlaylist ();
 	private slots:
 		void handleSorted ();
+		void handlePlaylistChunk (const QList<Phonon::MediaSource>&, bool);
+		void handleStreamerFinished ();
+		void resolveLazyItems ();
+		void handleLazyResolved ();
 		void continueAfterSorted (const QList<QPair<Phonon::MediaSource, MediaInfo>>&);
 
 		void restorePlaylist ();
@@ -167,11 +254,13 @@ namespace LMP
 		void postPlaylistCleanup (const QString&);
 		void handleUpdateSourceQueue ();
 		void handlePlaybackFinished ();
-		void handleStateChanged (Phonon::State);
+		void handleStateChanged (Phonon::State, Phonon::State);
 		void handleCurrentSourceChanged (const Phonon::MediaSource&);
 		void handleMetadata ();
 		void refillPlaylist ();
 		void setTransitionTime ();
+		void handleReplayGainChanged ();
+		void handleReplayGainResolved ();
 	signals:
 		void songChanged (const MediaInfo&);
 		void indexChanged (const QModelIndex&);
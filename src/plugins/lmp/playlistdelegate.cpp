@@ -31,9 +31,10 @@ namespace LMP
 {
 	const int Padding = 2;
 
-	PlaylistDelegate::PlaylistDelegate (QTreeView *view, QObject *parent)
+	PlaylistDelegate::PlaylistDelegate (QTreeView *view, Player *player, QObject *parent)
 	: QStyledItemDelegate (parent)
 	, View_ (view)
+	, Player_ (player)
 	{
 	}
 
@@ -79,7 +80,10 @@ namespace LMP
 			const QStyleOptionViewItem& optionOld, const QModelIndex& index) const
 	{
 		QStyleOptionViewItemV4 option = optionOld;
-		const auto& info = index.data (Player::Role::Info).value<MediaInfo> ();
+		const auto& infoVar = index.data (Player::Role::Info);
+		if (!infoVar.isValid ())
+			Player_->RequestLazyInfo (index);
+		const auto& info = infoVar.value<MediaInfo> ();
 
 		QStyle *style = option.widget ?
 				option.widget->style () :
@@ -106,9 +110,13 @@ namespace LMP
 		}
 
 		style->drawPrimitive (QStyle::PE_PanelItemViewItem, &bgOpt, painter, option.widget);
-		QString lengthText = Util::MakeTimeFromLong (info.Length_);
-		if (lengthText.startsWith ("00:"))
-			lengthText = lengthText.mid (3);
+		QString lengthText;
+		if (infoVar.isValid ())
+		{
+			lengthText = Util::MakeTimeFromLong (info.Length_);
+			if (lengthText.startsWith ("00:"))
+				lengthText = lengthText.mid (3);
+		}
 
 		if (index.data (Player::Role::IsStop).toBool ())
 		{
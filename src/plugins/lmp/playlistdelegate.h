@@ -27,12 +27,14 @@ namespace LeechCraft
 namespace LMP
 {
 	struct MediaInfo;
+	class Player;
 
 	class PlaylistDelegate : public QStyledItemDelegate
 	{
 		QTreeView *View_;
+		Player *Player_;
 	public:
-		PlaylistDelegate (QTreeView*, QObject* = 0);
+		PlaylistDelegate (QTreeView*, Player*, QObject* = 0);
 
 		void paint (QPainter*, const QStyleOptionViewItem&, const QModelIndex&) const;
 		QSize sizeHint (const QStyleOptionViewItem&, const QModelIndex&) const;
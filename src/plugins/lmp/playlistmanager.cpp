@@ -26,6 +26,7 @@
 #include "staticplaylistmanager.h"
 #include "localcollection.h"
 #include "mediainfo.h"
+#include "smartplaylist.h"
 
 namespace LeechCraft
 {
@@ -91,6 +92,8 @@ namespace LMP
 	: QObject (parent)
 	, Model_ (new PlaylistModel (this))
 	, StaticRoot_ (new QStandardItem (tr ("Static playlists")))
+	, GenresRoot_ (new QStandardItem (tr ("By genre")))
+	, YearsRoot_ (new QStandardItem (tr ("By decade")))
 	, Static_ (new StaticPlaylistManager (this))
 	{
 		StaticRoot_->setEditable (false);
@@ -128,6 +131,52 @@ namespace LMP
 			item->setEditable (false);
 			dynamicRoot->appendRow (item);
 		}
+
+		auto addSmart = [] (QStandardItem *parent, const QString& name, const SmartPlaylist& rules)
+		{
+			auto item = new QStandardItem (name);
+			item->setData (PlaylistTypes::Smart, Roles::PlaylistType);
+			item->setData (QVariant::fromValue (rules), Roles::SmartRules);
+			item->setEditable (false);
+			parent->appendRow (item);
+		};
+
+		SmartPlaylist recentlyAdded;
+		recentlyAdded.AddedWithinDays_ = 30;
+		recentlyAdded.Order_ = SmartPlaylist::Order::RecentlyAdded;
+		addSmart (dynamicRoot, tr ("Recently added"), recentlyAdded);
+
+		SmartPlaylist recentlyPlayed;
+		recentlyPlayed.PlayedWithinDays_ = 7;
+		recentlyPlayed.Order_ = SmartPlaylist::Order::RecentlyPlayed;
+		addSmart (dynamicRoot, tr ("Recently played"), recentlyPlayed);
+
+		SmartPlaylist mostPlayed;
+		mostPlayed.MinPlaycount_ = 1;
+		mostPlayed.Order_ = SmartPlaylist::Order::MostPlayed;
+		mostPlayed.Limit_ = 100;
+		addSmart (dynamicRoot, tr ("100 most played tracks"), mostPlayed);
+
+		SmartPlaylist neverPlayed;
+		neverPlayed.MaxPlaycount_ = 0;
+		addSmart (dynamicRoot, tr ("Never played"), neverPlayed);
+
+		SmartPlaylist forgotten;
+		forgotten.MinPlaycount_ = 1;
+		forgotten.NotPlayedForDays_ = 90;
+		forgotten.Order_ = SmartPlaylist::Order::Random;
+		forgotten.Limit_ = 50;
+		addSmart (dynamicRoot, tr ("50 forgotten tracks"), forgotten);
+
+		for (auto root : { GenresRoot_, YearsRoot_ })
+		{
+			root->setEditable (false);
+			dynamicRoot->appendRow (root);
+		}
+
+		QTimer::singleShot (0,
+				this,
+				SLOT (setupSmartPlaylists ()));
 	}
 
 	QAbstractItemModel* PlaylistManager::GetPlaylistsModel () const
@@ -185,8 +234,10 @@ namespace LMP
 			return toSrcs (col->GetDynamicPlaylist (LocalCollection::DynamicPlaylist::Random50));
 		case PlaylistTypes::LovedTracks:
 			return toSrcs (col->GetDynamicPlaylist (LocalCollection::DynamicPlaylist::LovedTracks));
-			case PlaylistTypes::BannedTracks:
+		case PlaylistTypes::BannedTracks:
 			return toSrcs (col->GetDynamicPlaylist (LocalCollection::DynamicPlaylist::BannedTracks));
+		case PlaylistTypes::Smart:
+			return toSrcs (col->GetSmartPlaylist (index.data (Roles::SmartRules).value<SmartPlaylist> ()));
 		default:
 		{
 			QList<Phonon::MediaSource> result;
@@ -227,5 +278,68 @@ namespace LMP
 			StaticRoot_->appendRow (item);
 		}
 	}
+
+	void PlaylistManager::setupSmartPlaylists ()
+	{
+		auto col = Core::Instance ().GetLocalCollection ();
+		connect (col,
+				SIGNAL (collectionReady ()),
+				this,
+				SLOT (handleSmartPlaylistsChanged ()));
+		connect (col,
+				SIGNAL (smartPlaylistsChanged ()),
+				this,
+				SLOT (handleSmartPlaylistsChanged ()));
+
+		if (col->IsReady ())
+			handleSmartPlaylistsChanged ();
+	}
+
+	void PlaylistManager::handleSmartPlaylistsChanged ()
+	{
+		auto col = Core::Instance ().GetLocalCollection ();
+
+		auto setItems = [] (QStandardItem *root, const QList<QPair<QString, SmartPlaylist>>& lists)
+		{
+			while (root->rowCount ())
+				root->removeRow (0);
+
+			for (const auto& pair : lists)
+			{
+				auto item = new QStandardItem (pair.first);
+				item->setData (PlaylistTypes::Smart, Roles::PlaylistType);
+				item->setData (QVariant::fromValue (pair.second), Roles::SmartRules);
+				item->setEditable (false);
+				root->appendRow (item);
+			}
+		};
+
+		QList<QPair<QString, SmartPlaylist>> genres;
+		for (const auto& genre : col->GetGenres ())
+		{
+			SmartPlaylist rules;
+			rules.Genres_ << genre;
+			genres.append ({ genre, rules });
+		}
+		setItems (GenresRoot_, genres);
+
+		QList<int> decades;
+		for (auto year : col->GetYears ())
+		{
+			const int decade = year - year % 10;
+			if (!decades.contains (decade))
+				decades << decade;
+		}
+
+		QList<QPair<QString, SmartPlaylist>> years;
+		for (auto decade : decades)
+		{
+			SmartPlaylist rules;
+			rules.MinYear_ = decade;
+			rules.MaxYear_ = decade + 9;
+			years.append ({ tr ("%1s").arg (decade), rules });
+		}
+		setItems (YearsRoot_, years);
+	}
 }
 }
@@ -41,6 +41,8 @@ namespace LMP
 
 		QStandardItemModel *Model_;
 		QStandardItem *StaticRoot_;
+		QStandardItem *GenresRoot_;
+		QStandardItem *YearsRoot_;
 
 		StaticPlaylistManager *Static_;
 
@@ -50,11 +52,13 @@ namespace LMP
 			Static,
 			Random50,
 			LovedTracks,
-			BannedTracks
+			BannedTracks,
+			Smart
 		};
 		enum Roles
 		{
-			PlaylistType = IPlaylistProvider::ItemRoles::Max + 1
+			PlaylistType = IPlaylistProvider::ItemRoles::Max + 1,
+			SmartRules
 		};
 
 		QObjectList PlaylistProviders_;
@@ -74,6 +78,9 @@ namespace LMP
 		boost::optional<MediaInfo> TryResolveMediaInfo (const QUrl&) const;
 	private slots:
 		void handleStaticPlaylistsChanged ();
+
+		void setupSmartPlaylists ();
+		void handleSmartPlaylistsChanged ();
 	};
 }
 }
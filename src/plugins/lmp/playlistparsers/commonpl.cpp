@@ -25,30 +25,51 @@ namespace LeechCraft
 {
 namespace LMP
 {
-	QList<Phonon::MediaSource> CommonRead2Sources (const ReadParams& params)
+	bool CommonReadSources (const ReadParams& params, const SourceHandler_f& handler)
 	{
 		const auto& plDir = QFileInfo (params.Path_).absoluteDir ();
 
-		QList<Phonon::MediaSource> result;
-		Q_FOREACH (const auto& src, params.RawParser_ (params.Path_))
-		{
-			QUrl url (src);
-			if (!url.scheme ().isEmpty ())
-			{
-				result << (url.scheme () == "file" ? url.toLocalFile () : url);
-				continue;
-			}
+		return params.RawParser_ (params.Path_,
+				[&] (const QString& src) -> bool
+				{
+					QUrl url (src);
+					if (!url.scheme ().isEmpty ())
+						return handler (url.scheme () == "file" ?
+								Phonon::MediaSource (url.toLocalFile ()) :
+								Phonon::MediaSource (url));
 
-			const QFileInfo fi (src);
-			if (params.Suffixes_.contains (fi.suffix ()))
-				result += CommonRead2Sources ({ params.Suffixes_,
-							plDir.absoluteFilePath (src), params.RawParser_ });
-			else if (fi.isRelative ())
-				result << plDir.absoluteFilePath (src);
-			else
-				result << src;
-		}
+					const QFileInfo fi (src);
+					if (params.Suffixes_.contains (fi.suffix ()))
+						return CommonReadSources ({ params.Suffixes_,
+									plDir.absoluteFilePath (src), params.RawParser_ }, handler);
+					else if (fi.isRelative ())
+						return handler (plDir.absoluteFilePath (src));
+					else
+						return handler (src);
+				});
+	}
+
+	QList<Phonon::MediaSource> CommonRead2Sources (const ReadParams& params)
+	{
+		QList<Phonon::MediaSource> result;
+		CommonReadSources (params,
+				[&result] (const Phonon::MediaSource& src) -> bool
+				{
+					result << src;
+					return true;
+				});
+		return result;
+	}
 
+	QStringList CollectRawEntries (const RawStreamingParser_f& parser, const QString& path)
+	{
+		QStringList result;
+		parser (path,
+				[&result] (const QString& entry) -> bool
+				{
+					result << entry;
+					return true;
+				});
 		return result;
 	}
 }
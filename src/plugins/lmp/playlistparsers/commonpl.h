@@ -26,13 +26,38 @@ namespace LeechCraft
 {
 namespace LMP
 {
+	/** Called for each raw entry of a playlist as it is parsed.
+	 * Returning false stops parsing.
+	 */
+	typedef std::function<bool (const QString&)> RawEntryHandler_f;
+
+	/** Called for each source of a playlist as it is parsed.
+	 * Returning false stops parsing.
+	 */
+	typedef std::function<bool (const Phonon::MediaSource&)> SourceHandler_f;
+
+	typedef std::function<bool (const QString&, const RawEntryHandler_f&)> RawStreamingParser_f;
+
 	struct ReadParams
 	{
 		QStringList Suffixes_;
 		QString Path_;
 
-		std::function<QStringList (QString)> RawParser_;
+		RawStreamingParser_f RawParser_;
 	};
+
+	/** Parses the playlist, passing each source to the handler as
+	 * soon as it is read, without keeping the whole playlist in
+	 * memory. Nested playlists are expanded in place.
+	 *
+	 * Returns false if the handler requested to stop.
+	 */
+	bool CommonReadSources (const ReadParams&, const SourceHandler_f&);
+
 	QList<Phonon::MediaSource> CommonRead2Sources (const ReadParams&);
+
+	/** Collects the raw entries produced by the streaming parser.
+	 */
+	QStringList CollectRawEntries (const RawStreamingParser_f&, const QString&);
 }
 }
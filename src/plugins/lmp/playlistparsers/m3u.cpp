@@ -29,7 +29,7 @@ namespace LMP
 {
 namespace M3U
 {
-	QStringList Read (const QString& path)
+	bool ReadStreaming (const QString& path, const RawEntryHandler_f& handler)
 	{
 		QFile file (path);
 		if (!file.open (QIODevice::ReadOnly))
@@ -38,19 +38,24 @@ namespace M3U
 					<< "unable to open"
 					<< path
 					<< file.errorString ();
-			return QStringList ();
+			return true;
 		}
 
-		QStringList result;
 		while (!file.atEnd ())
 		{
 			const auto& line = file.readLine ().trimmed ();
-			if (line.startsWith ('#'))
+			if (line.isEmpty () || line.startsWith ('#'))
 				continue;
 
-			result << QString::fromUtf8 (line.constData ());
+			if (!handler (QString::fromUtf8 (line.constData ())))
+				return false;
 		}
-		return result;
+		return true;
+	}
+
+	QStringList Read (const QString& path)
+	{
+		return CollectRawEntries (ReadStreaming, path);
 	}
 
 	void Write (const QString& path, const QStringList& lines)
@@ -68,35 +73,45 @@ namespace M3U
 		file.write (lines.join ("\n").toUtf8 ());
 	}
 
-	QList<Phonon::MediaSource> Read2Sources (const QString& path)
+	bool ReadSources (const QString& path, const SourceHandler_f& handler)
 	{
 		const auto& m3uDir = QFileInfo (path).absoluteDir ();
 
-		QList<Phonon::MediaSource> result;
-		Q_FOREACH (QString src, Read (path))
-		{
-			QUrl url (src);
+		return ReadStreaming (path,
+				[&] (QString src) -> bool
+				{
+					QUrl url (src);
 #ifdef Q_OS_WIN32
-			if (url.scheme ().size () > 1)
+					if (url.scheme ().size () > 1)
 #else
-			if (!url.scheme ().isEmpty ())
+					if (!url.scheme ().isEmpty ())
 #endif
-			{
-				result << (url.scheme () == "file" ? url.toLocalFile () : url);
-				continue;
-			}
+						return handler (url.scheme () == "file" ?
+								Phonon::MediaSource (url.toLocalFile ()) :
+								Phonon::MediaSource (url));
 
-			src.replace ('\\', '/');
+					src.replace ('\\', '/');
 
-			const QFileInfo fi (src);
-			if (fi.isRelative ())
-				src = m3uDir.absoluteFilePath (src);
+					const QFileInfo fi (src);
+					if (fi.isRelative ())
+						src = m3uDir.absoluteFilePath (src);
 
-			if (fi.suffix () == "m3u" || fi.suffix () == "m3u8")
-				result += Read2Sources (src);
-			else
-				result << src;
-		}
+					if (fi.suffix () == "m3u" || fi.suffix () == "m3u8")
+						return ReadSources (src, handler);
+					else
+						return handler (src);
+				});
+	}
+
+	QList<Phonon::MediaSource> Read2Sources (const QString& path)
+	{
+		QList<Phonon::MediaSource> result;
+		ReadSources (path,
+				[&result] (const Phonon::MediaSource& src) -> bool
+				{
+					result << src;
+					return true;
+				});
 		return result;
 	}
 
@@ -20,6 +20,7 @@
 
 #include <QStringList>
 #include <phonon/mediasource.h>
+#include "commonpl.h"
 
 namespace LeechCraft
 {
@@ -27,9 +28,11 @@ namespace LMP
 {
 namespace M3U
 {
+	bool ReadStreaming (const QString&, const RawEntryHandler_f&);
 	QStringList Read (const QString&);
 	void Write (const QString&, const QStringList&);
 
+	bool ReadSources (const QString&, const SourceHandler_f&);
 	QList<Phonon::MediaSource> Read2Sources (const QString&);
 	void Write (const QString&, const QList<Phonon::MediaSource>&);
 }
@@ -36,5 +36,17 @@ namespace LMP
 
 		return PlaylistParser_f ();
 	}
+
+	StreamingPlaylistParser_f MakeStreamingPlaylistParser (const QString& file)
+	{
+		if (file.endsWith ("m3u") || file.endsWith ("m3u8"))
+			return M3U::ReadSources;
+		else if (file.endsWith ("xspf"))
+			return XSPF::ReadSources;
+		else if (file.endsWith ("pls"))
+			return PLS::ReadSources;
+
+		return StreamingPlaylistParser_f ();
+	}
 }
 }
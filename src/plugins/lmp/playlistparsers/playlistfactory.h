@@ -21,6 +21,7 @@
 #include <functional>
 #include <QString>
 #include <phonon/mediasource.h>
+#include "commonpl.h"
 
 namespace LeechCraft
 {
@@ -29,5 +30,9 @@ namespace LMP
 	typedef std::function<QList<Phonon::MediaSource> (const QString&)> PlaylistParser_f;
 
 	PlaylistParser_f MakePlaylistParser (const QString& filename);
+
+	typedef std::function<bool (const QString&, const SourceHandler_f&)> StreamingPlaylistParser_f;
+
+	StreamingPlaylistParser_f MakeStreamingPlaylistParser (const QString& filename);
 }
 }
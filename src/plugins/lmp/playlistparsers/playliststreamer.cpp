@@ -0,0 +1,86 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "playliststreamer.h"
+#include <functional>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
+
+namespace LeechCraft
+{
+namespace LMP
+{
+	PlaylistStreamer::PlaylistStreamer (const StreamingPlaylistParser_f& parser,
+			const QString& path, int chunkSize, QObject *parent)
+	: QObject (parent)
+	, Parser_ (parser)
+	, Path_ (path)
+	, ChunkSize_ (chunkSize)
+	, Cancelled_ (0)
+	, Watcher_ (new QFutureWatcher<void> (this))
+	{
+		connect (Watcher_,
+				SIGNAL (finished ()),
+				this,
+				SLOT (handleFinished ()));
+	}
+
+	QString PlaylistStreamer::GetPath () const
+	{
+		return Path_;
+	}
+
+	void PlaylistStreamer::Start ()
+	{
+		Watcher_->setFuture (QtConcurrent::run (std::function<void ()> ([this] { Run (); })));
+	}
+
+	void PlaylistStreamer::Cancel ()
+	{
+		Cancelled_.fetchAndStoreOrdered (1);
+	}
+
+	void PlaylistStreamer::Run ()
+	{
+		QList<Phonon::MediaSource> chunk;
+		const bool completed = Parser_ (Path_,
+				[this, &chunk] (const Phonon::MediaSource& source) -> bool
+				{
+					if (Cancelled_)
+						return false;
+
+					chunk << source;
+					if (chunk.size () >= ChunkSize_)
+					{
+						emit gotChunk (chunk, false);
+						chunk.clear ();
+					}
+					return true;
+				});
+
+		if (completed && !Cancelled_)
+			emit gotChunk (chunk, true);
+	}
+
+	void PlaylistStreamer::handleFinished ()
+	{
+		emit finished ();
+		deleteLater ();
+	}
+}
+}
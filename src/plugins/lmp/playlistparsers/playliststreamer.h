@@ -0,0 +1,75 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#pragma once
+
+#include <QObject>
+#include <QAtomicInt>
+#include <phonon/mediasource.h>
+#include "playlistfactory.h"
+
+template<typename T>
+class QFutureWatcher;
+
+namespace LeechCraft
+{
+namespace LMP
+{
+	/** Parses a playlist in a separate thread, emitting its sources
+	 * in chunks as soon as they are read.
+	 *
+	 * The streamer deletes itself once it's finished.
+	 */
+	class PlaylistStreamer : public QObject
+	{
+		Q_OBJECT
+
+		const StreamingPlaylistParser_f Parser_;
+		const QString Path_;
+		const int ChunkSize_;
+
+		QAtomicInt Cancelled_;
+
+		QFutureWatcher<void> *Watcher_;
+	public:
+		PlaylistStreamer (const StreamingPlaylistParser_f& parser,
+				const QString& path, int chunkSize, QObject* = 0);
+
+		QString GetPath () const;
+
+		void Start ();
+
+		/** Stops parsing as soon as possible. Chunks that have
+		 * already been emitted may still be delivered.
+		 */
+		void Cancel ();
+	private:
+		void Run ();
+	private slots:
+		void handleFinished ();
+	signals:
+		/** Emitted from the parsing thread. The last chunk may be
+		 * empty, and it is always emitted unless the streamer is
+		 * cancelled.
+		 */
+		void gotChunk (const QList<Phonon::MediaSource>& sources, bool last);
+
+		void finished ();
+	};
+}
+}
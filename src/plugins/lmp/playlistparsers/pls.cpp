@@ -17,9 +17,9 @@
  **********************************************************************/
 
 #include "pls.h"
+#include <QFile>
+#include <QtDebug>
 #include "commonpl.h"
-#include <algorithm>
-#include <QSettings>
 
 namespace LeechCraft
 {
@@ -27,29 +27,68 @@ namespace LMP
 {
 namespace PLS
 {
-	QStringList Read (const QString& path)
+	/* Entries are read line by line in the order they appear in the
+	 * file instead of being loaded via QSettings, which parses the
+	 * whole file first. Entries are practically always ordered by
+	 * their numbers anyway.
+	 */
+	bool ReadStreaming (const QString& path, const RawEntryHandler_f& handler)
 	{
-		QStringList result;
-
-		QSettings settings (path, QSettings::IniFormat);
-		settings.beginGroup ("playlist");
+		QFile file (path);
+		if (!file.open (QIODevice::ReadOnly))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to open"
+					<< path
+					<< file.errorString ();
+			return true;
+		}
 
-		const int numFiles = settings.value ("NumberOfEntries").toInt ();
-		for (int i = 1; i <= numFiles; ++i)
+		bool inPlaylist = false;
+		while (!file.atEnd ())
 		{
-			const auto& str = settings.value ("File" + QString::number (i)).toString ();
-			if (!str.isEmpty ())
-				result << str;
+			const auto& line = QString::fromUtf8 (file.readLine ()).trimmed ();
+			if (line.startsWith ('['))
+			{
+				inPlaylist = !line.compare ("[playlist]", Qt::CaseInsensitive);
+				continue;
+			}
+
+			if (!inPlaylist || !line.startsWith ("file", Qt::CaseInsensitive))
+				continue;
+
+			const int eqPos = line.indexOf ('=');
+			if (eqPos <= 0)
+				continue;
+
+			bool isNum = false;
+			line.mid (4, eqPos - 4).trimmed ().toInt (&isNum);
+			if (!isNum)
+				continue;
+
+			auto value = line.mid (eqPos + 1).trimmed ();
+			if (value.size () >= 2 && value.startsWith ('"') && value.endsWith ('"'))
+				value = value.mid (1, value.size () - 2);
+
+			if (!value.isEmpty () && !handler (value))
+				return false;
 		}
+		return true;
+	}
 
-		settings.endGroup ();
+	QStringList Read (const QString& path)
+	{
+		return CollectRawEntries (ReadStreaming, path);
+	}
 
-		return result;
+	bool ReadSources (const QString& path, const SourceHandler_f& handler)
+	{
+		return CommonReadSources ({ QStringList ("pls"), path, ReadStreaming }, handler);
 	}
 
 	QList<Phonon::MediaSource> Read2Sources (const QString& path)
 	{
-		return CommonRead2Sources ({ QStringList ("pls"), path, Read });
+		return CommonRead2Sources ({ QStringList ("pls"), path, ReadStreaming });
 	}
 }
 }
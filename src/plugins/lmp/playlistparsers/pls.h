@@ -20,6 +20,7 @@
 
 #include <QStringList>
 #include <phonon/mediasource.h>
+#include "commonpl.h"
 
 namespace LeechCraft
 {
@@ -27,7 +28,10 @@ namespace LMP
 {
 namespace PLS
 {
+	bool ReadStreaming (const QString&, const RawEntryHandler_f&);
 	QStringList Read (const QString&);
+
+	bool ReadSources (const QString&, const SourceHandler_f&);
 	QList<Phonon::MediaSource> Read2Sources (const QString&);
 }
 }
@@ -18,7 +18,8 @@
 
 #include "xspf.h"
 #include <QFile>
-#include <QDomDocument>
+#include <QXmlStreamReader>
+#include <QtDebug>
 #include "commonpl.h"
 
 namespace LeechCraft
@@ -27,7 +28,7 @@ namespace LMP
 {
 namespace XSPF
 {
-	QStringList Read (const QString& path)
+	bool ReadStreaming (const QString& path, const RawEntryHandler_f& handler)
 	{
 		QFile file (path);
 		if (!file.open (QIODevice::ReadOnly))
@@ -36,36 +37,76 @@ namespace XSPF
 					<< "unable to open"
 					<< path
 					<< file.errorString ();
-			return QStringList ();
+			return true;
 		}
 
-		QDomDocument doc;
-		if (!doc.setContent (file.readAll ()))
+		QXmlStreamReader reader (&file);
+
+		int depth = 0;
+		bool inTrackList = false;
+		bool inTrack = false;
+		bool gotLocation = false;
+		while (!reader.atEnd ())
 		{
+			switch (reader.readNext ())
+			{
+			case QXmlStreamReader::StartElement:
+			{
+				++depth;
+
+				const auto& name = reader.name ();
+				if (depth == 2 && name == QLatin1String ("trackList"))
+					inTrackList = true;
+				else if (depth == 3 && inTrackList && name == QLatin1String ("track"))
+				{
+					inTrack = true;
+					gotLocation = false;
+				}
+				else if (depth == 4 && inTrack && !gotLocation && name == QLatin1String ("location"))
+				{
+					gotLocation = true;
+
+					const auto& loc = reader.readElementText ().trimmed ();
+					--depth;
+					if (!loc.isEmpty () && !handler (loc))
+						return false;
+				}
+				break;
+			}
+			case QXmlStreamReader::EndElement:
+				if (depth == 2)
+					inTrackList = false;
+				else if (depth == 3)
+					inTrack = false;
+				--depth;
+				break;
+			default:
+				break;
+			}
+		}
+
+		if (reader.hasError ())
 			qWarning () << Q_FUNC_INFO
 					<< "unable to parse"
-					<< path;
-			return QStringList ();
-		}
+					<< path
+					<< reader.errorString ();
 
-		QStringList result;
-		auto track = doc.documentElement ()
-				.firstChildElement ("trackList")
-				.firstChildElement ("track");
-		while (!track.isNull ())
-		{
-			const auto& loc = track.firstChildElement ("location").text ();
-			if (!loc.isEmpty ())
-				result << loc;
+		return true;
+	}
 
-			track = track.nextSiblingElement ("track");
-		}
-		return result;
+	QStringList Read (const QString& path)
+	{
+		return CollectRawEntries (ReadStreaming, path);
+	}
+
+	bool ReadSources (const QString& path, const SourceHandler_f& handler)
+	{
+		return CommonReadSources ({ QStringList ("xspf"), path, ReadStreaming }, handler);
 	}
 
 	QList<Phonon::MediaSource> Read2Sources (const QString& path)
 	{
-		return CommonRead2Sources ({ QStringList ("xspf"), path, Read });
+		return CommonRead2Sources ({ QStringList ("xspf"), path, ReadStreaming });
 	}
 }
 }
@@ -143,7 +143,6 @@ namespace LMP
 		new Util::ClearLineEditAddon (Core::Instance ().GetProxy (), Ui_.SearchPlaylist_);
 
 		Ui_.BufferProgress_->hide ();
-		Ui_.Playlist_->setItemDelegate (new PlaylistDelegate (Ui_.Playlist_, Ui_.Playlist_));
 
 		connect (Ui_.SearchPlaylist_,
 				SIGNAL (textChanged (QString)),
@@ -177,6 +176,7 @@ namespace LMP
 				SLOT (handleBufferStatus (int)));
 
 		PlaylistFilter_->setSourceModel (Player_->GetPlaylistModel ());
+		Ui_.Playlist_->setItemDelegate (new PlaylistDelegate (Ui_.Playlist_, Player_, Ui_.Playlist_));
 		Ui_.Playlist_->setModel (PlaylistFilter_);
 		Ui_.Playlist_->expandAll ();
 
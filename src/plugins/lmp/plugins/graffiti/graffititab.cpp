@@ -224,7 +224,7 @@ namespace Graffiti
 		{
 			const auto& newInfo = pair.first;
 
-			QMutexLocker locker (&resolver->GetMutex ());
+			QMutexLocker locker (&resolver->GetMutex (newInfo.LocalPath_));
 			auto file = resolver->GetFileRef (newInfo.LocalPath_);
 			auto tag = file.tag ();
 
@@ -0,0 +1,84 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "smartplaylist.h"
+
+namespace LeechCraft
+{
+namespace LMP
+{
+	SmartPlaylist::SmartPlaylist ()
+	: MinYear_ (0)
+	, MaxYear_ (0)
+	, MinRating_ (0)
+	, MinPlaycount_ (0)
+	, MaxPlaycount_ (-1)
+	, PlayedWithinDays_ (0)
+	, NotPlayedForDays_ (0)
+	, AddedWithinDays_ (0)
+	, Order_ (Order::None)
+	, Limit_ (0)
+	{
+	}
+
+	bool SmartPlaylist::DependsOnStats () const
+	{
+		return MinRating_ > 0 ||
+				MinPlaycount_ > 0 ||
+				MaxPlaycount_ >= 0 ||
+				DependsOnTime () ||
+				Order_ == Order::MostPlayed ||
+				Order_ == Order::RecentlyPlayed ||
+				Order_ == Order::RecentlyAdded;
+	}
+
+	bool SmartPlaylist::DependsOnTime () const
+	{
+		return PlayedWithinDays_ > 0 ||
+				NotPlayedForDays_ > 0 ||
+				AddedWithinDays_ > 0;
+	}
+
+	bool SmartPlaylist::IsIncremental () const
+	{
+		return Order_ == Order::None && Limit_ <= 0;
+	}
+
+	QString SmartPlaylist::GetKey () const
+	{
+		QStringList genres;
+		for (const auto& genre : Genres_)
+			genres << genre.toLower ();
+		genres.sort ();
+
+		return QString ("%1|%2|%3|%4|%5|%6|%7|%8|%9")
+				.arg (genres.join (","))
+				.arg (MinYear_)
+				.arg (MaxYear_)
+				.arg (MinRating_)
+				.arg (MinPlaycount_)
+				.arg (MaxPlaycount_)
+				.arg (PlayedWithinDays_)
+				.arg (NotPlayedForDays_)
+				.arg (AddedWithinDays_) +
+			QString ("|%1|%2")
+				.arg (static_cast<int> (Order_))
+				.arg (Limit_);
+	}
+}
+}
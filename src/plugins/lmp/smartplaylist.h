@@ -0,0 +1,84 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#pragma once
+
+#include <QStringList>
+#include <QMetaType>
+
+namespace LeechCraft
+{
+namespace LMP
+{
+	/** Rules of a smart playlist.
+	 *
+	 * A track matches the playlist if it matches all the rules that
+	 * are set. Zero or negative values mean the corresponding rule
+	 * isn't set.
+	 */
+	struct SmartPlaylist
+	{
+		/** Any of these genres, case-insensitively.
+		 */
+		QStringList Genres_;
+
+		int MinYear_;
+		int MaxYear_;
+
+		int MinRating_;
+
+		int MinPlaycount_;
+		/** Unlike other rules, zero is a valid value here, meaning
+		 * "never played". Negative values disable the rule.
+		 */
+		int MaxPlaycount_;
+
+		int PlayedWithinDays_;
+		int NotPlayedForDays_;
+		int AddedWithinDays_;
+
+		enum class Order
+		{
+			None,
+			Random,
+			MostPlayed,
+			RecentlyPlayed,
+			RecentlyAdded
+		} Order_;
+
+		int Limit_;
+
+		SmartPlaylist ();
+
+		bool DependsOnStats () const;
+		bool DependsOnTime () const;
+
+		/** Returns whether the result can be updated track-by-track,
+		 * that is, whether adding or removing a single track can't
+		 * affect the other ones.
+		 */
+		bool IsIncremental () const;
+
+		/** Returns a string uniquely identifying these rules.
+		 */
+		QString GetKey () const;
+	};
+}
+}
+
+Q_DECLARE_METATYPE (LeechCraft::LMP::SmartPlaylist);
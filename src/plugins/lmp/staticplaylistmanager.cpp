@@ -48,6 +48,11 @@ namespace LMP
 		return ReadPlaylist (GetOnLoadPath ());
 	}
 
+	QString StaticPlaylistManager::GetOnLoadPlaylistPath () const
+	{
+		return GetOnLoadPath ();
+	}
+
 	namespace
 	{
 		QString GetFileName (QString playlist)
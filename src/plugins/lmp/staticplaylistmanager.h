@@ -36,6 +36,7 @@ namespace LMP
 
 		void SetOnLoadPlaylist (const QList<Phonon::MediaSource>&);
 		QList<Phonon::MediaSource> GetOnLoadPlaylist () const;
+		QString GetOnLoadPlaylistPath () const;
 
 		void SaveCustomPlaylist (QString, const QList<Phonon::MediaSource>&);
 		QStringList EnumerateCustomPlaylists () const;
@@ -79,7 +79,7 @@ namespace LMP
 
 		if (!Cloud2Uploaders_.contains (syncTo.Cloud_))
 			CreateUploader (syncTo.Cloud_);
-		Cloud2Uploaders_ [syncTo.Cloud_]->Upload ({ from != transcoded, syncTo.Account_, transcoded });
+		Cloud2Uploaders_ [syncTo.Cloud_]->Upload ({ ShouldRemoveTranscoded (from, transcoded), syncTo.Account_, transcoded });
 	}
 }
 }
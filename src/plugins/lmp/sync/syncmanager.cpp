@@ -115,7 +115,7 @@ namespace LMP
 		const CopyJob copyJob
 		{
 			transcoded,
-			from != transcoded,
+			ShouldRemoveTranscoded (from, transcoded),
 			syncTo.Syncer_,
 			from,
 			syncTo.MountPath_,
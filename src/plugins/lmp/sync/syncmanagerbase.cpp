@@ -102,6 +102,11 @@ namespace LMP
 		CheckTCFinished ();
 	}
 
+	bool SyncManagerBase::ShouldRemoveTranscoded (const QString& from, const QString& transcoded) const
+	{
+		return from != transcoded && !Transcoder_->IsCachedFile (transcoded);
+	}
+
 	void SyncManagerBase::handleStartedTranscoding (const QString& file)
 	{
 		emit uploadLog (tr ("File %1 started transcoding...")
@@ -47,6 +47,12 @@ namespace LMP
 	protected:
 		void AddFiles (const QStringList&, const TranscodingParams&);
 		void HandleFileTranscoded (const QString&, const QString&);
+
+		/** Returns whether the transcoded file should be removed after
+		 * it has been uploaded, that is, if it is neither the original
+		 * file nor an entry of the transcoded files cache.
+		 */
+		bool ShouldRemoveTranscoded (const QString& from, const QString& transcoded) const;
 	private:
 		void CheckTCFinished ();
 		void CheckUploadFinished ();
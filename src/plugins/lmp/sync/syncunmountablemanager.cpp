@@ -101,7 +101,7 @@ namespace LMP
 		const CopyJob copyJob
 		{
 			transcoded,
-			from != transcoded,
+			ShouldRemoveTranscoded (from, transcoded),
 			params.Syncer_,
 			params.DevID_,
 			params.StorageID_,
@@ -0,0 +1,217 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "transcodecache.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QCryptographicHash>
+#include <QtDebug>
+#include <util/util.h>
+#include "transcodingparams.h"
+#include "../xmlsettingsmanager.h"
+
+#ifdef Q_OS_UNIX
+#include <sys/time.h>
+#endif
+
+namespace LeechCraft
+{
+namespace LMP
+{
+	namespace
+	{
+		const QString PartialMarker = ".part";
+
+		/* Entries used this recently are never evicted, so that the
+		 * files of the sync that is currently in progress don't get
+		 * removed before they are copied.
+		 */
+		const int EvictGraceSecs = 60 * 60;
+
+		const qint64 SampleSize = 64 * 1024;
+
+		bool IsPartialName (const QString& name)
+		{
+			return name.contains (PartialMarker + '.');
+		}
+
+		void Touch (const QString& path)
+		{
+#ifdef Q_OS_UNIX
+			utimes (QFile::encodeName (path).constData (), 0);
+#else
+			Q_UNUSED (path);
+#endif
+		}
+	}
+
+	TranscodeCache::TranscodeCache ()
+	: Dir_ (Util::CreateIfNotExists ("lmp/transcodecache"))
+	, TotalSize_ (0)
+	, PartialCounter_ (0)
+	{
+		for (const auto& info : Dir_.entryInfoList (QDir::Files))
+		{
+			if (IsPartialName (info.fileName ()))
+				QFile::remove (info.absoluteFilePath ());
+			else
+				TotalSize_ += info.size ();
+		}
+	}
+
+	QString TranscodeCache::ComputeKey (const QString& path, const TranscodingParams& params)
+	{
+		QFile file (path);
+		if (!file.open (QIODevice::ReadOnly))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to open"
+					<< path
+					<< file.errorString ();
+			return QString ();
+		}
+
+		/* Tags live either in the beginning or in the end of a file,
+		 * so retagging a file invalidates its entry, which is what we
+		 * want since tags are copied to the transcoded file.
+		 */
+		QCryptographicHash hash (QCryptographicHash::Sha1);
+		hash.addData (QByteArray::number (file.size ()));
+		hash.addData (file.read (SampleSize));
+		if (file.size () > 2 * SampleSize)
+			file.seek (file.size () - SampleSize);
+		hash.addData (file.readAll ());
+
+		hash.addData (params.FormatID_.toUtf8 ());
+		hash.addData (QByteArray::number (static_cast<int> (params.BitrateType_)));
+		hash.addData (QByteArray::number (params.Quality_));
+
+		return hash.result ().toHex ();
+	}
+
+	bool TranscodeCache::IsEnabled () const
+	{
+		return XmlSettingsManager::Instance ()
+				.property ("EnableTranscodeCache").toBool ();
+	}
+
+	QString TranscodeCache::Lookup (const QString& key, const TranscodingParams& params)
+	{
+		const auto& format = Formats ().GetFormat (params.FormatID_);
+		if (!format)
+			return QString ();
+
+		const auto& name = GetEntryName (key, format->GetFileExtension ());
+		if (!Dir_.exists (name))
+			return QString ();
+
+		const auto& path = Dir_.absoluteFilePath (name);
+		Touch (path);
+		return path;
+	}
+
+	QString TranscodeCache::GetPartialPath (const QString& key, const TranscodingParams& params)
+	{
+		const auto& format = Formats ().GetFormat (params.FormatID_);
+		const auto& ext = format ? format->GetFileExtension () : QString ();
+		const auto& name = QString ("%1-%2%3.%4")
+				.arg (key)
+				.arg (PartialCounter_++)
+				.arg (PartialMarker)
+				.arg (ext);
+		return Dir_.absoluteFilePath (name);
+	}
+
+	QString TranscodeCache::Commit (const QString& partialPath, const QString& key)
+	{
+		const auto& name = GetEntryName (key, QFileInfo (partialPath).suffix ());
+
+		// Same file may have been transcoded in parallel for another device.
+		if (Dir_.exists (name))
+		{
+			QFile::remove (partialPath);
+			const auto& path = Dir_.absoluteFilePath (name);
+			Touch (path);
+			return path;
+		}
+
+		if (!Dir_.rename (QFileInfo (partialPath).fileName (), name))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to move"
+					<< partialPath
+					<< "to"
+					<< name;
+			return partialPath;
+		}
+
+		TotalSize_ += QFileInfo (Dir_, name).size ();
+		Evict ();
+
+		return Dir_.absoluteFilePath (name);
+	}
+
+	bool TranscodeCache::IsCachedFile (const QString& path) const
+	{
+		// Partial files left by a failed Commit() aren't cache entries,
+		// so the callers remove them once they're done.
+		const QFileInfo info (path);
+		return info.absolutePath () == Dir_.absolutePath () &&
+				!IsPartialName (info.fileName ());
+	}
+
+	QString TranscodeCache::GetEntryName (const QString& key, const QString& ext) const
+	{
+		return key + '.' + ext;
+	}
+
+	void TranscodeCache::Evict ()
+	{
+		const qint64 limit = XmlSettingsManager::Instance ()
+				.property ("TranscodeCacheSize").toLongLong () * 1024 * 1024;
+		if (TotalSize_ <= limit)
+			return;
+
+		const auto& threshold = QDateTime::currentDateTime ().addSecs (-EvictGraceSecs);
+
+		auto infos = Dir_.entryInfoList (QDir::Files, QDir::Time | QDir::Reversed);
+		for (const auto& info : infos)
+		{
+			if (TotalSize_ <= limit)
+				break;
+
+			if (IsPartialName (info.fileName ()))
+				continue;
+
+			if (info.lastModified () > threshold)
+				break;
+
+			if (!QFile::remove (info.absoluteFilePath ()))
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "unable to remove"
+						<< info.absoluteFilePath ();
+				continue;
+			}
+
+			TotalSize_ -= info.size ();
+		}
+	}
+}
+}
@@ -0,0 +1,86 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#pragma once
+
+#include <QDir>
+#include <QString>
+
+namespace LeechCraft
+{
+namespace LMP
+{
+	struct TranscodingParams;
+
+	/** Persistent cache of transcoded files.
+	 *
+	 * Entries are keyed by a hash of the source file contents sample
+	 * and of the transcoding parameters affecting the output, so the
+	 * same file synced to several devices (or several times to the
+	 * same device) is transcoded only once. Least recently used
+	 * entries are evicted once the cache grows larger than the limit
+	 * set by the user.
+	 */
+	class TranscodeCache
+	{
+		QDir Dir_;
+		qint64 TotalSize_;
+		int PartialCounter_;
+	public:
+		TranscodeCache ();
+
+		/** Computes the cache key for the given file and params.
+		 *
+		 * This function reads the beginning and the end of the file,
+		 * so it is better to be called from a separate thread. It is
+		 * thread-safe.
+		 *
+		 * Returns a null string if the file could not be read.
+		 */
+		static QString ComputeKey (const QString& path, const TranscodingParams&);
+
+		bool IsEnabled () const;
+
+		/** Returns the path to the cached entry for the given key and
+		 * params, or a null string if there is no such entry.
+		 */
+		QString Lookup (const QString& key, const TranscodingParams&);
+
+		/** Returns a unique path a transcoder should write the entry
+		 * for the given key to, which should later be passed to
+		 * Commit().
+		 */
+		QString GetPartialPath (const QString& key, const TranscodingParams&);
+
+		/** Moves the partial file into the cache and returns the path
+		 * to the resulting entry, or the partial path if this fails.
+		 * In the latter case the partial file isn't considered cached
+		 * by IsCachedFile(), so it's removed by the caller.
+		 */
+		QString Commit (const QString& partialPath, const QString& key);
+
+		/** Returns whether the given path is a cache entry, so that it
+		 * should not be removed by the callers.
+		 */
+		bool IsCachedFile (const QString& path) const;
+	private:
+		QString GetEntryName (const QString& key, const QString& ext) const;
+		void Evict ();
+	};
+}
+}
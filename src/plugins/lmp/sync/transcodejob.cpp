@@ -33,23 +33,27 @@ namespace LeechCraft
 {
 namespace LMP
 {
-	TranscodeJob::TranscodeJob (const QString& path, const TranscodingParams& params, QObject* parent)
+	TranscodeJob::TranscodeJob (const QString& path, const TranscodingParams& params,
+			const QString& outPath, QObject* parent)
 	: QObject (parent)
 	, Process_ (new QProcess (this))
 	, OriginalPath_ (path)
+	, TranscodedPath_ (outPath)
 	, TargetPattern_ (params.FilePattern_)
 	{
-		QDir dir = QDir::temp ();
-		if (!dir.exists ("lmp_transcode"))
-			dir.mkdir ("lmp_transcode");
-		if (!dir.cd ("lmp_transcode"))
-			throw std::runtime_error ("unable to cd into temp dir");
-
-		const QFileInfo fi (path);
-
 		const auto format = Formats ().GetFormat (params.FormatID_);
 
-		TranscodedPath_ = dir.absoluteFilePath (fi.fileName () + '.' + format->GetFileExtension ());
+		if (TranscodedPath_.isEmpty ())
+		{
+			QDir dir = QDir::temp ();
+			if (!dir.exists ("lmp_transcode"))
+				dir.mkdir ("lmp_transcode");
+			if (!dir.cd ("lmp_transcode"))
+				throw std::runtime_error ("unable to cd into temp dir");
+
+			const QFileInfo fi (path);
+			TranscodedPath_ = dir.absoluteFilePath (fi.fileName () + '.' + format->GetFileExtension ());
+		}
 
 		QStringList args;
 		args << "-i" << path;
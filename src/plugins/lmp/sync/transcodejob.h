@@ -37,7 +37,11 @@ namespace LMP
 		QString TranscodedPath_;
 		const QString TargetPattern_;
 	public:
-		TranscodeJob (const QString& path, const TranscodingParams& params, QObject* parent = 0);
+		/** If outPath is empty, the file is transcoded to a temporary
+		 * directory.
+		 */
+		TranscodeJob (const QString& path, const TranscodingParams& params,
+				const QString& outPath = QString (), QObject* parent = 0);
 
 		QString GetOrigPath () const;
 		QString GetTranscodedPath () const;
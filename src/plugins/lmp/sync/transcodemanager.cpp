@@ -18,15 +18,55 @@
 
 #include "transcodemanager.h"
 #include <algorithm>
+#include <functional>
 #include <QStringList>
 #include <QtDebug>
+#include <QFile>
 #include <QFileInfo>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
 #include "transcodejob.h"
 
 namespace LeechCraft
 {
 namespace LMP
 {
+	namespace
+	{
+		/* Transcoding time is roughly proportional to the duration of
+		 * the track, which is estimated from the file size and the
+		 * typical bitrate of its format, so that a 50 MiB FLAC isn't
+		 * considered to be as long as a 50 MiB MP3.
+		 *
+		 * Returns the estimated duration in milliseconds.
+		 */
+		qint64 EstimateDuration (const QString& path)
+		{
+			const QFileInfo fi (path);
+
+			static const auto ext2kbps = [] () -> QHash<QString, int>
+			{
+				QHash<QString, int> result;
+				result ["flac"] = 900;
+				result ["ape"] = 700;
+				result ["wv"] = 800;
+				result ["wav"] = 1411;
+				result ["aif"] = 1411;
+				result ["aiff"] = 1411;
+				result ["mp3"] = 256;
+				result ["ogg"] = 192;
+				result ["oga"] = 192;
+				result ["opus"] = 128;
+				result ["m4a"] = 256;
+				result ["aac"] = 256;
+				result ["wma"] = 192;
+				return result;
+			} ();
+			const int kbps = ext2kbps.value (fi.suffix ().toLower (), 320);
+			return fi.size () * 8 / kbps;
+		}
+	}
+
 	TranscodeManager::TranscodeManager (QObject *parent)
 	: QObject (parent)
 	{
@@ -44,22 +84,96 @@ namespace LMP
 			return;
 		}
 
-		std::transform (files.begin (), files.end (), std::back_inserter (Queue_),
-				[&params] (decltype (files.front ()) file) { return qMakePair (file, params); });
+		/* Hashing the files for the cache requires reading them, so
+		 * it's done in a separate thread, as well as estimating the
+		 * durations.
+		 */
+		const bool useCache = Cache_.IsEnabled ();
+		auto worker = [files, params, useCache] () -> QList<QueueItem>
+		{
+			QList<QueueItem> items;
+			for (const auto& file : files)
+			{
+				const QueueItem item
+				{
+					file,
+					params,
+					useCache ? TranscodeCache::ComputeKey (file, params) : QString (),
+					EstimateDuration (file)
+				};
+				items << item;
+			}
+			return items;
+		};
 
-		while (RunningJobs_.size () < params.NumThreads_ && !Queue_.isEmpty ())
-			EnqueueJob (Queue_.takeFirst ());
+		auto watcher = new QFutureWatcher<QList<QueueItem>> (this);
+		connect (watcher,
+				SIGNAL (finished ()),
+				this,
+				SLOT (handleItemsPrepared ()));
+		watcher->setFuture (QtConcurrent::run (std::function<QList<QueueItem> ()> (worker)));
+	}
+
+	bool TranscodeManager::IsCachedFile (const QString& path) const
+	{
+		return Cache_.IsCachedFile (path);
 	}
 
-	void TranscodeManager::EnqueueJob (const QPair<QString, TranscodingParams>& pair)
+	void TranscodeManager::EnqueueJob (const QueueItem& item)
 	{
-		auto job = new TranscodeJob (pair.first, pair.second, this);
+		const auto& outPath = item.CacheKey_.isEmpty () ?
+				QString () :
+				Cache_.GetPartialPath (item.CacheKey_, item.Params_);
+
+		auto job = new TranscodeJob (item.Path_, item.Params_, outPath, this);
 		RunningJobs_ << job;
+		if (!item.CacheKey_.isEmpty ())
+			Job2CacheKey_ [job] = item.CacheKey_;
+
 		connect (job,
 				SIGNAL (done (TranscodeJob*, bool)),
 				this,
 				SLOT (handleDone (TranscodeJob*, bool)));
-		emit fileStartedTranscoding (QFileInfo (pair.first).fileName ());
+		emit fileStartedTranscoding (QFileInfo (item.Path_).fileName ());
+	}
+
+	void TranscodeManager::handleItemsPrepared ()
+	{
+		auto watcher = dynamic_cast<QFutureWatcher<QList<QueueItem>>*> (sender ());
+		if (!watcher)
+			return;
+
+		watcher->deleteLater ();
+
+		const auto& items = watcher->result ();
+		if (items.isEmpty ())
+			return;
+
+		for (const auto& item : items)
+		{
+			if (!item.CacheKey_.isEmpty ())
+			{
+				const auto& cached = Cache_.Lookup (item.CacheKey_, item.Params_);
+				if (!cached.isEmpty ())
+				{
+					emit fileReady (item.Path_, cached, item.Params_.FilePattern_);
+					continue;
+				}
+			}
+
+			Queue_ << item;
+		}
+
+		/* Longest jobs go first, so that the last running jobs are the
+		 * short ones and the threads finish at roughly the same time.
+		 */
+		std::stable_sort (Queue_.begin (), Queue_.end (),
+				[] (const QueueItem& left, const QueueItem& right)
+					{ return left.EstimatedDuration_ > right.EstimatedDuration_; });
+
+		const int numThreads = items.front ().Params_.NumThreads_;
+		while (RunningJobs_.size () < numThreads && !Queue_.isEmpty ())
+			EnqueueJob (Queue_.takeFirst ());
 	}
 
 	void TranscodeManager::handleDone (TranscodeJob *job, bool success)
@@ -67,14 +181,21 @@ namespace LMP
 		RunningJobs_.removeAll (job);
 		job->deleteLater ();
 
-		if (!Queue_.isEmpty ())
+		auto transcoded = job->GetTranscodedPath ();
+		const auto& key = Job2CacheKey_.take (job);
+		if (!key.isEmpty ())
 		{
-			const auto& pair = Queue_.takeFirst ();
-			EnqueueJob (pair);
+			if (success)
+				transcoded = Cache_.Commit (transcoded, key);
+			else
+				QFile::remove (transcoded);
 		}
 
+		if (!Queue_.isEmpty ())
+			EnqueueJob (Queue_.takeFirst ());
+
 		if (success)
-			emit fileReady (job->GetOrigPath (), job->GetTranscodedPath (), job->GetTargetPattern ());
+			emit fileReady (job->GetOrigPath (), transcoded, job->GetTargetPattern ());
 		else
 			emit fileFailed (job->GetOrigPath ());
 	}
@@ -19,8 +19,9 @@
 #pragma once
 
 #include <QObject>
-#include <QPair>
+#include <QHash>
 #include "transcodingparams.h"
+#include "transcodecache.h"
 
 namespace LeechCraft
 {
@@ -31,17 +32,35 @@ namespace LMP
 	class TranscodeManager : public QObject
 	{
 		Q_OBJECT
+	public:
+		struct QueueItem
+		{
+			QString Path_;
+			TranscodingParams Params_;
+			QString CacheKey_;
+			qint64 EstimatedDuration_;
+		};
+	private:
+		TranscodeCache Cache_;
 
-		QList<QPair<QString, TranscodingParams>> Queue_;
+		QList<QueueItem> Queue_;
 
 		QList<TranscodeJob*> RunningJobs_;
+		QHash<TranscodeJob*, QString> Job2CacheKey_;
 	public:
 		TranscodeManager (QObject* = 0);
 
 		void Enqueue (const QStringList&, const TranscodingParams&);
+
+		/** Returns whether the given transcoded file is kept by the
+		 * transcoded files cache and thus shouldn't be removed after
+		 * it has been copied.
+		 */
+		bool IsCachedFile (const QString&) const;
 	private:
-		void EnqueueJob (const QPair<QString, TranscodingParams>&);
+		void EnqueueJob (const QueueItem&);
 	private slots:
+		void handleItemsPrepared ();
 		void handleDone (TranscodeJob*, bool);
 	signals:
 		void fileStartedTranscoding (const QString& origPath);
@@ -0,0 +1,203 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+
+#include <QObject>
+#include <QtTest>
+#include <QDir>
+#include <QFile>
+#include <QTextStream>
+#include <QCoreApplication>
+#include "../playlistparsers/playlistfactory.h"
+
+using namespace LeechCraft::LMP;
+
+class TestPlaylistParsers : public QObject
+{
+	Q_OBJECT
+
+	QDir Dir_;
+	QList<int> Sizes_;
+	QStringList Formats_;
+
+	QString GetTrackPath (int i) const
+	{
+		return QString ("/music/Artist %1/Album %2/%3 - Track.mp3")
+				.arg (i / 100)
+				.arg (i / 10)
+				.arg (i);
+	}
+
+	QString GetPlaylistPath (const QString& format, int size) const
+	{
+		return Dir_.absoluteFilePath (QString ("playlist_%1.%2").arg (size).arg (format));
+	}
+
+	void WritePlaylist (const QString& format, int size)
+	{
+		QFile file (GetPlaylistPath (format, size));
+		if (!file.open (QIODevice::WriteOnly))
+			QFAIL (qPrintable (file.errorString ()));
+
+		QTextStream stream (&file);
+		stream.setCodec ("UTF-8");
+
+		if (format == "m3u8")
+		{
+			stream << "#EXTM3U\n";
+			for (int i = 0; i < size; ++i)
+				stream << "#EXTINF:-1,Track " << i << "\n"
+						<< GetTrackPath (i) << "\n";
+		}
+		else if (format == "pls")
+		{
+			stream << "[playlist]\n";
+			for (int i = 1; i <= size; ++i)
+				stream << "File" << i << "=" << GetTrackPath (i - 1) << "\n"
+						<< "Title" << i << "=Track " << i - 1 << "\n"
+						<< "Length" << i << "=-1\n";
+			stream << "NumberOfEntries=" << size << "\n"
+					<< "Version=2\n";
+		}
+		else if (format == "xspf")
+		{
+			stream << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+					<< "<playlist version=\"1\" xmlns=\"http://xspf.org/ns/0/\">\n"
+					<< "<trackList>\n";
+			for (int i = 0; i < size; ++i)
+				stream << "<track><title>Track " << i << "</title><location>"
+						<< QUrl::fromLocalFile (GetTrackPath (i)).toEncoded ()
+						<< "</location></track>\n";
+			stream << "</trackList>\n</playlist>\n";
+		}
+	}
+
+	int Count (const QString& path, int stopAfter = -1) const
+	{
+		int count = 0;
+		MakeStreamingPlaylistParser (path) (path,
+				[&count, stopAfter] (const Phonon::MediaSource&) -> bool
+					{ return ++count != stopAfter; });
+		return count;
+	}
+
+	void PopulateData ()
+	{
+		QTest::addColumn<QString> ("path");
+		QTest::addColumn<int> ("size");
+
+		for (const auto& format : Formats_)
+			for (auto size : Sizes_)
+				QTest::newRow (qPrintable (QString ("%1/%2").arg (format).arg (size)))
+						<< GetPlaylistPath (format, size)
+						<< size;
+	}
+private slots:
+	void initTestCase ()
+	{
+		Sizes_ << 1000 << 10000 << 100000;
+		Formats_ << "m3u8" << "pls" << "xspf";
+
+		const auto& dirName = QString ("lmp_playlistparserstest_%1")
+				.arg (QCoreApplication::applicationPid ());
+		Dir_ = QDir::temp ();
+		QVERIFY (Dir_.mkpath (dirName));
+		QVERIFY (Dir_.cd (dirName));
+
+		for (const auto& format : Formats_)
+			for (auto size : Sizes_)
+				WritePlaylist (format, size);
+	}
+
+	void cleanupTestCase ()
+	{
+		for (const auto& entry : Dir_.entryList (QDir::Files))
+			Dir_.remove (entry);
+
+		const auto& dirName = Dir_.dirName ();
+		Dir_.cdUp ();
+		Dir_.rmdir (dirName);
+	}
+
+	void testParse_data ()
+	{
+		PopulateData ();
+	}
+
+	void testParse ()
+	{
+		QFETCH (QString, path);
+		QFETCH (int, size);
+
+		QList<Phonon::MediaSource> sources;
+		MakeStreamingPlaylistParser (path) (path,
+				[&sources] (const Phonon::MediaSource& src) -> bool
+				{
+					sources << src;
+					return true;
+				});
+
+		QCOMPARE (sources.size (), size);
+		QCOMPARE (sources.first ().fileName (), GetTrackPath (0));
+		QCOMPARE (sources.last ().fileName (), GetTrackPath (size - 1));
+	}
+
+	void testStopEarly_data ()
+	{
+		PopulateData ();
+	}
+
+	void testStopEarly ()
+	{
+		QFETCH (QString, path);
+
+		QCOMPARE (Count (path, 10), 10);
+	}
+
+	void perfFullParse_data ()
+	{
+		PopulateData ();
+	}
+
+	void perfFullParse ()
+	{
+		QFETCH (QString, path);
+		QFETCH (int, size);
+
+		int count = 0;
+		QBENCHMARK { count = Count (path); }
+		QCOMPARE (count, size);
+	}
+
+	/** The time until the first chunk of a playlist reaches the
+	 * player, which is what the user actually waits for.
+	 */
+	void perfFirstChunk_data ()
+	{
+		PopulateData ();
+	}
+
+	void perfFirstChunk ()
+	{
+		QFETCH (QString, path);
+
+		int count = 0;
+		QBENCHMARK { count = Count (path, 1000); }
+		QCOMPARE (count, 1000);
+	}
+};
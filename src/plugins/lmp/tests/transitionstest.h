@@ -0,0 +1,145 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include <cmath>
+#include <QObject>
+#include <QtTest>
+#include <QUrl>
+#include "../transitions.h"
+
+using namespace LeechCraft::LMP;
+
+Q_DECLARE_METATYPE (LeechCraft::LMP::ReplayGainInfo)
+
+class TestTransitions : public QObject
+{
+	Q_OBJECT
+
+	/** Sources of three albums, A, B and C, with three, one and two
+	 * tracks respectively.
+	 */
+	QList<Phonon::MediaSource> Sources_;
+
+	Phonon::MediaSource Unknown_;
+
+	ReplayGainInfo MakeInfo (bool hasTrack, double trackGain, double trackPeak,
+			bool hasAlbum, double albumGain, double albumPeak) const
+	{
+		ReplayGainInfo info;
+		info.HasTrack_ = hasTrack;
+		info.TrackGain_ = trackGain;
+		info.TrackPeak_ = trackPeak;
+		info.HasAlbum_ = hasAlbum;
+		info.AlbumGain_ = albumGain;
+		info.AlbumPeak_ = albumPeak;
+		return info;
+	}
+
+	static QString GetAlbum (const Phonon::MediaSource& source)
+	{
+		return source.url ().path ().section ('/', 1, 1);
+	}
+private slots:
+	void initTestCase ()
+	{
+		const QStringList paths { "A/1", "A/2", "A/3", "B/1", "C/1", "C/2" };
+		for (const auto& path : paths)
+			Sources_ << Phonon::MediaSource (QUrl ("http://example.com/" + path + ".mp3"));
+
+		Unknown_ = Phonon::MediaSource (QUrl ("http://example.com/D/1.mp3"));
+	}
+
+	void testGainFactor_data ()
+	{
+		QTest::addColumn<ReplayGainInfo> ("info");
+		QTest::addColumn<bool> ("preferAlbum");
+		QTest::addColumn<double> ("preamp");
+		QTest::addColumn<double> ("factor");
+
+		QTest::newRow ("no tags")
+				<< ReplayGainInfo () << false << 0. << 1.;
+		QTest::newRow ("no tags with preamp")
+				<< ReplayGainInfo () << false << -6. << 1.;
+		QTest::newRow ("track")
+				<< MakeInfo (true, -6, 0, true, -10, 0) << false << 0. << 0.501187;
+		QTest::newRow ("album preferred")
+				<< MakeInfo (true, -6, 0, true, -10, 0) << true << 0. << 0.316228;
+		QTest::newRow ("album fallback")
+				<< MakeInfo (false, 0, 0, true, -10, 0) << false << 0. << 0.316228;
+		QTest::newRow ("track fallback")
+				<< MakeInfo (true, -6, 0, false, 0, 0) << true << 0. << 0.501187;
+		QTest::newRow ("preamp")
+				<< MakeInfo (true, -10, 0, false, 0, 0) << false << 4. << 0.501187;
+		QTest::newRow ("peak limited")
+				<< MakeInfo (true, -1, 1.25, false, 0, 0) << false << 0. << 0.8;
+		QTest::newRow ("no amplification")
+				<< MakeInfo (true, 6, 0.5, false, 0, 0) << false << 0. << 1.;
+	}
+
+	void testGainFactor ()
+	{
+		QFETCH (ReplayGainInfo, info);
+		QFETCH (bool, preferAlbum);
+		QFETCH (double, preamp);
+		QFETCH (double, factor);
+
+		QVERIFY (std::abs (GetGainFactor (info, preferAlbum, preamp) - factor) < 1e-5);
+	}
+
+	void testFollowing ()
+	{
+		QCOMPARE (GetFollowingSource (Sources_, Sources_ [0], false), Sources_ [1]);
+		QCOMPARE (GetFollowingSource (Sources_, Sources_ [4], false), Sources_ [5]);
+		QCOMPARE (GetFollowingSource (Sources_, Sources_ [5], false).type (), Phonon::MediaSource::Empty);
+		QCOMPARE (GetFollowingSource (Sources_, Unknown_, false).type (), Phonon::MediaSource::Empty);
+		QCOMPARE (GetFollowingSource (QList<Phonon::MediaSource> (), Unknown_, true).type (),
+				Phonon::MediaSource::Empty);
+	}
+
+	void testFollowingWrapped ()
+	{
+		QCOMPARE (GetFollowingSource (Sources_, Sources_ [2], true), Sources_ [3]);
+		QCOMPARE (GetFollowingSource (Sources_, Sources_ [5], true), Sources_ [0]);
+		QCOMPARE (GetFollowingSource (Sources_, Unknown_, true), Sources_ [0]);
+	}
+
+	void testFollowingInGroup ()
+	{
+		QCOMPARE (GetFollowingInGroup (Sources_, Sources_ [0], &GetAlbum), Sources_ [1]);
+		QCOMPARE (GetFollowingInGroup (Sources_, Sources_ [1], &GetAlbum), Sources_ [2]);
+		QCOMPARE (GetFollowingInGroup (Sources_, Sources_ [2], &GetAlbum), Sources_ [0]);
+		QCOMPARE (GetFollowingInGroup (Sources_, Sources_ [3], &GetAlbum), Sources_ [3]);
+		QCOMPARE (GetFollowingInGroup (Sources_, Sources_ [4], &GetAlbum), Sources_ [5]);
+		QCOMPARE (GetFollowingInGroup (Sources_, Sources_ [5], &GetAlbum), Sources_ [4]);
+		QCOMPARE (GetFollowingInGroup (Sources_, Unknown_, &GetAlbum).type (), Phonon::MediaSource::Empty);
+	}
+
+	void testPreloadAction ()
+	{
+		const QList<Phonon::MediaSource> empty;
+		const QList<Phonon::MediaSource> queued { Sources_ [1] };
+		const QList<Phonon::MediaSource> overfull { Sources_ [1], Sources_ [2] };
+
+		QVERIFY (GetPreloadAction (Phonon::MediaSource (), empty) == PreloadAction::Keep);
+		QVERIFY (GetPreloadAction (Phonon::MediaSource (), queued) == PreloadAction::Clear);
+		QVERIFY (GetPreloadAction (Sources_ [1], empty) == PreloadAction::Replace);
+		QVERIFY (GetPreloadAction (Sources_ [1], queued) == PreloadAction::Keep);
+		QVERIFY (GetPreloadAction (Sources_ [2], queued) == PreloadAction::Replace);
+		QVERIFY (GetPreloadAction (Sources_ [1], overfull) == PreloadAction::Replace);
+	}
+};
@@ -0,0 +1,96 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "transitions.h"
+#include <algorithm>
+#include <cmath>
+
+namespace LeechCraft
+{
+namespace LMP
+{
+	ReplayGainInfo::ReplayGainInfo ()
+	: HasTrack_ (false)
+	, TrackGain_ (0)
+	, TrackPeak_ (0)
+	, HasAlbum_ (false)
+	, AlbumGain_ (0)
+	, AlbumPeak_ (0)
+	{
+	}
+
+	float GetGainFactor (const ReplayGainInfo& info, bool preferAlbum, double preamp)
+	{
+		const bool useAlbum = info.HasAlbum_ && (preferAlbum || !info.HasTrack_);
+		if (!useAlbum && !info.HasTrack_)
+			return 1;
+
+		const double gain = useAlbum ? info.AlbumGain_ : info.TrackGain_;
+		const double peak = useAlbum ? info.AlbumPeak_ : info.TrackPeak_;
+
+		double factor = std::pow (10, (gain + preamp) / 20);
+		if (peak > 0)
+			factor = std::min (factor, 1 / peak);
+
+		// The fader effect isn't guaranteed to amplify on all backends.
+		return std::min (factor, 1.0);
+	}
+
+	Phonon::MediaSource GetFollowingSource (const QList<Phonon::MediaSource>& queue,
+			const Phonon::MediaSource& current, bool wrap)
+	{
+		if (queue.isEmpty ())
+			return Phonon::MediaSource ();
+
+		const int pos = queue.indexOf (current);
+		if (pos >= 0 && pos + 1 < queue.size ())
+			return queue.at (pos + 1);
+
+		return wrap ? queue.first () : Phonon::MediaSource ();
+	}
+
+	Phonon::MediaSource GetFollowingInGroup (const QList<Phonon::MediaSource>& queue,
+			const Phonon::MediaSource& current,
+			const std::function<QString (Phonon::MediaSource)>& group)
+	{
+		int pos = queue.indexOf (current);
+		if (pos < 0)
+			return Phonon::MediaSource ();
+
+		const auto& curGroup = group (queue.at (pos));
+		if (pos + 1 < queue.size () && group (queue.at (pos + 1)) == curGroup)
+			return queue.at (pos + 1);
+
+		while (pos > 0 && group (queue.at (pos - 1)) == curGroup)
+			--pos;
+		return queue.at (pos);
+	}
+
+	PreloadAction GetPreloadAction (const Phonon::MediaSource& next,
+			const QList<Phonon::MediaSource>& queue)
+	{
+		if (next.type () == Phonon::MediaSource::Empty)
+			return queue.isEmpty () ? PreloadAction::Keep : PreloadAction::Clear;
+
+		if (queue.size () == 1 && queue.first () == next)
+			return PreloadAction::Keep;
+
+		return PreloadAction::Replace;
+	}
+}
+}
@@ -0,0 +1,79 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#pragma once
+
+#include <functional>
+#include <QList>
+#include <phonon/mediasource.h>
+
+namespace LeechCraft
+{
+namespace LMP
+{
+	struct ReplayGainInfo
+	{
+		bool HasTrack_;
+		double TrackGain_;
+		double TrackPeak_;
+
+		bool HasAlbum_;
+		double AlbumGain_;
+		double AlbumPeak_;
+
+		ReplayGainInfo ();
+	};
+
+	/** Returns the volume factor for a track with the given ReplayGain
+	 * info. The album gain is used if it's preferred or if there is no
+	 * track gain. The factor is limited by the peak so that the track
+	 * doesn't clip, and it never exceeds 1.
+	 */
+	float GetGainFactor (const ReplayGainInfo& info, bool preferAlbum, double preamp);
+
+	/** Returns the source following the current one in the queue, or
+	 * an empty source if the current one is the last one or isn't in
+	 * the queue at all. If wrap is true, the first source follows the
+	 * last one, and it's also returned for unknown sources.
+	 */
+	Phonon::MediaSource GetFollowingSource (const QList<Phonon::MediaSource>& queue,
+			const Phonon::MediaSource& current, bool wrap);
+
+	/** Returns the source following the current one in the queue if
+	 * it belongs to the same group, or the first source of the current
+	 * group in the run containing the current one otherwise. Returns an
+	 * empty source if the current one isn't in the queue.
+	 */
+	Phonon::MediaSource GetFollowingInGroup (const QList<Phonon::MediaSource>& queue,
+			const Phonon::MediaSource& current,
+			const std::function<QString (Phonon::MediaSource)>& group);
+
+	enum class PreloadAction
+	{
+		Keep,
+		Clear,
+		Replace
+	};
+
+	/** Returns what to do with the media object queue, given its
+	 * current contents, to have exactly the next source preloaded.
+	 */
+	PreloadAction GetPreloadAction (const Phonon::MediaSource& next,
+			const QList<Phonon::MediaSource>& queue);
+}
+}
@@ -33,25 +33,34 @@ namespace LeechCraft
 {
 namespace LMP
 {
+	namespace
+	{
+		QStringList GetMediaNameFilters ()
+		{
+			QStringList nameFilters;
+			nameFilters << "*.aiff"
+					<< "*.ape"
+					<< "*.asf"
+					<< "*.flac"
+					<< "*.m4a"
+					<< "*.mp3"
+					<< "*.mp4"
+					<< "*.mpc"
+					<< "*.mpeg"
+					<< "*.mpg"
+					<< "*.ogg"
+					<< "*.tta"
+					<< "*.wav"
+					<< "*.wma"
+					<< "*.wv"
+					<< "*.wvp";
+			return nameFilters;
+		}
+	}
+
 	QList<QFileInfo> RecIterateInfo (const QString& dirPath, bool followSymlinks)
 	{
-		QStringList nameFilters;
-		nameFilters << "*.aiff"
-				<< "*.ape"
-				<< "*.asf"
-				<< "*.flac"
-				<< "*.m4a"
-				<< "*.mp3"
-				<< "*.mp4"
-				<< "*.mpc"
-				<< "*.mpeg"
-				<< "*.mpg"
-				<< "*.ogg"
-				<< "*.tta"
-				<< "*.wav"
-				<< "*.wma"
-				<< "*.wv"
-				<< "*.wvp";
+		const auto& nameFilters = GetMediaNameFilters ();
 
 		const QFileInfo dirInfo (dirPath);
 		if (dirInfo.isFile ())
@@ -84,6 +93,15 @@ namespace LMP
 		return result;
 	}
 
+	QList<QFileInfo> DirIterateInfo (const QString& dirPath, bool followSymlinks)
+	{
+		QDir::Filters filters = QDir::Files;
+		if (!followSymlinks)
+			filters |= QDir::NoSymLinks;
+
+		return QDir (dirPath).entryInfoList (GetMediaNameFilters (), filters);
+	}
+
 	QStringList RecIterate (const QString& dirPath, bool followSymlinks)
 	{
 		const auto& infos = RecIterateInfo (dirPath, followSymlinks);
@@ -39,6 +39,11 @@ namespace LMP
 	QList<QFileInfo> RecIterateInfo (const QString& dirPath, bool followSymlinks = false);
 	QStringList RecIterate (const QString& dirPath, bool followSymlinks = false);
 
+	/** Returns the media files directly in the given directory, without
+	 * descending into the subdirectories.
+	 */
+	QList<QFileInfo> DirIterateInfo (const QString& dirPath, bool followSymlinks = false);
+
 	QString FindAlbumArtPath (const QString& near, bool ignoreCollection = false);
 	QPixmap FindAlbumArt (const QString& near, bool ignoreCollection = false);
 
@@ -20,6 +20,7 @@
 #include <QFile>
 #include <interfaces/iplugin2.h>
 #include "pixmapcachemanager.h"
+#include "renderscheduler.h"
 #include "recentlyopenedmanager.h"
 #include "defaultbackendmanager.h"
 #include "docstatemanager.h"
@@ -31,6 +32,7 @@ namespace Monocle
 {
 	Core::Core ()
 	: CacheManager_ (new PixmapCacheManager (this))
+	, RenderScheduler_ (new RenderScheduler (this))
 	, ROManager_ (new RecentlyOpenedManager (this))
 	, DefaultBackendManager_ (new DefaultBackendManager (this))
 	, DocStateManager_ (new DocStateManager (this))
@@ -98,6 +100,11 @@ namespace Monocle
 		return CacheManager_;
 	}
 
+	RenderScheduler* Core::GetRenderScheduler () const
+	{
+		return RenderScheduler_;
+	}
+
 	RecentlyOpenedManager* Core::GetROManager () const
 	{
 		return ROManager_;
@@ -28,6 +28,7 @@ namespace Monocle
 {
 	class RecentlyOpenedManager;
 	class PixmapCacheManager;
+	class RenderScheduler;
 	class DefaultBackendManager;
 	class DocStateManager;
 	class BookmarksManager;
@@ -40,6 +41,7 @@ namespace Monocle
 		QList<QObject*> Backends_;
 
 		PixmapCacheManager *CacheManager_;
+		RenderScheduler *RenderScheduler_;
 		RecentlyOpenedManager *ROManager_;
 		DefaultBackendManager *DefaultBackendManager_;
 		DocStateManager *DocStateManager_;
@@ -58,6 +60,7 @@ namespace Monocle
 		IDocument_ptr LoadDocument (const QString&);
 
 		PixmapCacheManager* GetPixmapCacheManager () const;
+		RenderScheduler* GetRenderScheduler () const;
 		RecentlyOpenedManager* GetROManager () const;
 		DefaultBackendManager* GetDefaultBackendManager () const;
 		DocStateManager* GetDocStateManager () const;
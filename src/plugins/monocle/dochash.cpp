@@ -0,0 +1,47 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "dochash.h"
+#include <algorithm>
+#include <QFile>
+#include <QCryptographicHash>
+
+namespace LeechCraft
+{
+namespace Monocle
+{
+	QString GetDocHash (const QString& path)
+	{
+		QFile file (path);
+		if (!file.open (QIODevice::ReadOnly))
+			return QString ();
+
+		const qint64 chunkSize = 64 * 1024;
+
+		QCryptographicHash hash (QCryptographicHash::Sha1);
+		hash.addData (QByteArray::number (file.size ()));
+		hash.addData (file.read (chunkSize));
+		if (file.size () > chunkSize)
+		{
+			file.seek (std::max (chunkSize, file.size () - chunkSize));
+			hash.addData (file.read (chunkSize));
+		}
+		return hash.result ().toHex ();
+	}
+}
+}
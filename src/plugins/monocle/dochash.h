@@ -0,0 +1,35 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#pragma once
+
+class QString;
+
+namespace LeechCraft
+{
+namespace Monocle
+{
+	/** Returns a hash identifying the contents of the document at the
+	 * given path, or an empty string if the file cannot be read.
+	 *
+	 * Only the file size and its first and last 64 KiB are hashed, so
+	 * this is cheap even for very large documents.
+	 */
+	QString GetDocHash (const QString& path);
+}
+}
@@ -18,6 +18,7 @@
 
 #include "documenttab.h"
 #include <functional>
+#include <algorithm>
 #include <QToolBar>
 #include <QComboBox>
 #include <QFileDialog>
@@ -61,9 +62,12 @@
 #include "xmlsettingsmanager.h"
 #include "bookmarkswidget.h"
 #include "pageslayoutmanager.h"
+#include "pagesizeresolver.h"
 #include "thumbswidget.h"
 #include "textsearchhandler.h"
 #include "formmanager.h"
+#include "pixmapcachemanager.h"
+#include "renderscheduler.h"
 
 namespace LeechCraft
 {
@@ -102,6 +106,7 @@ namespace Monocle
 	, ThumbsWidget_ (new ThumbsWidget ())
 	, MouseMode_ (MouseMode::Move)
 	, SaveStateScheduled_ (false)
+	, PrevScrollValue_ (0)
 	, Onload_ ({ -1, 0, 0 })
 	{
 		Ui_.setupUi (this);
@@ -115,6 +120,10 @@ namespace Monocle
 
 		FindDialog_ = new FindDialog (SearchHandler_, this);
 		FindDialog_->hide ();
+		connect (SearchHandler_,
+				SIGNAL (searchFinished (bool)),
+				this,
+				SLOT (handleSearchFinished (bool)));
 
 		SetupToolbar ();
 
@@ -321,6 +330,7 @@ namespace Monocle
 		Scene_.clear ();
 		Pages_.clear ();
 		CurrentDoc_ = IDocument_ptr ();
+		Thumbs_.reset ();
 		CurrentDocPath_.clear ();
 
 		const auto& pos = Ui_.PagesView_->GetCurrentCenter ();
@@ -356,6 +366,7 @@ namespace Monocle
 
 		Scene_.clear ();
 		Pages_.clear ();
+		ActiveRenderPages_.clear ();
 
 		CurrentDoc_ = document;
 		CurrentDocPath_ = path;
@@ -369,7 +380,8 @@ namespace Monocle
 			Pages_ << item;
 		}
 
-		LayoutManager_->HandleDoc (CurrentDoc_, Pages_);
+		const auto& sizes = std::make_shared<PageSizeResolver> (CurrentDoc_);
+		LayoutManager_->HandleDoc (CurrentDoc_, Pages_, sizes);
 		SearchHandler_->HandleDoc (CurrentDoc_, Pages_);
 		FormManager_->HandleDoc (CurrentDoc_, Pages_);
 
@@ -405,7 +417,8 @@ namespace Monocle
 					SLOT (handlePageContentsChanged (int)));
 
 		BMWidget_->HandleDoc (CurrentDoc_);
-		ThumbsWidget_->HandleDoc (CurrentDoc_);
+		Thumbs_ = std::make_shared<ThumbsCache> (CurrentDoc_);
+		ThumbsWidget_->HandleDoc (CurrentDoc_, sizes, Thumbs_);
 
 		FindAction_->setEnabled (qobject_cast<ISearchableDocument*> (CurrentDoc_->GetQObject ()));
 
@@ -440,6 +453,10 @@ namespace Monocle
 					Core::Instance ().GetProxy ()->GetEntityManager (),
 					menu);
 		}
+
+		menu->addSeparator ();
+		menu->addAction (tr ("Rendering statistics..."),
+				this, SLOT (showRenderStats ()));
 	}
 
 	int DocumentTab::GetCurrentPage () const
@@ -754,6 +771,45 @@ namespace Monocle
 		emit pagesVisibilityChanged (rects);
 	}
 
+	void DocumentTab::PrefetchPages ()
+	{
+		const int value = Ui_.PagesView_->verticalScrollBar ()->value ();
+		const bool backwards = value < PrevScrollValue_;
+		PrevScrollValue_ = value;
+
+		QSet<int> active;
+		int first = Pages_.size ();
+		int last = -1;
+		for (auto item : Ui_.PagesView_->items (Ui_.PagesView_->viewport ()->rect ()))
+		{
+			auto page = dynamic_cast<PageGraphicsItem*> (item);
+			if (!page)
+				continue;
+
+			const auto num = page->GetPageNum ();
+			active << num;
+			first = std::min (first, num);
+			last = std::max (last, num);
+		}
+
+		if (last >= 0)
+			for (int i = 1; i <= 2; ++i)
+			{
+				const int num = backwards ? first - i : last + i;
+				if (num < 0 || num >= Pages_.size ())
+					break;
+
+				active << num;
+				Pages_ [num]->Prefetch ();
+			}
+
+		for (auto num : QSet<int> (ActiveRenderPages_).subtract (active))
+			if (num < Pages_.size ())
+				Pages_ [num]->CancelRenders ();
+
+		ActiveRenderPages_ = active;
+	}
+
 	void DocumentTab::handleNavigateRequested (QString path, int num, double x, double y)
 	{
 		if (!path.isEmpty ())
@@ -947,7 +1003,7 @@ namespace Monocle
 		if (!CurrentDoc_)
 			return;
 
-		new PresenterWidget (CurrentDoc_);
+		new PresenterWidget (CurrentDoc_, Thumbs_);
 	}
 
 	void DocumentTab::handleGoPrev ()
@@ -990,6 +1046,7 @@ namespace Monocle
 	void DocumentTab::checkCurrentPageChange (bool force)
 	{
 		RegenPageVisibility ();
+		PrefetchPages ();
 
 		auto current = GetCurrentPage ();
 		if (PrevCurrentPage_ == current && !force)
@@ -1172,6 +1229,43 @@ namespace Monocle
 		QApplication::clipboard ()->setText (text);
 	}
 
+	void DocumentTab::showRenderStats ()
+	{
+		const auto& cache = Core::Instance ().GetPixmapCacheManager ()->GetStats ();
+		const auto& sched = Core::Instance ().GetRenderScheduler ()->GetStats ();
+
+		auto mib = [] (qint64 size) { return QString::number (size / 1024. / 1024., 'f', 1); };
+
+		QStringList lines;
+		lines << tr ("Pixmap cache: %1 MiB.").arg (mib (cache.Size_))
+				<< tr ("Cache hits: %1, scaled hits: %2, misses: %3.")
+					.arg (cache.Hits_)
+					.arg (cache.ScaledHits_)
+					.arg (cache.Misses_)
+				<< tr ("Pixmaps evicted: %1.").arg (cache.Evictions_)
+				<< tr ("Compressed cache: %1 pages, %2 MiB, %3 evicted.")
+					.arg (cache.CompressedCount_)
+					.arg (mib (cache.CompressedSize_))
+					.arg (cache.CompressedEvictions_)
+				<< QString ()
+				<< tr ("Renders scheduled: %1, completed: %2.")
+					.arg (sched.Scheduled_)
+					.arg (sched.Completed_)
+				<< tr ("Renders coalesced: %1, cancelled: %2, wasted: %3.")
+					.arg (sched.Coalesced_)
+					.arg (sched.Cancelled_)
+					.arg (sched.Wasted_);
+
+		QMessageBox::information (this,
+				"LeechCraft",
+				lines.join ("<br/>"));
+	}
+
+	void DocumentTab::handleSearchFinished (bool found)
+	{
+		FindDialog_->SetSuccessful (found);
+	}
+
 	void DocumentTab::showDocInfo ()
 	{
 		if (!CurrentDoc_)
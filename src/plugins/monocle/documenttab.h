@@ -20,11 +20,13 @@
 
 #include <QWidget>
 #include <QComboBox>
+#include <QSet>
 #include <interfaces/ihavetabs.h>
 #include <interfaces/ihaverecoverabletabs.h>
 #include <interfaces/idndtab.h>
 #include "interfaces/monocle/idocument.h"
 #include "docstatemanager.h"
+#include "thumbscache.h"
 #include "ui_documenttab.h"
 
 class QDockWidget;
@@ -81,6 +83,7 @@ namespace Monocle
 
 		IDocument_ptr CurrentDoc_;
 		QString CurrentDocPath_;
+		ThumbsCache_ptr Thumbs_;
 		QList<PageGraphicsItem*> Pages_;
 		QGraphicsScene Scene_;
 
@@ -94,6 +97,9 @@ namespace Monocle
 
 		int PrevCurrentPage_;
 
+		int PrevScrollValue_;
+		QSet<int> ActiveRenderPages_;
+
 		struct OnloadData
 		{
 			int Num_;
@@ -138,6 +144,7 @@ namespace Monocle
 		QString GetSelectionText () const;
 
 		void RegenPageVisibility ();
+		void PrefetchPages ();
 	private slots:
 		void handleNavigateRequested (QString, int, double, double);
 		void handlePrintRequested ();
@@ -180,6 +187,9 @@ namespace Monocle
 		void handleCopyAsText ();
 
 		void showDocInfo ();
+		void showRenderStats ();
+
+		void handleSearchFinished (bool);
 
 		void delayedCenterOn (const QPoint&);
 
@@ -0,0 +1,94 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#pragma once
+
+#include <QList>
+#include <QRectF>
+#include <QString>
+#include <QtPlugin>
+
+namespace LeechCraft
+{
+namespace Monocle
+{
+	/** @brief Describes a single word on a page.
+	 *
+	 * All the rectangles are in page coordinates, just like in
+	 * ISearchableDocument::GetTextPositions().
+	 */
+	struct TextBox
+	{
+		/** @brief The text of the word.
+		 */
+		QString Text_;
+
+		/** @brief The bounding rectangle of the whole word.
+		 */
+		QRectF Rect_;
+
+		/** @brief The bounding rectangles of each character of Text_.
+		 *
+		 * This list may be empty if the document doesn't provide
+		 * per-character geometry, otherwise it should contain exactly
+		 * as many elements as there are characters in Text_.
+		 */
+		QList<QRectF> CharRects_;
+
+		/** @brief Whether the word is followed by a whitespace.
+		 */
+		bool HasSpaceAfter_;
+	};
+
+	/** @brief Interface for documents providing text with its geometry.
+	 *
+	 * If a document is able to return the words of a page together with
+	 * their positions, it should implement this interface. Monocle then
+	 * extracts the text of the document in background, caches it on
+	 * disk and uses it for searching without blocking the UI.
+	 *
+	 * Documents implementing this interface would typically implement
+	 * ISearchableDocument as well, which is then used as a fallback.
+	 *
+	 * @sa ISearchableDocument
+	 */
+	class IHavePageText
+	{
+	public:
+		/** @brief Virtual destructor.
+		 */
+		virtual ~IHavePageText () {}
+
+		/** @brief Returns the words of the given page.
+		 *
+		 * The words should be returned in reading order.
+		 *
+		 * This function is called from a non-GUI thread, so it should
+		 * be safe to call it concurrently with any other methods of the
+		 * document.
+		 *
+		 * @param[in] page The index of the page to query.
+		 * @return The list of words on the \em page.
+		 */
+		virtual QList<TextBox> GetPageText (int page) = 0;
+	};
+}
+}
+
+Q_DECLARE_INTERFACE (LeechCraft::Monocle::IHavePageText,
+		"org.LeechCraft.Monocle.IHavePageText/1.0");
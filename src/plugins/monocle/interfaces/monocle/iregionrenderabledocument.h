@@ -0,0 +1,74 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+
+#pragma once
+
+#include <QImage>
+#include <QRect>
+#include <QtPlugin>
+
+namespace LeechCraft
+{
+namespace Monocle
+{
+	/** @brief Interface for documents supporting rendering page regions.
+	 *
+	 * Rendering the whole page at high zoom levels is both slow and
+	 * memory-hungry, so if the document is able to render just a part
+	 * of a page, it should implement this interface. Monocle will
+	 * then split large pages into tiles and render only the tiles that
+	 * are actually visible.
+	 *
+	 * The rendering function may be called from a non-GUI thread if
+	 * the backend is threaded (see IBackendPlugin::IsThreaded()).
+	 *
+	 * @sa IDocument
+	 */
+	class IRegionRenderableDocument
+	{
+	public:
+		/** @brief Virtual destructor.
+		 */
+		virtual ~IRegionRenderableDocument () {}
+
+		/** @brief Renders the given region of the given page.
+		 *
+		 * The \em region is in the coordinates of the page scaled by
+		 * \em xScale and \em yScale, that is, rendering the rectangle
+		 * from (0, 0) to the scaled page size should produce the same
+		 * image as IDocument::RenderPage() with the same scales.
+		 *
+		 * The returned image should be of \em region's size. A null
+		 * image may be returned if the page isn't available yet.
+		 *
+		 * @param[in] page The index of the page to render.
+		 * @param[in] xScale The horizontal scale of the page.
+		 * @param[in] yScale The vertical scale of the page.
+		 * @param[in] region The region of the scaled page to render.
+		 * @return The image with the rendered region.
+		 *
+		 * @sa IDocument::RenderPage()
+		 */
+		virtual QImage RenderPageRegion (int page, double xScale, double yScale, const QRect& region) = 0;
+	};
+}
+}
+
+Q_DECLARE_INTERFACE (LeechCraft::Monocle::IRegionRenderableDocument,
+		"org.LeechCraft.Monocle.IRegionRenderableDocument/1.0");
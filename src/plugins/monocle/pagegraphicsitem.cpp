@@ -17,12 +17,16 @@
  **********************************************************************/
 
 #include "pagegraphicsitem.h"
+#include <algorithm>
 #include <QtDebug>
-#include <QtConcurrentRun>
-#include <QFutureWatcher>
 #include <QGraphicsSceneMouseEvent>
+#include <QGraphicsScene>
+#include <QGraphicsView>
+#include <QStyleOptionGraphicsItem>
+#include <QPainter>
 #include <QCursor>
 #include <QApplication>
+#include "interfaces/monocle/iregionrenderabledocument.h"
 #include "core.h"
 #include "pixmapcachemanager.h"
 
@@ -30,20 +34,44 @@ namespace LeechCraft
 {
 namespace Monocle
 {
+	namespace
+	{
+		const int TileSize = 512;
+
+		/** Pages with more pixels than this are rendered in tiles.
+		 */
+		const qint64 TilingThreshold = 2048 * 2048;
+
+		const int PreviewMaxDim = 768;
+
+		/** If a page has more tiles than this, the ones that aren't
+		 * visible are dropped.
+		 */
+		const int MaxTiles = 48;
+
+		const int FullPageKey = -1;
+		const int PreviewKey = -2;
+
+		/** Thumbnails are used for pages at most this much wider than
+		 * the thumbnails themselves.
+		 */
+		const double MaxThumbUpscale = 1.25;
+	}
+
 	PageGraphicsItem::PageGraphicsItem (IDocument_ptr doc, int page, QGraphicsItem *parent)
 	: QGraphicsPixmapItem (parent)
 	, Doc_ (doc)
 	, PageNum_ (page)
 	, IsHoverLink_ (false)
-	, Links_ (Doc_->GetPageLinks (PageNum_))
+	, LinksLoaded_ (false)
 	, XScale_ (1)
 	, YScale_ (1)
 	, Invalid_ (true)
+	, RenderPending_ (false)
+	, IsRendered_ (false)
+	, IsTiled_ (false)
 	{
-		setPixmap (QPixmap (Doc_->GetPageSize (page)));
-
-		if (!Links_.isEmpty ())
-			setAcceptHoverEvents (true);
+		setFlag (ItemUsesExtendedStyleOption);
 	}
 
 	PageGraphicsItem::~PageGraphicsItem ()
@@ -56,15 +84,39 @@ namespace Monocle
 		ReleaseHandler_ = handler;
 	}
 
+	void PageGraphicsItem::SetThumbsCache (ThumbsCache_ptr cache)
+	{
+		ThumbsCache_ = cache;
+	}
+
+	void PageGraphicsItem::SetPageSize (const QSize& size)
+	{
+		UpdateGeometry (size, XScale_, YScale_);
+	}
+
 	void PageGraphicsItem::SetScale (double xs, double ys)
 	{
+		UpdateGeometry (PageSize_, xs, ys);
+	}
+
+	void PageGraphicsItem::UpdateGeometry (const QSize& size, double xs, double ys)
+	{
+		if (size == PageSize_ && xs == XScale_ && ys == YScale_)
+			return;
+
+		prepareGeometryChange ();
+
+		if (!IsTiled_ && IsRendered_)
+			StalePixmap_ = pixmap ();
+		IsRendered_ = false;
+
+		PageSize_ = size;
 		XScale_ = xs;
 		YScale_ = ys;
 
-		auto size = Doc_->GetPageSize (PageNum_);
-		size.rwidth () *= xs;
-		size.rheight () *= ys;
-		setPixmap (QPixmap (size));
+		IsTiled_ = ShouldTile ();
+		ResetTiles ();
+		setPixmap (IsTiled_ ? QPixmap () : QPixmap (GetScaledSize ()));
 
 		Invalid_ = true;
 
@@ -118,52 +170,123 @@ namespace Monocle
 
 	void PageGraphicsItem::ClearPixmap ()
 	{
-		auto size = Doc_->GetPageSize (PageNum_);
-		size.rwidth () *= XScale_;
-		size.rheight () *= YScale_;
-		setPixmap (QPixmap (size));
+		if (!IsTiled_ && IsRendered_ && !RenderPending_ && !CanUseThumb ())
+			Core::Instance ().GetPixmapCacheManager ()->StoreCompressed ({ Doc_->GetQObject (), PageNum_, XScale_, YScale_ },
+					pixmap ().toImage ());
+		StalePixmap_ = QPixmap ();
+		IsRendered_ = false;
+
+		ResetTiles ();
+		if (!IsTiled_)
+			setPixmap (QPixmap (GetScaledSize ()));
 
 		Invalid_ = true;
 	}
 
 	void PageGraphicsItem::UpdatePixmap ()
 	{
+		Core::Instance ().GetPixmapCacheManager ()->DropCompressed (Doc_->GetQObject (), PageNum_);
+		StalePixmap_ = QPixmap ();
+		IsRendered_ = false;
+
+		ResetTiles ();
+
 		Invalid_ = true;
 		if (isVisible ())
 			update ();
 	}
 
+	void PageGraphicsItem::Prefetch ()
+	{
+		// The thumbnails are rendered by the cache itself.
+		if (RenderPending_ || CanUseThumb ())
+			return;
+
+		if (!IsTiled_)
+		{
+			if (Invalid_)
+				ScheduleRender (RenderScheduler::Priority::Prefetch);
+			return;
+		}
+
+		if (Preview_.isNull ())
+			RequestPreview (RenderScheduler::Priority::Prefetch);
+	}
+
+	void PageGraphicsItem::CancelRenders ()
+	{
+		Core::Instance ().GetRenderScheduler ()->Cancel (this);
+		RequestedTiles_.clear ();
+
+		if (RenderPending_)
+		{
+			RenderPending_ = false;
+			Invalid_ = true;
+		}
+	}
+
+	qint64 PageGraphicsItem::GetRenderedArea () const
+	{
+		auto area = [] (const QPixmap& px) { return static_cast<qint64> (px.width ()) * px.height (); };
+
+		qint64 result = area (pixmap ()) + area (Preview_) + area (StalePixmap_);
+		for (const auto& tile : Tiles_)
+			result += area (tile);
+		return result;
+	}
+
+	QRectF PageGraphicsItem::boundingRect () const
+	{
+		return IsTiled_ ?
+				QRectF (QPointF (0, 0), GetScaledSize ()) :
+				QGraphicsPixmapItem::boundingRect ();
+	}
+
+	QPainterPath PageGraphicsItem::shape () const
+	{
+		if (!IsTiled_)
+			return QGraphicsPixmapItem::shape ();
+
+		QPainterPath path;
+		path.addRect (boundingRect ());
+		return path;
+	}
+
 	void PageGraphicsItem::paint (QPainter *painter,
 			const QStyleOptionGraphicsItem *option, QWidget *w)
 	{
+		if (IsTiled_)
+		{
+			if (Invalid_)
+			{
+				LayoutLinks ();
+				Invalid_ = false;
+			}
+
+			PaintTiled (painter, option);
+			Core::Instance ().GetPixmapCacheManager ()->PixmapPainted (this);
+			return;
+		}
+
 		if (Invalid_)
 		{
-			auto backendObj = Doc_->GetBackendPlugin ();
-			if (qobject_cast<IBackendPlugin*> (backendObj)->IsThreaded ())
+			if (RestoreFromThumb () || RestoreFromCache ())
+				;
+			else if (IsThreaded ())
 			{
-				auto watcher = new QFutureWatcher<QImage> ();
-				connect (watcher,
-						SIGNAL (finished ()),
-						this,
-						SLOT (handlePixmapRendered ()));
-
-				std::function<QImage ()> worker ([this] ()
-						{
-							return Doc_->RenderPage (PageNum_, XScale_, YScale_);
-						});
-				watcher->setFuture (QtConcurrent::run (worker));
-
-				auto size = Doc_->GetPageSize (PageNum_);
-				size.rwidth () *= XScale_;
-				size.rheight () *= YScale_;
-				QPixmap px (size);
+				ScheduleRender (RenderScheduler::Priority::Visible);
+
+				QPixmap px (GetScaledSize ());
 				px.fill ();
 				setPixmap (px);
 			}
 			else
 			{
+				RenderPending_ = false;
+
 				const auto& img = Doc_->RenderPage (PageNum_, XScale_, YScale_);
 				setPixmap (QPixmap::fromImage (img));
+				IsRendered_ = true;
 			}
 			LayoutLinks ();
 			Invalid_ = false;
@@ -224,8 +347,312 @@ namespace Monocle
 		relLink->Execute ();
 	}
 
+	QSize PageGraphicsItem::GetScaledSize () const
+	{
+		auto size = PageSize_;
+		size.rwidth () *= XScale_;
+		size.rheight () *= YScale_;
+		return size;
+	}
+
+	bool PageGraphicsItem::ShouldTile () const
+	{
+		if (!qobject_cast<IRegionRenderableDocument*> (Doc_->GetQObject ()))
+			return false;
+
+		const auto& size = GetScaledSize ();
+		return static_cast<qint64> (size.width ()) * size.height () > TilingThreshold;
+	}
+
+	bool PageGraphicsItem::IsThreaded () const
+	{
+		auto backendObj = Doc_->GetBackendPlugin ();
+		return qobject_cast<IBackendPlugin*> (backendObj)->IsThreaded ();
+	}
+
+	void PageGraphicsItem::ResetTiles ()
+	{
+		Core::Instance ().GetRenderScheduler ()->Cancel (this);
+		RenderPending_ = false;
+
+		Preview_ = QPixmap ();
+		Tiles_.clear ();
+		RequestedTiles_.clear ();
+	}
+
+	RenderScheduler::Job PageGraphicsItem::MakeJob (int key, RenderScheduler::Priority priority) const
+	{
+		RenderScheduler::Job job;
+		job.Doc_ = Doc_;
+		job.Owner_ = const_cast<PageGraphicsItem*> (this);
+		job.Key_ = key;
+		job.Priority_ = priority;
+		return job;
+	}
+
+	void PageGraphicsItem::ScheduleRender (RenderScheduler::Priority priority)
+	{
+		RenderPending_ = true;
+
+		auto job = MakeJob (FullPageKey, priority);
+		const auto doc = Doc_;
+		const auto pageNum = PageNum_;
+		const auto xs = XScale_;
+		const auto ys = YScale_;
+		job.Render_ = [doc, pageNum, xs, ys] { return doc->RenderPage (pageNum, xs, ys); };
+		job.IsWanted_ = [this] { return RenderPending_; };
+		job.Handler_ = [this] (const QImage& img) { HandleRendered (img); };
+		Core::Instance ().GetRenderScheduler ()->Schedule (job);
+	}
+
+	void PageGraphicsItem::HandleRendered (const QImage& img)
+	{
+		if (!RenderPending_)
+			return;
+
+		RenderPending_ = false;
+		if (IsTiled_ || img.isNull ())
+			return;
+
+		setPixmap (QPixmap::fromImage (img));
+		LayoutLinks ();
+		Invalid_ = false;
+		IsRendered_ = true;
+
+		Core::Instance ().GetPixmapCacheManager ()->PixmapChanged (this);
+	}
+
+	bool PageGraphicsItem::RestoreFromCache ()
+	{
+		auto cacheMgr = Core::Instance ().GetPixmapCacheManager ();
+		const auto& size = GetScaledSize ();
+
+		bool exact = false;
+		const auto& img = cacheMgr->GetCompressed ({ Doc_->GetQObject (), PageNum_, XScale_, YScale_ },
+				size, &exact);
+		if (!img.isNull () && exact)
+		{
+			cacheMgr->RecordLookup (PixmapCacheManager::LookupResult::Hit);
+
+			StalePixmap_ = QPixmap ();
+			RenderPending_ = false;
+			setPixmap (QPixmap::fromImage (img));
+			IsRendered_ = true;
+			return true;
+		}
+
+		QPixmap interim;
+		if (!img.isNull ())
+			interim = QPixmap::fromImage (img);
+		else if (!StalePixmap_.isNull ())
+		{
+			const auto ratio = static_cast<double> (StalePixmap_.width ()) / size.width ();
+			if (ratio >= 1 / 1.5 && ratio <= 1.5)
+				interim = StalePixmap_.scaled (size, Qt::IgnoreAspectRatio, Qt::FastTransformation);
+		}
+		StalePixmap_ = QPixmap ();
+
+		if (interim.isNull ())
+		{
+			cacheMgr->RecordLookup (PixmapCacheManager::LookupResult::Miss);
+			return false;
+		}
+
+		cacheMgr->RecordLookup (PixmapCacheManager::LookupResult::ScaledHit);
+
+		setPixmap (interim);
+		IsRendered_ = true;
+		ScheduleRender (RenderScheduler::Priority::Visible);
+		return true;
+	}
+
+	bool PageGraphicsItem::CanUseThumb () const
+	{
+		return ThumbsCache_ &&
+				ThumbsCache_->IsEnabled () &&
+				!IsTiled_ &&
+				GetScaledSize ().width () <= ThumbsCache::ThumbWidth * MaxThumbUpscale;
+	}
+
+	bool PageGraphicsItem::RestoreFromThumb ()
+	{
+		if (!CanUseThumb ())
+			return false;
+
+		StalePixmap_ = QPixmap ();
+		RenderPending_ = false;
+
+		const auto& size = GetScaledSize ();
+		const auto& thumb = ThumbsCache_->GetThumb (PageNum_);
+		if (thumb.isNull ())
+		{
+			ThumbsCache_->Request (PageNum_);
+
+			QPixmap px (size);
+			px.fill ();
+			setPixmap (px);
+			return true;
+		}
+
+		setPixmap (QPixmap::fromImage (thumb.scaled (size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation)));
+		IsRendered_ = true;
+		return true;
+	}
+
+	QRect PageGraphicsItem::GetTileRect (const Tile_t& tile) const
+	{
+		const QRect rect (tile.first * TileSize, tile.second * TileSize, TileSize, TileSize);
+		return rect & QRect (QPoint (0, 0), GetScaledSize ());
+	}
+
+	QRectF PageGraphicsItem::GetVisibleRect () const
+	{
+		if (!scene ())
+			return QRectF ();
+
+		QRectF result;
+		for (auto view : scene ()->views ())
+		{
+			const auto& viewRect = view->mapToScene (view->viewport ()->rect ()).boundingRect ();
+			result |= mapFromScene (viewRect).boundingRect ();
+		}
+		return result & boundingRect ();
+	}
+
+	void PageGraphicsItem::PaintTiled (QPainter *painter, const QStyleOptionGraphicsItem *option)
+	{
+		const auto& pageSize = GetScaledSize ();
+
+		const auto& exposed = option->exposedRect.toAlignedRect () & QRect (QPoint (0, 0), pageSize);
+		if (exposed.isEmpty ())
+			return;
+
+		// Until the preview is rendered the tiles that aren't ready
+		// yet are left blank.
+		if (Preview_.isNull ())
+			RequestPreview (RenderScheduler::Priority::Visible);
+
+		const double previewXScale = static_cast<double> (Preview_.width ()) / pageSize.width ();
+		const double previewYScale = static_cast<double> (Preview_.height ()) / pageSize.height ();
+
+		for (int row = exposed.top () / TileSize; row <= exposed.bottom () / TileSize; ++row)
+			for (int col = exposed.left () / TileSize; col <= exposed.right () / TileSize; ++col)
+			{
+				const Tile_t tile (col, row);
+				const auto& rect = GetTileRect (tile);
+
+				if (Tiles_.contains (tile))
+				{
+					painter->drawPixmap (rect.topLeft (), Tiles_ [tile]);
+					continue;
+				}
+
+				if (Preview_.isNull ())
+					painter->fillRect (rect, Qt::white);
+				else
+				{
+					const QRectF previewRect (rect.x () * previewXScale, rect.y () * previewYScale,
+							rect.width () * previewXScale, rect.height () * previewYScale);
+					painter->drawPixmap (QRectF (rect), Preview_, previewRect);
+				}
+
+				RequestTile (tile);
+			}
+	}
+
+	void PageGraphicsItem::RequestPreview (RenderScheduler::Priority priority)
+	{
+		const auto& pageSize = GetScaledSize ();
+		const auto factor = std::min (1.0,
+				static_cast<double> (PreviewMaxDim) / std::max (pageSize.width (), pageSize.height ()));
+
+		auto job = MakeJob (PreviewKey, priority);
+		const auto doc = Doc_;
+		const auto pageNum = PageNum_;
+		const auto xs = XScale_ * factor;
+		const auto ys = YScale_ * factor;
+		job.Render_ = [doc, pageNum, xs, ys] { return doc->RenderPage (pageNum, xs, ys); };
+		job.IsWanted_ = [this] { return Preview_.isNull (); };
+		job.Handler_ = [this] (const QImage& img)
+		{
+			if (img.isNull () || !Preview_.isNull ())
+				return;
+
+			Preview_ = QPixmap::fromImage (img);
+			update ();
+			Core::Instance ().GetPixmapCacheManager ()->PixmapChanged (this);
+		};
+		Core::Instance ().GetRenderScheduler ()->Schedule (job);
+	}
+
+	void PageGraphicsItem::RequestTile (const Tile_t& tile)
+	{
+		if (RequestedTiles_.contains (tile))
+			return;
+
+		RequestedTiles_ << tile;
+
+		auto job = MakeJob ((tile.first << 16) | tile.second, RenderScheduler::Priority::Visible);
+		const auto doc = Doc_;
+		const auto rr = qobject_cast<IRegionRenderableDocument*> (doc->GetQObject ());
+		const auto pageNum = PageNum_;
+		const auto xs = XScale_;
+		const auto ys = YScale_;
+		const auto& rect = GetTileRect (tile);
+		job.Render_ = [doc, rr, pageNum, xs, ys, rect] { return rr->RenderPageRegion (pageNum, xs, ys, rect); };
+		// Tiles that have been scrolled out of view by the time their
+		// turn comes are dropped, they will be requested again once
+		// they are painted.
+		job.IsWanted_ = [this, rect] { return GetVisibleRect ().intersects (rect); };
+		job.Handler_ = [this, tile] (const QImage& img) { AddTile (tile, img); };
+		Core::Instance ().GetRenderScheduler ()->Schedule (job);
+	}
+
+	void PageGraphicsItem::AddTile (const Tile_t& tile, const QImage& img)
+	{
+		RequestedTiles_.remove (tile);
+
+		// The page may be unavailable yet, in which case it will be
+		// re-requested once the contents are updated.
+		if (img.isNull ())
+			return;
+
+		Tiles_ [tile] = QPixmap::fromImage (img);
+		update (GetTileRect (tile));
+
+		PruneTiles ();
+		Core::Instance ().GetPixmapCacheManager ()->PixmapChanged (this);
+	}
+
+	void PageGraphicsItem::PruneTiles ()
+	{
+		if (Tiles_.size () <= MaxTiles)
+			return;
+
+		const auto& visible = GetVisibleRect ()
+				.adjusted (-TileSize, -TileSize, TileSize, TileSize);
+		for (auto i = Tiles_.begin (); i != Tiles_.end (); )
+			if (!visible.intersects (GetTileRect (i.key ())))
+				i = Tiles_.erase (i);
+			else
+				++i;
+	}
+
+	void PageGraphicsItem::LoadLinks ()
+	{
+		if (LinksLoaded_)
+			return;
+
+		LinksLoaded_ = true;
+		Links_ = Doc_->GetPageLinks (PageNum_);
+		if (!Links_.isEmpty ())
+			setAcceptHoverEvents (true);
+	}
+
 	void PageGraphicsItem::LayoutLinks ()
 	{
+		LoadLinks ();
+
 		Rect2Link_.clear ();
 
 		const auto& rect = boundingRect ();
@@ -247,14 +674,5 @@ namespace Monocle
 				return pair.second;
 		return ILink_ptr ();
 	}
-
-	void PageGraphicsItem::handlePixmapRendered ()
-	{
-		auto watcher = dynamic_cast<QFutureWatcher<QImage>*> (sender ());
-		watcher->deleteLater ();
-
-		const auto& img = watcher->result ();
-		setPixmap (QPixmap::fromImage (img));
-	}
 }
 }
@@ -20,7 +20,11 @@
 
 #include <functional>
 #include <QGraphicsPixmapItem>
+#include <QHash>
+#include <QSet>
 #include "interfaces/monocle/idocument.h"
+#include "renderscheduler.h"
+#include "thumbscache.h"
 
 namespace LeechCraft
 {
@@ -34,7 +38,12 @@ namespace Monocle
 		IDocument_ptr Doc_;
 		const int PageNum_;
 
+		/** The unscaled size of the page, as set by the layout.
+		 */
+		QSize PageSize_;
+
 		bool IsHoverLink_;
+		bool LinksLoaded_;
 		QList<ILink_ptr> Links_;
 		QList<QPair<QRect, ILink_ptr>> Rect2Link_;
 		ILink_ptr PressedLink_;
@@ -43,6 +52,31 @@ namespace Monocle
 		double YScale_;
 
 		bool Invalid_;
+		bool RenderPending_;
+
+		/** Whether the pixmap has actual page contents, possibly
+		 * scaled from a different zoom level while the proper one is
+		 * being rendered.
+		 */
+		bool IsRendered_;
+
+		/** The last rendered pixmap before the scale has changed, used
+		 * in place of the page until it's rendered at the new scale.
+		 */
+		QPixmap StalePixmap_;
+
+		ThumbsCache_ptr ThumbsCache_;
+
+		/** Large pages are split into tiles that are rendered only
+		 * when they are visible, with a low-resolution preview of the
+		 * whole page shown in place of the tiles not rendered yet.
+		 */
+		bool IsTiled_;
+		QPixmap Preview_;
+
+		typedef QPair<int, int> Tile_t;
+		QHash<Tile_t, QPixmap> Tiles_;
+		QSet<Tile_t> RequestedTiles_;
 
 		std::function<void (int, QPointF)> ReleaseHandler_;
 
@@ -61,6 +95,12 @@ namespace Monocle
 
 		void SetReleaseHandler (std::function<void (int, QPointF)>);
 
+		/** Makes the page be shown from the given thumbnails cache
+		 * whenever it is small enough, instead of being rendered.
+		 */
+		void SetThumbsCache (ThumbsCache_ptr);
+
+		void SetPageSize (const QSize&);
 		void SetScale (double, double);
 		int GetPageNum () const;
 
@@ -72,6 +112,25 @@ namespace Monocle
 
 		void ClearPixmap ();
 		void UpdatePixmap ();
+
+		/** Schedules rendering the page in background with a low
+		 * priority, if it isn't rendered yet. For tiled pages only the
+		 * preview is prefetched.
+		 */
+		void Prefetch ();
+
+		/** Cancels the pending renders of this page, for example,
+		 * when it is scrolled out of view.
+		 */
+		void CancelRenders ();
+
+		/** Returns the number of pixels in all the pixmaps currently
+		 * held by this page, including tiles and the preview.
+		 */
+		qint64 GetRenderedArea () const;
+
+		QRectF boundingRect () const;
+		QPainterPath shape () const;
 	protected:
 		void paint (QPainter*, const QStyleOptionGraphicsItem*, QWidget*);
 		void hoverMoveEvent (QGraphicsSceneHoverEvent*);
@@ -79,10 +138,29 @@ namespace Monocle
 		void mousePressEvent (QGraphicsSceneMouseEvent*);
 		void mouseReleaseEvent (QGraphicsSceneMouseEvent*);
 	private:
+		void UpdateGeometry (const QSize&, double, double);
+		QSize GetScaledSize () const;
+		bool ShouldTile () const;
+		bool IsThreaded () const;
+		void ResetTiles ();
+		RenderScheduler::Job MakeJob (int, RenderScheduler::Priority) const;
+		void ScheduleRender (RenderScheduler::Priority);
+		void HandleRendered (const QImage&);
+		bool RestoreFromCache ();
+		bool CanUseThumb () const;
+		bool RestoreFromThumb ();
+		QRect GetTileRect (const Tile_t&) const;
+		QRectF GetVisibleRect () const;
+
+		void PaintTiled (QPainter*, const QStyleOptionGraphicsItem*);
+		void RequestPreview (RenderScheduler::Priority);
+		void RequestTile (const Tile_t&);
+		void AddTile (const Tile_t&, const QImage&);
+		void PruneTiles ();
+
+		void LoadLinks ();
 		void LayoutLinks ();
 		ILink_ptr FindLink (const QPointF&);
-	private slots:
-		void handlePixmapRendered ();
 	};
 }
 }
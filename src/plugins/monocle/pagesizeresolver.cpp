@@ -0,0 +1,202 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "pagesizeresolver.h"
+#include <algorithm>
+#include <QFile>
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QtDebug>
+#include <util/util.h>
+#include "interfaces/monocle/idynamicdocument.h"
+#include "dochash.h"
+
+namespace LeechCraft
+{
+namespace Monocle
+{
+	namespace
+	{
+		const quint8 CacheVersion = 1;
+
+		/** The time, in milliseconds, the background refinement may
+		 * block the UI for at once.
+		 */
+		const int RefineBatchTime = 10;
+	}
+
+	PageSizeResolver::PageSizeResolver (IDocument_ptr doc, QObject *parent)
+	: QObject (parent)
+	, Doc_ (doc)
+	, Sizes_ (doc->GetNumPages ())
+	, Known_ (Sizes_.size ())
+	, KnownCount_ (0)
+	, NextPage_ (0)
+	, HasChanges_ (false)
+	{
+		// Sizes of dynamic documents aren't stable enough to be cached.
+		if (!qobject_cast<IDynamicDocument*> (Doc_->GetQObject ()))
+		{
+			const auto& hash = GetDocHash (Doc_->GetDocURL ().toLocalFile ());
+			if (!hash.isEmpty ())
+				CachePath_ = Util::CreateIfNotExists ("monocle/pagesizes").filePath (hash + ".dat");
+		}
+
+		if (Sizes_.isEmpty () || LoadCache ())
+			return;
+
+		ResolvePage (0);
+		Estimate_ = Sizes_.at (0);
+
+		ScheduleRefine ();
+	}
+
+	QSize PageSizeResolver::GetPageSize (int page) const
+	{
+		if (page < 0 || page >= Sizes_.size ())
+			return QSize ();
+
+		return Known_.testBit (page) ? Sizes_.at (page) : Estimate_;
+	}
+
+	bool PageSizeResolver::Resolve (int from, int to)
+	{
+		from = std::max (from, 0);
+		to = std::min (to, Sizes_.size () - 1);
+
+		bool changed = false;
+		for (int i = from; i <= to; ++i)
+			if (!Known_.testBit (i))
+				changed = ResolvePage (i) || changed;
+		return changed;
+	}
+
+	void PageSizeResolver::Refresh (int page)
+	{
+		if (page < 0 || page >= Sizes_.size ())
+			return;
+
+		if (Known_.testBit (page))
+		{
+			Known_.clearBit (page);
+			--KnownCount_;
+		}
+		ResolvePage (page);
+	}
+
+	bool PageSizeResolver::IsComplete () const
+	{
+		return KnownCount_ == Sizes_.size ();
+	}
+
+	bool PageSizeResolver::ResolvePage (int page)
+	{
+		const auto& size = Doc_->GetPageSize (page);
+		Sizes_ [page] = size;
+		Known_.setBit (page);
+		++KnownCount_;
+
+		if (IsComplete ())
+			SaveCache ();
+
+		return size != Estimate_;
+	}
+
+	bool PageSizeResolver::LoadCache ()
+	{
+		if (CachePath_.isEmpty ())
+			return false;
+
+		QFile file (CachePath_);
+		if (!file.open (QIODevice::ReadOnly))
+			return false;
+
+		QDataStream in (&file);
+		quint8 version = 0;
+		in >> version;
+		if (version != CacheVersion)
+			return false;
+
+		QVector<QSize> sizes;
+		in >> sizes;
+		if (in.status () != QDataStream::Ok || sizes.size () != Sizes_.size ())
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "invalid page sizes cache"
+					<< CachePath_;
+			return false;
+		}
+
+		Sizes_ = sizes;
+		Known_.fill (true);
+		KnownCount_ = Sizes_.size ();
+		Estimate_ = Sizes_.at (0);
+		return true;
+	}
+
+	void PageSizeResolver::SaveCache () const
+	{
+		if (CachePath_.isEmpty ())
+			return;
+
+		QFile file (CachePath_);
+		if (!file.open (QIODevice::WriteOnly))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to open"
+					<< CachePath_
+					<< file.errorString ();
+			return;
+		}
+
+		QDataStream out (&file);
+		out << CacheVersion << Sizes_;
+	}
+
+	void PageSizeResolver::ScheduleRefine ()
+	{
+		QTimer::singleShot (0,
+				this,
+				SLOT (refine ()));
+	}
+
+	void PageSizeResolver::refine ()
+	{
+		QElapsedTimer timer;
+		timer.start ();
+
+		const auto size = Sizes_.size ();
+		while (NextPage_ < size && timer.elapsed () < RefineBatchTime)
+		{
+			if (!Known_.testBit (NextPage_))
+				HasChanges_ = ResolvePage (NextPage_) || HasChanges_;
+			++NextPage_;
+		}
+
+		if (HasChanges_)
+		{
+			HasChanges_ = false;
+			emit sizesChanged ();
+		}
+
+		if (NextPage_ < size)
+			ScheduleRefine ();
+	}
+}
+}
@@ -0,0 +1,89 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#pragma once
+
+#include <memory>
+#include <QObject>
+#include <QVector>
+#include <QBitArray>
+#include <QSize>
+#include "interfaces/monocle/idocument.h"
+
+namespace LeechCraft
+{
+namespace Monocle
+{
+	/** Provides page sizes without querying all of them from the
+	 * document at once, since some backends have to load each page to
+	 * know its size.
+	 *
+	 * The sizes that aren't known yet are estimated from the first
+	 * page. The actual sizes are queried in background in small
+	 * batches, and sizesChanged() is emitted whenever they turn out
+	 * to differ from the estimate. Once all the sizes are known, they
+	 * are cached on disk by the document contents hash.
+	 */
+	class PageSizeResolver : public QObject
+	{
+		Q_OBJECT
+
+		const IDocument_ptr Doc_;
+		QString CachePath_;
+
+		QVector<QSize> Sizes_;
+		QBitArray Known_;
+		int KnownCount_;
+		QSize Estimate_;
+
+		int NextPage_;
+		bool HasChanges_;
+	public:
+		PageSizeResolver (IDocument_ptr, QObject* = 0);
+
+		/** Returns the size of the page if it is known, or the
+		 * estimate otherwise.
+		 */
+		QSize GetPageSize (int) const;
+
+		/** Queries the sizes of the pages from \em from to \em to,
+		 * inclusive, which aren't known yet. Returns true if any of
+		 * them differs from the estimate.
+		 */
+		bool Resolve (int from, int to);
+
+		/** Queries the size of the given page once again, for example,
+		 * after IDynamicDocument::pageSizeChanged().
+		 */
+		void Refresh (int);
+
+		bool IsComplete () const;
+	private:
+		bool ResolvePage (int);
+		bool LoadCache ();
+		void SaveCache () const;
+		void ScheduleRefine ();
+	private slots:
+		void refine ();
+	signals:
+		void sizesChanged ();
+	};
+
+	typedef std::shared_ptr<PageSizeResolver> PageSizeResolver_ptr;
+}
+}
@@ -40,6 +40,7 @@ namespace Monocle
 	, ScaleMode_ (ScaleMode::FitWidth)
 	, FixedScale_ (1)
 	, RelayoutScheduled_ (false)
+	, RefineRelayoutScheduled_ (false)
 	, HorMargin_ (0)
 	, VertMargin_ (0)
 	{
@@ -48,13 +49,33 @@ namespace Monocle
 				this,
 				SLOT (scheduleRelayout ()),
 				Qt::QueuedConnection);
+		connect (View_->verticalScrollBar (),
+				SIGNAL (valueChanged (int)),
+				this,
+				SLOT (handleViewScrolled ()));
 	}
 
-	void PagesLayoutManager::HandleDoc (IDocument_ptr doc, const QList<PageGraphicsItem*>& pages)
+	void PagesLayoutManager::HandleDoc (IDocument_ptr doc,
+			const QList<PageGraphicsItem*>& pages, PageSizeResolver_ptr sizes)
 	{
+		if (Sizes_)
+			disconnect (Sizes_.get (),
+					0,
+					this,
+					0);
+
 		CurrentDoc_ = doc;
 		Pages_ = pages;
 
+		Sizes_ = sizes;
+		if (!Sizes_ && CurrentDoc_)
+			Sizes_ = std::make_shared<PageSizeResolver> (CurrentDoc_);
+		if (Sizes_)
+			connect (Sizes_.get (),
+					SIGNAL (sizesChanged ()),
+					this,
+					SLOT (handleSizesRefined ()));
+
 		if (CurrentDoc_ && qobject_cast<IDynamicDocument*> (CurrentDoc_->GetQObject ()))
 			connect (CurrentDoc_->GetQObject (),
 					SIGNAL (pageSizeChanged (int)),
@@ -107,6 +128,9 @@ namespace Monocle
 		if (idx < 0 || idx >= Pages_.size ())
 			return;
 
+		if (ResolveAround (idx))
+			LayoutPages ();
+
 		auto page = Pages_.at (idx);
 		const auto& rect = page->boundingRect ();
 		const auto& pos = page->scenePos ();
@@ -149,7 +173,7 @@ namespace Monocle
 			if (pageIdx < 0)
 				pageIdx = 0;
 
-			double dim = dimGetter (CurrentDoc_->GetPageSize (pageIdx) + QSize (2 * HorMargin_, 2 * VertMargin_));
+			double dim = dimGetter (Sizes_->GetPageSize (pageIdx) + QSize (2 * HorMargin_, 2 * VertMargin_));
 			auto size = View_->maximumViewportSize ();
 			size.rwidth () -= View_->verticalScrollBar ()->size ().width ();
 			size.rheight () -= View_->horizontalScrollBar ()->size ().height ();
@@ -196,37 +220,87 @@ namespace Monocle
 
 	void PagesLayoutManager::Relayout ()
 	{
-		const auto scale = GetCurrentScale ();
 		const auto pageWas = GetCurrentPage ();
 
-		for (auto item : Pages_)
-			item->SetScale (scale, scale);
+		ResolveAround (std::max (pageWas, 0));
+		LayoutPages ();
+
+		SetCurrentPage (std::max (pageWas, 0), true);
+
+		if (RelayoutScheduled_)
+		{
+			RelayoutScheduled_ = false;
+			emit scheduledRelayoutFinished ();
+		}
+	}
+
+	bool PagesLayoutManager::ResolveAround (int idx)
+	{
+		if (!Sizes_ || Sizes_->IsComplete ())
+			return false;
+
+		const auto count = GetLayoutModeCount ();
+		return Sizes_->Resolve (idx - count, idx + 4 * count);
+	}
+
+	void PagesLayoutManager::LayoutPages ()
+	{
+		if (!Sizes_)
+			return;
+
+		const auto scale = GetCurrentScale ();
+		const auto cols = GetLayoutModeCount ();
 
-		for (int i = 0, pagesCount = Pages_.size (); i < pagesCount; ++i)
+		qreal y = Margin;
+		for (int i = 0, pagesCount = Pages_.size (); i < pagesCount; i += cols)
 		{
-			const auto& size = CurrentDoc_->GetPageSize (i) * scale;
-			auto page = Pages_ [i];
-			switch (LayMode_)
+			qreal x = 0;
+			qreal rowHeight = 0;
+			for (int j = i; j < std::min (i + cols, pagesCount); ++j)
 			{
-			case LayoutMode::OnePage:
-				page->setPos (0, Margin + (size.height () + Margin) * i);
-				break;
-			case LayoutMode::TwoPages:
-				page->setPos ((i % 2) * (Margin / 3 + size.width ()), Margin + (size.height () + Margin) * (i / 2));
-				break;
+				const auto& pageSize = Sizes_->GetPageSize (j);
+				const auto& size = pageSize * scale;
+
+				auto page = Pages_ [j];
+				page->SetPageSize (pageSize);
+				page->SetScale (scale, scale);
+				page->setPos (x, y);
+
+				x += size.width () + Margin / 3;
+				rowHeight = std::max<qreal> (rowHeight, size.height ());
 			}
+			y += rowHeight + Margin;
 		}
 
 		Scene_->setSceneRect (Scene_->itemsBoundingRect ()
 					.adjusted (-HorMargin_, -VertMargin_, 0, 0));
+	}
 
-		SetCurrentPage (std::max (pageWas, 0), true);
-
-		if (RelayoutScheduled_)
+	void PagesLayoutManager::RelayoutKeepingAnchor ()
+	{
+		const auto pageIdx = GetCurrentPage ();
+		if (pageIdx < 0 || Pages_.at (pageIdx)->boundingRect ().isEmpty ())
 		{
-			RelayoutScheduled_ = false;
-			emit scheduledRelayoutFinished ();
+			LayoutPages ();
+			return;
 		}
+
+		auto page = Pages_.at (pageIdx);
+		const auto& center = View_->mapToScene (GetViewportCenter ());
+		const auto& rect = page->sceneBoundingRect ();
+		const QPointF relative
+		{
+			(center.x () - rect.left ()) / rect.width (),
+			(center.y () - rect.top ()) / rect.height ()
+		};
+
+		LayoutPages ();
+
+		const auto& newRect = page->sceneBoundingRect ();
+		View_->centerOn (newRect.left () + relative.x () * newRect.width (),
+				newRect.top () + relative.y () * newRect.height ());
+
+		emit scheduledRelayoutFinished ();
 	}
 
 	void PagesLayoutManager::scheduleRelayout ()
@@ -249,9 +323,36 @@ namespace Monocle
 		emit scheduledRelayoutFinished ();
 	}
 
-	void PagesLayoutManager::handlePageSizeChanged (int)
+	void PagesLayoutManager::handlePageSizeChanged (int page)
 	{
+		if (Sizes_)
+			Sizes_->Refresh (page);
+
 		scheduleRelayout ();
 	}
+
+	void PagesLayoutManager::handleSizesRefined ()
+	{
+		if (RefineRelayoutScheduled_)
+			return;
+
+		QTimer::singleShot (250,
+				this,
+				SLOT (relayoutRefined ()));
+		RefineRelayoutScheduled_ = true;
+	}
+
+	void PagesLayoutManager::relayoutRefined ()
+	{
+		RefineRelayoutScheduled_ = false;
+		RelayoutKeepingAnchor ();
+	}
+
+	void PagesLayoutManager::handleViewScrolled ()
+	{
+		const auto page = GetCurrentPage ();
+		if (page >= 0 && ResolveAround (page))
+			RelayoutKeepingAnchor ();
+	}
 }
 }
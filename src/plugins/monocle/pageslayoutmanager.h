@@ -20,6 +20,7 @@
 
 #include <QObject>
 #include "interfaces/monocle/idocument.h"
+#include "pagesizeresolver.h"
 
 class QGraphicsScene;
 
@@ -41,6 +42,7 @@ namespace Monocle
 		QGraphicsScene * const Scene_;
 
 		IDocument_ptr CurrentDoc_;
+		PageSizeResolver_ptr Sizes_;
 
 		QList<PageGraphicsItem*> Pages_;
 
@@ -50,13 +52,18 @@ namespace Monocle
 		double FixedScale_;
 
 		bool RelayoutScheduled_;
+		bool RefineRelayoutScheduled_;
 
 		double HorMargin_;
 		double VertMargin_;
 	public:
 		PagesLayoutManager (PagesView*, QObject* = 0);
 
-		void HandleDoc (IDocument_ptr, const QList<PageGraphicsItem*>&);
+		/** If \em sizes is null, a new resolver is created for the
+		 * \em doc.
+		 */
+		void HandleDoc (IDocument_ptr doc, const QList<PageGraphicsItem*>&,
+				PageSizeResolver_ptr sizes = PageSizeResolver_ptr ());
 		const QList<PageGraphicsItem*>& GetPages () const;
 
 		LayoutMode GetLayoutMode () const;
@@ -76,11 +83,18 @@ namespace Monocle
 		void SetMargins (double horizontal, double vertical);
 
 		void Relayout ();
+	private:
+		bool ResolveAround (int);
+		void LayoutPages ();
+		void RelayoutKeepingAnchor ();
 	public slots:
 		void scheduleRelayout ();
 		void handleRelayout ();
 	private slots:
 		void handlePageSizeChanged (int);
+		void handleSizesRefined ();
+		void relayoutRefined ();
+		void handleViewScrolled ();
 	signals:
 		void scheduledRelayoutFinished ();
 	};
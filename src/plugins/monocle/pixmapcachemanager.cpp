@@ -16,8 +16,14 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  **********************************************************************/
 
+
 #include "pixmapcachemanager.h"
-#include <numeric>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <QPixmap>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
 #include <QtDebug>
 #include "xmlsettingsmanager.h"
 #include "pagegraphicsitem.h"
@@ -26,64 +32,289 @@ namespace LeechCraft
 {
 namespace Monocle
 {
+	PixmapCacheManager::Stats::Stats ()
+	: Hits_ (0)
+	, ScaledHits_ (0)
+	, Misses_ (0)
+	, Evictions_ (0)
+	, CompressedEvictions_ (0)
+	, Size_ (0)
+	, CompressedSize_ (0)
+	, CompressedCount_ (0)
+	{
+	}
+
+	bool PixmapCacheManager::CompressedKey::operator== (const CompressedKey& other) const
+	{
+		return Doc_ == other.Doc_ &&
+				Page_ == other.Page_ &&
+				XScale_ == other.XScale_ &&
+				YScale_ == other.YScale_;
+	}
+
+	uint qHash (const PixmapCacheManager::CompressedKey& key)
+	{
+		return qHash (key.Doc_) ^
+				qHash (key.Page_) ^
+				qHash (static_cast<quint64> (key.XScale_ * 1000)) ^
+				qHash (static_cast<quint64> (key.YScale_ * 1000) << 1);
+	}
+
 	PixmapCacheManager::PixmapCacheManager (QObject *parent)
 	: QObject (parent)
 	, CurrentSize_ (0)
 	, MaxSize_ (0)
+	, CompressedSize_ (0)
+	, MaxCompressedSize_ (0)
 	{
-		XmlSettingsManager::Instance ().RegisterObject ("PixmapCacheSize",
+		XmlSettingsManager::Instance ().RegisterObject ({ "PixmapCacheSize", "CompressedCacheSize" },
 				this, "handleCacheSizeChanged");
 		handleCacheSizeChanged ();
 	}
 
 	namespace
 	{
-		quint64 GetPixmapSize (const QPixmap& px)
+		quint64 GetPixmapSize (const PageGraphicsItem *item)
 		{
-			return px.width () * px.height () * px.defaultDepth () / 8 * 1.5;
+			return item->GetRenderedArea () * QPixmap::defaultDepth () / 8 * 1.5;
 		}
 	}
 
 	void PixmapCacheManager::PixmapPainted (PageGraphicsItem *item)
 	{
-		RecentlyUsed_.removeAll (item);
-		RecentlyUsed_ << item;
+		Touch (item);
 	}
 
 	void PixmapCacheManager::PixmapChanged (PageGraphicsItem *item)
 	{
-		if (RecentlyUsed_.removeAll (item))
-			CurrentSize_ = std::accumulate (RecentlyUsed_.begin (), RecentlyUsed_.end (), 0,
-					[] (qint64 size, decltype (RecentlyUsed_.front ()) item)
-						{ return size + GetPixmapSize (item->pixmap ()); });
+		Touch (item);
+
+		const auto newSize = GetPixmapSize (item);
+		auto& size = ItemSizes_ [item];
+		CurrentSize_ += newSize - size;
+		size = newSize;
 
-		RecentlyUsed_ << item;
-		CurrentSize_ += GetPixmapSize (item->pixmap ());
 		CheckCache ();
 	}
 
 	void PixmapCacheManager::PixmapDeleted (PageGraphicsItem *item)
 	{
-		CurrentSize_ -= GetPixmapSize (item->pixmap ());
-		RecentlyUsed_.removeAll (item);
+		Forget (item);
+	}
+
+	void PixmapCacheManager::StoreCompressed (const CompressedKey& key, const QImage& image)
+	{
+		if (!MaxCompressedSize_ || image.isNull ())
+			return;
+
+		if (Compressed_.contains (key))
+		{
+			auto& entry = Compressed_ [key];
+			CompressedLRU_.splice (CompressedLRU_.end (), CompressedLRU_, entry.LRUPos_);
+			return;
+		}
+
+		for (const auto& pending : PendingCompressions_)
+			if (pending.first == key)
+				return;
+
+		connect (key.Doc_,
+				SIGNAL (destroyed ()),
+				this,
+				SLOT (handleDocDestroyed ()),
+				Qt::UniqueConnection);
+
+		auto watcher = new QFutureWatcher<QByteArray> ();
+		PendingCompressions_ [watcher] = { key, image };
+		connect (watcher,
+				SIGNAL (finished ()),
+				this,
+				SLOT (handleCompressed ()));
+
+		std::function<QByteArray ()> worker = [image] () -> QByteArray
+		{
+			const auto& raw = QByteArray::fromRawData (reinterpret_cast<const char*> (image.bits ()),
+					image.byteCount ());
+			return qCompress (raw, 1);
+		};
+		watcher->setFuture (QtConcurrent::run (worker));
+	}
+
+	QImage PixmapCacheManager::GetCompressed (const CompressedKey& key, const QSize& targetSize, bool *exact)
+	{
+		const auto& candidates = Page2Compressed_.value ({ key.Doc_, key.Page_ });
+
+		const CompressedKey *best = 0;
+		double bestDistance = std::log (1.5);
+		for (const auto& candidate : candidates)
+		{
+			const auto distance = std::max (std::abs (std::log (candidate.XScale_ / key.XScale_)),
+					std::abs (std::log (candidate.YScale_ / key.YScale_)));
+			if (distance <= bestDistance)
+			{
+				best = &candidate;
+				bestDistance = distance;
+			}
+		}
+
+		if (!best)
+			return QImage ();
+
+		auto& entry = Compressed_ [*best];
+		CompressedLRU_.splice (CompressedLRU_.end (), CompressedLRU_, entry.LRUPos_);
+
+		const auto& raw = qUncompress (entry.Data_);
+		QImage image (entry.Size_, entry.Format_);
+		if (raw.size () != image.byteCount ())
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "size mismatch"
+					<< raw.size ()
+					<< image.byteCount ();
+			RemoveCompressed (*best);
+			return QImage ();
+		}
+		std::memcpy (image.bits (), raw.constData (), raw.size ());
+
+		*exact = *best == key;
+		if (*exact || image.size () == targetSize)
+			return image;
+
+		return image.scaled (targetSize, Qt::IgnoreAspectRatio, Qt::FastTransformation);
+	}
+
+	void PixmapCacheManager::DropCompressed (QObject *doc, int page)
+	{
+		for (const auto& key : Page2Compressed_.value ({ doc, page }))
+			RemoveCompressed (key);
+
+		for (auto& pending : PendingCompressions_)
+			if (pending.first.Doc_ == doc && pending.first.Page_ == page)
+				pending.first.Doc_ = 0;
+	}
+
+	void PixmapCacheManager::RecordLookup (LookupResult result)
+	{
+		switch (result)
+		{
+		case LookupResult::Hit:
+			++Stats_.Hits_;
+			break;
+		case LookupResult::ScaledHit:
+			++Stats_.ScaledHits_;
+			break;
+		case LookupResult::Miss:
+			++Stats_.Misses_;
+			break;
+		}
+	}
+
+	PixmapCacheManager::Stats PixmapCacheManager::GetStats () const
+	{
+		auto stats = Stats_;
+		stats.Size_ = CurrentSize_;
+		stats.CompressedSize_ = CompressedSize_;
+		stats.CompressedCount_ = Compressed_.size ();
+		return stats;
+	}
+
+	void PixmapCacheManager::Touch (PageGraphicsItem *item)
+	{
+		auto pos = RecentlyUsedPos_.find (item);
+		if (pos == RecentlyUsedPos_.end ())
+			RecentlyUsedPos_ [item] = RecentlyUsed_.insert (RecentlyUsed_.end (), item);
+		else
+			RecentlyUsed_.splice (RecentlyUsed_.end (), RecentlyUsed_, *pos);
+	}
+
+	void PixmapCacheManager::Forget (PageGraphicsItem *item)
+	{
+		auto pos = RecentlyUsedPos_.find (item);
+		if (pos == RecentlyUsedPos_.end ())
+			return;
+
+		RecentlyUsed_.erase (*pos);
+		RecentlyUsedPos_.erase (pos);
+		CurrentSize_ -= ItemSizes_.take (item);
 	}
 
 	void PixmapCacheManager::CheckCache ()
 	{
 		while (MaxSize_ < CurrentSize_ && RecentlyUsed_.size () > 2)
 		{
-			auto page = RecentlyUsed_.takeFirst ();
-			const quint64 pxSize = GetPixmapSize (page->pixmap ());
-			CurrentSize_ -= pxSize;
+			auto page = RecentlyUsed_.front ();
+			Forget (page);
 			page->ClearPixmap ();
+			++Stats_.Evictions_;
+		}
+	}
+
+	void PixmapCacheManager::RemoveCompressed (const CompressedKey& key)
+	{
+		const auto& entry = Compressed_.take (key);
+		CompressedLRU_.erase (entry.LRUPos_);
+		CompressedSize_ -= entry.Data_.size ();
+
+		const QPair<QObject*, int> pageKey { key.Doc_, key.Page_ };
+		auto& pageKeys = Page2Compressed_ [pageKey];
+		pageKeys.removeAll (key);
+		if (pageKeys.isEmpty ())
+			Page2Compressed_.remove (pageKey);
+	}
+
+	void PixmapCacheManager::CheckCompressedCache ()
+	{
+		while (MaxCompressedSize_ < CompressedSize_ && !CompressedLRU_.empty ())
+		{
+			RemoveCompressed (CompressedLRU_.front ());
+			++Stats_.CompressedEvictions_;
 		}
 	}
 
 	void PixmapCacheManager::handleCacheSizeChanged ()
 	{
-		MaxSize_ = XmlSettingsManager::Instance ().property ("PixmapCacheSize").value<qint64> () * 1024 * 1024;
+		auto& xsm = XmlSettingsManager::Instance ();
+		MaxSize_ = xsm.property ("PixmapCacheSize").value<qint64> () * 1024 * 1024;
+		MaxCompressedSize_ = xsm.property ("CompressedCacheSize").value<qint64> () * 1024 * 1024;
 
 		CheckCache ();
+		CheckCompressedCache ();
+	}
+
+	void PixmapCacheManager::handleCompressed ()
+	{
+		auto watcher = dynamic_cast<QFutureWatcher<QByteArray>*> (sender ());
+		watcher->deleteLater ();
+
+		const auto& pending = PendingCompressions_.take (watcher);
+		const auto& key = pending.first;
+		const auto& image = pending.second;
+
+		// The document could have been closed in the meantime.
+		if (!key.Doc_ || Compressed_.contains (key))
+			return;
+
+		const auto& data = watcher->result ();
+		Compressed_ [key] = { data, image.size (), image.format (),
+				CompressedLRU_.insert (CompressedLRU_.end (), key) };
+		Page2Compressed_ [{ key.Doc_, key.Page_ }] << key;
+		CompressedSize_ += data.size ();
+
+		CheckCompressedCache ();
+	}
+
+	void PixmapCacheManager::handleDocDestroyed ()
+	{
+		const auto doc = sender ();
+
+		for (const auto& pageKey : Page2Compressed_.keys ())
+			if (pageKey.first == doc)
+				for (const auto& key : Page2Compressed_.value (pageKey))
+					RemoveCompressed (key);
+
+		for (auto& pending : PendingCompressions_)
+			if (pending.first.Doc_ == doc)
+				pending.first.Doc_ = 0;
 	}
 }
 }
@@ -16,9 +16,16 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  **********************************************************************/
 
+
 #pragma once
 
+#include <list>
 #include <QObject>
+#include <QHash>
+#include <QImage>
+
+template<typename T>
+class QFutureWatcher;
 
 namespace LeechCraft
 {
@@ -26,23 +33,122 @@ namespace Monocle
 {
 	class PageGraphicsItem;
 
+	/** Manages the memory used by the rendered pages.
+	 *
+	 * The first tier consists of the pixmaps held by the pages
+	 * themselves, which are evicted in LRU order once they exceed
+	 * PixmapCacheSize.
+	 *
+	 * The second tier keeps the evicted pages' images compressed,
+	 * keyed by the document, page and scale, within the
+	 * CompressedCacheSize budget. Restoring a page from there is much
+	 * cheaper than rendering it again, and an image for a slightly
+	 * different scale can be shown while the proper one is rendered.
+	 */
 	class PixmapCacheManager : public QObject
 	{
 		Q_OBJECT
+	public:
+		struct Stats
+		{
+			quint64 Hits_;
+			quint64 ScaledHits_;
+			quint64 Misses_;
+
+			quint64 Evictions_;
+			quint64 CompressedEvictions_;
+
+			qint64 Size_;
+			qint64 CompressedSize_;
+			int CompressedCount_;
 
+			Stats ();
+		};
+
+		enum class LookupResult
+		{
+			Hit,
+			ScaledHit,
+			Miss
+		};
+
+		struct CompressedKey
+		{
+			QObject *Doc_;
+			int Page_;
+			double XScale_;
+			double YScale_;
+
+			bool operator== (const CompressedKey&) const;
+		};
+	private:
 		qint64 CurrentSize_;
 		qint64 MaxSize_;
-		QList<PageGraphicsItem*> RecentlyUsed_;
+
+		std::list<PageGraphicsItem*> RecentlyUsed_;
+		QHash<PageGraphicsItem*, std::list<PageGraphicsItem*>::iterator> RecentlyUsedPos_;
+		QHash<PageGraphicsItem*, qint64> ItemSizes_;
+
+		struct CompressedEntry
+		{
+			QByteArray Data_;
+			QSize Size_;
+			QImage::Format Format_;
+			std::list<CompressedKey>::iterator LRUPos_;
+		};
+		qint64 CompressedSize_;
+		qint64 MaxCompressedSize_;
+		std::list<CompressedKey> CompressedLRU_;
+		QHash<CompressedKey, CompressedEntry> Compressed_;
+		QHash<QPair<QObject*, int>, QList<CompressedKey>> Page2Compressed_;
+
+		QHash<QFutureWatcher<QByteArray>*, QPair<CompressedKey, QImage>> PendingCompressions_;
+
+		Stats Stats_;
 	public:
 		PixmapCacheManager (QObject* = 0);
 
 		void PixmapPainted (PageGraphicsItem*);
 		void PixmapChanged (PageGraphicsItem*);
 		void PixmapDeleted (PageGraphicsItem*);
+
+		/** Stores the rendered image of the whole page in the
+		 * compressed tier. The compression itself is done in
+		 * background.
+		 */
+		void StoreCompressed (const CompressedKey&, const QImage&);
+
+		/** Returns the image of the page rendered exactly at the
+		 * given scale, or, if there is none, the image rendered at the
+		 * closest scale that differs by no more than 50%, scaled to
+		 * the \em targetSize. In the latter case \em exact is set to
+		 * false.
+		 *
+		 * A null image is returned if there is nothing suitable.
+		 */
+		QImage GetCompressed (const CompressedKey&, const QSize& targetSize, bool *exact);
+
+		/** Drops all the compressed images of the given page, for
+		 * example, after its contents have changed.
+		 */
+		void DropCompressed (QObject *doc, int page);
+
+		void RecordLookup (LookupResult);
+
+		Stats GetStats () const;
 	private:
+		void Touch (PageGraphicsItem*);
+		void Forget (PageGraphicsItem*);
 		void CheckCache ();
+
+		void RemoveCompressed (const CompressedKey&);
+		void CheckCompressedCache ();
 	private slots:
 		void handleCacheSizeChanged ();
+		void handleCompressed ();
+		void handleDocDestroyed ();
 	};
+
+	uint qHash (const PixmapCacheManager::CompressedKey&);
 }
 }
@@ -18,7 +18,6 @@
 
 #include "document.h"
 #include <QFile>
-#include <QDomDocument>
 #include <QtDebug>
 #include <QTextDocument>
 #include <QTextBlock>
@@ -46,18 +45,22 @@ namespace FXB
 			return;
 		}
 
-		QDomDocument doc;
-		if (!doc.setContent (file.readAll (), true))
+		FB2Converter conv (this, &file);
+		while (conv.ConvertNext ())
+			;
+
+		const auto& error = conv.GetError ();
+		if (!error.isEmpty ())
 		{
 			qWarning () << Q_FUNC_INFO
-					<< "malformed XML in"
-					<< filename;
+					<< "unable to convert"
+					<< filename
+					<< error;
+			delete conv.GetResult ();
 			return;
 		}
 
-		FB2Converter conv (this, doc);
-		auto textDoc = conv.GetResult ();
-		SetDocument (textDoc);
+		SetDocument (conv.GetResult ());
 		Info_ = conv.GetDocumentInfo ();
 		TOC_ = conv.GetTOC ();
 	}
@@ -17,18 +17,19 @@
  **********************************************************************/
 
 #include "fb2converter.h"
-#include "toclink.h"
 #include <functional>
-#include <memory>
-#include <QDomDocument>
 #include <QTextDocument>
 #include <QTextCursor>
 #include <QTextFrame>
+#include <QTextBlock>
+#include <QAbstractTextDocumentLayout>
 #include <QUrl>
 #include <QImage>
 #include <QVariant>
 #include <QStringList>
 #include <QtDebug>
+#include "toclink.h"
+#include "lazyimagedocument.h"
 
 namespace LeechCraft
 {
@@ -36,94 +37,66 @@ namespace Monocle
 {
 namespace FXB
 {
-	FB2Converter::FB2Converter (Document *doc, const QDomDocument& fb2)
+	FB2Converter::FB2Converter (Document *doc, QIODevice *device)
 	: ParentDoc_ (doc)
-	, FB2_ (fb2)
-	, Result_ (new QTextDocument)
+	, Reader_ (device)
+	, Result_ (new LazyImageDocument)
 	, Cursor_ (new QTextCursor (Result_))
 	, SectionLevel_ (0)
+	, InBody_ (false)
+	, Finished_ (false)
 	{
 		Result_->setPageSize (QSize (600, 800));
 		Result_->setUndoRedoEnabled (false);
 
-		const auto& docElem = FB2_.documentElement ();
-		if (docElem.tagName () != "FictionBook")
-		{
-			Error_ = tr ("Invalid FictionBook document.");
-			return;
-		}
-
-		auto elems = docElem.elementsByTagName ("binary");
-		for (int i = 0, size = elems.size (); i < size; ++i)
-		{
-			const auto& elem = elems.at (i).toElement ();
-			AddImage (elem);
-		}
-
 		auto frameFmt = Result_->rootFrame ()->frameFormat ();
 		frameFmt.setMargin (20);
 		Result_->rootFrame ()->setFrameFormat (frameFmt);
 
-		Handlers_ ["section"] = [this] (const QDomElement& p) { HandleSection (p); };
-		Handlers_ ["title"] = [this] (const QDomElement& p) { HandleTitle (p); };
-		Handlers_ ["subtitle"] = [this] (const QDomElement& p) { HandleTitle (p, 1); };
-		Handlers_ ["epigraph"] = [this] (const QDomElement& p) { HandleEpigraph (p); };
-		Handlers_ ["image"] = [this] (const QDomElement& p) { HandleImage (p); };
-
-		Handlers_ ["p"] = [this] (const QDomElement& p) { HandlePara (p); };
-		Handlers_ ["poem"] = [this] (const QDomElement& p) { HandlePoem (p); };
-		Handlers_ ["empty-line"] = [this] (const QDomElement& p) { HandleEmptyLine (p); };
-		Handlers_ ["stanza"] = [this] (const QDomElement& p) { HandleStanza (p); };
-		Handlers_ ["v"] = [this] (const QDomElement& p)
+		Handlers_ ["section"] = [this] { HandleSection (); };
+		Handlers_ ["title"] = [this] { HandleTitle (); };
+		Handlers_ ["subtitle"] = [this] { HandleTitle (1); };
+		Handlers_ ["epigraph"] = [this] { HandleChildren (); };
+		Handlers_ ["image"] = [this] { HandleImage (); };
+
+		Handlers_ ["p"] = [this] { HandlePara (); };
+		Handlers_ ["poem"] = [this] { HandleChildren (); };
+		Handlers_ ["empty-line"] = [this] { HandleEmptyLine (); };
+		Handlers_ ["stanza"] = [this] { HandleChildren (); };
+		Handlers_ ["v"] = [this]
 		{
 			auto fmt = Cursor_->blockFormat ();
 			fmt.setTextIndent (50);
 			Cursor_->insertBlock (fmt);
-			HandleParaWONL (p);
+			HandleParaWONL ();
 		};
 
-		Handlers_ ["emphasis"] = [this] (const QDomElement& p)
+		Handlers_ ["emphasis"] = [this]
 		{
-			HandleMangleCharFormat (p,
-					[] (QTextCharFormat& fmt) { fmt.setFontItalic (true); },
-					[this] (const QDomElement& p) { HandleParaWONL (p); });
+			HandleMangleCharFormat ([] (QTextCharFormat& fmt) { fmt.setFontItalic (true); },
+					[this] { HandleParaWONL (); });
 		};
-		Handlers_ ["strong"] = [this] (const QDomElement& p)
+		Handlers_ ["strong"] = [this]
 		{
-			HandleMangleCharFormat (p,
-					[] (QTextCharFormat& fmt) { fmt.setFontWeight (QFont::Bold); },
-					[this] (const QDomElement& p) { HandleParaWONL (p); });
+			HandleMangleCharFormat ([] (QTextCharFormat& fmt) { fmt.setFontWeight (QFont::Bold); },
+					[this] { HandleParaWONL (); });
 		};
-		Handlers_ ["strikethrough"] = [this] (const QDomElement& p)
+		Handlers_ ["strikethrough"] = [this]
 		{
-			HandleMangleCharFormat (p,
-					[] (QTextCharFormat& fmt) { fmt.setFontStrikeOut (true); },
-					[this] (const QDomElement& p) { HandleParaWONL (p); });
+			HandleMangleCharFormat ([] (QTextCharFormat& fmt) { fmt.setFontStrikeOut (true); },
+					[this] { HandleParaWONL (); });
 		};
 
-		Handlers_ ["style"] = [this] (const QDomElement& p) { HandleParaWONL (p); };
+		Handlers_ ["style"] = [this] { HandleParaWONL (); };
 
-		TOCEntry entry =
-		{
-			ILink_ptr (),
-			"root",
-			TOCEntryLevel_t ()
-		};
-		CurrentTOCStack_.push (&entry);
+		TOCRoot_.Name_ = "root";
+		CurrentTOCStack_.push (&TOCRoot_);
 
-		auto elem = docElem.firstChildElement ();
-		while (!elem.isNull ())
+		if (!Reader_.readNextStartElement () || Reader_.name () != "FictionBook")
 		{
-			const auto& tagName = elem.tagName ();
-			if (tagName == "description")
-				HandleDescription (elem);
-			else if (tagName == "body")
-				HandleBody (elem);
-
-			elem = elem.nextSiblingElement ();
+			Error_ = tr ("Invalid FictionBook document.");
+			Finished_ = true;
 		}
-
-		TOC_ = entry.ChildLevel_;
 	}
 
 	FB2Converter::~FB2Converter ()
@@ -131,6 +104,45 @@ namespace FXB
 		delete Cursor_;
 	}
 
+	bool FB2Converter::ConvertNext ()
+	{
+		if (Finished_)
+			return false;
+
+		while (true)
+		{
+			if (InBody_)
+			{
+				if (Reader_.readNextStartElement ())
+				{
+					Handle ();
+					return true;
+				}
+
+				InBody_ = false;
+			}
+
+			if (!Reader_.readNextStartElement ())
+				break;
+
+			const auto& tagName = Reader_.name ();
+			if (tagName == "description")
+				HandleDescription ();
+			else if (tagName == "body")
+			{
+				InBody_ = true;
+				FillPreamble ();
+			}
+			else if (tagName == "binary")
+				HandleBinary ();
+			else
+				Reader_.skipCurrentElement ();
+		}
+
+		Finish ();
+		return false;
+	}
+
 	QString FB2Converter::GetError () const
 	{
 		return Error_;
@@ -151,29 +163,100 @@ namespace FXB
 		return TOC_;
 	}
 
-	void FB2Converter::HandleDescription (const QDomElement& elem)
+	void FB2Converter::Finish ()
+	{
+		Finished_ = true;
+
+		if (Reader_.hasError ())
+		{
+			Error_ = tr ("Malformed FictionBook document: %1.")
+					.arg (Reader_.errorString ());
+			return;
+		}
+
+		const auto margin = Result_->rootFrame ()->frameFormat ().margin ();
+		const auto& maxSize = (Result_->pageSize () - QSizeF (2 * margin, 2 * margin)).toSize ();
+		for (const auto& pair : PendingImages_)
+		{
+			auto size = Result_->GetImageSize (pair.second);
+			if (!size.isValid ())
+				continue;
+
+			if (size.width () > maxSize.width () || size.height () > maxSize.height ())
+				size.scale (maxSize, Qt::KeepAspectRatio);
+
+			QTextCursor cursor (Result_);
+			cursor.setPosition (pair.first);
+			cursor.setPosition (pair.first + 1, QTextCursor::KeepAnchor);
+
+			auto fmt = cursor.charFormat ().toImageFormat ();
+			fmt.setWidth (size.width ());
+			fmt.setHeight (size.height ());
+			cursor.setCharFormat (fmt);
+		}
+
+		const auto pageHeight = Result_->pageSize ().height ();
+		const auto layout = Result_->documentLayout ();
+		for (const auto& pair : PendingTOCLinks_)
+		{
+			const auto& rect = layout->blockBoundingRect (Result_->findBlock (pair.second));
+			pair.first->Link_ = ILink_ptr (new TOCLink (ParentDoc_, static_cast<int> (rect.top () / pageHeight)));
+		}
+
+		TOC_ = TOCRoot_.ChildLevel_;
+	}
+
+	void FB2Converter::HandleDescription ()
 	{
-		auto getChildValues = [&elem] (const QString& nodeName) -> QStringList
+		QStringList fields;
+		fields << "genre"
+				<< "book-title"
+				<< "keywords"
+				<< "first-name"
+				<< "middle-name"
+				<< "last-name"
+				<< "email"
+				<< "nickname";
+
+		QHash<QString, QStringList> values;
+		QString date;
+
+		int depth = 1;
+		while (depth && !Reader_.atEnd ())
 		{
-			QStringList result;
-			auto elems = elem.elementsByTagName (nodeName);
-			for (int i = 0; i < elems.size (); ++i)
+			Reader_.readNext ();
+			if (Reader_.isEndElement ())
 			{
-				const auto& elem = elems.at (i);
-				const auto& str = elem.toElement ().text ();
-				if (!str.isEmpty ())
-					result << str;
+				--depth;
+				continue;
 			}
-			return result;
-		};
+
+			if (!Reader_.isStartElement ())
+				continue;
+
+			const auto& tagName = Reader_.name ().toString ();
+			if (tagName == "date" && date.isEmpty ())
+				date = Reader_.attributes ().value ("value").toString ();
+
+			if (!fields.contains (tagName))
+			{
+				++depth;
+				continue;
+			}
+
+			const auto& str = Reader_.readElementText (QXmlStreamReader::IncludeChildElements);
+			if (!str.isEmpty ())
+				values [tagName] << str;
+		}
+
+		auto getChildValues = [&values] (const QString& nodeName) { return values.value (nodeName); };
 
 		DocInfo_.Genres_ = getChildValues ("genre");
 		DocInfo_.Title_ = getChildValues ("book-title").value (0);
 		DocInfo_.Keywords_ = getChildValues ("keywords")
 				.value (0).split (' ', QString::SkipEmptyParts);
 
-		const auto& dateElem = elem.elementsByTagName ("date").at (0).toElement ();
-		DocInfo_.Date_.setDate (QDate::fromString (dateElem.attribute ("value"), Qt::ISODate));
+		DocInfo_.Date_.setDate (QDate::fromString (date, Qt::ISODate));
 
 		DocInfo_.Author_ = QString ("%1 %2 %3 <%4> %5")
 				.arg (getChildValues ("first-name").value (0))
@@ -184,19 +267,36 @@ namespace FXB
 				.simplified ();
 	}
 
-	void FB2Converter::HandleBody (const QDomElement& bodyElem)
+	void FB2Converter::HandleBinary ()
 	{
-		FillPreamble ();
+		const auto& id = Reader_.attributes ().value ("id").toString ();
+		const auto& data = Reader_.readElementText ().toLatin1 ();
+		Result_->AddBinary (id, QByteArray::fromBase64 (data));
+	}
 
-		auto elem = bodyElem.firstChildElement ();
-		while (!elem.isNull ())
+	namespace
+	{
+		/** Reads the text of the current element up to its end or up
+		 * to its first child element. Returns true if the element has
+		 * been read completely.
+		 */
+		bool ReadPlainText (QXmlStreamReader& reader, QString& text)
 		{
-			Handle (elem);
-			elem = elem.nextSiblingElement ();
+			while (!reader.atEnd ())
+			{
+				reader.readNext ();
+				if (reader.isCharacters ())
+					text += reader.text ();
+				else if (reader.isEndElement ())
+					return true;
+				else if (reader.isStartElement ())
+					return false;
+			}
+			return true;
 		}
 	}
 
-	void FB2Converter::HandleSection (const QDomElement& tagElem)
+	void FB2Converter::HandleSection ()
 	{
 		++SectionLevel_;
 
@@ -217,22 +317,33 @@ namespace FXB
 			}
 		};
 
-		auto child = tagElem.firstChildElement ();
-		while (!child.isNull ())
+		while (Reader_.readNextStartElement ())
 		{
-			if (child.tagName () == "p")
+			if (Reader_.name () == "p")
 			{
-				if (child.childNodes ().size () == 1 && child.firstChild ().isText ())
-					chunks << child.firstChild ().toText ().data ();
+				// Plain text paragraphs are inserted in batches.
+				QString text;
+				if (ReadPlainText (Reader_, text))
+				{
+					chunks << text;
+					continue;
+				}
+
+				flushChunks ();
 
-				child = child.nextSiblingElement ();
+				QTextBlockFormat fmt;
+				fmt.setTextIndent (20);
+				Cursor_->insertBlock (fmt);
+				Cursor_->insertText (text);
+
+				Handle ();
+				HandleParaWONL ();
 				continue;
 			}
 
 			flushChunks ();
 
-			Handle (child);
-			child = child.nextSiblingElement ();
+			Handle ();
 		}
 
 		flushChunks ();
@@ -242,7 +353,7 @@ namespace FXB
 		--SectionLevel_;
 	}
 
-	void FB2Converter::HandleTitle (const QDomElement& tagElem, int level)
+	void FB2Converter::HandleTitle (int level)
 	{
 		auto topFrame = Cursor_->currentFrame ();
 
@@ -252,13 +363,12 @@ namespace FXB
 		frameFmt.setBackground (QColor ("#A4C0E4"));
 		Cursor_->insertFrame (frameFmt);
 
-		auto child = tagElem.firstChildElement ();
-		while (!child.isNull ())
+		while (Reader_.readNextStartElement ())
 		{
-			const auto& tagName = child.tagName ();
+			const auto& tagName = Reader_.name ();
 
 			if (tagName == "empty-line")
-				Handlers_ [tagName] ({ child });
+				HandleEmptyLine ();
 			else if (tagName == "p")
 			{
 				const auto origFmt = Cursor_->charFormat ();
@@ -267,109 +377,109 @@ namespace FXB
 				titleFmt.setFontPointSize (18 - 2 * level - SectionLevel_);
 				Cursor_->setCharFormat (titleFmt);
 
-				Handlers_ ["p"] ({ child });
+				const auto start = Cursor_->position ();
+				HandlePara ();
 
 				Cursor_->setCharFormat (origFmt);
 
-				const TOCEntry entry =
+				auto entry = CurrentTOCStack_.top ();
+				if (entry->Name_.isEmpty ())
 				{
-					ILink_ptr (new TOCLink (ParentDoc_, Result_->pageCount () - 1)),
-					child.text (),
-					TOCEntryLevel_t ()
-				};
-				if (CurrentTOCStack_.top ()->Name_.isEmpty ())
-					*CurrentTOCStack_.top () = entry;
-			}
+					QTextCursor titleCursor (Result_);
+					titleCursor.setPosition (start);
+					titleCursor.setPosition (Cursor_->position (), QTextCursor::KeepAnchor);
+					entry->Name_ = titleCursor.selectedText ().trimmed ();
 
-			child = child.nextSiblingElement ();
+					PendingTOCLinks_ << qMakePair (entry, start);
+				}
+			}
+			else
+				Reader_.skipCurrentElement ();
 		}
 
 		Cursor_->setPosition (topFrame->lastPosition ());
 	}
 
-	void FB2Converter::HandleEpigraph (const QDomElement& tagElem)
+	void FB2Converter::HandleChildren ()
 	{
-		auto child = tagElem.firstChildElement ();
-		while (!child.isNull ())
-		{
-			Handle (child);
-			child = child.nextSiblingElement ();
-		}
+		while (Reader_.readNextStartElement ())
+			Handle ();
 	}
 
-	void FB2Converter::HandleImage (const QDomElement&)
+	void FB2Converter::HandleImage ()
 	{
-		// TODO
+		QString id;
+		for (const auto& attr : Reader_.attributes ())
+			if (attr.name () == "href")
+			{
+				id = attr.value ().toString ();
+				break;
+			}
+		Reader_.skipCurrentElement ();
+
+		if (id.startsWith ('#'))
+			id.remove (0, 1);
+		if (id.isEmpty ())
+			return;
+
+		QTextBlockFormat blockFmt;
+		blockFmt.setAlignment (Qt::AlignHCenter);
+		Cursor_->insertBlock (blockFmt);
+
+		PendingImages_ << qMakePair (Cursor_->position (), id);
+
+		QTextImageFormat imageFmt;
+		imageFmt.setName (id);
+		Cursor_->insertImage (imageFmt);
 	}
 
-	void FB2Converter::HandlePara (const QDomElement& tagElem)
+	void FB2Converter::HandlePara ()
 	{
 		QTextBlockFormat fmt;
 		fmt.setTextIndent (20);
 		Cursor_->insertBlock (fmt);
 
-		HandleParaWONL (tagElem);
+		HandleParaWONL ();
 	}
 
-	void FB2Converter::HandleParaWONL (const QDomElement& tagElem)
+	void FB2Converter::HandleParaWONL ()
 	{
-		auto child = tagElem.firstChild ();
-		while (!child.isNull ())
+		while (!Reader_.atEnd ())
 		{
-			std::shared_ptr<void> guard (static_cast<void*> (0),
-					[&child] (void*) { child = child.nextSibling (); });
-
-			if (child.isText ())
-			{
-				Cursor_->insertText (child.toText ().data ());
-				continue;
-			}
-
-			if (!child.isElement ())
-				continue;
-
-			Handle (child.toElement ());
+			Reader_.readNext ();
+			if (Reader_.isEndElement ())
+				return;
+
+			if (Reader_.isCharacters ())
+				Cursor_->insertText (Reader_.text ().toString ());
+			else if (Reader_.isStartElement ())
+				Handle ();
 		}
 	}
 
-	void FB2Converter::HandlePoem (const QDomElement& tagElem)
+	void FB2Converter::HandleEmptyLine ()
 	{
-		auto child = tagElem.firstChildElement ();
-		while (!child.isNull ())
-		{
-			Handle (child);
-			child = child.nextSiblingElement ();
-		}
+		Cursor_->insertText ("\n\n");
+		Reader_.skipCurrentElement ();
 	}
 
-	void FB2Converter::HandleStanza (const QDomElement& tagElem)
+	void FB2Converter::Handle ()
 	{
-		auto child = tagElem.firstChildElement ();
-		while (!child.isNull ())
+		const auto& tagName = Reader_.name ().toString ();
+		const auto& handler = Handlers_.value (tagName);
+		if (handler)
 		{
-			Handle (child);
-			child = child.nextSiblingElement ();
+			handler ();
+			return;
 		}
-	}
 
-	void FB2Converter::HandleEmptyLine (const QDomElement&)
-	{
-		Cursor_->insertText ("\n\n");
+		qWarning () << Q_FUNC_INFO
+				<< "unhandled tag"
+				<< tagName;
+		Reader_.skipCurrentElement ();
 	}
 
-	void FB2Converter::Handle (const QDomElement& child)
-	{
-		const auto& tagName = child.tagName ();
-		Handlers_.value (tagName, [&tagName] (const QDomElement&)
-					{
-						qWarning () << Q_FUNC_INFO
-								<< "unhandled tag"
-								<< tagName;
-					}) (child);
-	}
-
-	void FB2Converter::HandleMangleCharFormat (const QDomElement& tagElem,
-			std::function<void (QTextCharFormat&)> mangler, Handler_f next)
+	void FB2Converter::HandleMangleCharFormat (std::function<void (QTextCharFormat&)> mangler, Handler_f next)
 	{
 		const auto origFmt = Cursor_->charFormat ();
 
@@ -377,7 +487,7 @@ namespace FXB
 		mangler (mangledFmt);
 		Cursor_->setCharFormat (mangledFmt);
 
-		next ({ tagElem });
+		next ();
 
 		Cursor_->setCharFormat (origFmt);
 	}
@@ -417,14 +527,6 @@ namespace FXB
 
 		Cursor_->insertBlock ();
 	}
-
-	void FB2Converter::AddImage (const QDomElement& elem)
-	{
-		const auto& data = elem.firstChild ().toText ().data ().toLatin1 ();
-		Result_->addResource (QTextDocument::ImageResource,
-				QUrl (elem.attribute ("id")),
-				QImage::fromData (QByteArray::fromBase64 (data)));
-	}
 }
 }
 }
@@ -23,14 +23,14 @@
 #include <QObject>
 #include <QHash>
 #include <QStack>
+#include <QXmlStreamReader>
 #include <interfaces/monocle/idocument.h>
 #include <interfaces/monocle/ihavetoc.h>
 
 class QTextCharFormat;
 class QTextCursor;
-class QDomElement;
-class QDomDocument;
 class QTextDocument;
+class QIODevice;
 
 namespace LeechCraft
 {
@@ -39,58 +39,87 @@ namespace Monocle
 namespace FXB
 {
 	class Document;
-
+	class LazyImageDocument;
+
+	/** Converts a FictionBook document into a QTextDocument reading
+	 * the source as a stream.
+	 *
+	 * The body is converted chapter by chapter by calling
+	 * ConvertNext() until it returns false, the document description is
+	 * read along with the first chapter, and the table of contents is
+	 * available once the conversion is finished. The embedded images
+	 * are only stored at this point and are decoded by the resulting
+	 * document when they are drawn.
+	 */
 	class FB2Converter : public QObject
 	{
 		Document *ParentDoc_;
 
-		const QDomDocument& FB2_;
+		QXmlStreamReader Reader_;
 
-		QTextDocument *Result_;
+		LazyImageDocument *Result_;
 		DocumentInfo DocInfo_;
 		TOCEntryLevel_t TOC_;
 
+		TOCEntry TOCRoot_;
 		QStack<TOCEntry*> CurrentTOCStack_;
 
+		/** TOC entries along with the positions of their titles in
+		 * the document, resolved into pages when the conversion is
+		 * finished.
+		 */
+		QList<QPair<TOCEntry*, int>> PendingTOCLinks_;
+
+		/** Positions of the images whose sizes are to be set when the
+		 * corresponding binaries are read.
+		 */
+		QList<QPair<int, QString>> PendingImages_;
+
 		QTextCursor *Cursor_;
 
 		int SectionLevel_;
+		bool InBody_;
+		bool Finished_;
 
-		typedef std::function<void (QDomElement)> Handler_f;
+		typedef std::function<void ()> Handler_f;
 		QHash<QString, Handler_f> Handlers_;
 
 		QString Error_;
 	public:
-		FB2Converter (Document*, const QDomDocument&);
+		FB2Converter (Document*, QIODevice*);
 		~FB2Converter ();
 
+		/** Converts the next top-level element of the document body,
+		 * typically a chapter.
+		 *
+		 * Returns false if there is nothing left to convert.
+		 */
+		bool ConvertNext ();
+
 		QString GetError () const;
 		QTextDocument* GetResult () const;
 		DocumentInfo GetDocumentInfo () const;
 		TOCEntryLevel_t GetTOC () const;
 	private:
-		void HandleDescription (const QDomElement&);
-		void HandleBody (const QDomElement&);
+		void Finish ();
 
-		void HandleSection (const QDomElement&);
-		void HandleTitle (const QDomElement&, int = 0);
-		void HandleEpigraph (const QDomElement&);
-		void HandleImage (const QDomElement&);
+		void HandleDescription ();
+		void HandleBinary ();
 
-		void HandlePara (const QDomElement&);
-		void HandleParaWONL (const QDomElement&);
-		void HandlePoem (const QDomElement&);
-		void HandleStanza (const QDomElement&);
-		void HandleEmptyLine (const QDomElement&);
+		void HandleSection ();
+		void HandleTitle (int = 0);
+		void HandleChildren ();
+		void HandleImage ();
 
-		void Handle (const QDomElement&);
+		void HandlePara ();
+		void HandleParaWONL ();
+		void HandleEmptyLine ();
 
-		void HandleMangleCharFormat (const QDomElement&,
-				std::function<void (QTextCharFormat&)>, Handler_f);
+		void Handle ();
 
-		void FillPreamble ();
+		void HandleMangleCharFormat (std::function<void (QTextCharFormat&)>, Handler_f);
 
-		void AddImage (const QDomElement&);
+		void FillPreamble ();
 	};
 }
 }
@@ -0,0 +1,87 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "lazyimagedocument.h"
+#include <QBuffer>
+#include <QImageReader>
+#include <QUrl>
+#include <QVariant>
+#include <QtDebug>
+
+namespace LeechCraft
+{
+namespace Monocle
+{
+namespace FXB
+{
+	namespace
+	{
+		/** The cost of the decoded images cache, in kibibytes.
+		 */
+		const int MaxDecodedCost = 64 * 1024;
+	}
+
+	LazyImageDocument::LazyImageDocument (QObject *parent)
+	: QTextDocument (parent)
+	, Decoded_ (MaxDecodedCost)
+	{
+	}
+
+	void LazyImageDocument::AddBinary (const QString& id, const QByteArray& data)
+	{
+		Binaries_ [id] = data;
+	}
+
+	QSize LazyImageDocument::GetImageSize (const QString& id) const
+	{
+		if (!Binaries_.contains (id))
+			return QSize ();
+
+		auto data = Binaries_ [id];
+		QBuffer buffer (&data);
+		buffer.open (QIODevice::ReadOnly);
+		return QImageReader (&buffer).size ();
+	}
+
+	QVariant LazyImageDocument::loadResource (int type, const QUrl& name)
+	{
+		if (type != QTextDocument::ImageResource)
+			return QTextDocument::loadResource (type, name);
+
+		const auto& id = name.toString ();
+		if (!Binaries_.contains (id))
+			return QVariant ();
+
+		if (auto image = Decoded_.object (id))
+			return *image;
+
+		const auto& image = QImage::fromData (Binaries_ [id]);
+		if (image.isNull ())
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to decode image"
+					<< id;
+			return QVariant ();
+		}
+
+		Decoded_.insert (id, new QImage (image), image.byteCount () / 1024);
+		return image;
+	}
+}
+}
+}
@@ -0,0 +1,56 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#pragma once
+
+#include <QTextDocument>
+#include <QHash>
+#include <QCache>
+#include <QImage>
+
+namespace LeechCraft
+{
+namespace Monocle
+{
+namespace FXB
+{
+	/** A text document keeping the images in their encoded form and
+	 * decoding them only when they are actually drawn.
+	 *
+	 * The decoded images are kept in a size-limited cache.
+	 */
+	class LazyImageDocument : public QTextDocument
+	{
+		QHash<QString, QByteArray> Binaries_;
+		QCache<QString, QImage> Decoded_;
+	public:
+		LazyImageDocument (QObject* = 0);
+
+		void AddBinary (const QString& id, const QByteArray& data);
+
+		/** Returns the size of the image with the given \em id
+		 * without decoding the image itself, or an invalid size if
+		 * there is no such image.
+		 */
+		QSize GetImageSize (const QString& id) const;
+	protected:
+		QVariant loadResource (int, const QUrl&);
+	};
+}
+}
+}
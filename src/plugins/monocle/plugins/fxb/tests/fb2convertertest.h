@@ -0,0 +1,243 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+
+#include <memory>
+#include <QObject>
+#include <QtTest>
+#include <QBuffer>
+#include <QImage>
+#include <QTextDocument>
+#include <QTextBlock>
+#include "../fb2converter.h"
+
+using namespace LeechCraft::Monocle::FXB;
+
+class TestFB2Converter : public QObject
+{
+	Q_OBJECT
+
+	static QByteArray MakeBook (const QStringList& sections, const QString& binaries = QString ())
+	{
+		QString result = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+				"<FictionBook xmlns=\"http://www.gribuser.ru/xml/fictionbook/2.0\" "
+				"xmlns:l=\"http://www.w3.org/1999/xlink\">\n"
+				"<description><title-info>"
+				"<author><first-name>Test</first-name><last-name>Author</last-name></author>"
+				"<book-title>Test Book</book-title>"
+				"</title-info></description>\n"
+				"<body>\n";
+		for (const auto& section : sections)
+			result += "<section>" + section + "</section>\n";
+		result += "</body>\n" + binaries + "</FictionBook>\n";
+		return result.toUtf8 ();
+	}
+
+	static QString MakeBinary (const QString& id, const QSize& size)
+	{
+		QImage image (size, QImage::Format_RGB32);
+		image.fill (Qt::gray);
+
+		QBuffer buffer;
+		buffer.open (QIODevice::WriteOnly);
+		image.save (&buffer, "PNG");
+
+		return QString ("<binary id=\"%1\" content-type=\"image/png\">%2</binary>\n")
+				.arg (id)
+				.arg (QString::fromLatin1 (buffer.data ().toBase64 ()));
+	}
+
+	static QString GetText (const QTextDocument *doc)
+	{
+		return doc->toPlainText ().simplified ();
+	}
+
+	static QTextImageFormat FindImage (const QTextDocument *doc, const QString& name)
+	{
+		for (auto block = doc->begin (); block != doc->end (); block = block.next ())
+			for (auto it = block.begin (); !it.atEnd (); ++it)
+			{
+				const auto& fmt = it.fragment ().charFormat ();
+				if (fmt.isImageFormat () && fmt.toImageFormat ().name () == name)
+					return fmt.toImageFormat ();
+			}
+		return QTextImageFormat ();
+	}
+private slots:
+	void testChunkBoundaries ()
+	{
+		QBuffer buffer;
+		buffer.setData (MakeBook ({
+					"<title><p>Chapter 1</p></title><p>One</p>",
+					"<title><p>Chapter 2</p></title><p>Two</p>",
+					"<title><p>Chapter 3</p></title><p>Three</p>"
+				}));
+		buffer.open (QIODevice::ReadOnly);
+
+		FB2Converter conv (0, &buffer);
+		std::unique_ptr<QTextDocument> doc (conv.GetResult ());
+
+		QVERIFY (conv.ConvertNext ());
+		QCOMPARE (conv.GetDocumentInfo ().Title_, QString ("Test Book"));
+		QVERIFY (GetText (doc.get ()).contains ("Chapter 1 One"));
+		QVERIFY (!GetText (doc.get ()).contains ("Chapter 2"));
+
+		QVERIFY (conv.ConvertNext ());
+		QVERIFY (GetText (doc.get ()).contains ("Chapter 2 Two"));
+		QVERIFY (!GetText (doc.get ()).contains ("Chapter 3"));
+		QVERIFY (conv.GetTOC ().isEmpty ());
+
+		QVERIFY (conv.ConvertNext ());
+		QVERIFY (!conv.ConvertNext ());
+		QVERIFY (!conv.ConvertNext ());
+
+		QVERIFY (conv.GetError ().isEmpty ());
+		const auto& toc = conv.GetTOC ();
+		QCOMPARE (toc.size (), 3);
+		QCOMPARE (toc.at (2).Name_, QString ("Chapter 3"));
+	}
+
+	void testParagraphOrder ()
+	{
+		QBuffer buffer;
+		buffer.setData (MakeBook ({
+					"<p>Alpha</p><p>Beta</p><p>Gamma <emphasis>Delta</emphasis> Epsilon</p><p>Zeta</p>"
+				}));
+		buffer.open (QIODevice::ReadOnly);
+
+		FB2Converter conv (0, &buffer);
+		std::unique_ptr<QTextDocument> doc (conv.GetResult ());
+		while (conv.ConvertNext ())
+			;
+
+		QVERIFY (conv.GetError ().isEmpty ());
+		QVERIFY (GetText (doc.get ()).endsWith ("Alpha Beta Gamma Delta Epsilon Zeta"));
+	}
+
+	void testImagesAfterReference ()
+	{
+		QBuffer buffer;
+		buffer.setData (MakeBook ({
+					"<p>Small</p><image l:href=\"#small\"/>",
+					"<p>Large</p><image l:href=\"#large\"/><image l:href=\"#missing\"/>"
+				},
+				MakeBinary ("small", QSize (100, 50)) + MakeBinary ("large", QSize (1200, 600))));
+		buffer.open (QIODevice::ReadOnly);
+
+		FB2Converter conv (0, &buffer);
+		std::unique_ptr<QTextDocument> doc (conv.GetResult ());
+
+		// The binaries follow the body, so the sizes are unknown until
+		// the whole document has been read.
+		QVERIFY (conv.ConvertNext ());
+		QVERIFY (FindImage (doc.get (), "small").isValid ());
+		QCOMPARE (FindImage (doc.get (), "small").width (), 0.);
+
+		while (conv.ConvertNext ())
+			;
+		QVERIFY (conv.GetError ().isEmpty ());
+
+		const auto& small = FindImage (doc.get (), "small");
+		QCOMPARE (small.width (), 100.);
+		QCOMPARE (small.height (), 50.);
+
+		// Scaled down to fit the page minus the margins.
+		const auto& large = FindImage (doc.get (), "large");
+		QCOMPARE (large.width (), 560.);
+		QCOMPARE (large.height (), 280.);
+
+		const auto& missing = FindImage (doc.get (), "missing");
+		QVERIFY (missing.isValid ());
+		QCOMPARE (missing.width (), 0.);
+	}
+
+	void testMalformed ()
+	{
+		QBuffer buffer;
+		buffer.setData ("<FictionBook><body><section><p>Text</section></body>");
+		buffer.open (QIODevice::ReadOnly);
+
+		FB2Converter conv (0, &buffer);
+		std::unique_ptr<QTextDocument> doc (conv.GetResult ());
+		while (conv.ConvertNext ())
+			;
+
+		QVERIFY (!conv.GetError ().isEmpty ());
+		QVERIFY (!conv.ConvertNext ());
+	}
+
+	void testTruncated ()
+	{
+		auto data = MakeBook ({
+					"<title><p>Chapter 1</p></title><p>Complete</p>",
+					"<title><p>Chapter 2</p></title><p>Cut in the middle of the paragraph</p>"
+				});
+		data.truncate (data.indexOf ("middle"));
+
+		QBuffer buffer;
+		buffer.setData (data);
+		buffer.open (QIODevice::ReadOnly);
+
+		FB2Converter conv (0, &buffer);
+		std::unique_ptr<QTextDocument> doc (conv.GetResult ());
+
+		int steps = 0;
+		while (conv.ConvertNext ())
+			QVERIFY (++steps <= 2);
+
+		QVERIFY (!conv.GetError ().isEmpty ());
+		QVERIFY (GetText (doc.get ()).contains ("Chapter 1 Complete"));
+	}
+
+	void testNotFictionBook ()
+	{
+		QBuffer buffer;
+		buffer.setData ("<html><body><p>Text</p></body></html>");
+		buffer.open (QIODevice::ReadOnly);
+
+		FB2Converter conv (0, &buffer);
+		std::unique_ptr<QTextDocument> doc (conv.GetResult ());
+
+		QVERIFY (!conv.ConvertNext ());
+		QVERIFY (!conv.GetError ().isEmpty ());
+		QVERIFY (conv.GetTOC ().isEmpty ());
+	}
+
+	/** Converting the first chunk of a large book shouldn't depend on
+	 * the size of the rest of the book.
+	 */
+	void perfFirstChunk ()
+	{
+		QStringList sections;
+		for (int i = 0; i < 1000; ++i)
+			sections << QString ("<title><p>Chapter %1</p></title>").arg (i + 1) +
+					QString ("<p>Lorem ipsum dolor sit amet.</p>").repeated (30);
+		const auto& data = MakeBook (sections);
+
+		QBENCHMARK
+		{
+			QBuffer buffer;
+			buffer.setData (data);
+			buffer.open (QIODevice::ReadOnly);
+
+			FB2Converter conv (0, &buffer);
+			std::unique_ptr<QTextDocument> doc (conv.GetResult ());
+			QVERIFY (conv.ConvertNext ());
+		}
+	}
+};
@@ -97,11 +97,37 @@ namespace Mu
 			return QImage ();
 
 		const auto& rect = pdf_bound_page (MuDoc_, page.get ());
+		return RenderPage (page, xRes, yRes,
+				QRect (0, 0, xRes * (rect.x1 - rect.x0), yRes * (rect.y1 - rect.y0)));
+	}
+
+	QList<ILink_ptr> Document::GetPageLinks (int)
+	{
+		return QList<ILink_ptr> ();
+	}
 
-		auto px = fz_new_pixmap (MuCtx_, fz_device_bgr, xRes * (rect.x1 - rect.x0), yRes * (rect.y1 - rect.y0));
+	QUrl Document::GetDocURL () const
+	{
+		return URL_;
+	}
+
+	QImage Document::RenderPageRegion (int num, double xRes, double yRes, const QRect& region)
+	{
+		auto page = WrapPage (pdf_load_page (MuDoc_, num), MuDoc_);
+		if (!page)
+			return QImage ();
+
+		return RenderPage (page, xRes, yRes, region);
+	}
+
+	QImage Document::RenderPage (const std::shared_ptr<pdf_page>& page,
+			double xRes, double yRes, const QRect& region)
+	{
+		auto px = fz_new_pixmap (MuCtx_, fz_device_bgr, region.width (), region.height ());
 		fz_clear_pixmap (MuCtx_, px);
 		auto dev = fz_new_draw_device (MuCtx_, px);
-		pdf_run_page (MuDoc_, page.get (), dev, fz_scale (xRes, yRes), NULL);
+		const auto& ctm = fz_concat (fz_scale (xRes, yRes), fz_translate (-region.x (), -region.y ()));
+		pdf_run_page (MuDoc_, page.get (), dev, ctm, NULL);
 		fz_free_device (dev);
 
 		const int pxWidth = fz_pixmap_width (MuCtx_, px);
@@ -129,16 +155,6 @@ namespace Mu
 		p.end ();
 		return temp;
 	}
-
-	QList<ILink_ptr> Document::GetPageLinks (int)
-	{
-		return QList<ILink_ptr> ();
-	}
-
-	QUrl Document::GetDocURL () const
-	{
-		return URL_;
-	}
 }
 }
 }
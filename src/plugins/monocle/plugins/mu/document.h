@@ -18,6 +18,7 @@
 
 #pragma once
 
+#include <memory>
 #include <QObject>
 #include <QUrl>
 
@@ -27,6 +28,7 @@ extern "C"
 }
 
 #include <interfaces/monocle/idocument.h>
+#include <interfaces/monocle/iregionrenderabledocument.h>
 
 namespace LeechCraft
 {
@@ -36,9 +38,11 @@ namespace Mu
 {
 	class Document : public QObject
 				   , public IDocument
+				   , public IRegionRenderableDocument
 	{
 		Q_OBJECT
-		Q_INTERFACES (LeechCraft::Monocle::IDocument)
+		Q_INTERFACES (LeechCraft::Monocle::IDocument
+				LeechCraft::Monocle::IRegionRenderableDocument)
 
 		fz_context *MuCtx_;
 		pdf_document *MuDoc_;
@@ -59,6 +63,10 @@ namespace Mu
 		QImage RenderPage (int, double xRes, double yRes);
 		QList<ILink_ptr> GetPageLinks (int);
 		QUrl GetDocURL () const;
+
+		QImage RenderPageRegion (int, double xRes, double yRes, const QRect&);
+	private:
+		QImage RenderPage (const std::shared_ptr<pdf_page>&, double, double, const QRect&);
 	signals:
 		void navigateRequested (const QString& , int pageNum, double x, double y);
 		void printRequested (const QList<int>&);
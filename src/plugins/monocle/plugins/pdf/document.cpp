@@ -49,6 +49,10 @@ namespace PDF
 		BuildTOC ();
 	}
 
+	Document::~Document ()
+	{
+	}
+
 	QObject* Document::GetBackendPlugin () const
 	{
 		return Plugin_;
@@ -214,6 +218,31 @@ namespace PDF
 		return result;
 	}
 
+	QList<TextBox> Document::GetPageText (int pageNum)
+	{
+		QMutexLocker locker (&TextDocMutex_);
+		if (!TextDoc_)
+			TextDoc_.reset (Poppler::Document::load (DocURL_.toLocalFile ()));
+		if (!TextDoc_)
+			return QList<TextBox> ();
+
+		std::unique_ptr<Poppler::Page> page (TextDoc_->page (pageNum));
+		if (!page)
+			return QList<TextBox> ();
+
+		QList<TextBox> result;
+		for (auto popplerBox : page->textList ())
+		{
+			TextBox box { popplerBox->text (), popplerBox->boundingBox (), {}, popplerBox->hasSpaceAfter () };
+			for (int i = 0, size = box.Text_.size (); i < size; ++i)
+				box.CharRects_ << popplerBox->charBoundingBox (i);
+			result << box;
+
+			delete popplerBox;
+		}
+		return result;
+	}
+
 	auto Document::CanSave () const -> SaveQueryResult
 	{
 		if (PDocument_->isEncrypted ())
@@ -320,6 +349,16 @@ namespace PDF
 			return;
 		TOC_ = BuildTOCLevel (this, PDocument_, *doc);
 	}
+
+	QImage Document::RenderPageRegion (int num, double xScale, double yScale, const QRect& region)
+	{
+		std::unique_ptr<Poppler::Page> page (PDocument_->page (num));
+		if (!page)
+			return QImage ();
+
+		return page->renderToImage (72 * xScale, 72 * yScale,
+				region.x (), region.y (), region.width (), region.height ());
+	}
 }
 }
 }
@@ -21,6 +21,7 @@
 #include <memory>
 #include <QObject>
 #include <QUrl>
+#include <QMutex>
 #include <interfaces/monocle/idocument.h>
 #include <interfaces/monocle/ihavetoc.h>
 #include <interfaces/monocle/ihavetextcontent.h>
@@ -28,6 +29,8 @@
 #include <interfaces/monocle/isupportforms.h>
 #include <interfaces/monocle/isearchabledocument.h>
 #include <interfaces/monocle/isaveabledocument.h>
+#include <interfaces/monocle/iregionrenderabledocument.h>
+#include <interfaces/monocle/ihavepagetext.h>
 
 namespace Poppler
 {
@@ -50,6 +53,8 @@ namespace PDF
 				   , public ISupportForms
 				   , public ISearchableDocument
 				   , public ISaveableDocument
+				   , public IRegionRenderableDocument
+				   , public IHavePageText
 	{
 		Q_OBJECT
 		Q_INTERFACES (LeechCraft::Monocle::IDocument
@@ -58,15 +63,24 @@ namespace PDF
 				LeechCraft::Monocle::ISupportAnnotations
 				LeechCraft::Monocle::ISupportForms
 				LeechCraft::Monocle::ISearchableDocument
-				LeechCraft::Monocle::ISaveableDocument)
+				LeechCraft::Monocle::ISaveableDocument
+				LeechCraft::Monocle::IRegionRenderableDocument
+				LeechCraft::Monocle::IHavePageText)
 
 		PDocument_ptr PDocument_;
 		TOCEntryLevel_t TOC_;
 		QUrl DocURL_;
 
+		/** Poppler documents aren't thread-safe, so text is extracted
+		 * in background from a separate instance.
+		 */
+		QMutex TextDocMutex_;
+		std::unique_ptr<Poppler::Document> TextDoc_;
+
 		QObject *Plugin_;
 	public:
 		Document (const QString&, QObject*);
+		~Document ();
 
 		QObject* GetBackendPlugin () const;
 		QObject* GetQObject ();
@@ -91,6 +105,10 @@ namespace PDF
 		SaveQueryResult CanSave () const;
 		bool Save (const QString& path);
 
+		QImage RenderPageRegion (int, double, double, const QRect&);
+
+		QList<TextBox> GetPageText (int);
+
 		void RequestNavigation (const QString&, int, double, double);
 		void RequestPrinting ();
 	private:
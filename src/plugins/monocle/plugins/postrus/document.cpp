@@ -17,6 +17,7 @@
  **********************************************************************/
 
 #include "document.h"
+#include <cmath>
 #include <QtDebug>
 
 namespace LeechCraft
@@ -119,6 +120,45 @@ namespace Postrus
 	{
 		return DocURL_;
 	}
+
+	QImage Document::RenderPageRegion (int index, double xRes, double yRes, const QRect& region)
+	{
+		auto page = spectre_document_get_page (SD_, index);
+
+		auto rc = spectre_render_context_new ();
+		spectre_render_context_set_scale (rc, xRes, yRes);
+
+		// libspectre expects the slice in unscaled integer page
+		// coordinates and scales it by itself, rounding to the nearest
+		// pixel. The slice is thus expanded to cover the whole region,
+		// and the region is cropped out of it afterwards, so that the
+		// adjacent tiles stay aligned at non-integer scales.
+		const int left = std::floor (region.x () / xRes);
+		const int top = std::floor (region.y () / yRes);
+		const int right = std::ceil ((region.x () + region.width ()) / xRes);
+		const int bottom = std::ceil ((region.y () + region.height ()) / yRes);
+
+		const int dx = qRound (region.x () - left * xRes);
+		const int dy = qRound (region.y () - top * yRes);
+		const int renderedHeight = qRound ((bottom - top) * yRes);
+
+		unsigned char *data = 0;
+		int rowLength = 0;
+		spectre_page_render_slice (page, rc,
+				left, top,
+				right - left, bottom - top,
+				&data, &rowLength);
+		spectre_render_context_free (rc);
+		spectre_page_free (page);
+
+		if (!data)
+			return QImage ();
+
+		const QImage& img = QImage (data, rowLength / 4, renderedHeight, QImage::Format_RGB32)
+				.copy (dx, dy, region.width (), region.height ());
+		free (data);
+		return img;
+	}
 }
 }
 }
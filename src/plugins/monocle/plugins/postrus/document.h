@@ -21,6 +21,7 @@
 #include <QObject>
 #include <QUrl>
 #include <interfaces/monocle/idocument.h>
+#include <interfaces/monocle/iregionrenderabledocument.h>
 #include <libspectre/spectre.h>
 
 namespace LeechCraft
@@ -31,8 +32,11 @@ namespace Postrus
 {
 	class Document : public QObject
 				   , public IDocument
+				   , public IRegionRenderableDocument
 	{
 		Q_OBJECT
+		Q_INTERFACES (LeechCraft::Monocle::IDocument
+				LeechCraft::Monocle::IRegionRenderableDocument)
 
 		SpectreDocument *SD_;
 		QUrl DocURL_;
@@ -51,6 +55,8 @@ namespace Postrus
 		QImage RenderPage (int, double xRes, double yRes);
 		QList<ILink_ptr> GetPageLinks (int);
 		QUrl GetDocURL () const;
+
+		QImage RenderPageRegion (int, double xRes, double yRes, const QRect&);
 	signals:
 		void navigateRequested (const QString&, int, double, double);
 		void printRequested (const QList<int>&);
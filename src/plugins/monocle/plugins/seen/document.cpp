@@ -85,15 +85,7 @@ namespace Seen
 
 	QImage Document::RenderPage (int pageNum, double xScale, double yScale)
 	{
-		ddjvu_page_t *page = 0;
-		if (PendingRenders_.contains (pageNum))
-			page = PendingRenders_ [pageNum];
-		else
-		{
-			page = ddjvu_page_create_by_pageno (Doc_, pageNum);
-			PendingRenders_ [pageNum] = page;
-			PendingRendersNums_ [page] = pageNum;
-		}
+		auto page = GetPage (pageNum);
 
 		const auto& size = Sizes_.value (pageNum);
 		ddjvu_rect_s rect =
@@ -115,11 +107,7 @@ namespace Seen
 				reinterpret_cast<char*> (img.bits ()));
 		qDebug () << Q_FUNC_INFO << pageNum << res;
 		if (res)
-		{
-			PendingRenders_.remove (pageNum);
-			PendingRendersNums_.remove (page);
-			ddjvu_page_release (page);
-		}
+			ReleasePage (pageNum, page);
 
 		return img.scaled (img.width () * xScale, img.height () * yScale, Qt::KeepAspectRatio, Qt::SmoothTransformation);
 	}
@@ -134,6 +122,42 @@ namespace Seen
 		return DocURL_;
 	}
 
+	QImage Document::RenderPageRegion (int pageNum, double xScale, double yScale, const QRect& region)
+	{
+		auto page = GetPage (pageNum);
+
+		const auto& size = Sizes_.value (pageNum);
+		ddjvu_rect_s pageRect =
+		{
+			0,
+			0,
+			static_cast<unsigned int> (size.width () * xScale),
+			static_cast<unsigned int> (size.height () * yScale)
+		};
+		ddjvu_rect_s renderRect =
+		{
+			region.x (),
+			region.y (),
+			static_cast<unsigned int> (region.width ()),
+			static_cast<unsigned int> (region.height ())
+		};
+
+		QImage img (region.size (), QImage::Format_RGB32);
+
+		auto res = ddjvu_page_render (page,
+				DDJVU_RENDER_COLOR,
+				&pageRect,
+				&renderRect,
+				RenderFormat_,
+				img.bytesPerLine (),
+				reinterpret_cast<char*> (img.bits ()));
+		if (!res)
+			return QImage ();
+
+		ReleasePage (pageNum, page);
+		return img;
+	}
+
 	ddjvu_document_t* Document::GetNativeDoc () const
 	{
 		return Doc_;
@@ -155,6 +179,24 @@ namespace Seen
 		emit pageContentsChanged (num);
 	}
 
+	ddjvu_page_t* Document::GetPage (int pageNum)
+	{
+		if (PendingRenders_.contains (pageNum))
+			return PendingRenders_ [pageNum];
+
+		auto page = ddjvu_page_create_by_pageno (Doc_, pageNum);
+		PendingRenders_ [pageNum] = page;
+		PendingRendersNums_ [page] = pageNum;
+		return page;
+	}
+
+	void Document::ReleasePage (int pageNum, ddjvu_page_t *page)
+	{
+		PendingRenders_.remove (pageNum);
+		PendingRendersNums_.remove (page);
+		ddjvu_page_release (page);
+	}
+
 	void Document::TryUpdateSizes ()
 	{
 		const int numPages = GetNumPages ();
@@ -25,6 +25,7 @@
 #include <libdjvu/miniexp.h>
 #include <interfaces/monocle/idocument.h>
 #include <interfaces/monocle/idynamicdocument.h>
+#include <interfaces/monocle/iregionrenderabledocument.h>
 
 namespace LeechCraft
 {
@@ -37,9 +38,12 @@ namespace Seen
 	class Document : public QObject
 				   , public IDocument
 				   , public IDynamicDocument
+				   , public IRegionRenderableDocument
 	{
 		Q_OBJECT
-		Q_INTERFACES (LeechCraft::Monocle::IDocument LeechCraft::Monocle::IDynamicDocument)
+		Q_INTERFACES (LeechCraft::Monocle::IDocument
+				LeechCraft::Monocle::IDynamicDocument
+				LeechCraft::Monocle::IRegionRenderableDocument)
 
 		ddjvu_context_t *Context_;
 		ddjvu_document_t *Doc_;
@@ -68,12 +72,17 @@ namespace Seen
 		QList<ILink_ptr> GetPageLinks (int);
 		QUrl GetDocURL () const;
 
+		QImage RenderPageRegion (int, double xRes, double yRes, const QRect&);
+
 		ddjvu_document_t* GetNativeDoc () const;
 
 		void UpdateDocInfo ();
 		void UpdatePageInfo (ddjvu_page_t*);
 		void RedrawPage (ddjvu_page_t*);
 	private:
+		ddjvu_page_t* GetPage (int);
+		void ReleasePage (int, ddjvu_page_t*);
+
 		void TryUpdateSizes ();
 		void TryGetPageInfo (int);
 	signals:
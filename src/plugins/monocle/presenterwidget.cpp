@@ -21,15 +21,18 @@
 #include <QHBoxLayout>
 #include <QKeyEvent>
 #include <QTimer>
+#include "core.h"
+#include "renderscheduler.h"
 
 namespace LeechCraft
 {
 namespace Monocle
 {
-	PresenterWidget::PresenterWidget (IDocument_ptr doc)
+	PresenterWidget::PresenterWidget (IDocument_ptr doc, ThumbsCache_ptr thumbs)
 	: QWidget (0, Qt::Window | Qt::WindowStaysOnTopHint)
 	, PixmapLabel_ (new QLabel)
 	, Doc_ (doc)
+	, Thumbs_ (thumbs)
 	, CurrentPage_ (0)
 	{
 		setStyleSheet ("background-color: black;");
@@ -92,10 +95,39 @@ namespace Monocle
 		auto scale = std::min (static_cast<double> (width ()) / pageSize.width (),
 				static_cast<double> (height ()) / pageSize.height ());
 
-		const auto& img = Doc_->RenderPage (page, scale, scale);
+		const QSize size (pageSize.width () * scale, pageSize.height () * scale);
+		PixmapLabel_->setFixedSize (size);
 
-		PixmapLabel_->setFixedSize (img.size ());
-		PixmapLabel_->setPixmap (QPixmap::fromImage (img));
+		// Show the thumbnail, if any, while the page is being rendered.
+		const auto& thumb = Thumbs_ ? Thumbs_->GetThumb (page) : QImage ();
+		if (!thumb.isNull ())
+			PixmapLabel_->setPixmap (QPixmap::fromImage (thumb.scaled (size,
+						Qt::IgnoreAspectRatio, Qt::SmoothTransformation)));
+		else
+		{
+			QPixmap px (size);
+			px.fill ();
+			PixmapLabel_->setPixmap (px);
+		}
+
+		RenderScheduler::Job job;
+		job.Doc_ = Doc_;
+		job.Owner_ = this;
+		job.Key_ = page;
+		job.Priority_ = RenderScheduler::Priority::Visible;
+
+		const auto doc = Doc_;
+		job.Render_ = [doc, page, scale] { return doc->RenderPage (page, scale, scale); };
+		job.IsWanted_ = [this, page] { return page == CurrentPage_; };
+		job.Handler_ = [this, page] (const QImage& img)
+		{
+			if (img.isNull () || page != CurrentPage_)
+				return;
+
+			PixmapLabel_->setFixedSize (img.size ());
+			PixmapLabel_->setPixmap (QPixmap::fromImage (img));
+		};
+		Core::Instance ().GetRenderScheduler ()->Schedule (job);
 	}
 
 	void PresenterWidget::delayedShowInit ()
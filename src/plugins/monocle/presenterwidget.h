@@ -20,6 +20,7 @@
 
 #include <QWidget>
 #include "interfaces/monocle/idocument.h"
+#include "thumbscache.h"
 
 class QLabel;
 
@@ -33,9 +34,10 @@ namespace Monocle
 
 		QLabel *PixmapLabel_;
 		IDocument_ptr Doc_;
+		ThumbsCache_ptr Thumbs_;
 		int CurrentPage_;
 	public:
-		PresenterWidget (IDocument_ptr);
+		PresenterWidget (IDocument_ptr, ThumbsCache_ptr = ThumbsCache_ptr ());
 	protected:
 		void closeEvent (QCloseEvent*);
 		void keyPressEvent (QKeyEvent*);
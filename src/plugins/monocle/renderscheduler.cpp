@@ -0,0 +1,266 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+
+#include "renderscheduler.h"
+#include <algorithm>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
+#include <QTimer>
+#include <QtDebug>
+#include "interfaces/monocle/ibackendplugin.h"
+#include "xmlsettingsmanager.h"
+
+namespace LeechCraft
+{
+namespace Monocle
+{
+	RenderScheduler::Stats::Stats ()
+	: Scheduled_ (0)
+	, Completed_ (0)
+	, Coalesced_ (0)
+	, Cancelled_ (0)
+	, Wasted_ (0)
+	{
+	}
+
+	RenderScheduler::DocState::DocState ()
+	: Running_ (0)
+	{
+	}
+
+	RenderScheduler::RenderScheduler (QObject *parent)
+	: QObject (parent)
+	, MaxRunning_ (1)
+	, SyncScheduled_ (false)
+	{
+		XmlSettingsManager::Instance ().RegisterObject ("MaxConcurrentRenders",
+				this, "handleMaxRunningChanged");
+		handleMaxRunningChanged ();
+	}
+
+	void RenderScheduler::Schedule (const Job& job)
+	{
+		++Stats_.Scheduled_;
+
+		auto sameJob = [&job] (const Job& other)
+				{ return other.Owner_ == job.Owner_ && other.Key_ == job.Key_; };
+
+		for (auto i = Running_.begin (), end = Running_.end (); i != end; ++i)
+			if (!i->Cancelled_ && sameJob (i->Job_))
+			{
+				++Stats_.Coalesced_;
+				return;
+			}
+
+		const auto doc = job.Doc_.get ();
+		auto& queue = Docs_ [doc].Queue_;
+
+		auto pos = std::find_if (queue.begin (), queue.end (), sameJob);
+		if (pos != queue.end ())
+		{
+			++Stats_.Coalesced_;
+
+			const auto priority = std::min (pos->Priority_, job.Priority_);
+			queue.erase (pos);
+			queue << job;
+			queue.last ().Priority_ = priority;
+		}
+		else
+			queue << job;
+
+		if (!KnownOwners_.contains (job.Owner_))
+		{
+			KnownOwners_ << job.Owner_;
+			connect (job.Owner_,
+					SIGNAL (destroyed ()),
+					this,
+					SLOT (handleOwnerDestroyed ()));
+		}
+
+		Dispatch (doc);
+	}
+
+	void RenderScheduler::Cancel (QObject *owner)
+	{
+		// Docs_ is keyed by raw pointers, and it's the jobs that keep
+		// the documents alive, so the states left without any jobs are
+		// dropped along with them.
+		for (auto i = Docs_.begin (); i != Docs_.end (); )
+		{
+			auto& queue = i->Queue_;
+			const auto prevSize = queue.size ();
+			auto newEnd = std::remove_if (queue.begin (), queue.end (),
+					[owner] (const Job& job) { return job.Owner_ == owner; });
+			queue.erase (newEnd, queue.end ());
+			Stats_.Cancelled_ += prevSize - queue.size ();
+
+			if (queue.isEmpty () && !i->Running_)
+				i = Docs_.erase (i);
+			else
+				++i;
+		}
+
+		for (auto& running : Running_)
+			if (running.Job_.Owner_ == owner)
+				running.Cancelled_ = true;
+	}
+
+	RenderScheduler::Stats RenderScheduler::GetStats () const
+	{
+		return Stats_;
+	}
+
+	bool RenderScheduler::IsThreaded (IDocument *doc) const
+	{
+		auto backend = qobject_cast<IBackendPlugin*> (doc->GetBackendPlugin ());
+		return backend && backend->IsThreaded ();
+	}
+
+	bool RenderScheduler::TakeNext (IDocument *doc, Job& job)
+	{
+		auto& queue = Docs_ [doc].Queue_;
+		while (!queue.isEmpty ())
+		{
+			int idx = queue.size () - 1;
+			for (int i = idx - 1; i >= 0 && queue.at (idx).Priority_ != Priority::Visible; --i)
+				if (queue.at (i).Priority_ < queue.at (idx).Priority_)
+					idx = i;
+
+			job = queue.takeAt (idx);
+			if (!job.IsWanted_ || job.IsWanted_ ())
+				return true;
+
+			++Stats_.Cancelled_;
+			job.Handler_ (QImage ());
+		}
+
+		return false;
+	}
+
+	void RenderScheduler::Dispatch (IDocument *doc)
+	{
+		if (!IsThreaded (doc))
+		{
+			if (!SyncScheduled_)
+			{
+				SyncScheduled_ = true;
+				QTimer::singleShot (0,
+						this,
+						SLOT (runSyncJob ()));
+			}
+			return;
+		}
+
+		auto& state = Docs_ [doc];
+		Job job;
+		while (state.Running_ < MaxRunning_ && TakeNext (doc, job))
+		{
+			++state.Running_;
+
+			auto watcher = new QFutureWatcher<QImage> ();
+			Running_ [watcher] = { job, false };
+			connect (watcher,
+					SIGNAL (finished ()),
+					this,
+					SLOT (handleRendered ()));
+			watcher->setFuture (QtConcurrent::run (job.Render_));
+		}
+
+		if (state.Queue_.isEmpty () && !state.Running_)
+			Docs_.remove (doc);
+	}
+
+	void RenderScheduler::Finish (const Job& job, const QImage& image)
+	{
+		++Stats_.Completed_;
+		job.Handler_ (image);
+	}
+
+	void RenderScheduler::handleRendered ()
+	{
+		auto watcher = dynamic_cast<QFutureWatcher<QImage>*> (sender ());
+		watcher->deleteLater ();
+
+		const auto running = Running_.take (watcher);
+		const auto doc = running.Job_.Doc_.get ();
+		--Docs_ [doc].Running_;
+
+		if (running.Cancelled_)
+			++Stats_.Wasted_;
+		else
+			Finish (running.Job_, watcher->result ());
+
+		Dispatch (doc);
+	}
+
+	void RenderScheduler::runSyncJob ()
+	{
+		SyncScheduled_ = false;
+
+		for (auto i = Docs_.begin (); i != Docs_.end (); )
+		{
+			const auto doc = i.key ();
+			if (IsThreaded (doc))
+			{
+				++i;
+				continue;
+			}
+
+			Job job;
+			if (!TakeNext (doc, job))
+			{
+				i = Docs_.erase (i);
+				continue;
+			}
+
+			Finish (job, job.Render_ ());
+
+			const auto pos = Docs_.find (doc);
+			if (pos != Docs_.end () && pos->Queue_.isEmpty ())
+				Docs_.erase (pos);
+			break;
+		}
+
+		for (auto i = Docs_.begin (), end = Docs_.end (); i != end; ++i)
+			if (!i->Queue_.isEmpty () && !IsThreaded (i.key ()))
+			{
+				SyncScheduled_ = true;
+				QTimer::singleShot (0,
+						this,
+						SLOT (runSyncJob ()));
+				break;
+			}
+	}
+
+	void RenderScheduler::handleOwnerDestroyed ()
+	{
+		auto owner = sender ();
+		KnownOwners_.remove (owner);
+		Cancel (owner);
+	}
+
+	void RenderScheduler::handleMaxRunningChanged ()
+	{
+		MaxRunning_ = std::max (1, XmlSettingsManager::Instance ().property ("MaxConcurrentRenders").toInt ());
+
+		for (const auto doc : Docs_.keys ())
+			Dispatch (doc);
+	}
+}
+}
@@ -0,0 +1,154 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+
+#pragma once
+
+#include <functional>
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QImage>
+#include "interfaces/monocle/idocument.h"
+
+template<typename T>
+class QFutureWatcher;
+
+namespace LeechCraft
+{
+namespace Monocle
+{
+	/** Schedules page rendering jobs.
+	 *
+	 * Jobs for threaded backends are run in the global thread pool,
+	 * with at most MaxConcurrentRenders jobs running per document.
+	 * Jobs for non-threaded backends are run in the GUI thread, one
+	 * per event loop iteration, so that the UI stays responsive.
+	 *
+	 * Visible jobs always go before prefetch ones, and among jobs of
+	 * the same priority the most recently scheduled go first, since
+	 * they are the most likely to correspond to what the user is
+	 * looking at right now.
+	 */
+	class RenderScheduler : public QObject
+	{
+		Q_OBJECT
+	public:
+		enum class Priority
+		{
+			Visible,
+			Prefetch
+		};
+
+		struct Job
+		{
+			IDocument_ptr Doc_;
+
+			/** The object this job is rendered for. Jobs are coalesced
+			 * by their owner and key, and all of the owner's jobs are
+			 * cancelled if it is destroyed.
+			 */
+			QObject *Owner_;
+			int Key_;
+
+			Priority Priority_;
+
+			/** Renders the image. It may be called from a non-GUI
+			 * thread.
+			 */
+			std::function<QImage ()> Render_;
+
+			/** Called in the GUI thread right before the job is
+			 * started. If it returns false, the job is dropped, and
+			 * the Handler_ is called with a null image. May be empty.
+			 */
+			std::function<bool ()> IsWanted_;
+
+			/** Called in the GUI thread with the rendered image.
+			 */
+			std::function<void (QImage)> Handler_;
+		};
+
+		struct Stats
+		{
+			quint64 Scheduled_;
+			quint64 Completed_;
+
+			/** Requests merged into an already queued or running job.
+			 */
+			quint64 Coalesced_;
+
+			/** Jobs cancelled or dropped before being started.
+			 */
+			quint64 Cancelled_;
+
+			/** Jobs that were rendered, but whose results weren't
+			 * needed anymore by the time they finished.
+			 */
+			quint64 Wasted_;
+
+			Stats ();
+		};
+	private:
+		struct DocState
+		{
+			QList<Job> Queue_;
+			int Running_;
+
+			DocState ();
+		};
+		QHash<IDocument*, DocState> Docs_;
+
+		struct RunningJob
+		{
+			Job Job_;
+			bool Cancelled_;
+		};
+		QHash<QFutureWatcher<QImage>*, RunningJob> Running_;
+
+		QSet<QObject*> KnownOwners_;
+
+		int MaxRunning_;
+		bool SyncScheduled_;
+
+		Stats Stats_;
+	public:
+		RenderScheduler (QObject* = 0);
+
+		void Schedule (const Job&);
+
+		/** Cancels all the jobs of the given owner. The queued jobs
+		 * are removed, and the results of the running ones are
+		 * discarded. The handlers aren't called in either case.
+		 */
+		void Cancel (QObject *owner);
+
+		Stats GetStats () const;
+	private:
+		bool IsThreaded (IDocument*) const;
+		bool TakeNext (IDocument*, Job&);
+		void Dispatch (IDocument*);
+		void Finish (const Job&, const QImage&);
+	private slots:
+		void handleRendered ();
+		void runSyncJob ();
+		void handleOwnerDestroyed ();
+		void handleMaxRunningChanged ();
+	};
+}
+}
@@ -0,0 +1,339 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "textindex.h"
+#include <algorithm>
+#include <functional>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QDataStream>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
+#include <QtDebug>
+#include <util/util.h>
+#include "interfaces/monocle/ihavepagetext.h"
+
+namespace LeechCraft
+{
+namespace Monocle
+{
+	QDataStream& operator<< (QDataStream& out, const TextIndex::Word& word)
+	{
+		return out << static_cast<qint32> (word.Start_)
+				<< static_cast<qint32> (word.Length_)
+				<< word.Rect_;
+	}
+
+	QDataStream& operator>> (QDataStream& in, TextIndex::Word& word)
+	{
+		qint32 start = 0, length = 0;
+		in >> start >> length >> word.Rect_;
+		word.Start_ = start;
+		word.Length_ = length;
+		return in;
+	}
+
+	QDataStream& operator<< (QDataStream& out, const TextIndex::PageText& page)
+	{
+		return out << page.Text_ << page.Words_ << page.CharLefts_;
+	}
+
+	QDataStream& operator>> (QDataStream& in, TextIndex::PageText& page)
+	{
+		return in >> page.Text_ >> page.Words_ >> page.CharLefts_;
+	}
+
+	namespace
+	{
+		const int ChunkSize = 8;
+		const quint8 CacheVersion = 1;
+
+		QString GetCachePath (const QString& docPath)
+		{
+			const auto& id = QFileInfo (docPath).fileName ();
+			if (id.isEmpty ())
+				return QString ();
+
+			auto dir = Util::CreateIfNotExists ("monocle/textindex");
+			if (!dir.exists (id.at (0)))
+				dir.mkdir (id.at (0));
+			return dir.absoluteFilePath (id.at (0) + '/' + id + ".idx");
+		}
+
+		QVector<TextIndex::PageText> LoadCache (const QString& docPath, int numPages)
+		{
+			QFile file (GetCachePath (docPath));
+			if (!file.open (QIODevice::ReadOnly))
+				return QVector<TextIndex::PageText> ();
+
+			QDataStream header (&file);
+			quint8 version = 0;
+			header >> version;
+			if (version != CacheVersion)
+				return QVector<TextIndex::PageText> ();
+
+			QString path;
+			qint64 size = 0;
+			QDateTime modified;
+			QByteArray data;
+			header >> path >> size >> modified >> data;
+
+			const QFileInfo fi (docPath);
+			if (path != docPath ||
+					size != fi.size () ||
+					modified != fi.lastModified ())
+				return QVector<TextIndex::PageText> ();
+
+			const auto& uncompressed = qUncompress (data);
+			QDataStream stream (uncompressed);
+			QVector<TextIndex::PageText> pages;
+			stream >> pages;
+			if (stream.status () != QDataStream::Ok || pages.size () != numPages)
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "corrupted text index for"
+						<< docPath;
+				return QVector<TextIndex::PageText> ();
+			}
+
+			return pages;
+		}
+
+		void SaveCache (const QString& docPath, const QVector<TextIndex::PageText>& pages)
+		{
+			QFile file (GetCachePath (docPath));
+			if (!file.open (QIODevice::WriteOnly))
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "unable to open"
+						<< file.fileName ()
+						<< file.errorString ();
+				return;
+			}
+
+			QByteArray data;
+			{
+				QDataStream stream (&data, QIODevice::WriteOnly);
+				stream << pages;
+			}
+
+			const QFileInfo fi (docPath);
+			QDataStream out (&file);
+			out << CacheVersion
+					<< docPath
+					<< fi.size ()
+					<< fi.lastModified ()
+					<< qCompress (data);
+		}
+
+		bool NeedsSeparator (const TextBox& box, const TextBox& next)
+		{
+			return box.HasSpaceAfter_ || next.Rect_.left () < box.Rect_.right ();
+		}
+
+		TextIndex::PageText BuildPageText (const QList<TextBox>& boxes)
+		{
+			const bool haveChars = std::all_of (boxes.begin (), boxes.end (),
+					[] (const TextBox& box) { return box.CharRects_.size () == box.Text_.size (); });
+
+			TextIndex::PageText page;
+			for (int i = 0, size = boxes.size (); i < size; ++i)
+			{
+				const auto& box = boxes.at (i);
+				if (box.Text_.isEmpty ())
+					continue;
+
+				page.Words_.append (TextIndex::Word { page.Text_.size (), box.Text_.size (), box.Rect_ });
+				page.Text_ += box.Text_;
+				if (haveChars)
+					for (const auto& rect : box.CharRects_)
+						page.CharLefts_ << rect.left ();
+
+				if (i < size - 1 && NeedsSeparator (box, boxes.at (i + 1)))
+				{
+					page.Text_ += ' ';
+					if (haveChars)
+						page.CharLefts_ << box.Rect_.right ();
+				}
+			}
+			return page;
+		}
+
+		void AppendRect (QList<QRectF>& rects, const QRectF& rect)
+		{
+			if (!rects.isEmpty ())
+			{
+				auto& last = rects.last ();
+				const auto center = rect.center ().y ();
+				if (center > last.top () && center < last.bottom ())
+				{
+					last |= rect;
+					return;
+				}
+			}
+
+			rects << rect;
+		}
+
+		QList<QRectF> GetMatchRects (const TextIndex::PageText& page, int pos, int length)
+		{
+			const auto end = pos + length;
+
+			QList<QRectF> result;
+			auto word = std::upper_bound (page.Words_.begin (), page.Words_.end (), pos,
+					[] (int pos, const TextIndex::Word& word) { return pos < word.Start_ + word.Length_; });
+			for ( ; word != page.Words_.end () && word->Start_ < end; ++word)
+			{
+				const auto wordEnd = word->Start_ + word->Length_;
+				const auto from = std::max (pos, word->Start_);
+				const auto to = std::min (end, wordEnd);
+				if (from >= to)
+					continue;
+
+				if (page.CharLefts_.isEmpty ())
+				{
+					AppendRect (result, word->Rect_);
+					continue;
+				}
+
+				const qreal left = page.CharLefts_.at (from);
+				const qreal right = to < wordEnd ?
+						page.CharLefts_.at (to) :
+						word->Rect_.right ();
+				AppendRect (result, { left, word->Rect_.top (), right - left, word->Rect_.height () });
+			}
+			return result;
+		}
+	}
+
+	TextIndex::TextIndex (IDocument_ptr doc, QObject *parent)
+	: QObject (parent)
+	, Doc_ (doc)
+	, DocPath_ (doc->GetDocURL ().toLocalFile ())
+	, Watcher_ (new QFutureWatcher<QVector<PageText>> (this))
+	{
+		connect (Watcher_,
+				SIGNAL (finished ()),
+				this,
+				SLOT (handleLoaded ()));
+
+		const auto& path = DocPath_;
+		const auto numPages = Doc_->GetNumPages ();
+		std::function<QVector<PageText> ()> loader = [path, numPages]
+				{ return LoadCache (path, numPages); };
+		Watcher_->setFuture (QtConcurrent::run (loader));
+	}
+
+	TextIndex::~TextIndex ()
+	{
+		// The extraction job uses the document, so it shall not outlive us.
+		if (Watcher_)
+			Watcher_->waitForFinished ();
+	}
+
+	bool TextIndex::IsSupported (IDocument_ptr doc)
+	{
+		return doc && qobject_cast<IHavePageText*> (doc->GetQObject ());
+	}
+
+	int TextIndex::GetIndexedCount () const
+	{
+		return Pages_.size ();
+	}
+
+	bool TextIndex::IsComplete () const
+	{
+		return Pages_.size () == Doc_->GetNumPages ();
+	}
+
+	QList<QRectF> TextIndex::Find (int pageNum, const QString& text, Qt::CaseSensitivity cs) const
+	{
+		QList<QRectF> result;
+		if (pageNum < 0 || pageNum >= Pages_.size () || text.isEmpty ())
+			return result;
+
+		const auto& page = Pages_.at (pageNum);
+		for (auto pos = page.Text_.indexOf (text, 0, cs); pos >= 0;
+				pos = page.Text_.indexOf (text, pos + text.size (), cs))
+			result += GetMatchRects (page, pos, text.size ());
+		return result;
+	}
+
+	void TextIndex::ScheduleChunk ()
+	{
+		const auto from = Pages_.size ();
+		const auto count = std::min (ChunkSize, Doc_->GetNumPages () - from);
+
+		Watcher_ = new QFutureWatcher<QVector<PageText>> (this);
+		connect (Watcher_,
+				SIGNAL (finished ()),
+				this,
+				SLOT (handleChunkExtracted ()));
+
+		const auto iface = qobject_cast<IHavePageText*> (Doc_->GetQObject ());
+		std::function<QVector<PageText> ()> extractor = [iface, from, count] () -> QVector<PageText>
+		{
+			QVector<PageText> result;
+			result.reserve (count);
+			for (int i = from; i < from + count; ++i)
+				result << BuildPageText (iface->GetPageText (i));
+			return result;
+		};
+		Watcher_->setFuture (QtConcurrent::run (extractor));
+	}
+
+	void TextIndex::Save () const
+	{
+		if (DocPath_.isEmpty ())
+			return;
+
+		const auto& path = DocPath_;
+		const auto& pages = Pages_;
+		std::function<void ()> saver = [path, pages] { SaveCache (path, pages); };
+		QtConcurrent::run (saver);
+	}
+
+	void TextIndex::handleLoaded ()
+	{
+		Watcher_->deleteLater ();
+		Pages_ = Watcher_->result ();
+		Watcher_ = 0;
+
+		if (!Pages_.isEmpty ())
+			emit pagesIndexed ();
+
+		if (!IsComplete ())
+			ScheduleChunk ();
+	}
+
+	void TextIndex::handleChunkExtracted ()
+	{
+		Watcher_->deleteLater ();
+		Pages_ += Watcher_->result ();
+		Watcher_ = 0;
+
+		emit pagesIndexed ();
+
+		if (IsComplete ())
+			Save ();
+		else
+			ScheduleChunk ();
+	}
+}
+}
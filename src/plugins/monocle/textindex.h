@@ -0,0 +1,91 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#pragma once
+
+#include <QObject>
+#include <QVector>
+#include <QRectF>
+#include "interfaces/monocle/idocument.h"
+
+template<typename T>
+class QFutureWatcher;
+
+namespace LeechCraft
+{
+namespace Monocle
+{
+	/** Text of the document pages along with the geometry of words and
+	 * characters, extracted in background via IHavePageText and cached
+	 * on disk.
+	 */
+	class TextIndex : public QObject
+	{
+		Q_OBJECT
+	public:
+		struct Word
+		{
+			int Start_;
+			int Length_;
+			QRectF Rect_;
+		};
+
+		struct PageText
+		{
+			/** Words joined by spaces.
+			 */
+			QString Text_;
+
+			/** Sorted by Start_.
+			 */
+			QVector<Word> Words_;
+
+			/** Left edges of the characters of Text_, or an empty
+			 * vector if the backend doesn't provide per-character
+			 * geometry.
+			 */
+			QVector<float> CharLefts_;
+		};
+	private:
+		const IDocument_ptr Doc_;
+		const QString DocPath_;
+
+		QVector<PageText> Pages_;
+
+		QFutureWatcher<QVector<PageText>> *Watcher_;
+	public:
+		TextIndex (IDocument_ptr, QObject* = 0);
+		~TextIndex ();
+
+		static bool IsSupported (IDocument_ptr);
+
+		int GetIndexedCount () const;
+		bool IsComplete () const;
+
+		QList<QRectF> Find (int page, const QString&, Qt::CaseSensitivity) const;
+	private:
+		void ScheduleChunk ();
+		void Save () const;
+	private slots:
+		void handleLoaded ();
+		void handleChunkExtracted ();
+	signals:
+		void pagesIndexed ();
+	};
+}
+}
@@ -19,22 +19,53 @@
 #include "textsearchhandler.h"
 #include <QGraphicsView>
 #include <QGraphicsRectItem>
+#include <QScrollBar>
+#include <QElapsedTimer>
+#include <QTimer>
 #include <QtDebug>
 #include "interfaces/monocle/isearchabledocument.h"
 #include "pagegraphicsitem.h"
 #include "pageslayoutmanager.h"
+#include "textindex.h"
 
 namespace LeechCraft
 {
 namespace Monocle
 {
+	namespace
+	{
+		/** The time, in milliseconds, the search may block the UI for
+		 * at once.
+		 */
+		const int SearchBatchTime = 20;
+
+		void StyleItem (QGraphicsRectItem *item, bool selected)
+		{
+			item->setOpacity (selected ? 0.6 : 0.2);
+			item->setPen (selected ? QPen (Qt::black) : QPen ());
+		}
+	}
+
 	TextSearchHandler::TextSearchHandler (QGraphicsView *view, PagesLayoutManager *mgr, QObject *parent)
 	: QObject (parent)
 	, View_ (view)
 	, Scene_ (view->scene ())
 	, LayoutMgr_ (mgr)
+	, Index_ (0)
+	, CurrentCS_ (Qt::CaseInsensitive)
 	, CurrentRectIndex_ (-1)
+	, NextSearchPage_ (0)
+	, SearchPending_ (false)
+	, ContinueScheduled_ (false)
 	{
+		connect (View_->verticalScrollBar (),
+				SIGNAL (valueChanged (int)),
+				this,
+				SLOT (updateHighlights ()));
+		connect (View_->horizontalScrollBar (),
+				SIGNAL (valueChanged (int)),
+				this,
+				SLOT (updateHighlights ()));
 	}
 
 	void TextSearchHandler::HandleDoc (IDocument_ptr doc, const QList<PageGraphicsItem*>& pages)
@@ -42,9 +73,21 @@ namespace Monocle
 		Doc_ = doc;
 		Pages_ = pages;
 
-		CurrentHighlights_.clear ();
-		CurrentRectIndex_ = -1;
+		// The items have already been deleted together with the old pages.
+		Highlights_.clear ();
+		ResetSearch ();
 		CurrentSearchString_.clear ();
+
+		delete Index_;
+		Index_ = 0;
+		if (TextIndex::IsSupported (Doc_))
+		{
+			Index_ = new TextIndex (Doc_, this);
+			connect (Index_,
+					SIGNAL (pagesIndexed ()),
+					this,
+					SLOT (handlePagesIndexed ()));
+		}
 	}
 
 	bool TextSearchHandler::Search (const QString& text, Util::FindNotification::FindFlags flags)
@@ -54,51 +97,36 @@ namespace Monocle
 
 		if (text != CurrentSearchString_)
 		{
+			ResetSearch ();
+
 			CurrentSearchString_ = text;
-			for (auto item : CurrentHighlights_)
+			CurrentCS_ = flags & Util::FindNotification::FindCaseSensitively ?
+					Qt::CaseSensitive :
+					Qt::CaseInsensitive;
+
+			if (Index_)
 			{
-				auto parentPage = static_cast<PageGraphicsItem*> (item->parentItem ());
-				parentPage->UnregisterChildRect (item);
-				Scene_->removeItem (item);
-				delete item;
+				SearchPending_ = true;
+				continueSearch ();
+				return !Hits_.isEmpty () || SearchPending_;
 			}
 
-			CurrentHighlights_.clear ();
-
 			auto searchable = qobject_cast<ISearchableDocument*> (Doc_->GetQObject ());
 			if (!searchable)
 				return false;
 
-			const QBrush brush (Qt::yellow);
-
-			auto cs = flags & Util::FindNotification::FindCaseSensitively ?
-					Qt::CaseSensitive :
-					Qt::CaseInsensitive;
-			const auto& map = searchable->GetTextPositions (text, cs);
+			const auto& map = searchable->GetTextPositions (text, CurrentCS_);
 			for (auto i = map.begin (); i != map.end (); ++i)
-			{
-				auto page = Pages_.at (i.key ());
-				for (const auto& rect : *i)
-				{
-					auto item = new QGraphicsRectItem (page);
-					item->setBrush (brush);
-					item->setZValue (1);
-					item->setOpacity (0.2);
-					CurrentHighlights_ << item;
-
-					page->RegisterChildRect (item, rect,
-							[item] (const QRectF& rect) { item->setRect (rect); });
-				}
-			}
+				AddHits (i.key (), *i);
 
-			if (!CurrentHighlights_.isEmpty ())
+			if (!Hits_.isEmpty ())
 				SelectItem (0);
 
-			return !CurrentHighlights_.isEmpty ();
+			return !Hits_.isEmpty ();
 		}
 
-		if (CurrentHighlights_.isEmpty ())
-			return false;
+		if (Hits_.isEmpty ())
+			return SearchPending_;
 
 		if (flags & Util::FindNotification::FindBackwards)
 		{
@@ -106,7 +134,7 @@ namespace Monocle
 			if (nextIdx < 0)
 			{
 				if (flags & Util::FindNotification::FindWrapsAround)
-					nextIdx = CurrentHighlights_.size () - 1;
+					nextIdx = Hits_.size () - 1;
 				else
 					return false;
 			}
@@ -115,7 +143,7 @@ namespace Monocle
 		else
 		{
 			auto nextIdx = CurrentRectIndex_ + 1;
-			if (nextIdx >= CurrentHighlights_.size ())
+			if (nextIdx >= Hits_.size ())
 			{
 				if (flags & Util::FindNotification::FindWrapsAround)
 					nextIdx = 0;
@@ -128,24 +156,146 @@ namespace Monocle
 		return true;
 	}
 
-	void TextSearchHandler::SelectItem (int index)
+	void TextSearchHandler::ResetSearch ()
+	{
+		for (auto page : PageHits_.keys ())
+			RemoveHighlights (page);
+
+		Hits_.clear ();
+		PageHits_.clear ();
+		CurrentRectIndex_ = -1;
+
+		NextSearchPage_ = 0;
+		SearchPending_ = false;
+	}
+
+	void TextSearchHandler::AddHits (int page, const QList<QRectF>& rects)
+	{
+		if (rects.isEmpty ())
+			return;
+
+		PageHits_ [page] = { Hits_.size (), rects.size () };
+		for (const auto& rect : rects)
+			Hits_.append (Hit { page, rect });
+	}
+
+	void TextSearchHandler::CreateHighlights (int pageNum)
+	{
+		const auto& range = PageHits_.value (pageNum);
+		if (!range.second || Highlights_.contains (range.first))
+			return;
+
+		auto page = Pages_.at (pageNum);
+
+		const QBrush brush (Qt::yellow);
+		for (int i = range.first; i < range.first + range.second; ++i)
+		{
+			auto item = new QGraphicsRectItem (page);
+			item->setBrush (brush);
+			item->setZValue (1);
+			StyleItem (item, i == CurrentRectIndex_);
+			Highlights_ [i] = item;
+
+			page->RegisterChildRect (item, Hits_.at (i).Rect_,
+					[item] (const QRectF& rect) { item->setRect (rect); });
+		}
+	}
+
+	void TextSearchHandler::RemoveHighlights (int pageNum)
 	{
-		if (CurrentRectIndex_ >= 0 && CurrentRectIndex_ < CurrentHighlights_.size ())
+		const auto& range = PageHits_.value (pageNum);
+		for (int i = range.first; i < range.first + range.second; ++i)
 		{
-			auto oldHili = CurrentHighlights_.at (CurrentRectIndex_);
-			oldHili->setOpacity (0.2);
-			oldHili->setPen (QPen ());
+			auto item = Highlights_.take (i);
+			if (!item)
+				continue;
+
+			auto parentPage = static_cast<PageGraphicsItem*> (item->parentItem ());
+			parentPage->UnregisterChildRect (item);
+			Scene_->removeItem (item);
+			delete item;
 		}
+	}
+
+	void TextSearchHandler::SelectItem (int index)
+	{
+		if (auto oldHili = Highlights_.value (CurrentRectIndex_))
+			StyleItem (oldHili, false);
 
-		auto item = CurrentHighlights_.at (index);
-		item->setOpacity (0.6);
-		item->setPen ({ Qt::black });
 		CurrentRectIndex_ = index;
 
-		auto pageItem = static_cast<PageGraphicsItem*> (item->parentItem ());
-		const auto pageIdx = LayoutMgr_->GetPages ().indexOf (pageItem);
+		const auto pageNum = Hits_.at (index).Page_;
+		CreateHighlights (pageNum);
+		StyleItem (Highlights_ [index], true);
+
+		const auto pageIdx = LayoutMgr_->GetPages ().indexOf (Pages_.at (pageNum));
 		if (pageIdx >= 0)
 			LayoutMgr_->SetCurrentPage (pageIdx, false);
+
+		updateHighlights ();
+	}
+
+	void TextSearchHandler::continueSearch ()
+	{
+		ContinueScheduled_ = false;
+		if (!SearchPending_ || !Index_)
+			return;
+
+		const bool hadHits = !Hits_.isEmpty ();
+
+		QElapsedTimer timer;
+		timer.start ();
+
+		const auto indexed = Index_->GetIndexedCount ();
+		while (NextSearchPage_ < indexed && timer.elapsed () < SearchBatchTime)
+		{
+			AddHits (NextSearchPage_, Index_->Find (NextSearchPage_, CurrentSearchString_, CurrentCS_));
+			++NextSearchPage_;
+		}
+
+		if (!hadHits && !Hits_.isEmpty ())
+			SelectItem (0);
+		else
+			updateHighlights ();
+
+		if (NextSearchPage_ < indexed)
+		{
+			ContinueScheduled_ = true;
+			QTimer::singleShot (0,
+					this,
+					SLOT (continueSearch ()));
+		}
+		else if (Index_->IsComplete ())
+		{
+			SearchPending_ = false;
+			emit searchFinished (!Hits_.isEmpty ());
+		}
+	}
+
+	void TextSearchHandler::handlePagesIndexed ()
+	{
+		if (SearchPending_ && !ContinueScheduled_)
+			continueSearch ();
+	}
+
+	void TextSearchHandler::updateHighlights ()
+	{
+		if (PageHits_.isEmpty ())
+			return;
+
+		const auto& visible = View_->mapToScene (View_->viewport ()->rect ()).boundingRect ();
+		for (auto i = PageHits_.begin (), end = PageHits_.end (); i != end; ++i)
+		{
+			const auto pageNum = i.key ();
+			const auto& range = i.value ();
+			const bool hasCurrent = CurrentRectIndex_ >= range.first &&
+					CurrentRectIndex_ < range.first + range.second;
+
+			if (hasCurrent || Pages_.at (pageNum)->sceneBoundingRect ().intersects (visible))
+				CreateHighlights (pageNum);
+			else
+				RemoveHighlights (pageNum);
+		}
 	}
 }
 }
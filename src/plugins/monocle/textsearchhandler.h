@@ -19,6 +19,9 @@
 #pragma once
 
 #include <QObject>
+#include <QMap>
+#include <QHash>
+#include <QRectF>
 #include "interfaces/monocle/idocument.h"
 #include <util/gui/findnotification.h>
 
@@ -32,6 +35,7 @@ namespace Monocle
 {
 	class PageGraphicsItem;
 	class PagesLayoutManager;
+	class TextIndex;
 
 	class TextSearchHandler : public QObject
 	{
@@ -44,18 +48,61 @@ namespace Monocle
 		IDocument_ptr Doc_;
 		QList<PageGraphicsItem*> Pages_;
 
+		TextIndex *Index_;
+
 		QString CurrentSearchString_;
+		Qt::CaseSensitivity CurrentCS_;
+
+		struct Hit
+		{
+			int Page_;
+			QRectF Rect_;
+		};
+		QList<Hit> Hits_;
+
+		/** Maps page index to the index of its first hit in Hits_ and
+		 * the number of hits on that page.
+		 */
+		QMap<int, QPair<int, int>> PageHits_;
+
+		/** Highlight items are created only for the visible pages, this
+		 * maps the index of the hit in Hits_ to its highlight.
+		 */
+		QHash<int, QGraphicsRectItem*> Highlights_;
 
-		QList<QGraphicsRectItem*> CurrentHighlights_;
 		int CurrentRectIndex_;
+
+		int NextSearchPage_;
+		bool SearchPending_;
+		bool ContinueScheduled_;
 	public:
 		TextSearchHandler (QGraphicsView*, PagesLayoutManager*, QObject* = 0);
 
 		void HandleDoc (IDocument_ptr, const QList<PageGraphicsItem*>&);
 
-		bool Search (const QString&, Util::FindNotification::FindFlags);
+		/** Starts a new search if \em text differs from the last one,
+		 * or selects the next or previous hit otherwise.
+		 *
+		 * If the document has a text index, the search runs
+		 * incrementally as the pages get indexed, and true is returned
+		 * while it is still running. searchFinished() is emitted
+		 * when the search is complete.
+		 */
+		bool Search (const QString& text, Util::FindNotification::FindFlags);
 	private:
+		void ResetSearch ();
+		void AddHits (int page, const QList<QRectF>&);
+
+		void CreateHighlights (int page);
+		void RemoveHighlights (int page);
+
 		void SelectItem (int);
+	private slots:
+		void continueSearch ();
+		void handlePagesIndexed ();
+		void updateHighlights ();
+	signals:
+		void searchFinished (bool found);
 	};
 }
 }
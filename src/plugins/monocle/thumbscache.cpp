@@ -0,0 +1,341 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "thumbscache.h"
+#include <QDir>
+#include <QTimer>
+#include <QtDebug>
+#include <util/util.h>
+#include "interfaces/monocle/ibackendplugin.h"
+#include "interfaces/monocle/idynamicdocument.h"
+#include "core.h"
+#include "dochash.h"
+#include "xmlsettingsmanager.h"
+
+namespace LeechCraft
+{
+namespace Monocle
+{
+	namespace
+	{
+		const quint32 Magic = 0x4d544842;
+		const quint32 Version = 1;
+
+		/** The thumbnails files are local to this machine, so the
+		 * header, the index and the pixels are all stored in the
+		 * native byte order.
+		 */
+		struct Header
+		{
+			quint32 Magic_;
+			quint32 Version_;
+			quint32 PagesCount_;
+			quint32 ThumbWidth_;
+		};
+
+		/** Removes the least recently used thumbnails files, except
+		 * the one named \em keep, until the rest fit into the budget.
+		 */
+		void Prune (const QDir& dir, qint64 budget, const QString& keep)
+		{
+			qint64 total = 0;
+			for (const auto& info : dir.entryInfoList (QStringList ("*.thumbs"), QDir::Files, QDir::Time))
+			{
+				if (info.fileName () != keep && total + info.size () > budget)
+				{
+					if (!QFile::remove (info.absoluteFilePath ()))
+						qWarning () << Q_FUNC_INFO
+								<< "unable to remove"
+								<< info.absoluteFilePath ();
+					continue;
+				}
+
+				total += info.size ();
+			}
+		}
+	}
+
+	ThumbsCache::ThumbsCache (IDocument_ptr doc, QObject *parent)
+	: QObject (parent)
+	, Doc_ (doc)
+	, PagesCount_ (doc->GetNumPages ())
+	, Map_ (0)
+	, NextGenPage_ (0)
+	, GenPage_ (-1)
+	{
+		const auto budget = XmlSettingsManager::Instance ()
+				.property ("ThumbsCacheSize").value<qint64> () * 1024 * 1024;
+		if (!budget || !PagesCount_ || qobject_cast<IDynamicDocument*> (Doc_->GetQObject ()))
+			return;
+
+		const auto& hash = GetDocHash (Doc_->GetDocURL ().toLocalFile ());
+		if (hash.isEmpty ())
+			return;
+
+		const auto& dir = Util::CreateIfNotExists ("monocle/thumbs");
+		const auto& filename = hash + ".thumbs";
+		if (!Open (dir.filePath (filename)))
+			return;
+
+		Prune (dir, budget, filename);
+
+		// Rendering all the thumbnails in the GUI thread would make it
+		// sluggish for too long, so for non-threaded backends they are
+		// only rendered as they are shown.
+		auto backend = qobject_cast<IBackendPlugin*> (Doc_->GetBackendPlugin ());
+		if (backend && backend->IsThreaded ())
+			QTimer::singleShot (0,
+					this,
+					SLOT (generateNext ()));
+	}
+
+	ThumbsCache::~ThumbsCache ()
+	{
+		Core::Instance ().GetRenderScheduler ()->Cancel (this);
+
+		if (Map_)
+			File_.unmap (Map_);
+	}
+
+	bool ThumbsCache::IsEnabled () const
+	{
+		return File_.isOpen ();
+	}
+
+	QImage ThumbsCache::GetThumb (int page)
+	{
+		if (!IsEnabled () || page < 0 || page >= PagesCount_)
+			return QImage ();
+
+		const auto& entry = Entries_.at (page);
+		if (!entry.Offset_)
+			return QImage ();
+
+		if (!Map_)
+		{
+			Map_ = File_.map (0, File_.size ());
+			if (!Map_)
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "unable to map"
+						<< File_.fileName ()
+						<< File_.errorString ();
+				return QImage ();
+			}
+		}
+
+		const uchar *data = Map_ + entry.Offset_;
+		return QImage (data, entry.Width_, entry.Height_, entry.Width_ * 4, QImage::Format_RGB32);
+	}
+
+	void ThumbsCache::Request (int page)
+	{
+		if (!IsEnabled () || page < 0 || page >= PagesCount_ || Entries_.at (page).Offset_)
+			return;
+
+		Core::Instance ().GetRenderScheduler ()->Schedule (MakeJob (page, RenderScheduler::Priority::Visible));
+	}
+
+	bool ThumbsCache::Open (const QString& path)
+	{
+		File_.setFileName (path);
+		if (!File_.open (QIODevice::ReadWrite))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to open"
+					<< path
+					<< File_.errorString ();
+			return false;
+		}
+
+		if (ReadIndex ())
+		{
+			// Also bumps the modification time, which is used to find
+			// the least recently used files when pruning.
+			WriteHeader ();
+			return true;
+		}
+
+		if (Reset ())
+			return true;
+
+		File_.close ();
+		return false;
+	}
+
+	bool ThumbsCache::ReadIndex ()
+	{
+		Header header;
+		if (File_.read (reinterpret_cast<char*> (&header), sizeof (header)) != sizeof (header))
+			return false;
+
+		if (header.Magic_ != Magic ||
+				header.Version_ != Version ||
+				header.PagesCount_ != static_cast<quint32> (PagesCount_) ||
+				header.ThumbWidth_ != static_cast<quint32> (ThumbWidth))
+			return false;
+
+		Entries_.resize (PagesCount_);
+		const qint64 indexSize = PagesCount_ * sizeof (Entry);
+		if (File_.read (reinterpret_cast<char*> (Entries_.data ()), indexSize) != indexSize)
+			return false;
+
+		// Drop the entries whose data hasn't made it to the disk.
+		const auto fileSize = static_cast<quint64> (File_.size ());
+		for (auto& entry : Entries_)
+			if (entry.Offset_ &&
+					entry.Offset_ + static_cast<quint64> (entry.Width_) * entry.Height_ * 4 > fileSize)
+				entry = Entry ();
+
+		return true;
+	}
+
+	bool ThumbsCache::Reset ()
+	{
+		Entries_.fill (Entry (), PagesCount_);
+
+		if (!File_.resize (0))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to truncate"
+					<< File_.fileName ()
+					<< File_.errorString ();
+			return false;
+		}
+
+		WriteHeader ();
+
+		const qint64 indexSize = PagesCount_ * sizeof (Entry);
+		if (File_.write (reinterpret_cast<const char*> (Entries_.constData ()), indexSize) != indexSize ||
+				!File_.flush ())
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to write the index to"
+					<< File_.fileName ()
+					<< File_.errorString ();
+			return false;
+		}
+
+		return true;
+	}
+
+	void ThumbsCache::WriteHeader ()
+	{
+		const Header header
+		{
+			Magic,
+			Version,
+			static_cast<quint32> (PagesCount_),
+			static_cast<quint32> (ThumbWidth)
+		};
+		File_.seek (0);
+		File_.write (reinterpret_cast<const char*> (&header), sizeof (header));
+		File_.flush ();
+	}
+
+	RenderScheduler::Job ThumbsCache::MakeJob (int page, RenderScheduler::Priority priority)
+	{
+		RenderScheduler::Job job;
+		job.Doc_ = Doc_;
+		job.Owner_ = this;
+		job.Key_ = page;
+		job.Priority_ = priority;
+
+		const auto doc = Doc_;
+		job.Render_ = [doc, page] () -> QImage
+		{
+			const auto& size = doc->GetPageSize (page);
+			if (size.isEmpty ())
+				return QImage ();
+
+			const auto scale = static_cast<double> (ThumbWidth) / size.width ();
+			return doc->RenderPage (page, scale, scale);
+		};
+		job.IsWanted_ = [this, page] { return !Entries_.at (page).Offset_; };
+		job.Handler_ = [this, page] (const QImage& img) { HandleRendered (page, img); };
+		return job;
+	}
+
+	void ThumbsCache::HandleRendered (int page, const QImage& img)
+	{
+		if (!img.isNull () && !Entries_.at (page).Offset_)
+			Store (page, img);
+
+		if (page != GenPage_)
+			return;
+
+		GenPage_ = -1;
+		NextGenPage_ = page + 1;
+		QTimer::singleShot (0,
+				this,
+				SLOT (generateNext ()));
+	}
+
+	void ThumbsCache::Store (int page, QImage img)
+	{
+		img = img.convertToFormat (QImage::Format_RGB32);
+
+		if (Map_)
+		{
+			File_.unmap (Map_);
+			Map_ = 0;
+		}
+
+		const Entry entry
+		{
+			static_cast<quint64> (File_.size ()),
+			static_cast<quint32> (img.width ()),
+			static_cast<quint32> (img.height ())
+		};
+
+		// The pixels go first, so that the entry never refers to the
+		// data that hasn't been written.
+		const qint64 dataSize = img.byteCount ();
+		if (!File_.seek (entry.Offset_) ||
+				File_.write (reinterpret_cast<const char*> (img.constBits ()), dataSize) != dataSize ||
+				!File_.flush () ||
+				!File_.seek (sizeof (Header) + page * sizeof (Entry)) ||
+				File_.write (reinterpret_cast<const char*> (&entry), sizeof (entry)) != sizeof (entry) ||
+				!File_.flush ())
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to store the thumbnail of page"
+					<< page
+					<< "to"
+					<< File_.fileName ()
+					<< File_.errorString ();
+			return;
+		}
+
+		Entries_ [page] = entry;
+		emit thumbReady (page);
+	}
+
+	void ThumbsCache::generateNext ()
+	{
+		while (NextGenPage_ < PagesCount_ && Entries_.at (NextGenPage_).Offset_)
+			++NextGenPage_;
+
+		if (NextGenPage_ >= PagesCount_)
+			return;
+
+		GenPage_ = NextGenPage_;
+		Core::Instance ().GetRenderScheduler ()->Schedule (MakeJob (GenPage_, RenderScheduler::Priority::Prefetch));
+	}
+}
+}
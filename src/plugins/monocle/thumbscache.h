@@ -0,0 +1,110 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#pragma once
+
+#include <memory>
+#include <QObject>
+#include <QFile>
+#include <QVector>
+#include <QImage>
+#include "interfaces/monocle/idocument.h"
+#include "renderscheduler.h"
+
+namespace LeechCraft
+{
+namespace Monocle
+{
+	/** Keeps the page thumbnails of a document on disk, so that they
+	 * don't have to be rendered again each time it is opened.
+	 *
+	 * The thumbnails of a document are stored in a single file keyed
+	 * by the document contents hash. The file starts with a header
+	 * and a fixed-size index of the pages, followed by the raw
+	 * thumbnail pixels appended as they are rendered. The file is
+	 * memory-mapped, and thumbnails are returned directly from the
+	 * mapping without any decoding.
+	 *
+	 * The missing thumbnails are rendered in background with prefetch
+	 * priority for threaded backends, and on request otherwise.
+	 *
+	 * The cache is disabled for dynamic documents, since their
+	 * contents may change while they are open.
+	 */
+	class ThumbsCache : public QObject
+	{
+		Q_OBJECT
+
+		const IDocument_ptr Doc_;
+		const int PagesCount_;
+
+		QFile File_;
+		uchar *Map_;
+
+		struct Entry
+		{
+			quint64 Offset_;
+			quint32 Width_;
+			quint32 Height_;
+		};
+		QVector<Entry> Entries_;
+
+		int NextGenPage_;
+		int GenPage_;
+	public:
+		/** The width of the stored thumbnails.
+		 */
+		static const int ThumbWidth = 192;
+
+		ThumbsCache (IDocument_ptr, QObject* = 0);
+		~ThumbsCache ();
+
+		bool IsEnabled () const;
+
+		/** Returns the thumbnail of the given page, or a null image if
+		 * it isn't rendered yet.
+		 *
+		 * The returned image refers to the mapped file directly and
+		 * stays valid only until the next thumbnail is stored, so it
+		 * should be converted or copied right away.
+		 */
+		QImage GetThumb (int);
+
+		/** Schedules rendering the thumbnail of the given page with
+		 * the visible priority, if it isn't rendered yet.
+		 * thumbReady() is emitted once it's done.
+		 */
+		void Request (int);
+	private:
+		bool Open (const QString&);
+		bool ReadIndex ();
+		bool Reset ();
+		void WriteHeader ();
+
+		RenderScheduler::Job MakeJob (int, RenderScheduler::Priority);
+		void HandleRendered (int, const QImage&);
+		void Store (int, QImage);
+	private slots:
+		void generateNext ();
+	signals:
+		void thumbReady (int);
+	};
+
+	typedef std::shared_ptr<ThumbsCache> ThumbsCache_ptr;
+}
+}
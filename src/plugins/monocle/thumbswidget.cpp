@@ -43,12 +43,24 @@ namespace Monocle
 				SLOT (handleRelayouted ()));
 	}
 
-	void ThumbsWidget::HandleDoc (IDocument_ptr doc)
+	void ThumbsWidget::HandleDoc (IDocument_ptr doc, PageSizeResolver_ptr sizes, ThumbsCache_ptr thumbs)
 	{
 		Scene_.clear ();
 		CurrentAreaRects_.clear ();
 		CurrentDoc_ = doc;
 
+		if (Thumbs_)
+			disconnect (Thumbs_.get (),
+					0,
+					this,
+					0);
+		Thumbs_ = thumbs;
+		if (Thumbs_)
+			connect (Thumbs_.get (),
+					SIGNAL (thumbReady (int)),
+					this,
+					SLOT (handleThumbReady (int)));
+
 		if (!doc)
 			return;
 
@@ -58,10 +70,11 @@ namespace Monocle
 			auto item = new PageGraphicsItem (CurrentDoc_, i);
 			Scene_.addItem (item);
 			item->SetReleaseHandler ([this] (int page, const QPointF&) { emit pageClicked (page); });
+			item->SetThumbsCache (Thumbs_);
 			pages << item;
 		}
 
-		LayoutMgr_->HandleDoc (CurrentDoc_, pages);
+		LayoutMgr_->HandleDoc (CurrentDoc_, pages, sizes);
 		LayoutMgr_->Relayout ();
 	}
 
@@ -114,6 +127,13 @@ namespace Monocle
 	{
 		updatePagesVisibility (LastVisibleAreas_);
 	}
+
+	void ThumbsWidget::handleThumbReady (int page)
+	{
+		const auto& pages = LayoutMgr_->GetPages ();
+		if (page < pages.size ())
+			pages.at (page)->UpdatePixmap ();
+	}
 }
 }
 
@@ -20,6 +20,8 @@
 
 #include <QWidget>
 #include "interfaces/monocle/idocument.h"
+#include "pagesizeresolver.h"
+#include "thumbscache.h"
 #include "ui_thumbswidget.h"
 
 namespace LeechCraft
@@ -38,18 +40,22 @@ namespace Monocle
 		PagesLayoutManager *LayoutMgr_;
 
 		IDocument_ptr CurrentDoc_;
+		ThumbsCache_ptr Thumbs_;
 
 		QList<QGraphicsRectItem*> CurrentAreaRects_;
 		QMap<int, QRect> LastVisibleAreas_;
 	public:
 		ThumbsWidget (QWidget* = 0);
 
-		void HandleDoc (IDocument_ptr);
+		void HandleDoc (IDocument_ptr,
+				PageSizeResolver_ptr = PageSizeResolver_ptr (),
+				ThumbsCache_ptr = ThumbsCache_ptr ());
 	public slots:
 		void updatePagesVisibility (const QMap<int, QRect>&);
 		void handleCurrentPage (int);
 	private slots:
 		void handleRelayouted ();
+		void handleThumbReady (int);
 	signals:
 		void pageClicked (int);
 	};
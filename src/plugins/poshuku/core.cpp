@@ -39,6 +39,7 @@
 #include <QDesktopServices>
 #include <QFileDialog>
 #include <QMessageBox>
+#include <QTimer>
 #include <qwebframe.h>
 #include <qwebhistory.h>
 #include <QtDebug>
@@ -159,6 +160,25 @@ namespace Poshuku
 				SIGNAL (added (const HistoryItem&)),
 				URLCompletionModel_.get (),
 				SLOT (handleItemAdded (const HistoryItem&)));
+		connect (StorageBackend_.get (),
+				SIGNAL (added (const FavoritesModel::FavoritesItem&)),
+				URLCompletionModel_.get (),
+				SLOT (handleItemAdded (const FavoritesModel::FavoritesItem&)));
+		connect (StorageBackend_.get (),
+				SIGNAL (updated (const FavoritesModel::FavoritesItem&)),
+				URLCompletionModel_.get (),
+				SLOT (handleItemUpdated (const FavoritesModel::FavoritesItem&)));
+		connect (StorageBackend_.get (),
+				SIGNAL (removed (const FavoritesModel::FavoritesItem&)),
+				URLCompletionModel_.get (),
+				SLOT (handleItemRemoved (const FavoritesModel::FavoritesItem&)));
+		connect (StorageBackend_.get (),
+				SIGNAL (historyCleaned (int)),
+				URLCompletionModel_.get (),
+				SLOT (handleHistoryCleaned (int)));
+		QTimer::singleShot (0,
+				URLCompletionModel_.get (),
+				SLOT (loadIndex ()));
 
 		FavoritesModel_.reset (new FavoritesModel (this));
 		connect (StorageBackend_.get (),
@@ -0,0 +1,148 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+
+#include "historycleaner.h"
+#include <QDateTime>
+#include <QThread>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QtDebug>
+#include <util/dblock.h>
+
+namespace LeechCraft
+{
+namespace Poshuku
+{
+namespace HistoryCleaner
+{
+	namespace
+	{
+		const int BatchSize = 1000;
+
+		struct Cutoff
+		{
+			QDateTime Date_;
+
+			/** Whether the items at Date_ itself are to be removed too.
+			 */
+			bool Inclusive_;
+		};
+
+		Cutoff GetCutoff (QSqlDatabase& db, const Params& params)
+		{
+			Cutoff cutoff { QDateTime::currentDateTime ().addDays (-params.Days_), false };
+
+			QSqlQuery query (db);
+			query.prepare ("SELECT date FROM history ORDER BY date DESC LIMIT 1 OFFSET ?");
+			query.bindValue (0, params.Items_);
+			if (!query.exec ())
+			{
+				Util::DBLock::DumpError (query);
+				return cutoff;
+			}
+
+			// This is the newest item that doesn't fit into the limit.
+			if (query.next ())
+			{
+				const auto& overLimit = query.value (0).toDateTime ();
+				if (overLimit >= cutoff.Date_)
+					cutoff = { overLimit, true };
+			}
+
+			return cutoff;
+		}
+
+		int RemoveOlder (QSqlDatabase& db, const Cutoff& cutoff)
+		{
+			const QString op = cutoff.Inclusive_ ? "<=" : "<";
+
+			// MySQL doesn't support LIMIT in IN-subqueries, but it
+			// supports LIMIT in DELETE, unlike the others.
+			QSqlQuery query (db);
+			query.prepare (db.driverName () == "QMYSQL" ?
+					"DELETE FROM history WHERE date " + op + " ? LIMIT ?" :
+					"DELETE FROM history WHERE date IN "
+						"(SELECT date FROM history WHERE date " + op + " ? LIMIT ?)");
+
+			int removed = 0;
+			while (true)
+			{
+				query.bindValue (0, cutoff.Date_);
+				query.bindValue (1, BatchSize);
+				if (!query.exec ())
+				{
+					Util::DBLock::DumpError (query);
+					break;
+				}
+
+				const int affected = query.numRowsAffected ();
+				if (affected <= 0)
+					break;
+
+				removed += affected;
+			}
+			return removed;
+		}
+	}
+
+	Params MakeParams (const QSqlDatabase& db, int days, int items)
+	{
+		return
+		{
+			db.driverName (),
+			db.databaseName (),
+			db.hostName (),
+			db.port (),
+			db.userName (),
+			db.password (),
+			days,
+			items
+		};
+	}
+
+	int Run (const Params& params)
+	{
+		const auto& connName = QString ("PoshukuHistoryCleaner_%1")
+				.arg (reinterpret_cast<quintptr> (QThread::currentThread ()));
+
+		int removed = 0;
+		{
+			auto db = QSqlDatabase::addDatabase (params.Driver_, connName);
+			db.setDatabaseName (params.DBName_);
+			db.setHostName (params.Host_);
+			db.setPort (params.Port_);
+			db.setUserName (params.User_);
+			db.setPassword (params.Password_);
+
+			if (db.open ())
+			{
+				removed = RemoveOlder (db, GetCutoff (db, params));
+				db.close ();
+			}
+			else
+				Util::DBLock::DumpError (db.lastError ());
+		}
+		QSqlDatabase::removeDatabase (connName);
+
+		return removed;
+	}
+}
+}
+}
@@ -0,0 +1,67 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+
+#ifndef PLUGINS_POSHUKU_HISTORYCLEANER_H
+#define PLUGINS_POSHUKU_HISTORYCLEANER_H
+#include <QString>
+
+class QSqlDatabase;
+
+namespace LeechCraft
+{
+namespace Poshuku
+{
+namespace HistoryCleaner
+{
+	/** Everything needed to clean the history up in a separate
+	 * thread with its own database connection.
+	 */
+	struct Params
+	{
+		QString Driver_;
+		QString DBName_;
+		QString Host_;
+		int Port_;
+		QString User_;
+		QString Password_;
+
+		int Days_;
+		int Items_;
+	};
+
+	/** Collects the connection parameters of the given database.
+	 * Should be called from the thread owning the database.
+	 */
+	Params MakeParams (const QSqlDatabase& db, int days, int items);
+
+	/** Removes the history items older than the given number of days
+	 * and the ones beyond the given number of the most recent ones.
+	 *
+	 * The items are removed in small batches, each in its own
+	 * statement, so that the database isn't locked for long. This is
+	 * meant to be run in a background thread.
+	 *
+	 * Returns the number of removed items.
+	 */
+	int Run (const Params& params);
+}
+}
+}
+
+#endif
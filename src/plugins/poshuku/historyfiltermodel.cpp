@@ -28,22 +28,35 @@ namespace Poshuku
 	{
 	}
 	
+	void HistoryFilterModel::SetFilter (const QString& text,
+			QRegExp::PatternSyntax syntax, Qt::CaseSensitivity cs)
+	{
+		const bool inStorage = syntax != QRegExp::RegExp;
+		if (auto model = qobject_cast<HistoryModel*> (sourceModel ()))
+			model->SetFilter (inStorage ? text : QString (), syntax);
+
+		if (inStorage && cs == Qt::CaseInsensitive)
+			setFilterRegExp (QRegExp ());
+		else
+			setFilterRegExp (QRegExp (text, cs, syntax));
+	}
+
 	bool HistoryFilterModel::filterAcceptsRow (int row, const QModelIndex& parent) const
 	{
-		if (sourceModel ()->rowCount (sourceModel ()->index (row, 0, parent)))
+		// Sections are always shown since their items are loaded lazily.
+		if (!parent.isValid ())
 			return true;
-		
-		const auto& filter = filterRegExp ().pattern ();
-		if (filter.isEmpty ())
+
+		const auto& rx = filterRegExp ();
+		if (rx.isEmpty ())
 			return true;
-		
+
 		auto source = sourceModel ();
-		auto contains = [&filter, source, row, parent] (HistoryModel::Columns col)
+		auto matches = [&rx, source, row, parent] (HistoryModel::Columns col)
 		{
-			return source->index (row, col, parent).data ()
-					.toString ().contains (filter, Qt::CaseInsensitive);
+			return rx.indexIn (source->index (row, col, parent).data ().toString ()) >= 0;
 		};
-		return contains (HistoryModel::ColumnTitle) || contains (HistoryModel::ColumnURL);
+		return matches (HistoryModel::ColumnTitle) || matches (HistoryModel::ColumnURL);
 	}
 }
 }
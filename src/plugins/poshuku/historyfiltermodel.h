@@ -29,6 +29,15 @@ namespace Poshuku
 		Q_OBJECT
 	public:
 		HistoryFilterModel (QObject* = 0);
+
+		/** Fixed string and wildcard patterns are passed to the
+		 * HistoryModel, which filters the items in the storage, so
+		 * that the sections contain the matching items only and not
+		 * just the ones already loaded. Regular expressions and
+		 * case-sensitive matching are then done by this model.
+		 */
+		void SetFilter (const QString& text, QRegExp::PatternSyntax syntax,
+				Qt::CaseSensitivity cs);
 	protected:
 		virtual bool filterAcceptsRow (int, const QModelIndex&) const;
 	};
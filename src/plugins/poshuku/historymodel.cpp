@@ -21,8 +21,8 @@
 #include <QTimer>
 #include <QVariant>
 #include <QAction>
+#include <QUrl>
 #include <QtDebug>
-#include <util/models/treeitem.h>
 #include <util/defaulthookproxy.h>
 #include <interfaces/core/icoreproxy.h>
 #include "core.h"
@@ -33,11 +33,15 @@ namespace LeechCraft
 {
 namespace Poshuku
 {
-	using LeechCraft::Util::TreeItem;
-
 	namespace
 	{
-		/** Returns the number of the section for the given date.
+		/** How many items are loaded from the storage at once when a
+		 * section is expanded or scrolled down.
+		 */
+		const int PageSize = 200;
+
+		/** Returns the bounds of the section with the given number
+			* relative to the given day.
 			*
 			* - Today
 			* - Yesterday
@@ -50,26 +54,22 @@ namespace Poshuku
 			* - ...
 			* - Last N months
 			*/
-		int SectionNumber (const QDateTime& date)
+		std::pair<QDate, QDate> SectionBounds (int number, const QDate& today)
 		{
-			QDateTime current = QDateTime::currentDateTime ();
-			QDate orig = current.date ();
-			if (date.daysTo (current) == 0)
-				return 0;
-			else if (date.daysTo (current) == 1)
-				return 1;
-			else if (date.daysTo (current) == 2)
-				return 2;
-			else if (date.daysTo (current) <= 7)
-				return 3;
-
-			int i = 0;
-			while (true)
+			switch (number)
 			{
-				current.setDate (orig.addMonths (--i));
-
-				if (date.daysTo (current) <= 0)
-					return -i + 3;
+				case 0:
+					return std::make_pair (today, today.addYears (100));
+				case 1:
+					return std::make_pair (today.addDays (-1), today);
+				case 2:
+					return std::make_pair (today.addDays (-2), today.addDays (-1));
+				case 3:
+					return std::make_pair (today.addDays (-7), today.addDays (-2));
+				case 4:
+					return std::make_pair (today.addMonths (-1), today.addDays (-7));
+				default:
+					return std::make_pair (today.addMonths (3 - number), today.addMonths (4 - number));
 			}
 		}
 
@@ -96,14 +96,9 @@ namespace Poshuku
 	HistoryModel::HistoryModel (QObject *parent)
 	: QAbstractItemModel (parent)
 	{
-		QList<QVariant> headers;
-		headers << tr ("Title")
-			<< tr ("URL")
-			<< tr ("Date");
 		QTimer::singleShot (0,
 				this,
 				SLOT (loadData ()));
-		RootItem_ = new TreeItem (headers);
 
 		GarbageTimer_ = new QTimer (this);
 		GarbageTimer_->start (15 * 60 * 1000);
@@ -111,19 +106,20 @@ namespace Poshuku
 				SIGNAL (timeout ()),
 				this,
 				SLOT (loadData ()));
+
+		connect (Core::Instance ().GetStorageBackend (),
+				SIGNAL (historyCleaned (int)),
+				this,
+				SLOT (handleHistoryCleaned (int)));
 	}
 
 	HistoryModel::~HistoryModel ()
 	{
-		delete RootItem_;
 	}
 
-	int HistoryModel::columnCount (const QModelIndex& index) const
+	int HistoryModel::columnCount (const QModelIndex&) const
 	{
-		if (index.isValid ())
-			return static_cast<TreeItem*> (index.internalPointer ())->ColumnCount ();
-		else
-			return RootItem_->ColumnCount ();
+		return 3;
 	}
 
 	QVariant HistoryModel::data (const QModelIndex& index, int role) const
@@ -131,7 +127,45 @@ namespace Poshuku
 		if (!index.isValid ())
 			return QVariant ();
 
-		return static_cast<TreeItem*> (index.internalPointer ())->Data (index.column (), role);
+		const quint32 sectionId = index.internalId ();
+		if (!sectionId)
+		{
+			if (index.column () != ColumnTitle)
+				return QVariant ();
+
+			switch (role)
+			{
+				case Qt::DisplayRole:
+					return Sections_ [index.row ()].Name_;
+				case Qt::DecorationRole:
+					return Core::Instance ().GetProxy ()->GetIcon ("document-open-folder");
+				default:
+					return QVariant ();
+			}
+		}
+
+		const auto& item = Sections_ [sectionId - 1].Items_ [index.row ()];
+		switch (role)
+		{
+			case Qt::DisplayRole:
+				switch (index.column ())
+				{
+					case ColumnTitle:
+						return item.Title_;
+					case ColumnURL:
+						return item.URL_;
+					case ColumnDate:
+						return item.DateTime_;
+					default:
+						return QVariant ();
+				}
+			case Qt::DecorationRole:
+				if (index.column () == ColumnTitle)
+					return Core::Instance ().GetIcon (QUrl (item.URL_));
+				return QVariant ();
+			default:
+				return QVariant ();
+		}
 	}
 
 	Qt::ItemFlags HistoryModel::flags (const QModelIndex&) const
@@ -142,10 +176,20 @@ namespace Poshuku
 	QVariant HistoryModel::headerData (int h, Qt::Orientation orient,
 			int role) const
 	{
-		if (orient == Qt::Horizontal && role == Qt::DisplayRole)
-			return RootItem_->Data (h);
+		if (orient != Qt::Horizontal || role != Qt::DisplayRole)
+			return QVariant ();
 
-		return QVariant ();
+		switch (h)
+		{
+			case ColumnTitle:
+				return tr ("Title");
+			case ColumnURL:
+				return tr ("URL");
+			case ColumnDate:
+				return tr ("Date");
+			default:
+				return QVariant ();
+		}
 	}
 
 	QModelIndex HistoryModel::index (int row, int col,
@@ -154,18 +198,12 @@ namespace Poshuku
 		if (!hasIndex (row, col, parent))
 			return QModelIndex ();
 
-		TreeItem *parentItem;
-
+		// Sections have zero internal id, items have the number of
+		// their section plus one.
 		if (!parent.isValid ())
-			parentItem = RootItem_;
-		else
-			parentItem = static_cast<TreeItem*> (parent.internalPointer ());
-
-		TreeItem *childItem = parentItem->Child (row);
-		if (childItem)
-			return createIndex (row, col, childItem);
-		else
-			return QModelIndex ();
+			return createIndex (row, col, static_cast<quint32> (0));
+
+		return createIndex (row, col, static_cast<quint32> (parent.row () + 1));
 	}
 
 	QModelIndex HistoryModel::parent (const QModelIndex& index) const
@@ -173,27 +211,105 @@ namespace Poshuku
 		if (!index.isValid ())
 			return QModelIndex ();
 
-		TreeItem *childItem = static_cast<TreeItem*> (index.internalPointer ()),
-					*parentItem = childItem->Parent ();
-
-		if (parentItem == RootItem_)
+		const quint32 sectionId = index.internalId ();
+		if (!sectionId)
 			return QModelIndex ();
 
-		return createIndex (parentItem->Row (), 0, parentItem);
+		return createIndex (sectionId - 1, 0, static_cast<quint32> (0));
 	}
 
 	int HistoryModel::rowCount (const QModelIndex& parent) const
 	{
-		TreeItem *parentItem;
-		if (parent.column () > 0)
+		if (!parent.isValid ())
+			return Sections_.size ();
+
+		if (parent.internalId () || parent.column () > 0)
 			return 0;
 
+		return Sections_ [parent.row ()].Items_.size ();
+	}
+
+	bool HistoryModel::hasChildren (const QModelIndex& parent) const
+	{
 		if (!parent.isValid ())
-			parentItem = RootItem_;
-		else
-			parentItem = static_cast<TreeItem*> (parent.internalPointer ());
+			return !Sections_.empty ();
+
+		if (parent.internalId () || parent.column () > 0)
+			return false;
 
-		return parentItem->ChildCount ();
+		const auto& section = Sections_ [parent.row ()];
+		return !section.AllFetched_ || !section.Items_.empty ();
+	}
+
+	bool HistoryModel::canFetchMore (const QModelIndex& parent) const
+	{
+		if (!parent.isValid () || parent.internalId () || parent.column () > 0)
+			return false;
+
+		return !Sections_ [parent.row ()].AllFetched_;
+	}
+
+	void HistoryModel::fetchMore (const QModelIndex& parent)
+	{
+		if (!canFetchMore (parent))
+			return;
+
+		auto& section = Sections_ [parent.row ()];
+
+		history_items_t page;
+		Core::Instance ().GetStorageBackend ()->LoadHistory (section.From_, section.To_,
+				FilterPattern_, section.Fetched_, PageSize, page);
+
+		section.Fetched_ += page.size ();
+		if (static_cast<int> (page.size ()) < PageSize)
+			section.AllFetched_ = true;
+
+		// Items visited after the section has been loaded are already
+		// here, and they've also shifted the pages in the storage.
+		page.erase (std::remove_if (page.begin (), page.end (),
+					[&section] (const HistoryItem& item)
+						{ return section.URLs_.contains (item.URL_); }),
+				page.end ());
+		if (page.empty ())
+			return;
+
+		const int first = section.Items_.size ();
+		beginInsertRows (parent, first, first + page.size () - 1);
+		for (const auto& item : page)
+		{
+			section.URLs_ << item.URL_;
+			section.Items_.push_back (item);
+		}
+		endInsertRows ();
+	}
+
+	void HistoryModel::SetFilter (const QString& text, QRegExp::PatternSyntax syntax)
+	{
+		QString pattern;
+		if (!text.isEmpty ())
+		{
+			const bool wildcard = syntax == QRegExp::Wildcard;
+			for (int i = 0; i < text.size (); ++i)
+			{
+				const QChar c = text.at (i);
+				if (c == '\\' || c == '%' || c == '_')
+					pattern += QString ("\\") + c;
+				else if (wildcard && c == '*')
+					pattern += '%';
+				else if (wildcard && c == '?')
+					pattern += '_';
+				else
+					pattern += c;
+			}
+			pattern = '%' + pattern + '%';
+		}
+
+		if (pattern == FilterPattern_)
+			return;
+
+		FilterPattern_ = pattern;
+		FilterRx_ = QRegExp (text, Qt::CaseInsensitive, syntax);
+		ResetSections ();
 	}
 
 	void HistoryModel::addItem (QString title, QString url,
@@ -224,8 +340,11 @@ namespace Poshuku
 
 	QList<QMap<QString, QVariant>> HistoryModel::getItemsMap () const
 	{
+		history_items_t items;
+		Core::Instance ().GetStorageBackend ()->LoadHistory (items);
+
 		QList<QMap<QString, QVariant>> result;
-		Q_FOREACH (const HistoryItem& item, Items_)
+		Q_FOREACH (const HistoryItem& item, items)
 		{
 			QMap<QString, QVariant> map;
 			map ["Title"] = item.Title_;
@@ -236,84 +355,106 @@ namespace Poshuku
 		return result;
 	}
 
-	void HistoryModel::Add (const HistoryItem& item, bool announce)
+	void HistoryModel::ResetSections ()
 	{
-		int section = SectionNumber (item.DateTime_);
+		beginResetModel ();
 
-		while (section >= RootItem_->ChildCount ())
+		Sections_.clear ();
+		SectionsDate_ = QDate::currentDate ();
+
+		const QDateTime& oldest = Core::Instance ().GetStorageBackend ()->GetOldestHistoryDate ();
+		for (int number = 0; ; ++number)
 		{
-			QList<QVariant> data;
-			data << SectionName (RootItem_->ChildCount ())
-				<< QString ("")
-				<< QString ("");
-			TreeItem *folder = new TreeItem (data, RootItem_);
-			folder->ModifyData (0,
-					Core::Instance ().GetProxy ()->GetIcon ("document-open-folder"),
-					Qt::DecorationRole);
-			RootItem_->AppendChild (folder);
+			const auto& bounds = SectionBounds (number, SectionsDate_);
+			const Section section =
+			{
+				SectionName (number),
+				QDateTime (bounds.first),
+				QDateTime (bounds.second),
+				history_items_t (),
+				QSet<QString> (),
+				0,
+				false
+			};
+			Sections_.push_back (section);
+
+			if (!oldest.isValid () || oldest >= section.From_)
+				break;
 		}
 
-		QList<QVariant> data;
-		data << item.Title_
-			<< item.URL_
-			<< item.DateTime_;
-
-		TreeItem *folder = RootItem_->Child (section);
+		endResetModel ();
+	}
 
-		TreeItem *thisItem = new TreeItem (data, RootItem_->Child (section));
+	int HistoryModel::FindSection (const QDateTime& dt) const
+	{
+		for (size_t i = 0; i < Sections_.size (); ++i)
+			if (dt >= Sections_ [i].From_ && dt < Sections_ [i].To_)
+				return i;
+		return -1;
+	}
 
-		for (int i = folder->ChildCount () - 1; i >= 0; --i)
+	void HistoryModel::Insert (const HistoryItem& item)
+	{
+		const int number = FindSection (item.DateTime_);
+		if (number < 0 || SectionsDate_ != QDate::currentDate ())
 		{
-			auto child = folder->Child (i);
-			if (child->Data (ColumnURL) == item.URL_)
-			{
-				if (announce)
-					beginRemoveRows (index (section, 0), i, i);
-				folder->RemoveChild (i);
-				if (announce)
-					endRemoveRows ();
-			}
+			ResetSections ();
+			return;
 		}
 
-		if (announce)
-			beginInsertRows (index (section, 0), 0, 0);
-		folder->PrependChild (thisItem);
-		if (announce)
-			endInsertRows ();
+		if (!FilterPattern_.isEmpty () &&
+				FilterRx_.indexIn (item.Title_) < 0 &&
+				FilterRx_.indexIn (item.URL_) < 0)
+			return;
+
+		auto& section = Sections_ [number];
+		const QModelIndex& parent = index (number, 0);
+
+		if (section.URLs_.remove (item.URL_))
+			for (int i = section.Items_.size () - 1; i >= 0; --i)
+				if (section.Items_ [i].URL_ == item.URL_)
+				{
+					beginRemoveRows (parent, i, i);
+					section.Items_.erase (section.Items_.begin () + i);
+					endRemoveRows ();
+				}
+
+		const auto pos = std::find_if (section.Items_.begin (), section.Items_.end (),
+				[&item] (const HistoryItem& other) { return other.DateTime_ <= item.DateTime_; });
+
+		// Older than everything loaded so far, so it'll come with one
+		// of the next pages.
+		if (pos == section.Items_.end () && !section.AllFetched_)
+			return;
 
-		QIcon icon = Core::Instance ().GetIcon (QUrl (item.URL_));
-		thisItem->ModifyData (0,
-				icon, Qt::DecorationRole);
+		const int row = std::distance (section.Items_.begin (), pos);
+		beginInsertRows (parent, row, row);
+		section.Items_.insert (pos, item);
+		section.URLs_ << item.URL_;
+		endInsertRows ();
 	}
 
 	void HistoryModel::loadData ()
 	{
-		beginResetModel ();
+		if (Sections_.empty () || SectionsDate_ != QDate::currentDate ())
+			ResetSections ();
 
-		while (RootItem_->ChildCount ())
-			RootItem_->RemoveChild (0);
 		int age = XmlSettingsManager::Instance ()->
 			property ("HistoryClearOlderThan").toInt ();
 		int maxItems = XmlSettingsManager::Instance ()->
 			property ("HistoryKeepLessThan").toInt ();
 		Core::Instance ().GetStorageBackend ()->ClearOldHistory (age, maxItems);
+	}
 
-		Items_.clear ();
-		Core::Instance ().GetStorageBackend ()->LoadHistory (Items_);
-
-		if (Items_.empty ())
-			return;
-
-		for (const auto& item : Items_)
-			Add (item, false);
-
-		endResetModel ();
+	void HistoryModel::handleHistoryCleaned (int removed)
+	{
+		if (removed)
+			ResetSections ();
 	}
 
 	void HistoryModel::handleItemAdded (const HistoryItem& item)
 	{
-		Items_.push_back (item);
-		Add (item, true);
+		Insert (item);
 	}
 }
 }
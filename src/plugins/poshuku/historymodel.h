@@ -18,11 +18,12 @@
 
 #ifndef PLUGINS_POSHUKU_HISTORYMODEL_H
 #define PLUGINS_POSHUKU_HISTORYMODEL_H
-#include <deque>
 #include <vector>
 #include <QAbstractItemModel>
 #include <QStringList>
 #include <QDateTime>
+#include <QRegExp>
+#include <QSet>
 #include <interfaces/core/ihookproxy.h>
 
 class QTimer;
@@ -30,11 +31,6 @@ class QAction;
 
 namespace LeechCraft
 {
-namespace Util
-{
-	class TreeItem;
-}
-
 namespace Poshuku
 {
 	struct HistoryItem
@@ -46,13 +42,38 @@ namespace Poshuku
 
 	typedef std::vector<HistoryItem> history_items_t;
 
+	/** The history is split into sections by date (today, yesterday
+	 * and so on). The items of a section are loaded from the storage
+	 * backend page by page via fetchMore() when the section is expanded
+	 * and scrolled, so only the visible part of the history is kept in
+	 * memory.
+	 */
 	class HistoryModel : public QAbstractItemModel
 	{
 		Q_OBJECT
 
 		QTimer *GarbageTimer_;
-		Util::TreeItem *RootItem_;
-		history_items_t Items_;
+
+		struct Section
+		{
+			QString Name_;
+			QDateTime From_;
+			QDateTime To_;
+
+			history_items_t Items_;
+			QSet<QString> URLs_;
+
+			/** The number of items fetched from the storage, which is
+			 * the offset of the next page.
+			 */
+			int Fetched_;
+			bool AllFetched_;
+		};
+		std::vector<Section> Sections_;
+		QDate SectionsDate_;
+
+		QString FilterPattern_;
+		QRegExp FilterRx_;
 	public:
 		enum Columns
 		{
@@ -71,14 +92,27 @@ namespace Poshuku
 		QModelIndex index (int, int, const QModelIndex& = QModelIndex()) const;
 		QModelIndex parent (const QModelIndex&) const;
 		int rowCount (const QModelIndex& = QModelIndex ()) const;
+		bool hasChildren (const QModelIndex& = QModelIndex ()) const;
+		bool canFetchMore (const QModelIndex&) const;
+		void fetchMore (const QModelIndex&);
+
+		/** Makes the model contain only the items whose title or URL
+		 * contain the given text, either as a fixed string or as a
+		 * wildcard pattern, case-insensitively. The filtering is done
+		 * by the storage backend. Empty text disables filtering.
+		 */
+		void SetFilter (const QString& text, QRegExp::PatternSyntax syntax);
 	public slots:
 		void addItem (QString title, QString url,
 				QDateTime datetime, QObject *browserwidget = 0);
 		QList<QMap<QString, QVariant>> getItemsMap () const;
 	private:
-		void Add (const HistoryItem&, bool announce);
+		void ResetSections ();
+		int FindSection (const QDateTime&) const;
+		void Insert (const HistoryItem&);
 	private slots:
 		void loadData ();
+		void handleHistoryCleaned (int);
 		void handleItemAdded (const HistoryItem&);
 	signals:
 		// Hook support signals
@@ -73,23 +73,23 @@ namespace Poshuku
 		int section = Ui_.HistoryFilterType_->currentIndex ();
 		QString text = Ui_.HistoryFilterLine_->text ();
 	
+		QRegExp::PatternSyntax syntax = QRegExp::FixedString;
 		switch (section)
 		{
 			case 1:
-				HistoryFilterModel_->setFilterWildcard (text);
+				syntax = QRegExp::Wildcard;
 				break;
 			case 2:
-				HistoryFilterModel_->setFilterRegExp (text);
+				syntax = QRegExp::RegExp;
 				break;
 			default:
-				HistoryFilterModel_->setFilterFixedString (text);
 				break;
 		}
-	
-		HistoryFilterModel_->
-			setFilterCaseSensitivity ((Ui_.HistoryFilterCaseSensitivity_->
-						checkState () == Qt::Checked) ? Qt::CaseSensitive :
-					Qt::CaseInsensitive);
+
+		const auto cs = Ui_.HistoryFilterCaseSensitivity_->checkState () == Qt::Checked ?
+				Qt::CaseSensitive :
+				Qt::CaseInsensitive;
+		HistoryFilterModel_->SetFilter (text, syntax, cs);
 	}
 }
 }
@@ -31,6 +31,8 @@
 #include <qwebpage.h>
 #include <qwebelement.h>
 #include <QCoreApplication>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
 #include <QMenu>
 #include <QMainWindow>
 #include <qwebview.h>
@@ -40,7 +42,7 @@
 #include "flashonclickplugin.h"
 #include "flashonclickwhitelist.h"
 #include "userfiltersmodel.h"
-#include "lineparser.h"
+#include "filtercache.h"
 
 Q_DECLARE_METATYPE (QWebFrame*);
 Q_DECLARE_METATYPE (QPointer<QWebFrame>);
@@ -122,6 +124,9 @@ namespace CleanWeb
 	: FlashOnClickPlugin_ (0)
 	, FlashOnClickWhitelist_ (new FlashOnClickWhitelist ())
 	, UserFilters_ (new UserFiltersModel (this))
+	, IndexRebuildScheduled_ (false)
+	, PendingLoads_ (0)
+	, InitialLoadFinished_ (false)
 	{
 		qRegisterMetaType<QWebFrame*> ("QWebFrame*");
 		qRegisterMetaType<QPointer<QWebFrame>> ("QPointer<QWebFrame>");
@@ -132,6 +137,7 @@ namespace CleanWeb
 		try
 		{
 			Util::CreateIfNotExists ("cleanweb");
+			CompiledDir_ = Util::CreateIfNotExists ("cleanweb/compiled");
 		}
 		catch (const std::exception& e)
 		{
@@ -141,22 +147,27 @@ namespace CleanWeb
 			return;
 		}
 
+		ReadSettings ();
+
 		QDir home = QDir::home ();
 		home.cd (".leechcraft");
 		home.cd ("cleanweb");
 		QFileInfoList infos = home.entryInfoList (QDir::Files | QDir::Readable);
 		Q_FOREACH (QFileInfo info, infos)
-			Parse (info.absoluteFilePath ());
+			LoadSubscription (info.absoluteFilePath ());
 
-		ReadSettings ();
-		QTimer::singleShot (0,
-				this,
-				SLOT (update ()));
+		ScheduleIndexRebuild ();
+		if (!PendingLoads_)
+			FinishInitialLoad ();
 
 		connect (UserFilters_,
 				SIGNAL (gotEntity (LeechCraft::Entity)),
 				this,
 				SIGNAL (gotEntity (LeechCraft::Entity)));
+		connect (UserFilters_,
+				SIGNAL (filtersChanged ()),
+				this,
+				SLOT (rebuildIndexes ()));
 	}
 
 	Core& Core::Instance ()
@@ -394,26 +405,24 @@ namespace CleanWeb
 		return FlashOnClickWhitelist_;
 	}
 
-	/** We test each filter until we know that we should reject it or until
-	 * it gets whitelisted.
+	/** First, we look for a filter matching the URL among the candidates
+	 * provided by the filters index. If there is one, we check whether
+	 * the URL is whitelisted by any of the exceptions, likewise looking
+	 * only at the candidates from the exceptions index.
 	 *
-	 * So, for each filter we first iterate through the whitelist. For each
-	 * entry in the whitelist:
+	 * For each candidate, be it a filter or an exception:
 	 * - First, we check if the url's domain ends with a string from a "not
-	 *   apply" list if it's not empty. If it does, we skip this whitelist
-	 *   entry and go to the next one, if it doesn't, we continue
-	 *   processing.
+	 *   apply" list if it's not empty. If it does, we skip this candidate
+	 *   and go to the next one, if it doesn't, we continue processing.
 	 * - Then, if we continue processing, we check if the url's domain ends
 	 *   with a string from "apply list", if this list isn't empty. If it
-	 *   ends, we continue processing, otherwise we skip this whilelist
-	 *   entry and go to the next one.
-	 * - Then, we check if the URL matches this exception, either by regexp
+	 *   ends, we continue processing, otherwise we skip this candidate
+	 *   and go to the next one.
+	 * - Then, we check if the URL matches this candidate, either by regexp
 	 *   or wildcard. If it should be matched only in the beginning or in
 	 *   the end, then '*' is appended or prepended and exact match is
 	 *   checked. Otherwise only something is required to match. Please not
 	 *   that the '*' is prepended by the filter parsing code, not this one.
-	 *
-	 * The same is applied to the filter strings.
 	 */
 	bool Core::ShouldReject (const QNetworkRequest& req, QString *matchedFilter) const
 	{
@@ -454,153 +463,41 @@ namespace CleanWeb
 		const auto& domainUtf8 = domain.toUtf8 ();
 		const bool isForeign = !req.rawHeader ("Referer").contains (domainUtf8);
 
-		QList<Filter> allFilters = Filters_;
-		allFilters << UserFilters_->GetFilter ();
-		Q_FOREACH (const Filter& filter, allFilters)
+		auto matches = [&] (const FilterItem& item) -> bool
 		{
-			Q_FOREACH (const auto& item, filter.Exceptions_)
-			{
-				const auto& url = item.Option_.Case_ == Qt::CaseSensitive ? urlStr : cinUrlStr;
-				const auto& utf8 = item.Option_.Case_ == Qt::CaseSensitive ? urlUtf8 : cinUrlUtf8;
-				if (item.Option_.HideSelector_.isEmpty () && Matches (item, url, utf8, domain))
-					return false;
-			}
-
-			Q_FOREACH (const auto& item, filter.Filters_)
-			{
-				if (!item.Option_.HideSelector_.isEmpty ())
-					continue;
-
-				const auto& opt = item.Option_;
-				if (opt.AbortForeign_ && isForeign)
-					continue;
-
-				if (opt.MatchObjects_ != FilterOption::MatchObject::All &&
-						objs != FilterOption::MatchObject::All &&
-						!(objs & opt.MatchObjects_))
-					continue;
-
-				const auto& url = opt.Case_ == Qt::CaseSensitive ? urlStr : cinUrlStr;
-				const auto& utf8 = opt.Case_ == Qt::CaseSensitive ? urlUtf8 : cinUrlUtf8;
-				if (Matches (item, url, utf8, domain))
-				{
-					*matchedFilter = item.OrigString_;
-					return true;
-				}
-			}
-		}
-
-		return false;
-	}
-
-	#if defined (Q_OS_WIN32) || defined (Q_OS_MAC)
-	// Thanks for this goes to http://www.codeproject.com/KB/string/patmatch.aspx
-	bool WildcardMatches (const char *pattern, const char *str)
-	{
-		enum State {
-			Exact,        // exact match
-			Any,        // ?
-			AnyRepeat    // *
+			const auto& url = item.Option_.Case_ == Qt::CaseSensitive ? urlStr : cinUrlStr;
+			const auto& utf8 = item.Option_.Case_ == Qt::CaseSensitive ? urlUtf8 : cinUrlUtf8;
+			return Matches (item, url, utf8, domain);
 		};
 
-		const char *s = str;
-		const char *p = pattern;
-		const char *q = 0;
-		int state = 0;
-
-		bool match = true;
-		while (match && *p) {
-			if (*p == '*') {
-				state = AnyRepeat;
-				q = p+1;
-			} else if (*p == '?') state = Any;
-			else state = Exact;
-
-			if (*s == 0) break;
-
-			switch (state) {
-				case Exact:
-					match = *s == *p;
-					s++;
-					p++;
-					break;
-
-				case Any:
-					match = true;
-					s++;
-					p++;
-					break;
-
-				case AnyRepeat:
-					match = true;
-					s++;
-
-					if (*s == *q) p++;
-					break;
-			}
-		}
-
-		if (state == AnyRepeat) return (*s == *q);
-		else if (state == Any) return (*s == *p);
-		else return match && (*s == *p);
-	}
-	#else
-	#include <fnmatch.h>
-
-	bool WildcardMatches (const char *pat, const char *str)
-	{
-		return !fnmatch (pat, str, 0);
-	}
-	#endif
-
-	bool Core::Matches (const FilterItem& item, const QString& urlStr, const QByteArray& urlUtf8, const QString& domain) const
-	{
-		if (item.Option_.MatchObjects_ != FilterOption::MatchObject::All)
+		const auto& query = FilterIndex::MakeQuery (cinUrlStr, domain);
+		auto matchesFilter = [&] (const FilterItem& item) -> bool
 		{
-			if (!(item.Option_.MatchObjects_ & FilterOption::MatchObject::CSS) &&
-					!(item.Option_.MatchObjects_ & FilterOption::MatchObject::Image) &&
-					!(item.Option_.MatchObjects_ & FilterOption::MatchObject::Script) &&
-					!(item.Option_.MatchObjects_ & FilterOption::MatchObject::Object) &&
-					!(item.Option_.MatchObjects_ & FilterOption::MatchObject::ObjSubrequest))
+			const auto& opt = item.Option_;
+			if (opt.AbortForeign_ && isForeign)
 				return false;
-		}
-
-		const auto& opt = item.Option_;
-		if (!opt.NotDomains_.isEmpty ())
-		{
-			Q_FOREACH (const auto& notDomain, opt.NotDomains_)
-				if (domain.endsWith (notDomain, opt.Case_))
-					return false;
-		}
 
-		if (!opt.Domains_.isEmpty ())
-		{
-			bool shouldFurther = false;
-			Q_FOREACH (QString doDomain, opt.Domains_)
-				if (domain.endsWith (doDomain, opt.Case_))
-				{
-					shouldFurther = true;
-					break;
-				}
-			if (!shouldFurther)
+			if (opt.MatchObjects_ != FilterOption::MatchObject::All &&
+					objs != FilterOption::MatchObject::All &&
+					!(objs & opt.MatchObjects_))
 				return false;
-		}
 
-		switch (opt.MatchType_)
-		{
-		case FilterOption::MTRegexp:
-			return item.RegExp_.Matches (urlStr);
-		case FilterOption::MTWildcard:
-			return WildcardMatches (item.OrigString_.constData (), urlUtf8.constData ());
-		case FilterOption::MTPlain:
-			return item.PlainMatcher_.indexIn (urlUtf8) >= 0;
-		case FilterOption::MTBegin:
-			return urlStr.startsWith (item.OrigString_);
-		case FilterOption::MTEnd:
-			return urlStr.endsWith (item.OrigString_);
-		}
+			return matches (item);
+		};
+
+		const FilterItem *filter = 0;
+		for (const auto& index : FilterIndexes_)
+			if ((filter = index->Find (query, matchesFilter)))
+				break;
+		if (!filter)
+			return false;
 
-		return false;
+		for (const auto& index : ExceptionIndexes_)
+			if (index->Find (query, matches))
+				return false;
+
+		*matchedFilter = filter->OrigString_;
+		return true;
 	}
 
 	void Core::HandleProvider (QObject *provider)
@@ -619,47 +516,34 @@ namespace CleanWeb
 				SLOT (handleJobError (int, IDownload::Error)));
 	}
 
-	void Core::Parse (const QString& filePath)
+	void Core::LoadSubscription (const QString& filePath)
 	{
-		QFile file (filePath);
-		if (!file.open (QIODevice::ReadOnly))
-		{
-			qWarning () << Q_FUNC_INFO
-				<< "could not open file"
-				<< filePath
-				<< file.errorString ();
-			return;
-		}
+		++PendingLoads_;
 
-		QString data = QTextCodec::codecForName ("UTF-8")->
-			toUnicode (file.readAll ());
-		QStringList rawLines = data.split ('\n', QString::SkipEmptyParts);
-		if (rawLines.size ())
-			rawLines.removeAt (0);
-		QStringList lines;
-		std::transform (rawLines.begin (), rawLines.end (),
-				std::back_inserter (lines),
-				[] (const QString& t) { return t.trimmed (); });
+		auto watcher = new QFutureWatcher<Filter> (this);
+		connect (watcher,
+				SIGNAL (finished ()),
+				this,
+				SLOT (handleSubscriptionLoaded ()));
 
-		Filter f;
-		std::for_each (lines.begin (), lines.end (), LineParser (&f));
+		const auto& cacheDir = CompiledDir_;
+		std::function<Filter ()> worker = [filePath, cacheDir] { return FilterCache::Load (filePath, cacheDir); };
+		watcher->setFuture (QtConcurrent::run (worker));
+	}
 
-		f.SD_.Filename_ = QFileInfo (filePath).fileName ();
+	void Core::FinishInitialLoad ()
+	{
+		InitialLoadFinished_ = true;
 
-		auto pos = std::find_if (Filters_.begin (), Filters_.end (),
-				FilterFinder<FTFilename_> (f.SD_.Filename_));
-		if (pos != Filters_.end ())
-		{
-			int row = std::distance (Filters_.begin (), pos);
-			beginRemoveRows (QModelIndex (), row, row);
-			Filters_.erase (pos);
-			endRemoveRows ();
-			WriteSettings ();
-		}
+		for (const auto& sd : PendingSDs_)
+			qWarning () << Q_FUNC_INFO
+				<< "could not find filter for name"
+				<< sd.Filename_;
+		PendingSDs_.clear ();
 
-		beginInsertRows (QModelIndex (), Filters_.size (), Filters_.size ());
-		Filters_ << f;
-		endInsertRows ();
+		QTimer::singleShot (0,
+				this,
+				SLOT (update ()));
 	}
 
 	bool Core::Add (const QUrl& subscrUrl)
@@ -739,6 +623,8 @@ namespace CleanWeb
 		home.cd (".leechcraft");
 		home.cd ("cleanweb");
 		home.remove (fileName);
+		FilterCache::Remove (fileName, CompiledDir_);
+		PendingSDs_.remove (fileName);
 
 		QList<Filter>::iterator pos = std::find_if (Filters_.begin (), Filters_.end (),
 				FilterFinder<FTFilename_> (fileName));
@@ -749,6 +635,8 @@ namespace CleanWeb
 			Filters_.erase (pos);
 			endRemoveRows ();
 			WriteSettings ();
+
+			ScheduleIndexRebuild ();
 		}
 		else
 			qWarning () << Q_FUNC_INFO
@@ -763,14 +651,21 @@ namespace CleanWeb
 		settings.beginWriteArray ("Subscriptions");
 		settings.remove ("");
 
+		// The subscriptions that are still being loaded shouldn't be
+		// forgotten.
+		auto sds = PendingSDs_;
+		for (const auto& f : Filters_)
+			if (!sds.contains (f.SD_.Filename_))
+				sds [f.SD_.Filename_] = f.SD_;
+
 		int i = 0;
-		Q_FOREACH (Filter f, Filters_)
+		for (const auto& sd : sds)
 		{
 			settings.setArrayIndex (i++);
-			settings.setValue ("URL", f.SD_.URL_);
-			settings.setValue ("name", f.SD_.Name_);
-			settings.setValue ("fileName", f.SD_.Filename_);
-			settings.setValue ("lastDateTime", f.SD_.LastDateTime_);
+			settings.setValue ("URL", sd.URL_);
+			settings.setValue ("name", sd.Name_);
+			settings.setValue ("fileName", sd.Filename_);
+			settings.setValue ("lastDateTime", sd.LastDateTime_);
 		}
 
 		settings.endArray ();
@@ -792,29 +687,63 @@ namespace CleanWeb
 				settings.value ("fileName").toString (),
 				settings.value ("lastDateTime").toDateTime ()
 			};
-			if (!AssignSD (sd))
-				qWarning () << Q_FUNC_INFO
-					<< "could not find filter for name"
-					<< sd.Filename_;
+			PendingSDs_ [sd.Filename_] = sd;
 		}
 
 		settings.endArray ();
 	}
 
-	bool Core::AssignSD (const SubscriptionData& sd)
+	void Core::ScheduleIndexRebuild ()
 	{
-		QList<Filter>::iterator pos =
-			std::find_if (Filters_.begin (), Filters_.end (),
-				FilterFinder<FTFilename_> (sd.Filename_));
-		if (pos != Filters_.end ())
+		if (IndexRebuildScheduled_)
+			return;
+
+		IndexRebuildScheduled_ = true;
+		QTimer::singleShot (0,
+				this,
+				SLOT (rebuildIndexes ()));
+	}
+
+	void Core::rebuildIndexes ()
+	{
+		IndexRebuildScheduled_ = false;
+
+		FilterIndexes_.clear ();
+		ExceptionIndexes_.clear ();
+
+		auto build = [] (const QList<FilterItem>& items)
 		{
-			pos->SD_ = sd;
-			int row = std::distance (Filters_.begin (), pos);
-			emit dataChanged (index (row, 0), index (row, columnCount () - 1));
-			return true;
+			QList<FilterItem> requestItems;
+			for (const auto& item : items)
+				if (item.Option_.HideSelector_.isEmpty ())
+					requestItems << item;
+
+			auto index = std::make_shared<FilterIndex> ();
+			index->Build (requestItems);
+			return FilterIndex_ptr (index);
+		};
+
+		const auto& userFilter = UserFilters_->GetFilter ();
+		FilterIndexes_ << build (userFilter.Filters_);
+		ExceptionIndexes_ << build (userFilter.Exceptions_);
+
+		for (const auto& filter : Filters_)
+		{
+			FilterIndexes_ << (filter.FiltersIndex_ ? filter.FiltersIndex_ : build (filter.Filters_));
+			ExceptionIndexes_ << (filter.ExceptionsIndex_ ? filter.ExceptionsIndex_ : build (filter.Exceptions_));
 		}
-		else
-			return false;
+
+		QList<FilterItem> hideItems;
+		auto collectHiding = [&hideItems] (const QList<FilterItem>& items)
+		{
+			for (const auto& item : items)
+				if (!item.Option_.HideSelector_.isEmpty ())
+					hideItems << item;
+		};
+		collectHiding (userFilter.Filters_);
+		for (const auto& filter : Filters_)
+			collectHiding (filter.Filters_);
+		HidingIndex_.Build (hideItems);
 	}
 
 	void Core::update ()
@@ -844,15 +773,60 @@ namespace CleanWeb
 			pj.FileName_,
 			QDateTime::currentDateTime ()
 		};
-		Parse (pj.FullName_);
 		PendingJobs_.remove (id);
-		if (!AssignSD (sd))
-			qWarning () << Q_FUNC_INFO
-				<< "could not find filter for name"
-				<< sd.Filename_;
+
+		PendingSDs_ [sd.Filename_] = sd;
+		LoadSubscription (pj.FullName_);
 		WriteSettings ();
 	}
 
+	void Core::handleSubscriptionLoaded ()
+	{
+		auto watcher = dynamic_cast<QFutureWatcher<Filter>*> (sender ());
+		if (!watcher)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "not a future watcher"
+					<< sender ();
+			return;
+		}
+		watcher->deleteLater ();
+
+		auto filter = watcher->result ();
+		const auto& fileName = filter.SD_.Filename_;
+		if (!fileName.isEmpty () &&
+				QFile::exists (QDir::homePath () + "/.leechcraft/cleanweb/" + fileName))
+		{
+			const auto pos = std::find_if (Filters_.begin (), Filters_.end (),
+					FilterFinder<FTFilename_> (fileName));
+
+			if (PendingSDs_.contains (fileName))
+				filter.SD_ = PendingSDs_.take (fileName);
+			else if (pos != Filters_.end ())
+				filter.SD_ = pos->SD_;
+
+			if (pos != Filters_.end ())
+			{
+				const int row = std::distance (Filters_.begin (), pos);
+				*pos = filter;
+				emit dataChanged (index (row, 0), index (row, columnCount () - 1));
+			}
+			else
+			{
+				beginInsertRows (QModelIndex (), Filters_.size (), Filters_.size ());
+				Filters_ << filter;
+				endInsertRows ();
+			}
+
+			ScheduleIndexRebuild ();
+			if (InitialLoadFinished_)
+				WriteSettings ();
+		}
+
+		if (!--PendingLoads_ && !InitialLoadFinished_)
+			FinishInitialLoad ();
+	}
+
 	void Core::handleJobError (int id, IDownload::Error)
 	{
 		if (!PendingJobs_.contains (id))
@@ -861,54 +835,84 @@ namespace CleanWeb
 		PendingJobs_.remove (id);
 	}
 
+	namespace
+	{
+		const QString StylesheetClass = "leechcraft-cleanweb";
+
+		/** Injects the given stylesheets into the frame's document.
+		 * Returns false if the document doesn't allow that, in which
+		 * case the elements should be removed from the DOM instead.
+		 */
+		bool InjectStylesheets (QWebFrame *frame, const QStringList& stylesheets)
+		{
+			auto root = frame->documentElement ();
+			if (root.isNull ())
+				return false;
+
+			if (!root.findFirst ("style." + StylesheetClass).isNull ())
+				return true;
+
+			auto container = root.findFirst ("head");
+			if (container.isNull ())
+				container = root;
+
+			Q_FOREACH (const auto& stylesheet, stylesheets)
+			{
+				container.appendInside ("<style type=\"text/css\" class=\"" +
+						StylesheetClass + "\">" + stylesheet + "</style>");
+				const auto& style = container.lastChild ();
+				if (style.tagName ().toLower () != "style")
+					return false;
+			}
+
+			return true;
+		}
+	}
+
 	void Core::handleFrameLayout (QPointer<QWebFrame> frame)
 	{
+		if (!frame)
+			return;
+
 		const QUrl& frameUrl = frame->url ();
-		const QString& urlStr = frameUrl.toString ();
-		const auto& urlUtf8 = urlStr.toUtf8 ();
-		const QString& cinUrlStr = urlStr.toLower ();
-		const auto& cinUrlUtf8 = cinUrlStr.toUtf8 ();
 
-		const QString& domain = frameUrl.host ();
+		QStringList selectors;
+		if (InjectStylesheets (frame, HidingIndex_.GetStylesheets (frameUrl)))
+			selectors = HidingIndex_.GetUnsafeSelectors (frameUrl);
+		else
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to inject stylesheets into"
+					<< frameUrl
+					<< ", falling back to removing elements";
+			selectors = HidingIndex_.GetSelectors (frameUrl);
+		}
 
-		QList<Filter> allFilters = Filters_;
-		allFilters << UserFilters_->GetFilter ();
 		int numItems = 0;
-		QList<QWebElement> elems;
-		Q_FOREACH (const Filter& filter, allFilters)
-			Q_FOREACH (const auto& item, filter.Filters_)
+		Q_FOREACH (const auto& selector, selectors)
+		{
+			const auto& matchingElems = frame->findAllElements (selector);
+			if (matchingElems.count ())
+				qDebug () << "removing"
+						<< matchingElems.count ()
+						<< "elems for"
+						<< selector
+						<< frameUrl;
+
+			Q_FOREACH (auto elem, matchingElems)
+				RemoveElem (elem);
+
+			if (!(++numItems % 100))
 			{
-				if (item.Option_.HideSelector_.isEmpty ())
-					continue;
-
-				const auto& opt = item.Option_;
-				const auto& url = opt.Case_ == Qt::CaseSensitive ? urlStr : cinUrlStr;
-				const auto& utf8 = opt.Case_ == Qt::CaseSensitive ? urlUtf8 : cinUrlUtf8;
-				if (!item.OrigString_.isEmpty () && !Matches (item, url, utf8, domain))
-					continue;
-
-				const auto& matchingElems = frame->findAllElements (item.Option_.HideSelector_);
-				if (matchingElems.count ())
-					qDebug () << "removing"
-							<< matchingElems.count ()
-							<< "elems for"
-							<< item.Option_.HideSelector_
-							<< frameUrl;
-
-				Q_FOREACH (auto elem, matchingElems)
-					RemoveElem (elem);
-
-				if (!(++numItems % 100))
+				qApp->processEvents ();
+				if (!frame)
 				{
-					qApp->processEvents ();
-					if (!frame)
-					{
-						qDebug () << Q_FUNC_INFO
-								<< "frame destroyed in processEvents(), stopping";
-						return;
-					}
+					qDebug () << Q_FUNC_INFO
+							<< "frame destroyed in processEvents(), stopping";
+					return;
 				}
 			}
+		}
 	}
 
 	void Core::delayedRemoveElements (QPointer<QWebFrame> frame, const QString& url)
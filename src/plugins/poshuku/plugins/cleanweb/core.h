@@ -23,12 +23,15 @@
 #include <QStringList>
 #include <QNetworkReply>
 #include <QDateTime>
+#include <QDir>
 #include <QWebPage>
 #include <interfaces/iinfo.h>
 #include <interfaces/idownload.h>
 #include <interfaces/poshuku/poshukutypes.h>
 #include <interfaces/core/ihookproxy.h>
 #include "filter.h"
+#include "filterindex.h"
+#include "elementhidingindex.h"
 
 class QNetworkRequest;
 class QWebPage;
@@ -54,6 +57,16 @@ namespace CleanWeb
 		UserFiltersModel *UserFilters_;
 
 		QList<Filter> Filters_;
+
+		QList<FilterIndex_ptr> FilterIndexes_;
+		QList<FilterIndex_ptr> ExceptionIndexes_;
+		ElementHidingIndex HidingIndex_;
+		bool IndexRebuildScheduled_;
+
+		QDir CompiledDir_;
+		QHash<QString, SubscriptionData> PendingSDs_;
+		int PendingLoads_;
+		bool InitialLoadFinished_;
 		QObjectList Downloaders_;
 		QStringList HeaderLabels_;
 
@@ -144,9 +157,14 @@ namespace CleanWeb
 		 */
 		bool Load (const QUrl& url, const QString& subscrName);
 	private:
-		bool Matches (const FilterItem&, const QString&, const QByteArray&, const QString&) const;
 		void HandleProvider (QObject*);
-		void Parse (const QString&);
+
+		/** Loads the subscription at the given full path in a
+		 * background thread, using the precompiled cache if it is
+		 * up to date.
+		 */
+		void LoadSubscription (const QString&);
+		void FinishInitialLoad ();
 
 		/** Removes the subscription at
 		 * ~/.leechcraft/cleanweb/filename.
@@ -154,11 +172,13 @@ namespace CleanWeb
 		void Remove (const QString& filename);
 		void WriteSettings ();
 		void ReadSettings ();
-		bool AssignSD (const SubscriptionData&);
+		void ScheduleIndexRebuild ();
 	private slots:
+		void rebuildIndexes ();
 		void update ();
 		void handleJobFinished (int);
 		void handleJobError (int, IDownload::Error);
+		void handleSubscriptionLoaded ();
 		void handleFrameLayout (QPointer<QWebFrame>);
 		void delayedRemoveElements (QPointer<QWebFrame>, const QString&);
 		void moreDelayedRemoveElements ();
@@ -0,0 +1,283 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+
+#include "elementhidingindex.h"
+#include <algorithm>
+#include <QUrl>
+
+namespace LeechCraft
+{
+namespace Poshuku
+{
+namespace CleanWeb
+{
+	namespace
+	{
+		/** How many selectors are grouped into a single CSS rule. A
+		 * selector the engine fails to parse invalidates the whole
+		 * group, so the groups are kept small.
+		 */
+		const int SelectorsPerRule = 8;
+
+		/** The maximum number of cached per-domain stylesheets.
+		 */
+		const int MaxCachedDomains = 256;
+
+		/** Extended pseudo-classes used by some filter lists that are
+		 * not CSS and would invalidate a grouped rule.
+		 */
+		const QStringList NonCSSPseudoClasses = QStringList ()
+				<< ":-abp-"
+				<< ":has("
+				<< ":has-text("
+				<< ":contains("
+				<< ":xpath(";
+
+		/** Selectors containing these would break out of the rule or
+		 * of the style element itself, or are known not to be parsed
+		 * as CSS at all.
+		 */
+		bool IsSafe (const QString& selector)
+		{
+			if (selector.contains ('{') ||
+					selector.contains ('}') ||
+					selector.contains ('<') ||
+					selector.contains ('&'))
+				return false;
+
+			for (const auto& pseudo : NonCSSPseudoClasses)
+				if (selector.contains (pseudo))
+					return false;
+
+			return true;
+		}
+
+		QString MakeStylesheet (const QStringList& selectors)
+		{
+			QString result;
+			for (int i = 0; i < selectors.size (); i += SelectorsPerRule)
+			{
+				result += QStringList (selectors.mid (i, SelectorsPerRule)).join (", ");
+				result += " { display: none !important; }\n";
+			}
+			return result;
+		}
+
+		QStringList FilterSafe (const QStringList& selectors, bool safe)
+		{
+			QStringList result;
+			for (const auto& selector : selectors)
+				if (IsSafe (selector) == safe)
+					result << selector;
+			return result;
+		}
+
+		/** Checks whether the pattern of the hiding rule is a list of
+		 * domains like "example.com,~foo.example.com" and splits it to
+		 * the included and excluded ones if so.
+		 */
+		bool ParseDomains (const FilterItem& item, QStringList& domains, QStringList& notDomains)
+		{
+			if (item.Option_.MatchType_ != FilterOption::MTPlain)
+				return false;
+
+			const auto& pattern = QString::fromUtf8 (item.OrigString_).toLower ();
+			for (const auto c : pattern)
+				if (!c.isLetterOrNumber () && c != '.' && c != '-' && c != ',' && c != '~')
+					return false;
+
+			for (const auto& domain : pattern.split (',', QString::SkipEmptyParts))
+				if (domain.startsWith ('~'))
+					notDomains << domain.mid (1);
+				else
+					domains << domain;
+
+			for (const auto& domain : item.Option_.Domains_)
+				domains << domain.toLower ();
+			for (const auto& domain : item.Option_.NotDomains_)
+				notDomains << domain.toLower ();
+
+			return true;
+		}
+
+		/** Returns the domain itself and all of its parent domains.
+		 */
+		QStringList GetDomainSuffixes (QString domain)
+		{
+			QStringList result;
+			while (!domain.isEmpty ())
+			{
+				result << domain;
+				const int dot = domain.indexOf ('.');
+				if (dot < 0)
+					break;
+				domain = domain.mid (dot + 1);
+			}
+			return result;
+		}
+
+		bool IsSubdomain (const QString& domain, const QString& parent)
+		{
+			return domain == parent ||
+					(domain.endsWith (parent) &&
+						domain.at (domain.size () - parent.size () - 1) == '.');
+		}
+	}
+
+	ElementHidingIndex::ElementHidingIndex ()
+	: DomainStylesheets_ (MaxCachedDomains)
+	{
+	}
+
+	void ElementHidingIndex::Build (const QList<FilterItem>& items)
+	{
+		DomainRules_.clear ();
+		ByDomain_.clear ();
+		ExceptDomains_.clear ();
+		UrlRules_.clear ();
+		GenericSelectors_.clear ();
+		UnsafeSelectors_.clear ();
+		DomainStylesheets_.clear ();
+
+		for (const auto& item : items)
+		{
+			const auto& selector = item.Option_.HideSelector_;
+			if (selector.isEmpty ())
+				continue;
+
+			DomainRule rule { selector, QStringList (), QStringList () };
+			if (!ParseDomains (item, rule.Domains_, rule.NotDomains_))
+			{
+				UrlRules_ << item;
+				continue;
+			}
+
+			if (rule.Domains_.isEmpty () && rule.NotDomains_.isEmpty ())
+			{
+				if (IsSafe (selector))
+					GenericSelectors_ << selector;
+				else
+					UnsafeSelectors_ << selector;
+				continue;
+			}
+
+			const int idx = DomainRules_.size ();
+			DomainRules_ << rule;
+			if (rule.Domains_.isEmpty ())
+				ExceptDomains_ << idx;
+			else
+				for (const auto& domain : rule.Domains_)
+					ByDomain_ [domain] << idx;
+		}
+
+		GenericSelectors_.removeDuplicates ();
+		GenericStylesheet_ = MakeStylesheet (GenericSelectors_);
+	}
+
+	QStringList ElementHidingIndex::GetStylesheets (const QUrl& url)
+	{
+		QStringList result;
+		if (!GenericStylesheet_.isEmpty ())
+			result << GenericStylesheet_;
+
+		const auto& domain = url.host ().toLower ();
+		if (!DomainStylesheets_.contains (domain))
+		{
+			QStringList selectors;
+			for (const auto idx : GetDomainRules (domain))
+				selectors << DomainRules_.at (idx).Selector_;
+			DomainStylesheets_.insert (domain, new QString (MakeStylesheet (FilterSafe (selectors, true))));
+		}
+		const auto& domainStylesheet = *DomainStylesheets_.object (domain);
+		if (!domainStylesheet.isEmpty ())
+			result << domainStylesheet;
+
+		const auto& urlStylesheet = MakeStylesheet (FilterSafe (GetUrlSelectors (url), true));
+		if (!urlStylesheet.isEmpty ())
+			result << urlStylesheet;
+
+		return result;
+	}
+
+	QStringList ElementHidingIndex::GetSelectors (const QUrl& url) const
+	{
+		QStringList result = GenericSelectors_ + UnsafeSelectors_;
+		for (const auto idx : GetDomainRules (url.host ().toLower ()))
+			result << DomainRules_.at (idx).Selector_;
+		result += GetUrlSelectors (url);
+		return result;
+	}
+
+	QStringList ElementHidingIndex::GetUnsafeSelectors (const QUrl& url) const
+	{
+		auto result = UnsafeSelectors_;
+		for (const auto idx : GetDomainRules (url.host ().toLower ()))
+			if (!IsSafe (DomainRules_.at (idx).Selector_))
+				result << DomainRules_.at (idx).Selector_;
+		result += FilterSafe (GetUrlSelectors (url), false);
+		return result;
+	}
+
+	QList<int> ElementHidingIndex::GetDomainRules (const QString& domain) const
+	{
+		QList<int> candidates = ExceptDomains_.toList ();
+		for (const auto& suffix : GetDomainSuffixes (domain))
+		{
+			const auto pos = ByDomain_.constFind (suffix);
+			if (pos != ByDomain_.constEnd ())
+				candidates += pos->toList ();
+		}
+		std::sort (candidates.begin (), candidates.end ());
+		candidates.erase (std::unique (candidates.begin (), candidates.end ()), candidates.end ());
+
+		QList<int> result;
+		for (const auto idx : candidates)
+		{
+			const auto& notDomains = DomainRules_.at (idx).NotDomains_;
+			if (std::none_of (notDomains.begin (), notDomains.end (),
+					[&domain] (const QString& notDomain) { return IsSubdomain (domain, notDomain); }))
+				result << idx;
+		}
+		return result;
+	}
+
+	QStringList ElementHidingIndex::GetUrlSelectors (const QUrl& url) const
+	{
+		if (UrlRules_.isEmpty ())
+			return QStringList ();
+
+		const auto& urlStr = url.toString ();
+		const auto& urlUtf8 = urlStr.toUtf8 ();
+		const auto& cinUrlStr = urlStr.toLower ();
+		const auto& cinUrlUtf8 = cinUrlStr.toUtf8 ();
+		const auto& domain = url.host ();
+
+		QStringList result;
+		for (const auto& item : UrlRules_)
+		{
+			const auto cs = item.Option_.Case_ == Qt::CaseSensitive;
+			if (item.OrigString_.isEmpty () ||
+					Matches (item, cs ? urlStr : cinUrlStr, cs ? urlUtf8 : cinUrlUtf8, domain))
+				result << item.Option_.HideSelector_;
+		}
+		return result;
+	}
+}
+}
+}
@@ -0,0 +1,106 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+
+#pragma once
+
+#include <QVector>
+#include <QHash>
+#include <QCache>
+#include <QStringList>
+#include "filter.h"
+
+class QUrl;
+
+namespace LeechCraft
+{
+namespace Poshuku
+{
+namespace CleanWeb
+{
+	/** Compiles the element hiding rules into stylesheets, so that
+	 * hiding the elements on a page is a matter of injecting a couple
+	 * of style elements instead of querying the DOM once per rule.
+	 *
+	 * The rules are split into three groups:
+	 * - generic ones, which apply to every page and are compiled into a
+	 *   single stylesheet once;
+	 * - domain-specific ones (like "example.com,~foo.example.com##.ad"),
+	 *   whose stylesheets are compiled on demand and cached per domain;
+	 * - the rest, whose pattern isn't a list of domains and thus has to
+	 *   be matched against the full URL of every page.
+	 *
+	 * Selectors that can't be safely put into a stylesheet, including
+	 * the ones using non-CSS extensions, are kept aside and returned by
+	 * GetUnsafeSelectors(), so that the caller could remove the
+	 * corresponding elements from the DOM instead.
+	 */
+	class ElementHidingIndex
+	{
+		struct DomainRule
+		{
+			QString Selector_;
+			QStringList Domains_;
+			QStringList NotDomains_;
+		};
+		QVector<DomainRule> DomainRules_;
+		QHash<QString, QVector<int>> ByDomain_;
+		QVector<int> ExceptDomains_;
+
+		QVector<FilterItem> UrlRules_;
+
+		QStringList GenericSelectors_;
+		QString GenericStylesheet_;
+
+		QStringList UnsafeSelectors_;
+
+		QCache<QString, QString> DomainStylesheets_;
+	public:
+		ElementHidingIndex ();
+
+		/** Replaces the contents of the index with the hiding rules
+		 * from the given list. Items without a hide selector are
+		 * ignored.
+		 */
+		void Build (const QList<FilterItem>&);
+
+		/** Returns the stylesheets hiding the elements on the page at
+		 * the given URL: the generic one, the one for the domain of
+		 * the URL and the one for the rules matching the URL itself.
+		 * Empty stylesheets are omitted.
+		 */
+		QStringList GetStylesheets (const QUrl&);
+
+		/** Returns all the selectors that should be hidden on the
+		 * page at the given URL. This is meant for removing the
+		 * elements from the DOM if the stylesheets can't be used.
+		 */
+		QStringList GetSelectors (const QUrl&) const;
+
+		/** Returns the selectors that didn't make it into any
+		 * stylesheet and should be handled by removing the elements
+		 * from the DOM.
+		 */
+		QStringList GetUnsafeSelectors (const QUrl&) const;
+	private:
+		QList<int> GetDomainRules (const QString&) const;
+		QStringList GetUrlSelectors (const QUrl&) const;
+	};
+}
+}
+}
@@ -19,6 +19,10 @@
 #include "filter.h"
 #include <QtDebug>
 
+#if !defined (Q_OS_WIN32) && !defined (Q_OS_MAC)
+#include <fnmatch.h>
+#endif
+
 namespace LeechCraft
 {
 namespace Poshuku
@@ -27,13 +31,15 @@ namespace CleanWeb
 {
 	QDataStream& operator<< (QDataStream& out, const FilterOption& opt)
 	{
-		qint8 version = 2;
+		qint8 version = 3;
 		out << version
 			<< static_cast<qint8> (opt.Case_)
 			<< static_cast<qint8> (opt.MatchType_)
 			<< opt.Domains_
 			<< opt.NotDomains_
-			<< opt.AbortForeign_;
+			<< opt.AbortForeign_
+			<< static_cast<qint32> (opt.MatchObjects_)
+			<< opt.HideSelector_;
 		return out;
 	}
 
@@ -42,7 +48,7 @@ namespace CleanWeb
 		qint8 version = 0;
 		in >> version;
 
-		if (version < 1 || version > 2)
+		if (version < 1 || version > 3)
 		{
 			qWarning () << Q_FUNC_INFO
 				<< "unknown version"
@@ -54,9 +60,14 @@ namespace CleanWeb
 		{
 			qint8 cs;
 			in >> cs;
-			opt.Case_ = cs ?
-				Qt::CaseInsensitive :
-				Qt::CaseSensitive;
+			// Versions before 3 were read with the case sensitivity
+			// inverted, so keep that for the data saved back then.
+			if (version >= 3)
+				opt.Case_ = static_cast<Qt::CaseSensitivity> (cs);
+			else
+				opt.Case_ = cs ?
+					Qt::CaseInsensitive :
+					Qt::CaseSensitive;
 			qint8 mt;
 			in >> mt;
 			opt.MatchType_ = static_cast<FilterOption::MatchType> (mt);
@@ -65,6 +76,13 @@ namespace CleanWeb
 		}
 		if (version >= 2)
 			in >> opt.AbortForeign_;
+		if (version >= 3)
+		{
+			qint32 objs;
+			in >> objs
+				>> opt.HideSelector_;
+			opt.MatchObjects_ = static_cast<FilterOption::MatchObjects> (objs);
+		}
 
 		return in;
 	}
@@ -113,23 +131,151 @@ namespace CleanWeb
 		}
 
 		in >> item.OrigString_;
+
+		QString pattern;
+		Qt::CaseSensitivity cs = Qt::CaseInsensitive;
 		if (version == 1)
 		{
 			QRegExp rx;
 			in >> rx;
-			item.RegExp_ = RegExp (rx.pattern (), rx.caseSensitivity ());
+			pattern = rx.pattern ();
+			cs = rx.caseSensitivity ();
 		}
 		else if (version == 2)
 		{
-			QString str;
-			quint8 cs;
-			in >> str >> cs;
-			item.RegExp_ = RegExp (str, static_cast<Qt::CaseSensitivity> (cs));
+			quint8 csByte;
+			in >> pattern >> csByte;
+			cs = static_cast<Qt::CaseSensitivity> (csByte);
 		}
 		in >> item.Option_;
+
+		// Compiling regexps is expensive, so only do it for the items
+		// that are actually matched by them.
+		switch (item.Option_.MatchType_)
+		{
+		case FilterOption::MTRegexp:
+			item.RegExp_ = RegExp (pattern, cs);
+			break;
+		case FilterOption::MTPlain:
+			item.PlainMatcher_ = QByteArrayMatcher (item.OrigString_);
+			break;
+		default:
+			break;
+		}
 		return in;
 	}
 
+	namespace
+	{
+	#if defined (Q_OS_WIN32) || defined (Q_OS_MAC)
+		// Thanks for this goes to http://www.codeproject.com/KB/string/patmatch.aspx
+		bool WildcardMatches (const char *pattern, const char *str)
+		{
+			enum State {
+				Exact,        // exact match
+				Any,        // ?
+				AnyRepeat    // *
+			};
+
+			const char *s = str;
+			const char *p = pattern;
+			const char *q = 0;
+			int state = 0;
+
+			bool match = true;
+			while (match && *p) {
+				if (*p == '*') {
+					state = AnyRepeat;
+					q = p+1;
+				} else if (*p == '?') state = Any;
+				else state = Exact;
+
+				if (*s == 0) break;
+
+				switch (state) {
+					case Exact:
+						match = *s == *p;
+						s++;
+						p++;
+						break;
+
+					case Any:
+						match = true;
+						s++;
+						p++;
+						break;
+
+					case AnyRepeat:
+						match = true;
+						s++;
+
+						if (*s == *q) p++;
+						break;
+				}
+			}
+
+			if (state == AnyRepeat) return (*s == *q);
+			else if (state == Any) return (*s == *p);
+			else return match && (*s == *p);
+		}
+	#else
+		bool WildcardMatches (const char *pat, const char *str)
+		{
+			return !fnmatch (pat, str, 0);
+		}
+	#endif
+	}
+
+	bool Matches (const FilterItem& item, const QString& urlStr, const QByteArray& urlUtf8, const QString& domain)
+	{
+		if (item.Option_.MatchObjects_ != FilterOption::MatchObject::All)
+		{
+			if (!(item.Option_.MatchObjects_ & FilterOption::MatchObject::CSS) &&
+					!(item.Option_.MatchObjects_ & FilterOption::MatchObject::Image) &&
+					!(item.Option_.MatchObjects_ & FilterOption::MatchObject::Script) &&
+					!(item.Option_.MatchObjects_ & FilterOption::MatchObject::Object) &&
+					!(item.Option_.MatchObjects_ & FilterOption::MatchObject::ObjSubrequest))
+				return false;
+		}
+
+		const auto& opt = item.Option_;
+		if (!opt.NotDomains_.isEmpty ())
+		{
+			Q_FOREACH (const auto& notDomain, opt.NotDomains_)
+				if (domain.endsWith (notDomain, opt.Case_))
+					return false;
+		}
+
+		if (!opt.Domains_.isEmpty ())
+		{
+			bool shouldFurther = false;
+			Q_FOREACH (QString doDomain, opt.Domains_)
+				if (domain.endsWith (doDomain, opt.Case_))
+				{
+					shouldFurther = true;
+					break;
+				}
+			if (!shouldFurther)
+				return false;
+		}
+
+		switch (opt.MatchType_)
+		{
+		case FilterOption::MTRegexp:
+			return item.RegExp_.Matches (urlStr);
+		case FilterOption::MTWildcard:
+			return WildcardMatches (item.OrigString_.constData (), urlUtf8.constData ());
+		case FilterOption::MTPlain:
+			return item.PlainMatcher_.indexIn (urlUtf8) >= 0;
+		case FilterOption::MTBegin:
+			return urlStr.startsWith (item.OrigString_);
+		case FilterOption::MTEnd:
+			return urlStr.endsWith (item.OrigString_);
+		}
+
+		return false;
+	}
+
 	Filter& Filter::operator+= (const Filter& f)
 	{
 		Filters_ << f.Filters_;
@@ -18,6 +18,7 @@
 
 #pragma once
 
+#include <memory>
 #include <QMetaType>
 #include <QStringList>
 #include <QDateTime>
@@ -102,6 +103,16 @@ namespace CleanWeb
 	QDataStream& operator<< (QDataStream&, const FilterItem&);
 	QDataStream& operator>> (QDataStream&, FilterItem&);
 
+	/** Checks whether the item matches the given URL from the given
+	 * domain. The URL should be lowercased if the item is case
+	 * insensitive, and urlUtf8 should be its UTF-8 representation.
+	 */
+	bool Matches (const FilterItem& item, const QString& url,
+			const QByteArray& urlUtf8, const QString& domain);
+
+	class FilterIndex;
+	typedef std::shared_ptr<const FilterIndex> FilterIndex_ptr;
+
 	struct Filter
 	{
 		QList<FilterItem> Filters_;
@@ -109,6 +120,13 @@ namespace CleanWeb
 
 		SubscriptionData SD_;
 
+		/** The request filtering rules, indexed for matching. If these
+		 * are set, Filters_ and Exceptions_ contain only the element
+		 * hiding rules.
+		 */
+		FilterIndex_ptr FiltersIndex_;
+		FilterIndex_ptr ExceptionsIndex_;
+
 		Filter& operator+= (const Filter&);
 	};
 }
@@ -0,0 +1,277 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "filtercache.h"
+#include <algorithm>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDataStream>
+#include <QCryptographicHash>
+#include <QTextCodec>
+#include <QtDebug>
+#include "filterindex.h"
+#include "lineparser.h"
+
+namespace LeechCraft
+{
+namespace Poshuku
+{
+namespace CleanWeb
+{
+namespace FilterCache
+{
+	namespace
+	{
+		const quint32 Magic = 0x43574643;
+		const quint32 Version = 1;
+
+		/** The header has a fixed size, so it can be updated in place
+		 * when only the source modification time changes.
+		 */
+		struct SourceInfo
+		{
+			qint64 Size_;
+			qint64 Modified_;
+			QByteArray Hash_;
+		};
+
+		QString GetCachePath (const QString& filename, const QDir& cacheDir)
+		{
+			return cacheDir.filePath (filename + ".bin");
+		}
+
+		QByteArray GetHash (const QByteArray& data)
+		{
+			return QCryptographicHash::hash (data, QCryptographicHash::Sha1);
+		}
+
+		void WriteHeader (QDataStream& out, const SourceInfo& info)
+		{
+			out << Magic
+				<< Version
+				<< info.Size_
+				<< info.Modified_
+				<< info.Hash_;
+		}
+
+		bool ReadHeader (QDataStream& in, SourceInfo& info)
+		{
+			quint32 magic = 0;
+			quint32 version = 0;
+			in >> magic >> version;
+			if (magic != Magic || version != Version)
+				return false;
+
+			in >> info.Size_
+				>> info.Modified_
+				>> info.Hash_;
+			return in.status () == QDataStream::Ok;
+		}
+
+		Filter Parse (const QByteArray& contents)
+		{
+			const auto& data = QTextCodec::codecForName ("UTF-8")->toUnicode (contents);
+			QStringList rawLines = data.split ('\n', QString::SkipEmptyParts);
+			if (rawLines.size ())
+				rawLines.removeAt (0);
+			QStringList lines;
+			std::transform (rawLines.begin (), rawLines.end (),
+					std::back_inserter (lines),
+					[] (const QString& t) { return t.trimmed (); });
+
+			Filter parsed;
+			std::for_each (lines.begin (), lines.end (), LineParser (&parsed));
+
+			Filter result;
+			QList<FilterItem> filters;
+			QList<FilterItem> exceptions;
+			for (const auto& item : parsed.Filters_)
+				(item.Option_.HideSelector_.isEmpty () ? filters : result.Filters_) << item;
+			for (const auto& item : parsed.Exceptions_)
+				(item.Option_.HideSelector_.isEmpty () ? exceptions : result.Exceptions_) << item;
+
+			auto filtersIndex = std::make_shared<FilterIndex> ();
+			filtersIndex->Build (filters);
+			result.FiltersIndex_ = filtersIndex;
+
+			auto exceptionsIndex = std::make_shared<FilterIndex> ();
+			exceptionsIndex->Build (exceptions);
+			result.ExceptionsIndex_ = exceptionsIndex;
+
+			return result;
+		}
+
+		bool LoadCompiled (const QString& cachePath, const QFileInfo& source, Filter& filter)
+		{
+			QFile file (cachePath);
+			if (!file.exists () || !file.open (QIODevice::ReadWrite))
+				return false;
+
+			const auto size = file.size ();
+			const auto data = file.map (0, size);
+			if (!data)
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "unable to map"
+						<< cachePath
+						<< file.errorString ();
+				return false;
+			}
+
+			const auto& bytes = QByteArray::fromRawData (reinterpret_cast<const char*> (data), size);
+			QDataStream in (bytes);
+			in.setVersion (QDataStream::Qt_4_6);
+
+			SourceInfo info;
+			if (!ReadHeader (in, info) || info.Size_ != source.size ())
+			{
+				file.unmap (data);
+				return false;
+			}
+
+			// The subscriptions are often downloaded again without any
+			// changes, so check the contents before parsing them anew.
+			const auto modified = source.lastModified ().toMSecsSinceEpoch ();
+			const bool touched = info.Modified_ != modified;
+			if (touched)
+			{
+				QFile sourceFile (source.absoluteFilePath ());
+				if (!sourceFile.open (QIODevice::ReadOnly) ||
+						GetHash (sourceFile.readAll ()) != info.Hash_)
+				{
+					file.unmap (data);
+					return false;
+				}
+			}
+
+			Filter result;
+			auto filtersIndex = std::make_shared<FilterIndex> ();
+			auto exceptionsIndex = std::make_shared<FilterIndex> ();
+			in >> result.Filters_
+				>> result.Exceptions_
+				>> *filtersIndex
+				>> *exceptionsIndex;
+			file.unmap (data);
+
+			if (in.status () != QDataStream::Ok)
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "corrupted compiled subscription"
+						<< cachePath;
+				return false;
+			}
+
+			if (touched)
+			{
+				info.Modified_ = modified;
+				file.seek (0);
+				QDataStream out (&file);
+				out.setVersion (QDataStream::Qt_4_6);
+				WriteHeader (out, info);
+			}
+
+			result.FiltersIndex_ = filtersIndex;
+			result.ExceptionsIndex_ = exceptionsIndex;
+			filter = result;
+			return true;
+		}
+
+		void SaveCompiled (const QString& cachePath, const SourceInfo& info, const Filter& filter)
+		{
+			QFile file (cachePath + ".tmp");
+			if (!file.open (QIODevice::WriteOnly))
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "unable to open"
+						<< file.fileName ()
+						<< file.errorString ();
+				return;
+			}
+
+			QDataStream out (&file);
+			out.setVersion (QDataStream::Qt_4_6);
+			WriteHeader (out, info);
+			out << filter.Filters_
+				<< filter.Exceptions_
+				<< *filter.FiltersIndex_
+				<< *filter.ExceptionsIndex_;
+			file.close ();
+
+			if (out.status () != QDataStream::Ok)
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "unable to write"
+						<< file.fileName ();
+				file.remove ();
+				return;
+			}
+
+			QFile::remove (cachePath);
+			if (!file.rename (cachePath))
+				qWarning () << Q_FUNC_INFO
+						<< "unable to rename"
+						<< file.fileName ()
+						<< "to"
+						<< cachePath
+						<< file.errorString ();
+		}
+	}
+
+	Filter Load (const QString& path, const QDir& cacheDir)
+	{
+		const QFileInfo source (path);
+		const auto& cachePath = GetCachePath (source.fileName (), cacheDir);
+
+		Filter filter;
+		if (!LoadCompiled (cachePath, source, filter))
+		{
+			QFile file (path);
+			if (!file.open (QIODevice::ReadOnly))
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "could not open file"
+						<< path
+						<< file.errorString ();
+				return Filter ();
+			}
+
+			const auto& contents = file.readAll ();
+			filter = Parse (contents);
+
+			const SourceInfo info
+			{
+				contents.size (),
+				source.lastModified ().toMSecsSinceEpoch (),
+				GetHash (contents)
+			};
+			SaveCompiled (cachePath, info, filter);
+		}
+
+		filter.SD_.Filename_ = source.fileName ();
+		return filter;
+	}
+
+	void Remove (const QString& filename, const QDir& cacheDir)
+	{
+		QFile::remove (GetCachePath (filename, cacheDir));
+	}
+}
+}
+}
+}
@@ -0,0 +1,59 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#pragma once
+
+#include "filter.h"
+
+class QDir;
+
+namespace LeechCraft
+{
+namespace Poshuku
+{
+namespace CleanWeb
+{
+	/** Keeps the parsed and indexed subscriptions on disk, so that
+	 * they are parsed only when they actually change.
+	 *
+	 * A compiled subscription is checked against the size, the
+	 * modification time and, if the latter differs, the contents hash
+	 * of its source file. It is read from a memory-mapped file.
+	 *
+	 * These functions don't touch any GUI or Core state and may be
+	 * called from any thread.
+	 */
+	namespace FilterCache
+	{
+		/** Returns the subscription from the file at the given path,
+		 * loading its compiled representation from the cacheDir or
+		 * parsing and compiling it if there is no valid one.
+		 *
+		 * The returned filter has an empty SD_.Filename_ if the
+		 * subscription couldn't be loaded.
+		 */
+		Filter Load (const QString& path, const QDir& cacheDir);
+
+		/** Removes the compiled representation of the subscription
+		 * with the given file name.
+		 */
+		void Remove (const QString& filename, const QDir& cacheDir);
+	}
+}
+}
+}
@@ -0,0 +1,308 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "filterindex.h"
+#include <algorithm>
+#include <QDataStream>
+#include <QtDebug>
+
+namespace LeechCraft
+{
+namespace Poshuku
+{
+namespace CleanWeb
+{
+	namespace
+	{
+		bool IsTokenChar (QChar c)
+		{
+			const auto u = c.unicode ();
+			return (u >= 'a' && u <= 'z') ||
+					(u >= 'A' && u <= 'Z') ||
+					(u >= '0' && u <= '9') ||
+					u == '%';
+		}
+
+		/** A single element of a pattern: a literal character, or
+		 * something that may match any character, or something that
+		 * matches only non-token characters.
+		 */
+		struct Atom
+		{
+			enum class Type
+			{
+				Literal,
+				Any,
+				Separator
+			} Type_;
+
+			QChar Char_;
+		};
+
+		/** Splits the pattern into atoms. Returns false if the
+		 * pattern is too complex to tell which literals are required
+		 * to be present in the matching URLs.
+		 */
+		bool Atomize (const QString& pattern, FilterOption::MatchType type, QList<Atom>& atoms)
+		{
+			const auto size = pattern.size ();
+			switch (type)
+			{
+			case FilterOption::MTPlain:
+			case FilterOption::MTBegin:
+			case FilterOption::MTEnd:
+				for (const auto c : pattern)
+					atoms.append (Atom { Atom::Type::Literal, c });
+				return true;
+			case FilterOption::MTWildcard:
+				for (int i = 0; i < size; ++i)
+				{
+					const auto c = pattern.at (i);
+					if (c == '*' || c == '?')
+						atoms.append (Atom { Atom::Type::Any, c });
+					else if (c == '[')
+						return false;
+					else if (c == '\\' && i + 1 < size)
+						atoms.append (Atom { Atom::Type::Literal, pattern.at (++i) });
+					else
+						atoms.append (Atom { Atom::Type::Literal, c });
+				}
+				return true;
+			case FilterOption::MTRegexp:
+			{
+				// These are what LineParser produces for the ^-rules.
+				const QString sepClass ("[^a-zA-Z0-9_\\.%-]");
+				const QString specials ("()[]{}|+*?\\^$");
+
+				for (int i = 0; i < size; )
+				{
+					const auto c = pattern.at (i);
+					if (pattern.midRef (i, sepClass.size ()) == sepClass)
+					{
+						atoms.append (Atom { Atom::Type::Separator, c });
+						i += sepClass.size ();
+					}
+					else if (pattern.midRef (i, 2) == QLatin1String ("\\?"))
+					{
+						atoms.append (Atom { Atom::Type::Literal, QChar ('?') });
+						i += 2;
+					}
+					else if (pattern.midRef (i, 2) == QLatin1String (".*"))
+					{
+						atoms.append (Atom { Atom::Type::Any, c });
+						i += 2;
+					}
+					else if (c == '.')
+					{
+						atoms.append (Atom { Atom::Type::Any, c });
+						++i;
+					}
+					else if (specials.contains (c))
+						return false;
+					else
+					{
+						atoms.append (Atom { Atom::Type::Literal, c });
+						++i;
+					}
+				}
+				return true;
+			}
+			}
+
+			return false;
+		}
+
+		/** Returns the lowercased tokens of the item's pattern that
+		 * are guaranteed to be whole tokens of any URL it matches.
+		 */
+		QList<QByteArray> GetTokens (const FilterItem& item)
+		{
+			const auto type = item.Option_.MatchType_;
+
+			QList<Atom> atoms;
+			if (!Atomize (QString::fromUtf8 (item.OrigString_), type, atoms))
+				return QList<QByteArray> ();
+
+			// Wildcards are matched against the whole URL.
+			const bool anchoredLeft = type == FilterOption::MTBegin || type == FilterOption::MTWildcard;
+			const bool anchoredRight = type == FilterOption::MTEnd || type == FilterOption::MTWildcard;
+
+			auto isTokenAtom = [&atoms] (int i)
+			{
+				const auto& atom = atoms.at (i);
+				return atom.Type_ == Atom::Type::Literal && IsTokenChar (atom.Char_);
+			};
+			auto isBoundary = [&atoms] (int i)
+			{
+				const auto& atom = atoms.at (i);
+				return atom.Type_ == Atom::Type::Separator ||
+						(atom.Type_ == Atom::Type::Literal && !IsTokenChar (atom.Char_));
+			};
+
+			QList<QByteArray> result;
+			for (int i = 0, size = atoms.size (); i < size; )
+			{
+				if (!isTokenAtom (i))
+				{
+					++i;
+					continue;
+				}
+
+				const int start = i;
+				QString token;
+				for ( ; i < size && isTokenAtom (i); ++i)
+					token += atoms.at (i).Char_;
+
+				const bool leftBound = start ? isBoundary (start - 1) : anchoredLeft;
+				const bool rightBound = i < size ? isBoundary (i) : anchoredRight;
+				if (leftBound && rightBound)
+					result << token.toLower ().toLatin1 ();
+			}
+			return result;
+		}
+	}
+
+	void FilterIndex::Build (const QList<FilterItem>& items)
+	{
+		Items_.clear ();
+		ByToken_.clear ();
+		ByDomain_.clear ();
+		Generic_.clear ();
+
+		Items_.reserve (items.size ());
+
+		QVector<QList<QByteArray>> itemsTokens;
+		itemsTokens.reserve (items.size ());
+
+		QHash<QByteArray, int> frequencies;
+		for (const auto& item : items)
+		{
+			Items_ << item;
+			itemsTokens << GetTokens (item);
+			for (const auto& token : itemsTokens.last ())
+				++frequencies [token];
+		}
+
+		for (int i = 0; i < Items_.size (); ++i)
+		{
+			const auto& tokens = itemsTokens.at (i);
+			if (!tokens.isEmpty ())
+			{
+				const auto& rarest = *std::min_element (tokens.begin (), tokens.end (),
+						[&frequencies] (const QByteArray& left, const QByteArray& right)
+						{
+							const auto leftFreq = frequencies.value (left);
+							const auto rightFreq = frequencies.value (right);
+							return leftFreq < rightFreq ||
+									(leftFreq == rightFreq && left.size () > right.size ());
+						});
+				ByToken_ [rarest] << i;
+				continue;
+			}
+
+			const auto& domains = Items_.at (i).Option_.Domains_;
+			if (!domains.isEmpty ())
+			{
+				for (const auto& domain : domains)
+					ByDomain_ [domain.toLower ()] << i;
+				continue;
+			}
+
+			Generic_ << i;
+		}
+	}
+
+	FilterIndex::Stats FilterIndex::GetStats () const
+	{
+		return { Items_.size (), ByToken_.size (), ByDomain_.size (), Generic_.size () };
+	}
+
+	FilterIndex::Query FilterIndex::MakeQuery (const QString& url, const QString& domain)
+	{
+		Query query;
+
+		for (int i = 0, size = url.size (); i < size; )
+		{
+			if (!IsTokenChar (url.at (i)))
+			{
+				++i;
+				continue;
+			}
+
+			const int start = i;
+			while (i < size && IsTokenChar (url.at (i)))
+				++i;
+
+			const auto& token = url.mid (start, i - start).toLower ().toLatin1 ();
+			if (!query.Tokens_.contains (token))
+				query.Tokens_ << token;
+		}
+
+		// Domain options are matched by QString::endsWith(), so
+		// every suffix should be looked up, not just whole labels.
+		const auto& lowerDomain = domain.toLower ();
+		for (int i = 0; i < lowerDomain.size (); ++i)
+			query.DomainSuffixes_ << lowerDomain.mid (i);
+
+		return query;
+	}
+
+	QDataStream& operator<< (QDataStream& out, const FilterIndex& index)
+	{
+		out << static_cast<quint8> (1)
+			<< index.Items_
+			<< index.ByToken_
+			<< index.ByDomain_
+			<< index.Generic_;
+		return out;
+	}
+
+	QDataStream& operator>> (QDataStream& in, FilterIndex& index)
+	{
+		quint8 version = 0;
+		in >> version;
+		if (version != 1)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unknown version"
+					<< version;
+			in.setStatus (QDataStream::ReadCorruptData);
+			return in;
+		}
+
+		in >> index.Items_
+			>> index.ByToken_
+			>> index.ByDomain_
+			>> index.Generic_;
+
+		const auto size = index.Items_.size ();
+		auto isValid = [size] (const QVector<int>& bucket)
+		{
+			return std::all_of (bucket.begin (), bucket.end (),
+					[size] (int idx) { return idx >= 0 && idx < size; });
+		};
+		if (!isValid (index.Generic_) ||
+				!std::all_of (index.ByToken_.begin (), index.ByToken_.end (), isValid) ||
+				!std::all_of (index.ByDomain_.begin (), index.ByDomain_.end (), isValid))
+			in.setStatus (QDataStream::ReadCorruptData);
+
+		return in;
+	}
+}
+}
+}
@@ -0,0 +1,129 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#pragma once
+
+#include <QVector>
+#include <QHash>
+#include <QStringList>
+#include "filter.h"
+
+namespace LeechCraft
+{
+namespace Poshuku
+{
+namespace CleanWeb
+{
+	/** Indexes filter items so that only a small subset of them has to
+	 * be checked against any given URL.
+	 *
+	 * Each item goes to exactly one bucket:
+	 * - If its pattern has literal tokens (runs of [a-z0-9%]) that are
+	 *   guaranteed to be whole tokens of any matching URL, it goes to
+	 *   the bucket of the rarest one of them.
+	 * - Otherwise, if it is restricted to some domains, it goes to the
+	 *   buckets of these domains.
+	 * - Otherwise it is generic and is checked against every URL.
+	 *
+	 * The index doesn't check whether the items actually match, it
+	 * just enumerates the candidates.
+	 */
+	class FilterIndex
+	{
+		friend QDataStream& operator<< (QDataStream&, const FilterIndex&);
+		friend QDataStream& operator>> (QDataStream&, FilterIndex&);
+
+		QVector<FilterItem> Items_;
+
+		QHash<QByteArray, QVector<int>> ByToken_;
+		QHash<QString, QVector<int>> ByDomain_;
+		QVector<int> Generic_;
+	public:
+		struct Query
+		{
+			/** The distinct tokens of the lowercased URL.
+			 */
+			QList<QByteArray> Tokens_;
+
+			/** All the suffixes of the lowercased domain.
+			 */
+			QStringList DomainSuffixes_;
+		};
+
+		struct Stats
+		{
+			int Items_;
+			int Tokens_;
+			int Domains_;
+			int Generic_;
+		};
+
+		/** Replaces the contents of the index with the given items.
+		 */
+		void Build (const QList<FilterItem>&);
+
+		Stats GetStats () const;
+
+		/** Prepares the URL and its domain for Find(). The same query
+		 * may be used with several indexes.
+		 */
+		static Query MakeQuery (const QString& url, const QString& domain);
+
+		/** Returns the first candidate item for which \em matches
+		 * returns true, or 0 if there is no such item.
+		 */
+		template<typename F>
+		const FilterItem* Find (const Query& query, F matches) const
+		{
+			auto check = [this, &matches] (const QVector<int>& bucket) -> const FilterItem*
+			{
+				for (const auto idx : bucket)
+				{
+					const auto& item = Items_.at (idx);
+					if (matches (item))
+						return &item;
+				}
+				return 0;
+			};
+
+			for (const auto& token : query.Tokens_)
+			{
+				const auto pos = ByToken_.constFind (token);
+				if (pos != ByToken_.constEnd ())
+					if (const auto item = check (*pos))
+						return item;
+			}
+
+			if (!ByDomain_.isEmpty ())
+				for (const auto& suffix : query.DomainSuffixes_)
+				{
+					const auto pos = ByDomain_.constFind (suffix);
+					if (pos != ByDomain_.constEnd ())
+						if (const auto item = check (*pos))
+							return item;
+				}
+
+			return check (Generic_);
+		}
+	};
+
+	QDataStream& operator<< (QDataStream&, const FilterIndex&);
+	QDataStream& operator>> (QDataStream&, FilterIndex&);
+}
+}
+}
@@ -191,12 +191,13 @@ namespace CleanWeb
 			const auto& itemRx = f.MatchType_ == FilterOption::MTRegexp ?
 					RegExp (actualLine, f.Case_) :
 					RegExp ();
+			const auto& origString = (f.Case_ == Qt::CaseSensitive ? actualLine : actualLine.toLower ()).toUtf8 ();
 			const QByteArrayMatcher matcher = f.MatchType_ == FilterOption::MTPlain ?
-					QByteArrayMatcher (actualLine.toUtf8 ()) :
+					QByteArrayMatcher (origString) :
 					QByteArrayMatcher ();
 			const FilterItem item
 			{
-				(f.Case_ == Qt::CaseSensitive ? actualLine : actualLine.toLower ()).toUtf8 (),
+				origString,
 				itemRx,
 				matcher,
 				f
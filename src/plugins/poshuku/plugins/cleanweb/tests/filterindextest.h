@@ -0,0 +1,264 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+
+#include <algorithm>
+#include <functional>
+#include <QObject>
+#include <QtTest>
+#include <QFile>
+#include <QUrl>
+#include <QElapsedTimer>
+#include <QTextCodec>
+#include "../filter.h"
+#include "../filterindex.h"
+#include "../lineparser.h"
+
+using namespace LeechCraft::Poshuku::CleanWeb;
+
+/** Checks that the filter index finds the same filters as checking
+ * every one of them, and replays a corpus of URLs against filter lists
+ * reporting per-request latencies.
+ *
+ * The benchmark uses the filter lists from the colon-separated paths
+ * in the CLEANWEB_BENCH_FILTERS environment variable, and the URLs, one
+ * per line, from the file in CLEANWEB_BENCH_URLS. If these aren't set,
+ * synthetic lists and URLs are generated instead.
+ */
+class TestFilterIndex : public QObject
+{
+	Q_OBJECT
+
+	Filter Filter_;
+	QStringList URLs_;
+
+	FilterIndex FiltersIndex_;
+	FilterIndex ExceptionsIndex_;
+
+	static bool MatchesURL (const FilterItem& item, const QUrl& url, const QString& cinUrl)
+	{
+		const auto& urlStr = item.Option_.Case_ == Qt::CaseSensitive ? url.toString () : cinUrl;
+		return Matches (item, urlStr, urlStr.toUtf8 (), url.host ());
+	}
+
+	static void ParseLines (QStringList lines, Filter& filter)
+	{
+		for (auto& line : lines)
+			line = line.trimmed ();
+		std::for_each (lines.begin (), lines.end (), LineParser (&filter));
+	}
+
+	static QStringList ReadLines (const QString& path)
+	{
+		QFile file (path);
+		if (!file.open (QIODevice::ReadOnly))
+		{
+			qWarning () << "unable to open" << path << file.errorString ();
+			return QStringList ();
+		}
+
+		return QTextCodec::codecForName ("UTF-8")->toUnicode (file.readAll ())
+				.split ('\n', QString::SkipEmptyParts);
+	}
+
+	void GenerateSynthetic ()
+	{
+		qsrand (0);
+
+		QStringList rules;
+		for (int i = 0; i < 20000; ++i)
+			switch (i % 8)
+			{
+			case 0:
+				rules << QString ("||adhost%1.example.net^").arg (i);
+				break;
+			case 1:
+				rules << QString ("/banner%1/*").arg (i);
+				break;
+			case 2:
+				rules << QString ("&adid=%1&").arg (i);
+				break;
+			case 3:
+				rules << QString ("|http://track%1.").arg (i);
+				break;
+			case 4:
+				rules << QString ("-ad%1.gif|").arg (i);
+				break;
+			case 5:
+				rules << QString ("/pixel%1.$image,domain=site%1.com").arg (i);
+				break;
+			case 6:
+				rules << QString ("/promo_*_%1.").arg (i);
+				break;
+			case 7:
+				rules << QString ("@@||cdn%1.example.org^").arg (i);
+				break;
+			}
+		rules << "/ad[0-9]+\\.js/"
+				<< "/ads/"
+				<< "ads$domain=tracker.org";
+		ParseLines (rules, Filter_);
+
+		for (int i = 0; i < 5000; ++i)
+		{
+			const int n = qrand () % 20000;
+			switch (qrand () % 6)
+			{
+			case 0:
+				URLs_ << QString ("http://adhost%1.example.net/img.png").arg (n);
+				break;
+			case 1:
+				URLs_ << QString ("http://site%1.com/banner%2/top.gif").arg (n).arg (qrand ());
+				break;
+			case 2:
+				URLs_ << QString ("http://news.site%1.com/article?id=%2&adid=%1&x=1").arg (n).arg (qrand ());
+				break;
+			case 3:
+				URLs_ << QString ("http://cdn%1.example.org/lib/ad%2.js").arg (n).arg (qrand () % 10);
+				break;
+			case 4:
+				URLs_ << QString ("http://site%1.com/static/%2/main.css").arg (n).arg (qrand ());
+				break;
+			case 5:
+				URLs_ << QString ("http://track%1.example.com/pixel%1.gif").arg (n);
+				break;
+			}
+		}
+	}
+
+	bool IndexedRejects (const QString& urlStr) const
+	{
+		const QUrl url (urlStr);
+		const auto& cinUrl = urlStr.toLower ();
+		auto matches = [&url, &cinUrl] (const FilterItem& item) { return MatchesURL (item, url, cinUrl); };
+
+		const auto& query = FilterIndex::MakeQuery (cinUrl, url.host ());
+		return FiltersIndex_.Find (query, matches) && !ExceptionsIndex_.Find (query, matches);
+	}
+
+	bool LinearRejects (const QString& urlStr) const
+	{
+		const QUrl url (urlStr);
+		const auto& cinUrl = urlStr.toLower ();
+		auto matches = [&url, &cinUrl] (const FilterItem& item) { return MatchesURL (item, url, cinUrl); };
+
+		return std::any_of (Filter_.Filters_.begin (), Filter_.Filters_.end (), matches) &&
+				std::none_of (Filter_.Exceptions_.begin (), Filter_.Exceptions_.end (), matches);
+	}
+
+	static void ReportLatencies (const char *name, QVector<qint64> nsecs)
+	{
+		std::sort (nsecs.begin (), nsecs.end ());
+
+		auto percentile = [&nsecs] (double p)
+		{
+			const int idx = std::min<int> (nsecs.size () - 1, nsecs.size () * p);
+			return nsecs.at (idx) / 1000.;
+		};
+		qDebug () << name
+				<< "requests:" << nsecs.size ()
+				<< "p50:" << percentile (0.5) << "us"
+				<< "p90:" << percentile (0.9) << "us"
+				<< "p99:" << percentile (0.99) << "us"
+				<< "max:" << nsecs.last () / 1000. << "us";
+	}
+
+	QVector<qint64> Replay (std::function<bool (QString)> rejects, int *rejected) const
+	{
+		QVector<qint64> result;
+		result.reserve (URLs_.size ());
+
+		*rejected = 0;
+		QElapsedTimer timer;
+		for (const auto& url : URLs_)
+		{
+			timer.start ();
+			if (rejects (url))
+				++*rejected;
+			result << timer.nsecsElapsed ();
+		}
+		return result;
+	}
+private slots:
+	void initTestCase ()
+	{
+		const auto& filterPaths = qgetenv ("CLEANWEB_BENCH_FILTERS");
+		const auto& urlsPath = qgetenv ("CLEANWEB_BENCH_URLS");
+		if (filterPaths.isEmpty () || urlsPath.isEmpty ())
+			GenerateSynthetic ();
+		else
+		{
+			for (const auto& path : QString::fromLocal8Bit (filterPaths).split (':', QString::SkipEmptyParts))
+			{
+				auto lines = ReadLines (path);
+				if (!lines.isEmpty ())
+					lines.removeAt (0);
+				ParseLines (lines, Filter_);
+			}
+			for (const auto& line : ReadLines (QString::fromLocal8Bit (urlsPath)))
+				URLs_ << line.trimmed ();
+		}
+
+		QElapsedTimer timer;
+		timer.start ();
+		FiltersIndex_.Build (Filter_.Filters_);
+		ExceptionsIndex_.Build (Filter_.Exceptions_);
+
+		const auto& stats = FiltersIndex_.GetStats ();
+		qDebug () << "indexed"
+				<< stats.Items_
+				<< "filters and"
+				<< Filter_.Exceptions_.size ()
+				<< "exceptions in"
+				<< timer.elapsed ()
+				<< "ms;"
+				<< stats.Tokens_
+				<< "token buckets,"
+				<< stats.Domains_
+				<< "domain buckets,"
+				<< stats.Generic_
+				<< "generic filters";
+	}
+
+	void testIndexMatchesLinear ()
+	{
+		const int count = std::min (URLs_.size (), 2000);
+		for (int i = 0; i < count; ++i)
+		{
+			const auto& url = URLs_.at (i);
+			if (IndexedRejects (url) != LinearRejects (url))
+				QFAIL (qPrintable ("mismatch for " + url));
+		}
+	}
+
+	void perfReplayIndexed ()
+	{
+		int rejected = 0;
+		const auto& nsecs = Replay ([this] (const QString& url) { return IndexedRejects (url); }, &rejected);
+		ReportLatencies ("indexed:", nsecs);
+		qDebug () << "rejected" << rejected << "of" << URLs_.size ();
+	}
+
+	void perfReplayLinear ()
+	{
+		int rejected = 0;
+		const auto& nsecs = Replay ([this] (const QString& url) { return LinearRejects (url); }, &rejected);
+		ReportLatencies ("linear:", nsecs);
+		qDebug () << "rejected" << rejected << "of" << URLs_.size ();
+	}
+};
@@ -188,6 +188,7 @@ namespace CleanWeb
 		endInsertRows ();
 
 		WriteSettings ();
+		emit filtersChanged ();
 
 		return !dia.IsException ();
 	}
@@ -229,6 +230,7 @@ namespace CleanWeb
 			Filter_.Filters_.removeAt (pos);
 		endRemoveRows ();
 		WriteSettings ();
+		emit filtersChanged ();
 	}
 
 	void UserFiltersModel::AddMultiFilters (QStringList lines)
@@ -245,6 +247,7 @@ namespace CleanWeb
 			return;
 
 		WriteSettings ();
+		emit filtersChanged ();
 
 		emit gotEntity (Util::MakeNotification ("Poshuku CleanWeb",
 				tr ("Imported %1 user filters (%2 parsed successfully).")
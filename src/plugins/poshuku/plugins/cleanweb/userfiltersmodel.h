@@ -61,6 +61,7 @@ namespace CleanWeb
 		void blockImage ();
 	signals:
 		void gotEntity (const LeechCraft::Entity&);
+		void filtersChanged ();
 	};
 }
 }
@@ -170,18 +170,34 @@ namespace Poshuku
 				":url"
 				")");
 
-		HistoryEraser_ = QSqlQuery (DB_);
+		HistoryPageLoader_ = QSqlQuery (DB_);
 		switch (Type_)
 		{
 			case SBSQLite:
-				HistoryEraser_.prepare ("DELETE FROM history "
-						"WHERE "
-						"(julianday ('now') - julianday (date) > :age)");
+				HistoryPageLoader_.prepare ("SELECT "
+						"title, "
+						"MAX (date) AS last, "
+						"url "
+						"FROM history "
+						"WHERE date >= :from AND date < :to "
+						"AND ( title LIKE :titlefilter ESCAPE '\\' "
+						"OR url LIKE :urlfilter ESCAPE '\\' ) "
+						"GROUP BY url "
+						"ORDER BY last DESC "
+						"LIMIT :limit OFFSET :offset");
 				break;
 			case SBPostgres:
-				HistoryEraser_.prepare ("DELETE FROM history "
-						"WHERE "
-						"(date - now () > :age * interval '1 day')");
+				HistoryPageLoader_.prepare ("SELECT "
+						"MAX (title) AS title, "
+						"MAX (date) AS last, "
+						"url "
+						"FROM history "
+						"WHERE date >= :from AND date < :to "
+						"AND ( title ILIKE :titlefilter ESCAPE '\\' "
+						"OR url ILIKE :urlfilter ESCAPE '\\' ) "
+						"GROUP BY url "
+						"ORDER BY last DESC "
+						"LIMIT :limit OFFSET :offset");
 				break;
 			case SBMysql:
 				qWarning () << Q_FUNC_INFO
@@ -189,25 +205,8 @@ namespace Poshuku
 				break;
 		}
 
-		HistoryTruncater_ = QSqlQuery (DB_);
-		switch (Type_)
-		{
-			case SBSQLite:
-				HistoryTruncater_.prepare ("DELETE FROM history "
-						"WHERE date IN "
-						"(SELECT date FROM history ORDER BY date DESC "
-						"LIMIT 10000 OFFSET :num)");
-				break;
-			case SBPostgres:
-				HistoryTruncater_.prepare ("DELETE FROM history "
-						"WHERE date IN "
-						"	(SELECT date FROM history ORDER BY date DESC OFFSET :num)");
-				break;
-			case SBMysql:
-				qWarning () << Q_FUNC_INFO
-						<< "it's not MySQL";
-				break;
-		}
+		OldestHistoryGetter_ = QSqlQuery (DB_);
+		OldestHistoryGetter_.prepare ("SELECT MIN (date) FROM history");
 
 		FavoritesLoader_ = QSqlQuery (DB_);
 		switch (Type_)
@@ -294,6 +293,52 @@ namespace Poshuku
 		HistoryLoader_.finish ();
 	}
 
+	void SQLStorageBackend::LoadHistory (const QDateTime& from, const QDateTime& to,
+			const QString& filter, int offset, int count,
+			history_items_t& items) const
+	{
+		const QString& pattern = filter.isEmpty () ? "%" : filter;
+		HistoryPageLoader_.bindValue (":from", from);
+		HistoryPageLoader_.bindValue (":to", to);
+		HistoryPageLoader_.bindValue (":titlefilter", pattern);
+		HistoryPageLoader_.bindValue (":urlfilter", pattern);
+		HistoryPageLoader_.bindValue (":limit", count);
+		HistoryPageLoader_.bindValue (":offset", offset);
+		if (!HistoryPageLoader_.exec ())
+		{
+			LeechCraft::Util::DBLock::DumpError (HistoryPageLoader_);
+			return;
+		}
+
+		while (HistoryPageLoader_.next ())
+		{
+			HistoryItem item =
+			{
+				HistoryPageLoader_.value (0).toString (),
+				HistoryPageLoader_.value (1).toDateTime (),
+				HistoryPageLoader_.value (2).toString ()
+			};
+			items.push_back (item);
+		}
+
+		HistoryPageLoader_.finish ();
+	}
+
+	QDateTime SQLStorageBackend::GetOldestHistoryDate () const
+	{
+		if (!OldestHistoryGetter_.exec ())
+		{
+			LeechCraft::Util::DBLock::DumpError (OldestHistoryGetter_);
+			return QDateTime ();
+		}
+
+		QDateTime result;
+		if (OldestHistoryGetter_.next ())
+			result = OldestHistoryGetter_.value (0).toDateTime ();
+		OldestHistoryGetter_.finish ();
+		return result;
+	}
+
 	void SQLStorageBackend::LoadResemblingHistory (const QString& base,
 			history_items_t& items) const
 	{
@@ -338,23 +383,7 @@ namespace Poshuku
 
 	void SQLStorageBackend::ClearOldHistory (int age, int items)
 	{
-		LeechCraft::Util::DBLock lock (DB_);
-		lock.Init ();
-		HistoryEraser_.bindValue (":age", age);
-		HistoryTruncater_.bindValue (":num", items);
-
-		if (!HistoryEraser_.exec ())
-		{
-			LeechCraft::Util::DBLock::DumpError (HistoryEraser_);
-			return;
-		}
-		if (!HistoryTruncater_.exec ())
-		{
-			LeechCraft::Util::DBLock::DumpError (HistoryTruncater_);
-			return;
-		}
-
-		lock.Good ();
+		StartHistoryCleanup (HistoryCleaner::MakeParams (DB_, age, items));
 	}
 
 	void SQLStorageBackend::LoadFavorites (
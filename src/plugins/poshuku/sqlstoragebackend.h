@@ -55,13 +55,23 @@ namespace Poshuku
 					*/
 				HistoryAdder_,
 				/** Binds:
-					* - age
+					* - from
+					* - to
+					* - titlefilter
+					* - urlfilter
+					* - limit
+					* - offset
+					*
+					* Returns:
+					* - title
+					* - date
+					* - url
 					*/
-				HistoryEraser_,
-				/** Binds:
-					* - items
+				HistoryPageLoader_,
+				/** Returns:
+					* - date
 					*/
-				HistoryTruncater_,
+				OldestHistoryGetter_,
 				/** Returns:
 					* - title
 					* - url
@@ -103,6 +113,9 @@ namespace Poshuku
 		void Prepare ();
 
 		virtual void LoadHistory (history_items_t&) const;
+		virtual void LoadHistory (const QDateTime&, const QDateTime&,
+				const QString&, int, int, history_items_t&) const;
+		virtual QDateTime GetOldestHistoryDate () const;
 		virtual void LoadResemblingHistory (const QString&,
 				history_items_t&) const;
 		virtual void AddToHistory (const HistoryItem&);
@@ -93,16 +93,20 @@ namespace Poshuku
 				"? "
 				")");
 
-		HistoryEraser_ = QSqlQuery (DB_);
-		HistoryEraser_.prepare ("DELETE FROM history "
-				"WHERE "
-				" DATE_ADD(date, INTERVAL ? DAY) < now () )");
+		HistoryPageLoader_ = QSqlQuery (DB_);
+		HistoryPageLoader_.prepare ("SELECT "
+				"MAX(title) AS title, "
+				"MAX(date) AS last, "
+				"url "
+				"FROM history "
+				"WHERE date >= ? AND date < ? "
+				"AND ( title LIKE ? OR url LIKE ? ) "
+				"GROUP BY url "
+				"ORDER BY last DESC "
+				"LIMIT ? OFFSET ?");
 
-		HistoryTruncater_ = QSqlQuery (DB_);
-		HistoryTruncater_.prepare ("DELETE FROM history "
-				"WHERE date IN "
-				"(SELECT date FROM history ORDER BY date DESC "
-				"LIMIT 10000 OFFSET ?)");
+		OldestHistoryGetter_ = QSqlQuery (DB_);
+		OldestHistoryGetter_.prepare ("SELECT MIN(date) FROM history");
 
 		FavoritesLoader_ = QSqlQuery (DB_);
 		FavoritesLoader_.prepare ("SELECT "
@@ -172,6 +176,52 @@ namespace Poshuku
 		HistoryLoader_.finish ();
 	}
 
+	void SQLStorageBackendMysql::LoadHistory (const QDateTime& from, const QDateTime& to,
+			const QString& filter, int offset, int count,
+			history_items_t& items) const
+	{
+		const QString& pattern = filter.isEmpty () ? "%" : filter;
+		HistoryPageLoader_.bindValue (0, from);
+		HistoryPageLoader_.bindValue (1, to);
+		HistoryPageLoader_.bindValue (2, pattern);
+		HistoryPageLoader_.bindValue (3, pattern);
+		HistoryPageLoader_.bindValue (4, count);
+		HistoryPageLoader_.bindValue (5, offset);
+		if (!HistoryPageLoader_.exec ())
+		{
+			LeechCraft::Util::DBLock::DumpError (HistoryPageLoader_);
+			return;
+		}
+
+		while (HistoryPageLoader_.next ())
+		{
+			HistoryItem item =
+			{
+				HistoryPageLoader_.value (0).toString (),
+				HistoryPageLoader_.value (1).toDateTime (),
+				HistoryPageLoader_.value (2).toString ()
+			};
+			items.push_back (item);
+		}
+
+		HistoryPageLoader_.finish ();
+	}
+
+	QDateTime SQLStorageBackendMysql::GetOldestHistoryDate () const
+	{
+		if (!OldestHistoryGetter_.exec ())
+		{
+			LeechCraft::Util::DBLock::DumpError (OldestHistoryGetter_);
+			return QDateTime ();
+		}
+
+		QDateTime result;
+		if (OldestHistoryGetter_.next ())
+			result = OldestHistoryGetter_.value (0).toDateTime ();
+		OldestHistoryGetter_.finish ();
+		return result;
+	}
+
 	void SQLStorageBackendMysql::LoadResemblingHistory (const QString& base,
 			history_items_t& items) const
 	{
@@ -216,23 +266,7 @@ namespace Poshuku
 
 	void SQLStorageBackendMysql::ClearOldHistory (int age, int items)
 	{
-		LeechCraft::Util::DBLock lock (DB_);
-		lock.Init ();
-		HistoryEraser_.bindValue (0, age);
-		HistoryTruncater_.bindValue (1, items);
-
-		if (!HistoryEraser_.exec ())
-		{
-			LeechCraft::Util::DBLock::DumpError (HistoryEraser_);
-			return;
-		}
-		if (!HistoryTruncater_.exec ())
-		{
-			LeechCraft::Util::DBLock::DumpError (HistoryTruncater_);
-			return;
-		}
-
-		lock.Good ();
+		StartHistoryCleanup (HistoryCleaner::MakeParams (DB_, age, items));
 	}
 
 	void SQLStorageBackendMysql::LoadFavorites (
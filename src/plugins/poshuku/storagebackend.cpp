@@ -17,6 +17,10 @@
  **********************************************************************/
 
 #include "storagebackend.h"
+#include <functional>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
+#include <QtDebug>
 #include "sqlstoragebackend.h"
 #include "sqlstoragebackend_mysql.h"
 
@@ -26,6 +30,7 @@ namespace Poshuku
 {
 	StorageBackend::StorageBackend (QObject *parent)
 	: QObject (parent)
+	, CleanupRunning_ (false)
 	{
 	}
 	
@@ -47,5 +52,45 @@ namespace Poshuku
 		}
 		return result;
 	}
+
+	void StorageBackend::StartHistoryCleanup (const HistoryCleaner::Params& params)
+	{
+		if (CleanupRunning_)
+			return;
+
+		CleanupRunning_ = true;
+
+		auto watcher = new QFutureWatcher<int> (this);
+		connect (watcher,
+				SIGNAL (finished ()),
+				this,
+				SLOT (handleHistoryCleanupFinished ()));
+
+		std::function<int ()> worker = [params] { return HistoryCleaner::Run (params); };
+		watcher->setFuture (QtConcurrent::run (worker));
+	}
+
+	void StorageBackend::handleHistoryCleanupFinished ()
+	{
+		auto watcher = dynamic_cast<QFutureWatcher<int>*> (sender ());
+		if (!watcher)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "not a future watcher"
+					<< sender ();
+			return;
+		}
+		watcher->deleteLater ();
+
+		CleanupRunning_ = false;
+
+		const int removed = watcher->result ();
+		if (removed)
+			qDebug () << Q_FUNC_INFO
+					<< "removed"
+					<< removed
+					<< "history items";
+		emit historyCleaned (removed);
+	}
 }
 }
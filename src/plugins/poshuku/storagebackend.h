@@ -23,6 +23,7 @@
 #include "historymodel.h"
 #include "favoritesmodel.h"
 #include "pageformsdata.h"
+#include "historycleaner.h"
 
 namespace LeechCraft
 {
@@ -36,6 +37,8 @@ namespace Poshuku
 	class StorageBackend : public QObject
 	{
 		Q_OBJECT
+
+		bool CleanupRunning_;
 	public:
 		enum Type
 		{
@@ -65,6 +68,34 @@ namespace Poshuku
 			*/
 		virtual void LoadHistory (history_items_t& items) const = 0;
 
+		/** @brief Get a page of history items from the given period.
+			*
+			* Puts the history items (HistoryItem) visited in the
+			* [from; to) period into the passed container, one item per
+			* URL with the time of the latest visit, sorted by that time in
+			* descending order.
+			*
+			* @param[in] from The beginning of the period.
+			* @param[in] to The end of the period, not included.
+			* @param[in] filter The SQL LIKE pattern with backslash as
+			* the escape character that either the title or the URL of
+			* the item should match. Empty pattern matches everything.
+			* @param[in] offset The number of items to skip.
+			* @param[in] count The maximum number of items to load.
+			* @param[out] items The container with items. They would be
+			* appended to the container.
+			*/
+		virtual void LoadHistory (const QDateTime& from, const QDateTime& to,
+				const QString& filter, int offset, int count,
+				history_items_t& items) const = 0;
+
+		/** @brief Returns the date of the oldest history item.
+			*
+			* @return The date of the oldest history item, or a null
+			* QDateTime if the history is empty.
+			*/
+		virtual QDateTime GetOldestHistoryDate () const = 0;
+
 		/** @brief Get resembling history items from the storage.
 			*
 			* Puts resembling history items (HistoryItem) from the
@@ -91,8 +122,9 @@ namespace Poshuku
 
 		/** @brief Clears old history items.
 			*
-			* Removes all the history items that are older than days. Also
-			* removes items that are overlimit.
+			* Starts removing all the history items that are older than
+			* days and the items that are overlimit in a background thread
+			* and emits the historyCleaned() signal when done.
 			*
 			* @param[in] days Maximum age of an item.
 			* @param[in] items How much items should be kept at most.
@@ -150,7 +182,22 @@ namespace Poshuku
 			* @return Whether the page is ignored or not.
 			*/
 		virtual bool GetFormsIgnored (const QString& url) const = 0;
+	protected:
+		/** @brief Runs the history cleanup in a background thread.
+			*
+			* Does nothing if a cleanup is already running.
+			*/
+		void StartHistoryCleanup (const HistoryCleaner::Params&);
+	private slots:
+		void handleHistoryCleanupFinished ();
 	signals:
+		/** @brief Emitted when a cleanup started by ClearOldHistory()
+			* is finished.
+			*
+			* @param removed The number of removed items.
+			*/
+		void historyCleaned (int removed);
+
 		void added (const HistoryItem&);
 		void added (const FavoritesModel::FavoritesItem&);
 		void updated (const FavoritesModel::FavoritesItem&);
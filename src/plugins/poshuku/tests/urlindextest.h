@@ -0,0 +1,134 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+
+#include <algorithm>
+#include <QObject>
+#include <QtTest>
+#include <QElapsedTimer>
+#include "../urlindex.h"
+
+using namespace LeechCraft::Poshuku;
+
+/** Checks the matching and ranking of the URL completion index and
+ * measures its latency on a synthetic history.
+ */
+class TestURLIndex : public QObject
+{
+	Q_OBJECT
+
+	static QStringList GetURLs (const QList<URLIndex::Result>& results)
+	{
+		QStringList urls;
+		for (const auto& result : results)
+			urls << result.URL_;
+		return urls;
+	}
+private slots:
+	void testPrefixAndSubstring ()
+	{
+		URLIndex index;
+		const auto& now = QDateTime::currentDateTime ();
+		index.AddVisit ("http://github.com/", "GitHub", now);
+		index.AddVisit ("http://example.org/legit", "Some page", now);
+		index.AddVisit ("http://qt-project.org/doc/", "Qt Documentation", now);
+
+		QCOMPARE (GetURLs (index.Find ("gi", 10)), QStringList ("http://github.com/"));
+		QCOMPARE (GetURLs (index.Find ("git", 10)).size (), 2);
+		QCOMPARE (GetURLs (index.Find ("qt doc", 10)), QStringList ("http://qt-project.org/doc/"));
+		QCOMPARE (GetURLs (index.Find ("DOCUMENTATION", 10)), QStringList ("http://qt-project.org/doc/"));
+		QVERIFY (index.Find ("nonexistent", 10).isEmpty ());
+	}
+
+	void testFrecencyOrder ()
+	{
+		URLIndex index;
+		const auto& now = QDateTime::currentDateTime ();
+		index.AddVisit ("http://old.example.com/", "Old", now.addDays (-200));
+		index.AddVisit ("http://old.example.com/", "Old", now.addDays (-199));
+		index.AddVisit ("http://recent.example.com/", "Recent", now);
+		index.AddVisit ("http://often.example.com/", "Often", now.addDays (-1));
+		index.AddVisit ("http://often.example.com/", "Often", now);
+
+		const QStringList expected
+		{
+			"http://often.example.com/",
+			"http://recent.example.com/",
+			"http://old.example.com/"
+		};
+		QCOMPARE (GetURLs (index.Find ("example", 10)), expected);
+		QCOMPARE (GetURLs (index.Find ("example", 1)), QStringList (expected.first ()));
+
+		index.SetFavorite ("http://old.example.com/", QString (), true);
+		const QStringList withFavorite
+		{
+			"http://often.example.com/",
+			"http://old.example.com/",
+			"http://recent.example.com/"
+		};
+		QCOMPARE (GetURLs (index.Find ("example", 10)), withFavorite);
+
+		index.SetFavorite ("http://old.example.com/", QString (), false);
+		QCOMPARE (GetURLs (index.Find ("example", 10)), expected);
+	}
+
+	void testTitleUpdate ()
+	{
+		URLIndex index;
+		const auto& now = QDateTime::currentDateTime ();
+		index.AddVisit ("http://example.com/", "Loading", now);
+		index.AddVisit ("http://example.com/", "Welcome", now);
+
+		QCOMPARE (GetURLs (index.Find ("welcome", 10)), QStringList ("http://example.com/"));
+		QVERIFY (index.Find ("loading", 10).isEmpty ());
+	}
+
+	void perfSyntheticHistory ()
+	{
+		const QStringList words { "news", "mail", "video", "docs", "forum", "wiki",
+				"shop", "blog", "maps", "music", "photos", "search" };
+
+		URLIndex index;
+		const auto& now = QDateTime::currentDateTime ();
+		const int count = 100000;
+		for (int i = 0; i < count; ++i)
+		{
+			const auto& word = words.at (i % words.size ());
+			const auto& url = QString ("http://%1%2.example%3.com/page/%4")
+					.arg (word)
+					.arg (i % 97)
+					.arg (i % 13)
+					.arg (i);
+			index.AddVisit (url, word + " page " + QString::number (i), now.addSecs (-i * 60));
+		}
+		QCOMPARE (index.GetSize (), count);
+
+		const QStringList queries { "n", "ne", "new", "news", "news4", "mail page 12",
+				"example7", "page/9999", "wiki 5", "xyz" };
+		for (int round = 0; round < 20; ++round)
+			for (const auto& query : queries)
+				index.Find (query, 100);
+
+		const auto& stats = index.GetStats ();
+		qDebug () << "queries:" << stats.Queries_
+				<< "p50, ms:" << stats.P50_
+				<< "p90:" << stats.P90_
+				<< "p99:" << stats.P99_
+				<< "max:" << stats.Max_;
+	}
+};
@@ -19,6 +19,8 @@
 #include "urlcompletionmodel.h"
 #include <stdexcept>
 #include <QUrl>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
 #include <QtDebug>
 #include <util/defaulthookproxy.h>
 #include <interfaces/core/icoreproxy.h>
@@ -28,9 +30,25 @@ namespace LeechCraft
 {
 namespace Poshuku
 {
+	namespace
+	{
+		URLIndex BuildIndex (const history_items_t& history,
+				const FavoritesModel::items_t& favorites)
+		{
+			URLIndex index;
+			for (const auto& item : history)
+				index.AddVisit (item.URL_, item.Title_, item.DateTime_);
+			for (const auto& item : favorites)
+				index.SetFavorite (item.URL_, item.Title_, true);
+			return index;
+		}
+	}
+
 	URLCompletionModel::URLCompletionModel (QObject *parent)
 	: QAbstractItemModel (parent)
 	, Valid_ (false)
+	, IndexLoaded_ (false)
+	, IndexBuilding_ (false)
 	{
 	}
 
@@ -133,9 +151,99 @@ namespace Poshuku
 		}
 	}
 
-	void URLCompletionModel::handleItemAdded (const HistoryItem&)
+	void URLCompletionModel::handleItemAdded (const HistoryItem& item)
 	{
 		Valid_ = false;
+
+		UpdateIndex ([item] (URLIndex& index)
+				{ index.AddVisit (item.URL_, item.Title_, item.DateTime_); });
+	}
+
+	void URLCompletionModel::handleItemAdded (const FavoritesModel::FavoritesItem& item)
+	{
+		Valid_ = false;
+
+		UpdateIndex ([item] (URLIndex& index)
+				{ index.SetFavorite (item.URL_, item.Title_, true); });
+	}
+
+	void URLCompletionModel::handleItemUpdated (const FavoritesModel::FavoritesItem& item)
+	{
+		handleItemAdded (item);
+	}
+
+	void URLCompletionModel::handleItemRemoved (const FavoritesModel::FavoritesItem& item)
+	{
+		Valid_ = false;
+
+		UpdateIndex ([item] (URLIndex& index)
+				{ index.SetFavorite (item.URL_, item.Title_, false); });
+	}
+
+	void URLCompletionModel::loadIndex ()
+	{
+		if (IndexBuilding_)
+			return;
+
+		auto sb = Core::Instance ().GetStorageBackend ();
+		if (!sb)
+			return;
+
+		history_items_t history;
+		sb->LoadHistory (history);
+		FavoritesModel::items_t favorites;
+		sb->LoadFavorites (favorites);
+
+		IndexBuilding_ = true;
+
+		auto watcher = new QFutureWatcher<URLIndex> (this);
+		connect (watcher,
+				SIGNAL (finished ()),
+				this,
+				SLOT (handleIndexBuilt ()));
+
+		std::function<URLIndex ()> worker = [history, favorites]
+				{ return BuildIndex (history, favorites); };
+		watcher->setFuture (QtConcurrent::run (worker));
+	}
+
+	void URLCompletionModel::handleHistoryCleaned (int removed)
+	{
+		if (removed)
+			loadIndex ();
+	}
+
+	void URLCompletionModel::handleIndexBuilt ()
+	{
+		auto watcher = dynamic_cast<QFutureWatcher<URLIndex>*> (sender ());
+		if (!watcher)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "not a future watcher"
+					<< sender ();
+			return;
+		}
+		watcher->deleteLater ();
+
+		Index_ = watcher->result ();
+		for (const auto& update : PendingIndexUpdates_)
+			update (Index_);
+		PendingIndexUpdates_.clear ();
+
+		IndexBuilding_ = false;
+		IndexLoaded_ = true;
+
+		Valid_ = false;
+		if (!Base_.isEmpty ())
+			Populate ();
+	}
+
+	void URLCompletionModel::UpdateIndex (const std::function<void (URLIndex&)>& update)
+	{
+		if (IndexLoaded_)
+			update (Index_);
+		if (IndexBuilding_)
+			PendingIndexUpdates_ << update;
 	}
 
 	void URLCompletionModel::Populate ()
@@ -169,14 +277,20 @@ namespace Poshuku
 			}
 			else
 			{
-				try
-				{
-					Core::Instance ().GetStorageBackend ()->LoadResemblingHistory (Base_, Items_);
-				}
-				catch (const std::runtime_error& e)
+				// The results will be populated once the index is
+				// built.
+				if (!IndexLoaded_)
+					loadIndex ();
+
+				for (const auto& result : Index_.Find (Base_, 100))
 				{
-					qWarning () << Q_FUNC_INFO << e.what ();
-					Valid_ = false;
+					HistoryItem item =
+					{
+						result.Title_,
+						QDateTime (),
+						result.URL_
+					};
+					Items_.push_back (item);
 				}
 			}
 
@@ -18,10 +18,13 @@
 
 #ifndef PLUGINS_POSHUKU_URLCOMPLETIONMODEL_H
 #define PLUGINS_POSHUKU_URLCOMPLETIONMODEL_H
+#include <functional>
 #include <QAbstractItemModel>
 #include <interfaces/core/ihookproxy.h>
 #include <interfaces/poshuku/iurlcompletionmodel.h>
 #include "historymodel.h"
+#include "favoritesmodel.h"
+#include "urlindex.h"
 
 namespace LeechCraft
 {
@@ -36,6 +39,16 @@ namespace Poshuku
 		mutable bool Valid_;
 		mutable history_items_t Items_;
 		QString Base_;
+
+		URLIndex Index_;
+		bool IndexLoaded_;
+
+		/** Whether the index is being built in a background thread.
+		 * The changes made meanwhile are kept in PendingIndexUpdates_
+		 * and applied to the new index once it's ready.
+		 */
+		bool IndexBuilding_;
+		QList<std::function<void (URLIndex&)>> PendingIndexUpdates_;
 	public:
 		enum
 		{
@@ -58,6 +71,18 @@ namespace Poshuku
 	public slots:
 		void setBase (const QString&);
 		void handleItemAdded (const HistoryItem&);
+		void handleItemAdded (const FavoritesModel::FavoritesItem&);
+		void handleItemUpdated (const FavoritesModel::FavoritesItem&);
+		void handleItemRemoved (const FavoritesModel::FavoritesItem&);
+
+		/** Starts reloading the completion index from the storage
+		 * backend. The index is built in a background thread, and the
+		 * old one is used until the new one is ready.
+		 */
+		void loadIndex ();
+		void handleHistoryCleaned (int);
+	private slots:
+		void handleIndexBuilt ();
 	signals:
 		// Plugin API
 		void hookURLCompletionNewStringRequested (LeechCraft::IHookProxy_ptr proxy,
@@ -65,6 +90,7 @@ namespace Poshuku
 				const QString& string,
 				int historyItems);
 	private:
+		void UpdateIndex (const std::function<void (URLIndex&)>&);
 		void Populate ();
 	};
 }
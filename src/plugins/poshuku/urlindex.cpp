@@ -0,0 +1,423 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+
+#include "urlindex.h"
+#include <algorithm>
+#include <QElapsedTimer>
+#include <QtDebug>
+
+namespace LeechCraft
+{
+namespace Poshuku
+{
+	namespace
+	{
+		/** Only this many first characters of the URL are indexed, so
+		 * that long query strings don't bloat the trigram index.
+		 */
+		const int MaxIndexedURLLength = 256;
+
+		/** Only this many most recent visits are taken into account
+		 * when calculating the frecency.
+		 */
+		const int MaxSampledVisits = 10;
+
+		const double FavoriteBonus = 100;
+
+		/** If a query has more candidates than this, the entries are
+		 * scanned in the order of frecency until enough matches are
+		 * found instead.
+		 */
+		const int MaxCandidates = 2000;
+
+		const int LatencySamples = 256;
+
+		double GetVisitWeight (uint visit, uint now)
+		{
+			const int days = visit < now ? (now - visit) / 86400 : 0;
+			if (days <= 4)
+				return 100;
+			else if (days <= 14)
+				return 70;
+			else if (days <= 31)
+				return 50;
+			else if (days <= 90)
+				return 30;
+			else
+				return 10;
+		}
+
+		QStringList GetTokens (const QString& str)
+		{
+			QStringList result;
+
+			int start = -1;
+			for (int i = 0; i <= str.size (); ++i)
+			{
+				const bool isTokenChar = i < str.size () && str.at (i).isLetterOrNumber ();
+				if (isTokenChar && start < 0)
+					start = i;
+				else if (!isTokenChar && start >= 0)
+				{
+					result << str.mid (start, i - start);
+					start = -1;
+				}
+			}
+
+			result.sort ();
+			result.removeDuplicates ();
+			return result;
+		}
+
+		quint64 GetTrigram (const QChar *chars)
+		{
+			return (static_cast<quint64> (chars [0].unicode ()) << 32) |
+					(static_cast<quint64> (chars [1].unicode ()) << 16) |
+					chars [2].unicode ();
+		}
+
+		/** Words this short are looked up as token prefixes, since
+		 * they are contained in too many strings to be useful as
+		 * substrings.
+		 */
+		bool IsPrefixWord (const QString& word)
+		{
+			if (word.size () >= 3)
+				return false;
+
+			return std::all_of (word.begin (), word.end (),
+					[] (const QChar& c) { return c.isLetterOrNumber (); });
+		}
+
+		void AddPosting (QVector<int>& posting, int idx)
+		{
+			if (posting.isEmpty () || posting.last () != idx)
+				posting << idx;
+		}
+	}
+
+	URLIndex::URLIndex ()
+	: SortedTokensDirty_ (false)
+	, ByFrecencyDirty_ (false)
+	, Latencies_ (LatencySamples, 0)
+	, LatencyPos_ (0)
+	, QueriesCount_ (0)
+	{
+	}
+
+	void URLIndex::Clear ()
+	{
+		Entries_.clear ();
+		ByURL_.clear ();
+		SortedTokens_.clear ();
+		ByToken_.clear ();
+		ByTrigram_.clear ();
+		ByFrecency_.clear ();
+
+		// The entries are going to be added in bulk, so there is no
+		// point in keeping the order up to date until the next query.
+		ByFrecencyDirty_ = true;
+		SortedTokensDirty_ = true;
+	}
+
+	void URLIndex::AddVisit (const QString& url, const QString& title, const QDateTime& dt)
+	{
+		const int idx = GetEntry (url, title);
+		auto& entry = Entries_ [idx];
+
+		if (!title.isEmpty () && title != entry.Title_)
+		{
+			entry.Title_ = title;
+			IndexEntry (idx);
+		}
+
+		const auto visit = dt.toTime_t ();
+		const auto pos = std::lower_bound (entry.Visits_.begin (), entry.Visits_.end (),
+				visit, [] (uint left, uint right) { return left > right; });
+		entry.Visits_.insert (pos, visit);
+		if (entry.Visits_.size () > MaxSampledVisits)
+			entry.Visits_.resize (MaxSampledVisits);
+		++entry.VisitCount_;
+
+		UpdateFrecency (idx);
+	}
+
+	void URLIndex::SetFavorite (const QString& url, const QString& title, bool favorite)
+	{
+		if (!favorite && !ByURL_.contains (url))
+			return;
+
+		const int idx = GetEntry (url, title);
+		auto& entry = Entries_ [idx];
+		if (entry.IsFavorite_ == favorite)
+			return;
+
+		entry.IsFavorite_ = favorite;
+		UpdateFrecency (idx);
+	}
+
+	QList<URLIndex::Result> URLIndex::Find (const QString& query, int count) const
+	{
+		QElapsedTimer timer;
+		timer.start ();
+
+		const auto& words = query.toLower ().split (' ', QString::SkipEmptyParts);
+		if (words.isEmpty () || count <= 0)
+			return QList<Result> ();
+
+		EnsureSorted ();
+
+		auto finish = [this, &timer] (const std::vector<int>& indexes) -> QList<Result>
+		{
+			QList<Result> result;
+			for (const auto idx : indexes)
+			{
+				const auto& entry = Entries_ [idx];
+				result << Result { entry.Title_, entry.URL_ };
+			}
+			RecordLatency (timer.nsecsElapsed () / 1000000.);
+			return result;
+		};
+
+		// Pick the most selective word to enumerate the candidates.
+		QList<const QVector<int>*> bestPostings;
+		int bestSize = -1;
+		for (const auto& word : words)
+		{
+			QList<const QVector<int>*> postings;
+			int size = 0;
+			if (IsPrefixWord (word))
+			{
+				for (auto i = std::lower_bound (SortedTokens_.begin (), SortedTokens_.end (), word);
+						i != SortedTokens_.end () && i->startsWith (word); ++i)
+				{
+					const auto pos = ByToken_.constFind (*i);
+					postings << &*pos;
+					size += pos->size ();
+				}
+			}
+			else if (word.size () >= 3)
+			{
+				const QVector<int> *smallest = 0;
+				for (int i = 0; i + 3 <= word.size (); ++i)
+				{
+					const auto pos = ByTrigram_.constFind (GetTrigram (word.constData () + i));
+					if (pos == ByTrigram_.constEnd ())
+					{
+						smallest = 0;
+						break;
+					}
+					if (!smallest || pos->size () < smallest->size ())
+						smallest = &*pos;
+				}
+				if (smallest)
+				{
+					postings << smallest;
+					size = smallest->size ();
+				}
+			}
+			else
+				continue;
+
+			if (!size)
+				return finish (std::vector<int> ());
+
+			if (bestSize < 0 || size < bestSize)
+			{
+				bestSize = size;
+				bestPostings = postings;
+			}
+		}
+
+		std::vector<int> result;
+		if (bestSize < 0 || bestSize > MaxCandidates)
+		{
+			for (const auto idx : ByFrecency_)
+				if (Matches (Entries_ [idx], words))
+				{
+					result.push_back (idx);
+					if (static_cast<int> (result.size ()) >= count)
+						break;
+				}
+			return finish (result);
+		}
+
+		for (const auto posting : bestPostings)
+			result.insert (result.end (), posting->begin (), posting->end ());
+		std::sort (result.begin (), result.end ());
+		result.erase (std::unique (result.begin (), result.end ()), result.end ());
+		result.erase (std::remove_if (result.begin (), result.end (),
+					[this, &words] (int idx) { return !Matches (Entries_ [idx], words); }),
+				result.end ());
+
+		const auto& less = [this] (int left, int right) { return FrecencyLess (left, right); };
+		if (static_cast<int> (result.size ()) > count)
+		{
+			std::partial_sort (result.begin (), result.begin () + count, result.end (), less);
+			result.resize (count);
+		}
+		else
+			std::sort (result.begin (), result.end (), less);
+
+		return finish (result);
+	}
+
+	int URLIndex::GetSize () const
+	{
+		return Entries_.size ();
+	}
+
+	URLIndex::Stats URLIndex::GetStats () const
+	{
+		const int samples = std::min (QueriesCount_, LatencySamples);
+		if (!samples)
+			return { 0, 0, 0, 0, 0 };
+
+		std::vector<double> sorted (Latencies_.begin (), Latencies_.begin () + samples);
+		std::sort (sorted.begin (), sorted.end ());
+		auto percentile = [&sorted] (int p) { return sorted [(sorted.size () - 1) * p / 100]; };
+		return { QueriesCount_, percentile (50), percentile (90), percentile (99), sorted.back () };
+	}
+
+	int URLIndex::GetEntry (const QString& url, const QString& title)
+	{
+		const auto pos = ByURL_.constFind (url);
+		if (pos != ByURL_.constEnd ())
+			return *pos;
+
+		const int idx = Entries_.size ();
+		Entries_.push_back ({ title, url, QString (), QStringList (), 0, QVector<uint> (), false, 0 });
+		ByURL_ [url] = idx;
+		IndexEntry (idx);
+		return idx;
+	}
+
+	void URLIndex::IndexEntry (int idx)
+	{
+		auto& entry = Entries_ [idx];
+		entry.Haystack_ = (entry.Title_ + '\n' + entry.URL_.left (MaxIndexedURLLength)).toLower ();
+
+		// Postings of the previous title, if any, are left in place:
+		// the candidates are checked against the current haystack anyway.
+		entry.Tokens_ = GetTokens (entry.Haystack_);
+		for (const auto& token : entry.Tokens_)
+		{
+			auto& posting = ByToken_ [token];
+			if (posting.isEmpty ())
+				SortedTokensDirty_ = true;
+			AddPosting (posting, idx);
+		}
+
+		const auto chars = entry.Haystack_.constData ();
+		for (int i = 0; i + 3 <= entry.Haystack_.size (); ++i)
+			AddPosting (ByTrigram_ [GetTrigram (chars + i)], idx);
+	}
+
+	void URLIndex::UpdateFrecency (int idx)
+	{
+		const auto less = [this] (int left, int right) { return FrecencyLess (left, right); };
+
+		if (!ByFrecencyDirty_)
+		{
+			const auto pos = std::lower_bound (ByFrecency_.begin (), ByFrecency_.end (), idx, less);
+			if (pos != ByFrecency_.end () && *pos == idx)
+				ByFrecency_.erase (pos);
+		}
+
+		auto& entry = Entries_ [idx];
+		const auto now = QDateTime::currentDateTime ().toTime_t ();
+
+		double weights = 0;
+		for (const auto visit : entry.Visits_)
+			weights += GetVisitWeight (visit, now);
+		entry.Frecency_ = entry.Visits_.isEmpty () ?
+				0 :
+				entry.VisitCount_ * weights / entry.Visits_.size ();
+		if (entry.IsFavorite_)
+			entry.Frecency_ += FavoriteBonus;
+
+		if (!ByFrecencyDirty_)
+			ByFrecency_.insert (std::lower_bound (ByFrecency_.begin (), ByFrecency_.end (), idx, less), idx);
+	}
+
+	bool URLIndex::FrecencyLess (int left, int right) const
+	{
+		const auto lf = Entries_ [left].Frecency_;
+		const auto rf = Entries_ [right].Frecency_;
+		return lf != rf ? lf > rf : left < right;
+	}
+
+	void URLIndex::EnsureSorted () const
+	{
+		if (SortedTokensDirty_)
+		{
+			SortedTokens_ = ByToken_.keys ();
+			SortedTokens_.sort ();
+			SortedTokensDirty_ = false;
+		}
+
+		if (ByFrecencyDirty_)
+		{
+			ByFrecency_.resize (Entries_.size ());
+			for (size_t i = 0; i < Entries_.size (); ++i)
+				ByFrecency_ [i] = i;
+			std::sort (ByFrecency_.begin (), ByFrecency_.end (),
+					[this] (int left, int right) { return FrecencyLess (left, right); });
+			ByFrecencyDirty_ = false;
+		}
+	}
+
+	bool URLIndex::Matches (const Entry& entry, const QStringList& words) const
+	{
+		for (const auto& word : words)
+			if (IsPrefixWord (word))
+			{
+				const auto pos = std::lower_bound (entry.Tokens_.begin (), entry.Tokens_.end (), word);
+				if (pos == entry.Tokens_.end () || !pos->startsWith (word))
+					return false;
+			}
+			else if (!entry.Haystack_.contains (word))
+				return false;
+
+		return true;
+	}
+
+	void URLIndex::RecordLatency (double ms) const
+	{
+		Latencies_ [LatencyPos_] = ms;
+		LatencyPos_ = (LatencyPos_ + 1) % LatencySamples;
+
+		if (++QueriesCount_ % LatencySamples)
+			return;
+
+		const auto& stats = GetStats ();
+		qDebug () << Q_FUNC_INFO
+				<< "URL completion latency over the last"
+				<< LatencySamples
+				<< "queries, ms: p50"
+				<< stats.P50_
+				<< "p90"
+				<< stats.P90_
+				<< "p99"
+				<< stats.P99_
+				<< "max"
+				<< stats.Max_;
+	}
+}
+}
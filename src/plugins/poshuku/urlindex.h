@@ -0,0 +1,144 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+
+#ifndef PLUGINS_POSHUKU_URLINDEX_H
+#define PLUGINS_POSHUKU_URLINDEX_H
+#include <vector>
+#include <QHash>
+#include <QStringList>
+#include <QDateTime>
+#include <QVector>
+
+namespace LeechCraft
+{
+namespace Poshuku
+{
+	/** In-memory index of the visited and bookmarked URLs used for
+	 * completion in the address bar.
+	 *
+	 * Each URL is indexed by the tokens (runs of letters and digits)
+	 * of its title and address, and by the trigrams of the lowercased
+	 * title and address. A query matches an entry if each of its words
+	 * either is a prefix of some token of the entry, for words shorter
+	 * than three characters, or is contained in its title or address.
+	 *
+	 * The matching entries are ranked by frecency, which combines the
+	 * number of visits with how recent they are, bookmarked entries
+	 * getting an additional bonus.
+	 */
+	class URLIndex
+	{
+	public:
+		struct Result
+		{
+			QString Title_;
+			QString URL_;
+		};
+
+		struct Stats
+		{
+			int Queries_;
+			double P50_;
+			double P90_;
+			double P99_;
+			double Max_;
+		};
+	private:
+		struct Entry
+		{
+			QString Title_;
+			QString URL_;
+
+			/** Lowercased title and URL separated by a newline.
+			 */
+			QString Haystack_;
+
+			/** Sorted distinct tokens of the Haystack_.
+			 */
+			QStringList Tokens_;
+
+			int VisitCount_;
+
+			/** Times of the most recent visits, newest first.
+			 */
+			QVector<uint> Visits_;
+
+			bool IsFavorite_;
+
+			double Frecency_;
+		};
+		std::vector<Entry> Entries_;
+		QHash<QString, int> ByURL_;
+
+		/** Sorted distinct tokens of all entries along with the
+		 * entries containing them, for prefix lookups.
+		 */
+		mutable QStringList SortedTokens_;
+		mutable bool SortedTokensDirty_;
+		QHash<QString, QVector<int>> ByToken_;
+
+		QHash<quint64, QVector<int>> ByTrigram_;
+
+		/** Entry indexes in the order of descending frecency.
+		 */
+		mutable std::vector<int> ByFrecency_;
+		mutable bool ByFrecencyDirty_;
+
+		mutable QVector<double> Latencies_;
+		mutable int LatencyPos_;
+		mutable int QueriesCount_;
+	public:
+		URLIndex ();
+
+		void Clear ();
+
+		/** Records a visit to the given URL at the given time. The
+		 * title replaces the stored one unless it's empty.
+		 */
+		void AddVisit (const QString& url, const QString& title, const QDateTime& dt);
+
+		/** Marks the given URL as bookmarked or not, adding it to the
+		 * index if needed.
+		 */
+		void SetFavorite (const QString& url, const QString& title, bool favorite);
+
+		/** Returns at most \em count entries matching the given
+		 * query, most frecent first.
+		 */
+		QList<Result> Find (const QString& query, int count) const;
+
+		int GetSize () const;
+
+		/** Returns the latency statistics over the recent queries,
+		 * in milliseconds.
+		 */
+		Stats GetStats () const;
+	private:
+		int GetEntry (const QString& url, const QString& title);
+		void IndexEntry (int);
+		void UpdateFrecency (int);
+		bool FrecencyLess (int, int) const;
+		void EnsureSorted () const;
+		bool Matches (const Entry&, const QStringList& words) const;
+		void RecordLatency (double) const;
+	};
+}
+}
+
+#endif
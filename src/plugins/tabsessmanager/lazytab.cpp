@@ -0,0 +1,102 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+
+#include "lazytab.h"
+#include <QVBoxLayout>
+#include <QLabel>
+
+namespace LeechCraft
+{
+namespace TabSessManager
+{
+	LazyTab::LazyTab (QObject *tsmPlugin, QObject *plugin, const RecInfo& info)
+	: TSMPlugin_ (tsmPlugin)
+	, Plugin_ (plugin)
+	, Info_ (info)
+	{
+		for (const auto& pair : Info_.Props_)
+			setProperty (pair.first, pair.second);
+
+		auto label = new QLabel (tr ("This tab will be loaded once activated."));
+		label->setAlignment (Qt::AlignCenter);
+
+		auto lay = new QVBoxLayout;
+		lay->addWidget (label);
+		setLayout (lay);
+	}
+
+	QObject* LazyTab::GetPlugin () const
+	{
+		return Plugin_;
+	}
+
+	const RecInfo& LazyTab::GetRecInfo () const
+	{
+		return Info_;
+	}
+
+	TabClassInfo LazyTab::GetTabClassInfo () const
+	{
+		return
+		{
+			"TabSessManager_LazyTab",
+			Info_.Name_,
+			tr ("A restored tab that is not loaded yet."),
+			Info_.Icon_,
+			0,
+			TFEmpty
+		};
+	}
+
+	QObject* LazyTab::ParentMultiTabs ()
+	{
+		return TSMPlugin_;
+	}
+
+	void LazyTab::Remove ()
+	{
+		emit removeRequested ();
+	}
+
+	QToolBar* LazyTab::GetToolBar () const
+	{
+		return 0;
+	}
+
+	void LazyTab::TabMadeCurrent ()
+	{
+		emit activated ();
+	}
+
+	QByteArray LazyTab::GetTabRecoverData () const
+	{
+		return Info_.Data_;
+	}
+
+	QString LazyTab::GetTabRecoverName () const
+	{
+		return Info_.Name_;
+	}
+
+	QIcon LazyTab::GetTabRecoverIcon () const
+	{
+		return Info_.Icon_;
+	}
+}
+}
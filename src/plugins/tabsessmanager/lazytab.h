@@ -0,0 +1,74 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2013  Georg Rudoy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+
+#ifndef PLUGINS_TABSESSMANAGER_LAZYTAB_H
+#define PLUGINS_TABSESSMANAGER_LAZYTAB_H
+#include <QWidget>
+#include <interfaces/ihavetabs.h>
+#include <interfaces/ihaverecoverabletabs.h>
+#include "recinfo.h"
+
+namespace LeechCraft
+{
+namespace TabSessManager
+{
+	/** A lightweight placeholder for a restored tab. It only knows the
+	 * title and the icon of the tab and its recover data, and asks the
+	 * plugin to create the real tab once it's activated.
+	 *
+	 * The placeholder is recoverable itself, so the sessions saved
+	 * while it's not yet materialized still contain the original tab.
+	 */
+	class LazyTab : public QWidget
+				  , public ITabWidget
+				  , public IRecoverableTab
+	{
+		Q_OBJECT
+		Q_INTERFACES (ITabWidget IRecoverableTab)
+
+		QObject * const TSMPlugin_;
+		QObject * const Plugin_;
+		const RecInfo Info_;
+	public:
+		LazyTab (QObject *tsmPlugin, QObject *plugin, const RecInfo& info);
+
+		/** Returns the plugin that should create the real tab.
+		 */
+		QObject* GetPlugin () const;
+		const RecInfo& GetRecInfo () const;
+
+		TabClassInfo GetTabClassInfo () const;
+		QObject* ParentMultiTabs ();
+		void Remove ();
+		QToolBar* GetToolBar () const;
+		void TabMadeCurrent ();
+
+		QByteArray GetTabRecoverData () const;
+		QString GetTabRecoverName () const;
+		QIcon GetTabRecoverIcon () const;
+	signals:
+		void activated ();
+		void removeRequested ();
+
+		void tabRecoverDataChanged ();
+	};
+}
+}
+
+#endif
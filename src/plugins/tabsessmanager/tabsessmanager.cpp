@@ -27,6 +27,7 @@
 #include <QMainWindow>
 #include <QtDebug>
 #include <util/util.h>
+#include <xmlsettingsdialog/xmlsettingsdialog.h>
 #include <interfaces/core/icoreproxy.h>
 #include <interfaces/core/irootwindowsmanager.h>
 #include <interfaces/core/ipluginsmanager.h>
@@ -35,6 +36,8 @@
 #include <interfaces/ihavetabs.h>
 #include "restoresessiondialog.h"
 #include "recinfo.h"
+#include "lazytab.h"
+#include "xmlsettingsmanager.h"
 
 namespace LeechCraft
 {
@@ -44,7 +47,11 @@ namespace TabSessManager
 	{
 		Util::InstallTranslator ("tabsessmanager");
 
+		XSD_.reset (new Util::XmlSettingsDialog);
+		XSD_->RegisterObject (&XmlSettingsManager::Instance (), "tabsessmanagersettings.xml");
+
 		IsScheduled_ = false;
+		LastLazyID_ = 0;
 		UncloseMenu_ = new QMenu (tr ("Unclose tabs"));
 
 		Proxy_ = proxy;
@@ -65,6 +72,12 @@ namespace TabSessManager
 					SLOT (handleRemoveTab (QWidget*)));
 		}
 
+		connect (this,
+				SIGNAL (addNewTab (const QString&, QWidget*)),
+				this,
+				SLOT (handleNewTab (const QString&, QWidget*)),
+				Qt::QueuedConnection);
+
 		SessMgrMenu_ = new QMenu (tr ("Sessions"));
 		SessMgrMenu_->addAction (tr ("Save current session..."),
 				this,
@@ -124,6 +137,23 @@ namespace TabSessManager
 		return QIcon ();
 	}
 
+	TabClasses_t Plugin::GetTabClasses () const
+	{
+		return TabClasses_t ();
+	}
+
+	void Plugin::TabOpenRequested (const QByteArray& tabClass)
+	{
+		qWarning () << Q_FUNC_INFO
+				<< "unknown tab class"
+				<< tabClass;
+	}
+
+	Util::XmlSettingsDialog_ptr Plugin::GetSettingsDialog () const
+	{
+		return XSD_;
+	}
+
 	QList<QAction*> Plugin::GetActions (ActionsEmbedPlace place) const
 	{
 		QList<QAction*> result;
@@ -183,7 +213,10 @@ namespace TabSessManager
 				if (!tw)
 					continue;
 
-				auto plugin = qobject_cast<IInfo*> (tw->ParentMultiTabs ());
+				auto lazy = qobject_cast<LazyTab*> (tab);
+				auto plugin = qobject_cast<IInfo*> (lazy ?
+						lazy->GetPlugin () :
+						tw->ParentMultiTabs ());
 				if (!plugin)
 					continue;
 
@@ -262,6 +295,13 @@ namespace TabSessManager
 			if (prevPos < tabWidget->WidgetCount () && currentIdx != prevPos)
 				tabWidget->MoveTab (currentIdx, prevPos);
 		}
+
+		const auto& lazyProp = widget->property ("TabSessManager/LazyID");
+		if (lazyProp.isValid ())
+		{
+			widget->setProperty ("TabSessManager/LazyID", QVariant ());
+			ReplaceLazyTab (widget, lazyProp.toInt ());
+		}
 	}
 
 	void Plugin::handleRemoveTab (QWidget *widget)
@@ -286,13 +326,16 @@ namespace TabSessManager
 		if (recoverData.isEmpty ())
 			return;
 
+		auto lazy = qobject_cast<LazyTab*> (widget);
 		TabUncloseInfo info
 		{
 			{
 				recoverData,
 				GetSessionProps (widget)
 			},
-			qobject_cast<IHaveRecoverableTabs*> (tab->ParentMultiTabs ())
+			qobject_cast<IHaveRecoverableTabs*> (lazy ?
+					lazy->GetPlugin () :
+					tab->ParentMultiTabs ())
 		};
 
 		const auto rootWM = Proxy_->GetRootWindowsManager ();
@@ -415,26 +458,154 @@ namespace TabSessManager
 			tabs = dia.GetPages ();
 		}
 
-		void OpenTabs (const QHash<QObject*, QList<RecInfo>>& tabs)
+		/** How long a plugin is given to create the real tab for a
+		 * placeholder before the placeholder is considered loadable
+		 * again.
+		 */
+		const int MaterializeTimeout = 15000;
+
+		/** Only the plugins that create the recovered tabs right away and
+		 * set the passed dynamic properties on them can be restored
+		 * lazily, since that's how the real tab is matched with its
+		 * placeholder.
+		 */
+		bool SupportsLazyRestore (QObject *plugin)
 		{
-			QList<QPair<IHaveRecoverableTabs*, RecInfo>> ordered;
+			static const QList<QByteArray> ids
+			{
+				"org.LeechCraft.Aggregator",
+				"org.LeechCraft.LackMan",
+				"org.LeechCraft.LMP",
+				"org.LeechCraft.Monocle",
+				"org.LeechCraft.Poshuku",
+				"org.LeechCraft.Summary"
+			};
+
+			const auto info = qobject_cast<IInfo*> (plugin);
+			return info && ids.contains (info->GetUniqueID ());
+		}
+
+		QList<QPair<QObject*, RecInfo>> GetOrderedTabs (const QHash<QObject*, QList<RecInfo>>& tabs)
+		{
+			QList<QPair<QObject*, RecInfo>> ordered;
 			Q_FOREACH (auto plugin, tabs.keys ())
 			{
-				auto ihrt = qobject_cast<IHaveRecoverableTabs*> (plugin);
-				if (!ihrt)
+				if (!qobject_cast<IHaveRecoverableTabs*> (plugin))
 					continue;
 
 				Q_FOREACH (const auto& info, tabs [plugin])
-					ordered << qMakePair (ihrt, info);
+					ordered << qMakePair (plugin, info);
 			}
 
 			std::sort (ordered.begin (), ordered.end (),
 					[] (decltype (ordered.at (0)) left, decltype (ordered.at (0)) right)
 						{ return left.second.Order_ < right.second.Order_; });
+			return ordered;
+		}
+	}
+
+	void Plugin::OpenTabs (const QHash<QObject*, QList<RecInfo>>& tabs)
+	{
+		const bool lazy = XmlSettingsManager::Instance ().property ("LazyRestore").toBool ();
+		Q_FOREACH (const auto& pair, GetOrderedTabs (tabs))
+		{
+			if (!lazy || !SupportsLazyRestore (pair.first))
+			{
+				qobject_cast<IHaveRecoverableTabs*> (pair.first)->
+						RecoverTabs ({ TabRecoverInfo { pair.second.Data_, pair.second.Props_ } });
+				continue;
+			}
+
+			auto tab = new LazyTab (this, pair.first, pair.second);
+			connect (tab,
+					SIGNAL (activated ()),
+					this,
+					SLOT (handleLazyTabActivated ()),
+					Qt::QueuedConnection);
+			connect (tab,
+					SIGNAL (removeRequested ()),
+					this,
+					SLOT (handleLazyTabRemoveRequested ()));
+
+			emit addNewTab (pair.second.Name_, tab);
+
+			WarmUpQueue_ << tab;
+		}
+
+		if (!WarmUpQueue_.isEmpty ())
+			QTimer::singleShot (0,
+					this,
+					SLOT (warmUpNext ()));
+	}
+
+	void Plugin::Materialize (LazyTab *tab)
+	{
+		if (std::find (MaterializingTabs_.begin (), MaterializingTabs_.end (), tab) !=
+				MaterializingTabs_.end ())
+			return;
+
+		auto plugin = qobject_cast<IHaveRecoverableTabs*> (tab->GetPlugin ());
+		if (!plugin)
+			return;
+
+		const auto id = ++LastLazyID_;
+		MaterializingTabs_ [id] = tab;
+
+		auto timer = new QTimer (this);
+		timer->setSingleShot (true);
+		timer->setProperty ("TabSessManager/LazyID", id);
+		connect (timer,
+				SIGNAL (timeout ()),
+				this,
+				SLOT (handleMaterializeTimeout ()));
+		timer->start (MaterializeTimeout);
+
+		const auto& info = tab->GetRecInfo ();
+		auto props = info.Props_;
+		props.append ({ "TabSessManager/LazyID", id });
+		plugin->RecoverTabs ({ TabRecoverInfo { info.Data_, props } });
+	}
 
-			Q_FOREACH (const auto& pair, ordered)
-				pair.first->RecoverTabs ({ TabRecoverInfo { pair.second.Data_, pair.second.Props_ } });
+	void Plugin::ReplaceLazyTab (QWidget *widget, int id)
+	{
+		auto lazy = MaterializingTabs_.take (id);
+		if (!lazy)
+			return;
+
+		const auto rootWM = Proxy_->GetRootWindowsManager ();
+		const auto lazyWinIdx = rootWM->GetWindowForTab (lazy);
+		const auto winIdx = rootWM->GetWindowForTab (qobject_cast<ITabWidget*> (widget));
+		if (lazyWinIdx >= 0 && lazyWinIdx == winIdx)
+		{
+			const auto tabWidget = rootWM->GetTabWidget (winIdx);
+			const auto lazyIdx = tabWidget->IndexOf (lazy);
+			const bool wasCurrent = tabWidget->CurrentIndex () == lazyIdx;
+
+			const auto currentIdx = tabWidget->IndexOf (widget);
+			const bool isRaised = tabWidget->CurrentIndex () == currentIdx;
+			if (currentIdx != lazyIdx)
+				tabWidget->MoveTab (currentIdx, lazyIdx);
+
+			// Make the real tab current before the placeholder is removed
+			// so that the tab widget doesn't activate (and thus load) some
+			// other placeholder instead. Tabs loaded in background are
+			// kept there even if their plugin raises them.
+			if (wasCurrent)
+				tabWidget->setCurrentWidget (widget);
+			else if (isRaised && tabWidget->GetPreviousWidget ())
+				tabWidget->setCurrentWidget (tabWidget->GetPreviousWidget ());
 		}
+
+		for (auto& list : Tabs_)
+			list.removeAll (lazy);
+		emit removeTab (lazy);
+		lazy->deleteLater ();
+
+		handleTabRecoverDataChanged ();
+
+		QTimer::singleShot (1000,
+				this,
+				SLOT (warmUpNext ()));
 	}
 
 	void Plugin::handleUnclose ()
@@ -546,6 +717,70 @@ namespace TabSessManager
 		OpenTabs (tabs);
 	}
 
+	void Plugin::handleLazyTabActivated ()
+	{
+		auto tab = qobject_cast<LazyTab*> (sender ());
+		if (!tab)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "sender is not a lazy tab:"
+					<< sender ();
+			return;
+		}
+
+		Materialize (tab);
+	}
+
+	void Plugin::handleLazyTabRemoveRequested ()
+	{
+		auto tab = qobject_cast<LazyTab*> (sender ());
+		if (!tab)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "sender is not a lazy tab:"
+					<< sender ();
+			return;
+		}
+
+		const auto pos = std::find (MaterializingTabs_.begin (), MaterializingTabs_.end (), tab);
+		if (pos != MaterializingTabs_.end ())
+			MaterializingTabs_.erase (pos);
+
+		handleRemoveTab (tab);
+		emit removeTab (tab);
+		tab->deleteLater ();
+	}
+
+	void Plugin::handleMaterializeTimeout ()
+	{
+		sender ()->deleteLater ();
+
+		const auto id = sender ()->property ("TabSessManager/LazyID").toInt ();
+		const auto tab = MaterializingTabs_.take (id);
+		if (!tab)
+			return;
+
+		qWarning () << Q_FUNC_INFO
+				<< "no tab has been created for"
+				<< tab->GetRecInfo ().Name_
+				<< "by"
+				<< tab->GetPlugin ();
+
+		warmUpNext ();
+	}
+
+	void Plugin::warmUpNext ()
+	{
+		const auto concurrency = XmlSettingsManager::Instance ()
+				.property ("WarmUpConcurrency").toInt ();
+		while (MaterializingTabs_.size () < concurrency && !WarmUpQueue_.isEmpty ())
+		{
+			const auto tab = WarmUpQueue_.takeFirst ();
+			if (tab)
+				Materialize (tab);
+		}
+	}
+
 	void Plugin::handleWindow (int index)
 	{
 		Tabs_ << QList<QObject*> ();
@@ -19,22 +19,31 @@
 #ifndef PLUGINS_TABSESSMANAGER_TABSESSMANAGER_H
 #define PLUGINS_TABSESSMANAGER_TABSESSMANAGER_H
 #include <QObject>
+#include <QPointer>
 #include <interfaces/iinfo.h>
 #include <interfaces/iactionsexporter.h>
+#include <interfaces/ihavetabs.h>
+#include <interfaces/ihavesettings.h>
 #include <interfaces/ihaverecoverabletabs.h>
+#include "recinfo.h"
 
 namespace LeechCraft
 {
 namespace TabSessManager
 {
+	class LazyTab;
+
 	class Plugin : public QObject
 				 , public IInfo
+				 , public IHaveTabs
+				 , public IHaveSettings
 				 , public IActionsExporter
 	{
 		Q_OBJECT
-		Q_INTERFACES (IInfo IActionsExporter)
+		Q_INTERFACES (IInfo IHaveTabs IHaveSettings IActionsExporter)
 
 		ICoreProxy_ptr Proxy_;
+		Util::XmlSettingsDialog_ptr XSD_;
 		QList<QList<QObject*>> Tabs_;
 		bool IsRecovering_;
 
@@ -49,6 +58,15 @@ namespace TabSessManager
 		QHash<QAction*, TabUncloseInfo> UncloseAct2Data_;
 
 		QMenu *UncloseMenu_;
+
+		int LastLazyID_;
+		/** Placeholders whose real tabs have been requested from their
+		 * plugins but haven't been added yet, by the ID passed to the
+		 * plugin in the TabSessManager/LazyID property. The requests
+		 * are dropped if no tab arrives in time.
+		 */
+		QHash<int, LazyTab*> MaterializingTabs_;
+		QList<QPointer<LazyTab>> WarmUpQueue_;
 	public:
 		void Init (ICoreProxy_ptr);
 		void SecondInit ();
@@ -58,12 +76,21 @@ namespace TabSessManager
 		QString GetInfo () const;
 		QIcon GetIcon () const;
 
+		TabClasses_t GetTabClasses () const;
+		void TabOpenRequested (const QByteArray&);
+
+		Util::XmlSettingsDialog_ptr GetSettingsDialog () const;
+
 		QList<QAction*> GetActions (ActionsEmbedPlace) const;
 	protected:
 		bool eventFilter (QObject*, QEvent*);
 	private:
 		QByteArray GetCurrentSession () const;
 		void AddCustomSession (const QString&);
+
+		void OpenTabs (const QHash<QObject*, QList<RecInfo>>&);
+		void Materialize (LazyTab*);
+		void ReplaceLazyTab (QWidget*, int);
 	private slots:
 		void handleNewTab (const QString&, QWidget*);
 		void handleRemoveTab (QWidget*);
@@ -75,9 +102,21 @@ namespace TabSessManager
 		void saveCustomSession ();
 		void loadCustomSession ();
 
+		void handleLazyTabActivated ();
+		void handleLazyTabRemoveRequested ();
+		void handleMaterializeTimeout ();
+		void warmUpNext ();
+
 		void handleWindow (int);
 		void handleWindowRemoved (int);
 	signals:
+		void addNewTab (const QString&, QWidget*);
+		void removeTab (QWidget*);
+		void changeTabName (QWidget*, const QString&);
+		void changeTabIcon (QWidget*, const QIcon&);
+		void statusBarChanged (QWidget*, const QString&);
+		void raiseTab (QWidget*);
+
 		void gotActions (QList<QAction*>, LeechCraft::ActionsEmbedPlace);
 	};
 }